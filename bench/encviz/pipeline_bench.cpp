@@ -0,0 +1,453 @@
+/**
+ * \file
+ * \brief Tile Pipeline Benchmarks
+ *
+ * Renders a fixed set of representative tiles (harbor, coastal, offshore)
+ * from the charts of a config file, reporting tiles per second, latency
+ * percentiles and the time spent in each stage, plus SVG icon and PNG
+ * encoding benchmarks that need no charts.
+ *
+ * Renderer chatter on stdout is discarded, results go to stderr.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <gdal.h>
+#include <encviz/enc_renderer.h>
+#include <encviz/render_profile.h>
+#include <encviz/svg_collection.h>
+#include <encviz/tile_encoder.h>
+#include <encviz/web_mercator.h>
+
+namespace fs = std::filesystem;
+using namespace encviz;
+
+/// Representative tile, around the Newport sample charts
+struct bench_tile
+{
+    /// Benchmark name
+    const char *name;
+
+    /// Tile center longitude (deg)
+    double lon;
+
+    /// Tile center latitude (deg)
+    double lat;
+
+    /// Zoom
+    int z;
+};
+
+/// Tiles rendered by BM_tile
+static const bench_tile TILES[] = {
+    {"harbor_z16", -71.3256, 41.4860, 16},
+    {"coastal_z12", -71.3900, 41.4500, 12},
+    {"offshore_z8", -70.9000, 40.6000, 8},
+};
+
+/// Renderer under test (null if the config could not be loaded)
+static std::unique_ptr<enc_renderer> renderer;
+
+/// Style rendered
+static std::string style_name = "default";
+
+/// Stage timings summed over all iterations, and iteration count, by tile
+static std::map<std::string, std::pair<render_profile, int64_t>> profiles;
+
+/// Encoded harbor tile, the PNG encoding input (empty without charts)
+static std::vector<uint8_t> harbor_png;
+
+/**
+ * Tile Containing Coordinate
+ *
+ * \param[in] lon Longitude (deg)
+ * \param[in] lat Latitude (deg)
+ * \param[in] z Zoom
+ * \param[out] x Tile column (XYZ)
+ * \param[out] y Tile row (XYZ, 0 at south)
+ */
+static void deg_to_tile(double lon, double lat, int z, int &x, int &y)
+{
+    web_mercator world(0, 0, 0);
+    OGREnvelope bbox = world.get_bbox_meters();
+    coord m = world.deg_to_meters({lon, lat});
+
+    int ntiles = 1 << z;
+    double fx = (m.x - bbox.MinX) / (bbox.MaxX - bbox.MinX);
+    double fy = (m.y - bbox.MinY) / (bbox.MaxY - bbox.MinY);
+    x = std::clamp(int(std::floor(fx * ntiles)), 0, ntiles - 1);
+    y = std::clamp(int(std::floor(fy * ntiles)), 0, ntiles - 1);
+}
+
+/**
+ * Get Percentile
+ *
+ * \param[in,out] samples Samples (reordered)
+ * \param[in] p Percentile (0-100)
+ * \return Nearest rank value
+ */
+static double percentile(std::vector<double> &samples, double p)
+{
+    if (samples.empty())
+    {
+        return 0;
+    }
+    std::size_t rank = std::min(samples.size() - 1,
+                                std::size_t(std::ceil(p / 100 * samples.size())) - 1);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return samples[rank];
+}
+
+/**
+ * Sum of Per Layer Timings
+ *
+ * \param[in] by_layer Timings (usec)
+ * \return Total (usec)
+ */
+static int64_t total_us(const std::map<std::string, int64_t> &by_layer)
+{
+    int64_t total = 0;
+    for (const auto &[layer, us] : by_layer)
+    {
+        total += us;
+    }
+    return total;
+}
+
+/// Full render and PNG encode of one tile, warm chart cache
+static void BM_tile(benchmark::State &state, const bench_tile &tile)
+{
+    if (renderer == nullptr)
+    {
+        state.SkipWithError("No charts loaded");
+        return;
+    }
+
+    int x, y;
+    deg_to_tile(tile.lon, tile.lat, tile.z, x, y);
+
+    // First render opens (or compiles) the charts
+    std::vector<uint8_t> data;
+    if (!renderer->render(data, tile_coords::XYZ, x, y, tile.z, style_name.c_str()))
+    {
+        state.SkipWithError("No chart data for tile");
+        return;
+    }
+
+    render_profile profile;
+    std::vector<double> latency_ms;
+    for (auto _ : state)
+    {
+        data.clear();
+        auto start = std::chrono::steady_clock::now();
+        renderer->render(data, tile_coords::XYZ, x, y, tile.z, style_name.c_str(),
+                         tile_format::PNG, &profile);
+        latency_ms.push_back(elapsed_us(start) / 1000.0);
+    }
+
+    // Per tile stage averages
+    auto avg_ms = [&](int64_t us) {
+        return benchmark::Counter(us / 1000.0, benchmark::Counter::kAvgIterations);
+    };
+    state.counters["tiles/s"] = benchmark::Counter(state.iterations(),
+                                                   benchmark::Counter::kIsRate);
+    state.counters["p50_ms"] = percentile(latency_ms, 50);
+    state.counters["p99_ms"] = percentile(latency_ms, 99);
+    state.counters["select_ms"] = avg_ms(profile.select_us);
+    state.counters["open_ms"] = avg_ms(profile.open_us);
+    state.counters["export_ms"] = avg_ms(total_us(profile.export_us));
+    state.counters["erase_ms"] = avg_ms(profile.erase_us);
+    state.counters["draw_ms"] = avg_ms(total_us(profile.draw_us));
+    state.counters["icon_ms"] = avg_ms(profile.icon_us);
+    state.counters["encode_ms"] = avg_ms(profile.encode_us);
+    state.counters["bytes"] = data.size();
+
+    // Keep the longest run for the per layer table
+    auto &saved = profiles[tile.name];
+    if (state.iterations() >= saved.second)
+    {
+        saved = {profile, state.iterations()};
+    }
+}
+
+/**
+ * Find Benchmark Icons
+ *
+ * \param[in] svg_root Icon directory
+ * \return SVG files under it (relative)
+ */
+static std::vector<fs::path> find_icons(const fs::path &svg_root)
+{
+    std::vector<fs::path> icons;
+    if (fs::is_directory(svg_root))
+    {
+        for (const auto &entry : fs::recursive_directory_iterator(svg_root))
+        {
+            if (entry.path().extension() == ".svg")
+            {
+                icons.push_back(fs::relative(entry.path(), svg_root));
+            }
+        }
+    }
+    std::sort(icons.begin(), icons.end());
+    return icons;
+}
+
+/// One of each bundled icon, with and without sprites
+static void BM_svg_icons(benchmark::State &state)
+{
+    fs::path svg_root = fs::path(ENCVIZ_SOURCE_DIR) / "config" / "icons";
+    std::vector<fs::path> icons = find_icons(svg_root);
+    if (icons.empty())
+    {
+        state.SkipWithError("No icons found");
+        return;
+    }
+
+    svg_collection svg;
+    svg.set_svg_path(svg_root);
+    svg.set_sprite_cache(state.range(0) != 0);
+
+    cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 256, 256);
+    cairo_t *cr = cairo_create(surface);
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < icons.size(); i++)
+        {
+            coord c = {16.0 + (i * 37) % 224, 16.0 + (i * 53) % 224};
+            svg.render_svg(cr, icons[i], c, 20, 20);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * icons.size());
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+}
+BENCHMARK(BM_svg_icons)->ArgName("sprites")->Arg(0)->Arg(1);
+
+/// Cursor for reading harbor_png into cairo
+struct png_reader
+{
+    /// Encoded image
+    const std::vector<uint8_t> *data;
+
+    /// Read position
+    std::size_t pos;
+};
+
+/**
+ * Read PNG Bytes (cairo read callback)
+ */
+static cairo_status_t read_png(void *closure, unsigned char *out, unsigned int length)
+{
+    png_reader *reader = static_cast<png_reader*>(closure);
+    if (reader->pos + length > reader->data->size())
+    {
+        return CAIRO_STATUS_READ_ERROR;
+    }
+    std::copy_n(reader->data->data() + reader->pos, length, out);
+    reader->pos += length;
+    return CAIRO_STATUS_SUCCESS;
+}
+
+/**
+ * Draw Stand-In Tile
+ *
+ * \param[out] cr Image context (256 x 256)
+ */
+static void draw_sample(cairo_t *cr)
+{
+    // Water, a shoreline with land behind it, and some contours
+    cairo_set_source_rgb(cr, 0.79, 0.89, 0.95);
+    cairo_paint(cr);
+    cairo_set_source_rgb(cr, 0.96, 0.89, 0.71);
+    cairo_move_to(cr, 0, 0);
+    for (int i = 0; i <= 64; i++)
+    {
+        cairo_line_to(cr, i * 4, 80 + 30 * std::sin(i * 0.3) + 10 * std::sin(i * 1.7));
+    }
+    cairo_line_to(cr, 256, 0);
+    cairo_close_path(cr);
+    cairo_fill_preserve(cr);
+    cairo_set_source_rgb(cr, 0.2, 0.2, 0.2);
+    cairo_stroke(cr);
+    cairo_set_source_rgb(cr, 0.4, 0.5, 0.6);
+    cairo_set_line_width(cr, 0.7);
+    for (int k = 1; k <= 4; k++)
+    {
+        for (int i = 0; i <= 64; i++)
+        {
+            double y = 80 + 35 * k + 20 * std::sin(i * 0.3 + k) + 5 * std::sin(i * 2.1);
+            if (i == 0)
+            {
+                cairo_move_to(cr, 0, y);
+            }
+            else
+            {
+                cairo_line_to(cr, i * 4, y);
+            }
+        }
+        cairo_stroke(cr);
+    }
+}
+
+/// PNG encode of the harbor tile (a drawn stand-in without charts)
+static void BM_png_encode(benchmark::State &state)
+{
+    cairo_surface_t *surface = nullptr;
+    if (!harbor_png.empty())
+    {
+        png_reader reader = {&harbor_png, 0};
+        surface = cairo_image_surface_create_from_png_stream(read_png, &reader);
+    }
+    if (surface == nullptr || cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+    {
+        if (surface != nullptr)
+        {
+            cairo_surface_destroy(surface);
+        }
+        surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 256, 256);
+        cairo_t *cr = cairo_create(surface);
+        draw_sample(cr);
+        cairo_destroy(cr);
+    }
+
+    tile_encoder encoder;
+    tile_encoder::options opts;
+    opts.png_level = state.range(0);
+    opts.png_palette = state.range(1) != 0;
+    encoder.set_options(opts);
+
+    std::vector<uint8_t> data;
+    for (auto _ : state)
+    {
+        data.clear();
+        encoder.encode(data, surface, tile_format::PNG);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["bytes"] = data.size();
+    cairo_surface_destroy(surface);
+}
+BENCHMARK(BM_png_encode)->ArgNames({"level", "palette"})
+    ->Args({1, 0})->Args({6, 0})->Args({9, 0})->Args({6, 1});
+
+/**
+ * Print Per Layer Timings
+ *
+ * \param[in] out Output
+ */
+static void print_layers(FILE *out)
+{
+    for (const auto &[name, saved] : profiles)
+    {
+        const render_profile &profile = saved.first;
+        double n = saved.second;
+        fprintf(out, "\n%s per layer (ms/tile):\n", name.c_str());
+        fprintf(out, "  %-10s %10s %10s\n", "Layer", "Export", "Draw");
+        std::map<std::string, std::pair<int64_t, int64_t>> layers;
+        for (const auto &[layer, us] : profile.export_us)
+        {
+            layers[layer].first = us;
+        }
+        for (const auto &[layer, us] : profile.draw_us)
+        {
+            layers[layer].second = us;
+        }
+        for (const auto &[layer, us] : layers)
+        {
+            fprintf(out, "  %-10s %10.3f %10.3f\n", layer.c_str(),
+                    us.first / n / 1000, us.second / n / 1000);
+        }
+    }
+}
+
+void usage(int exit_code)
+{
+    printf("Usage:\n"
+           "  encviz_bench [benchmark opts] [opts]\n"
+           "\n"
+           "Options:\n"
+           "  -h          - Show help\n"
+           "  -c <file>   - Config file with the charts (default config/config.xml)\n"
+           "  -s <name>   - Style (default default)\n"
+           "\n"
+           "See --help for benchmark options (--benchmark_filter=...)\n");
+    exit(exit_code);
+}
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+
+    std::string config_file = fs::path(ENCVIZ_SOURCE_DIR) / "config" / "config.xml";
+    int opt;
+    while ((opt = getopt(argc, argv, "hc:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                usage(0);
+                break;
+            case 'c':
+                config_file = optarg;
+                break;
+            case 's':
+                style_name = optarg;
+                break;
+            default:
+                usage(1);
+                break;
+        }
+    }
+
+    // Renderer logging would bury the results
+    fflush(stdout);
+    int stdout_fd = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDOUT_FILENO);
+    close(null_fd);
+
+    GDALAllRegister();
+    try
+    {
+        renderer = std::make_unique<enc_renderer>(config_file.c_str());
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "No charts (%s), skipping tile benchmarks\n", e.what());
+    }
+
+    if (renderer != nullptr)
+    {
+        for (const bench_tile &tile : TILES)
+        {
+            benchmark::RegisterBenchmark((std::string("BM_tile/") + tile.name).c_str(),
+                                         BM_tile, tile)->Unit(benchmark::kMillisecond);
+        }
+
+        int x, y;
+        deg_to_tile(TILES[0].lon, TILES[0].lat, TILES[0].z, x, y);
+        renderer->render(harbor_png, tile_coords::XYZ, x, y, TILES[0].z, style_name.c_str());
+    }
+
+    benchmark::ConsoleReporter reporter;
+    reporter.SetOutputStream(&std::cerr);
+    reporter.SetErrorStream(&std::cerr);
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    print_layers(stderr);
+
+    fflush(stdout);
+    dup2(stdout_fd, STDOUT_FILENO);
+    close(stdout_fd);
+    benchmark::Shutdown();
+    return 0;
+}
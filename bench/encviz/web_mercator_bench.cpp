@@ -0,0 +1,53 @@
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <encviz/web_mercator.h>
+using namespace encviz;
+
+/**
+ * Get Test Line
+ *
+ * \param[in] n Number of points
+ * \return Zig-zag line across a z10 tile near Newport (deg)
+ */
+static std::vector<coord> test_line(std::size_t n)
+{
+    std::vector<coord> pts(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        pts[i] = {-71.4 + 0.35 * i / n, 41.4 + 0.25 * (i % 2) + 0.01 * i / n};
+    }
+    return pts;
+}
+
+/// Point at a time, as the renderer used to
+static void BM_project_scalar(benchmark::State &state)
+{
+    web_mercator wm(309, 382, 10, tile_coords::XYZ);
+    std::vector<coord> in = test_line(state.range(0));
+    std::vector<coord> out(in.size());
+    for (auto _ : state)
+    {
+        for (std::size_t i = 0; i < in.size(); i++)
+        {
+            out[i] = wm.meters_to_pixels(wm.deg_to_meters(in[i]));
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * in.size());
+}
+BENCHMARK(BM_project_scalar)->Arg(64)->Arg(4096)->Arg(65536);
+
+/// Whole line at once
+static void BM_project_batch(benchmark::State &state)
+{
+    web_mercator wm(309, 382, 10, tile_coords::XYZ);
+    std::vector<coord> in = test_line(state.range(0));
+    std::vector<coord> out(in.size());
+    for (auto _ : state)
+    {
+        wm.deg_to_pixels(in.data(), out.data(), in.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * in.size());
+}
+BENCHMARK(BM_project_batch)->Arg(64)->Arg(4096)->Arg(65536);
@@ -0,0 +1,169 @@
+#pragma once
+
+/**
+ * \file
+ * \brief ENC Chart Cache
+ *
+ * Memory bounded cache of compiled ENC(S-57) charts, so repeated requests over
+ * the same cells can skip the ISO 8211 parse done by the S57 driver.
+ */
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include <encviz/chart_store.h>
+#include <encviz/memory_budget.h>
+
+namespace encviz
+{
+
+/// LRU cache of compiled charts, bounded by (estimated) byte size
+class chart_cache
+{
+public:
+
+    /// Cache usage counters
+    struct stats
+    {
+        /// Requests served by an already compiled chart
+        uint64_t hits{0};
+
+        /// Requests that had to open and parse the chart
+        uint64_t misses{0};
+
+        /// Charts dropped to stay under the size limit
+        uint64_t evictions{0};
+
+        /// Estimated size of all cached charts (bytes)
+        std::size_t bytes{0};
+
+        /// Number of charts held in the cache
+        std::size_t entries{0};
+    };
+
+    /**
+     * Constructor
+     *
+     * \param[in] max_bytes Maximum estimated size of cached charts
+     */
+    chart_cache(std::size_t max_bytes = 512 * 1024 * 1024);
+
+    chart_cache(const chart_cache &) = delete;
+    chart_cache &operator=(const chart_cache &) = delete;
+
+    /**
+     * Set Size Limit
+     *
+     * \param[in] max_bytes Maximum estimated size of cached charts (0 disables)
+     */
+    void set_max_bytes(std::size_t max_bytes);
+
+    /**
+     * Share Memory Budget
+     *
+     * \param[in] budget Budget charts count against (must outlive the cache)
+     * \param[in] weight Relative share of budget
+     */
+    void set_budget(memory_budget &budget, double weight);
+
+    /**
+     * Set Layers to Keep
+     *
+     * Charts compiled after this only hold these layers, cached ones are
+     * dropped.
+     *
+     * \param[in] keep Layer names (empty = all)
+     */
+    void set_layers(const chart_store::layer_filter &keep);
+
+    /**
+     * Open Chart (or reuse cached copy)
+     *
+     * Compiled charts are read-only, so may be used by several threads at
+     * once, and stay valid after being evicted until the last user is done.
+     *
+     * \param[in] path Path to ENC chart
+     * \param[in] version Version of chart files, a changed chart is a new entry
+     * \return Compiled chart, or null if it cannot be opened
+     */
+    std::shared_ptr<const chart_store> acquire(const std::filesystem::path &path,
+                                               uint64_t version = 0);
+
+    /**
+     * Drop Cached Chart
+     *
+     * Users holding the chart keep it until they are done.
+     *
+     * \param[in] path Path to ENC chart
+     * \param[in] version Version of chart files
+     */
+    void erase(const std::filesystem::path &path, uint64_t version = 0);
+
+    /**
+     * Get Usage Counters
+     *
+     * \return Snapshot of cache counters
+     */
+    stats get_stats() const;
+
+    /**
+     * Drop All Cached Charts
+     */
+    void clear();
+
+private:
+
+    /// Cached chart
+    struct entry
+    {
+        /// Cache key (chart path and version)
+        std::string key;
+
+        /// Compiled chart
+        std::shared_ptr<const chart_store> store;
+
+        /// Estimated size (bytes)
+        std::size_t size;
+    };
+
+    /**
+     * Evict Charts Until Under Size Limit
+     *
+     * Also evicts while over the share of the memory budget.
+     *
+     * \note Caller must hold mutex_
+     */
+    void evict();
+
+    /**
+     * Evict Charts for Memory Budget
+     */
+    void trim();
+
+    /// Protects all members below
+    mutable std::mutex mutex_;
+
+    /// Cached charts, most recently used first
+    std::list<entry> lru_;
+
+    /// Cached charts by key
+    std::unordered_map<std::string, std::list<entry>::iterator> index_;
+
+    /// Maximum estimated size (bytes)
+    std::size_t max_bytes_;
+
+    /// Layers compiled charts keep (null = all)
+    std::shared_ptr<const chart_store::layer_filter> keep_;
+
+    /// Share of the memory budget (none until attached)
+    memory_budget::client budget_;
+
+    /// Usage counters
+    stats stats_;
+};
+
+}; // ~namespace encviz
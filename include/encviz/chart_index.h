@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Chart Index
+ *
+ * Packed R-tree over chart bounding boxes, for finding the charts that
+ * cover a tile without scanning the whole catalog.
+ */
+
+#include <cstddef>
+#include <vector>
+#include <ogr_core.h>
+
+namespace encviz
+{
+
+/// Static (bulk loaded) spatial index of charts
+class chart_index
+{
+public:
+
+    /// Indexed chart
+    struct item
+    {
+        /// Chart bounding box (deg)
+        OGREnvelope bbox;
+
+        /// Compilation scale
+        int scale;
+
+        /// Caller defined chart id
+        std::size_t id;
+    };
+
+    /**
+     * Build Index
+     *
+     * Replaces any existing contents, using Sort-Tile-Recursive packing.
+     *
+     * \param[in] items Charts to index
+     */
+    void build(std::vector<item> items);
+
+    /**
+     * Find Charts
+     *
+     * \param[in] bbox Query bounding box (deg)
+     * \param[in] scale_min Minimum chart compilation scale
+     * \return Ids of intersecting charts, in ascending scale order
+     */
+    std::vector<std::size_t> query(const OGREnvelope &bbox, int scale_min) const;
+
+    /**
+     * Get Number of Indexed Charts
+     *
+     * \return Chart count
+     */
+    std::size_t size() const;
+
+    /**
+     * Remove All Charts
+     */
+    void clear();
+
+private:
+
+    /// Tree node
+    struct node
+    {
+        /// Bounds of all children
+        OGREnvelope bbox;
+
+        /// Largest compilation scale of all children
+        int scale_max;
+
+        /// First child (index into items_ for leaves, nodes_ otherwise)
+        std::size_t first;
+
+        /// Number of children
+        std::size_t count;
+
+        /// Children are items rather than nodes
+        bool leaf;
+    };
+
+    /// Maximum children per node
+    static const std::size_t node_size = 16;
+
+    /// Indexed charts, in leaf order
+    std::vector<item> items_;
+
+    /// Tree nodes, root is last
+    std::vector<node> nodes_;
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,123 @@
+#pragma once
+
+/**
+ * \file
+ * \brief ENC Chart Store
+ *
+ * Read-only, in-memory copy of an ENC(S-57) chart's features, compiled once
+ * when the chart is opened so tile exports only need envelope tests and
+ * geometry slicing.
+ */
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <gdal_priv.h>
+#include <ogrsf_frmts.h>
+#include <ogr_geometry.h>
+
+namespace encviz
+{
+
+/// Compiled chart features, safe to share between threads once built
+class chart_store
+{
+public:
+
+    /// Stored feature
+    struct feature
+    {
+        /// Attributes and geometry
+        std::unique_ptr<OGRFeature> feat;
+
+        /// Geometry bounding box (deg)
+        OGREnvelope bbox;
+    };
+
+    /// Stored layer
+    struct layer
+    {
+        /**
+         * Constructor
+         *
+         * \param[in] source Field definitions to copy
+         */
+        explicit layer(const OGRFeatureDefn *source);
+
+        /**
+         * Destructor
+         */
+        ~layer();
+
+        layer(const layer &) = delete;
+        layer &operator=(const layer &) = delete;
+
+        /// Field definitions shared by all features (referenced)
+        OGRFeatureDefn *defn;
+
+        /// Features with geometry
+        std::vector<feature> features;
+    };
+
+    /// Layers to keep (empty = all)
+    typedef std::set<std::string> layer_filter;
+
+    /**
+     * Compile Chart
+     *
+     * \param[in] ds Opened chart dataset
+     * \param[in] keep Layers to copy (M_COVR is always kept)
+     */
+    explicit chart_store(GDALDataset *ds, const layer_filter &keep = layer_filter());
+
+    chart_store(const chart_store &) = delete;
+    chart_store &operator=(const chart_store &) = delete;
+
+    /**
+     * Open and Compile Chart
+     *
+     * \param[in] path Path to ENC chart
+     * \param[in] keep Layers to copy (M_COVR is always kept)
+     * \return Compiled chart, or null if it cannot be opened
+     */
+    static std::shared_ptr<const chart_store> open(const std::filesystem::path &path,
+                                                   const layer_filter &keep = layer_filter());
+
+    /**
+     * Get Layer
+     *
+     * \param[in] name S57 layer name
+     * \return Layer, or null if the chart doesn't have it
+     */
+    const layer *get_layer(const std::string &name) const;
+
+    /**
+     * Get Chart Coverage
+     *
+     * \return Union of "coverage available" M_COVR areas (null if none)
+     */
+    const OGRGeometry *get_coverage() const;
+
+    /**
+     * Get Estimated Footprint
+     *
+     * \return Approximate memory held by the compiled features (bytes)
+     */
+    std::size_t get_size() const;
+
+private:
+
+    /// Layers by name
+    std::map<std::string, std::unique_ptr<layer>> layers_;
+
+    /// Union of "coverage available" M_COVR areas (deg)
+    std::unique_ptr<OGRGeometry> coverage_;
+
+    /// Estimated footprint (bytes)
+    std::size_t size_{0};
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,89 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Chart Directory Watcher
+ *
+ * Watches a chart directory tree with inotify and reports changed files in
+ * batches, once writes have gone quiet, so a weekly update unpacked over
+ * the tree is applied in one go rather than file by file.
+ */
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace encviz
+{
+
+class chart_watcher
+{
+public:
+
+    /// Called from the watch thread with changed, added or removed paths
+    typedef std::function<void(const std::vector<std::filesystem::path> &)> callback;
+
+    /**
+     * Constructor
+     *
+     * Starts watching right away.
+     *
+     * \param[in] root Chart directory (watched recursively)
+     * \param[in] on_change Change handler
+     * \param[in] quiet Time without changes before a batch is reported
+     */
+    chart_watcher(const std::filesystem::path &root, callback on_change,
+                  std::chrono::milliseconds quiet = std::chrono::milliseconds(2000));
+
+    /**
+     * Destructor
+     *
+     * Stops the watch thread, pending changes are dropped.
+     */
+    ~chart_watcher();
+
+    chart_watcher(const chart_watcher &) = delete;
+    chart_watcher &operator=(const chart_watcher &) = delete;
+
+private:
+
+    /**
+     * Watch Thread
+     */
+    void run();
+
+    /**
+     * Watch Directory Tree
+     *
+     * \param[in] dir Directory to watch, with all subdirectories
+     * \param[out] found Files already in the tree are added (optional)
+     */
+    void add_tree(const std::filesystem::path &dir, std::set<std::filesystem::path> *found);
+
+    /// Chart directory
+    std::filesystem::path root_;
+
+    /// Change handler
+    callback on_change_;
+
+    /// Quiet time before reporting
+    std::chrono::milliseconds quiet_;
+
+    /// inotify instance
+    int inotify_fd_;
+
+    /// Signalled to stop the watch thread (eventfd)
+    int stop_fd_;
+
+    /// Watched directories by watch descriptor (watch thread only)
+    std::map<int, std::filesystem::path> watches_;
+
+    /// Watch thread
+    std::thread thread_;
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Coverage Boundary Index
+ *
+ * Chart coverage (M_COVR) ring segments in pixel space, bucketed on a
+ * uniform grid, so polygon borders can skip edges that lie on coverage
+ * bounds with a lookup per vertex instead of GEOS predicates against
+ * every coverage polygon.
+ */
+
+#include <cstdint>
+#include <vector>
+#include <encviz/common.h>
+
+namespace encviz
+{
+
+class coverage_index
+{
+public:
+
+    /// Max distance of a point from a ring to touch it (pixels)
+    static constexpr double TOLERANCE_PX = 0.05;
+
+    /**
+     * Add Coverage Ring
+     *
+     * \param[in] ring Ring points (pixels)
+     *
+     * \note Call build() once all rings are added.
+     */
+    void add_ring(const std::vector<coord> &ring);
+
+    /**
+     * Build Grid
+     *
+     * Read-only afterwards, touches() may be called from any thread.
+     */
+    void build();
+
+    /**
+     * Remove All Rings
+     *
+     * Storage is kept for the next tile.
+     */
+    void clear();
+
+    /**
+     * Check for Rings
+     *
+     * \return True if no coverage ring was added
+     */
+    bool empty() const { return segs_.empty(); }
+
+    /**
+     * Check Point Against Coverage Bounds
+     *
+     * \param[in] c Point (pixels)
+     * \return True if within TOLERANCE_PX of any coverage ring
+     */
+    bool touches(const coord &c) const;
+
+private:
+
+    /// Ring segment
+    struct segment
+    {
+        /// Start point (pixels)
+        coord a;
+
+        /// End point (pixels)
+        coord b;
+    };
+
+    /// Smallest grid cell size (pixels)
+    static constexpr double MIN_CELL_PX = 16;
+
+    /// Most grid cells per side, cells grow past MIN_CELL_PX to fit
+    static constexpr int MAX_CELLS = 256;
+
+    /// Segments of all rings
+    std::vector<segment> segs_;
+
+    /// Grid origin (pixels)
+    coord origin_{0, 0};
+
+    /// Grid cell size (pixels)
+    double cell_{MIN_CELL_PX};
+
+    /// Grid columns and rows
+    int nx_{0}, ny_{0};
+
+    /// Offset of each cell's run in cell_segs_, plus end (row-major)
+    std::vector<uint32_t> cell_start_;
+
+    /// Segment indices, grouped by cell
+    std::vector<uint32_t> cell_segs_;
+
+    /// Next free slot of each cell's run (build scratch)
+    std::vector<uint32_t> fill_;
+
+    /**
+     * Visit Cells Near Segment
+     *
+     * \param[in] s Segment
+     * \param[in] visit Called with each cell index within tolerance
+     */
+    template <typename F>
+    void for_cells(const segment &s, F visit) const;
+};
+
+}; // ~namespace encviz
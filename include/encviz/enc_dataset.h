@@ -9,12 +9,22 @@
  * data for later handling.
  */
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <gdal_priv.h>
 #include <ogrsf_frmts.h>
 #include <ogr_geometry.h>
+#include <encviz/chart_cache.h>
+#include <encviz/chart_index.h>
+#include <encviz/render_profile.h>
+#include <encviz/scale_plan.h>
+#include <encviz/tile_data.h>
 
 namespace encviz
 {
@@ -24,6 +34,40 @@ class enc_dataset
 {
 public:
 
+    /// Chart file version, for detecting changed charts
+    struct file_stamp
+    {
+        /// Size of base cell (.000) file
+        uint64_t size{0};
+
+        /// Modification time of base cell (.000) file
+        int64_t mtime{0};
+
+        /// Hash of update (.001 - .999) file names, sizes and times
+        uint64_t updates{0};
+
+        bool operator==(const file_stamp &other) const
+        {
+            return (size == other.size) && (mtime == other.mtime) &&
+                (updates == other.updates);
+        }
+
+        /**
+         * Combined Version
+         *
+         * \return Hash of all fields (chart cache key)
+         */
+        uint64_t version() const
+        {
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            for (uint64_t field : { size, (uint64_t)mtime, updates })
+            {
+                hash = (hash ^ field) * 0x100000001b3ULL;
+            }
+            return hash;
+        }
+    };
+
     /// Per chart metadata
     struct metadata
     {
@@ -35,6 +79,34 @@ public:
 
         /// Bounding box (deg)
         OGREnvelope bbox;
+
+        /// Simplified M_COVR "coverage available" area (deg)
+        std::shared_ptr<const OGRGeometry> coverage;
+
+        /// Version of chart files this metadata was read from
+        file_stamp stamp;
+    };
+
+    /// Loaded charts and their spatial index, replaced whole when charts change
+    struct chart_set
+    {
+        /// Loaded chart metadata by chart name (stem)
+        std::map<std::string, metadata> charts;
+
+        /// Indexed charts (by chart_index id)
+        std::vector<const metadata*> indexed;
+
+        /// Spatial index of charts
+        chart_index index;
+
+        /// Chart set generation id
+        std::string generation;
+
+        /// Coverage plans by minimum scale, built on first use
+        mutable std::map<int, std::unique_ptr<scale_plan>> plans;
+
+        /// Guards plans
+        mutable std::mutex plans_mutex;
     };
 
     /**
@@ -49,6 +121,45 @@ public:
      */
     void set_cache_path(const std::filesystem::path &cache_path);
 
+    /**
+     * Set Chart Cache Size
+     *
+     * \param[in] max_bytes Maximum estimated size of open charts (0 disables)
+     */
+    void set_chart_cache_size(std::size_t max_bytes);
+
+    /**
+     * Share Memory Budget
+     *
+     * \param[in] budget Budget compiled charts count against (must outlive the dataset)
+     * \param[in] weight Relative share of budget
+     */
+    void set_memory_budget(memory_budget &budget, double weight);
+
+    /**
+     * Set Chart Layers to Keep
+     *
+     * Compiled charts only hold these layers (plus M_COVR), for a smaller
+     * footprint when styles draw a few of them.
+     *
+     * \param[in] keep Layer names (empty = all)
+     */
+    void set_chart_layers(const chart_store::layer_filter &keep);
+
+    /**
+     * Set Chart Loading Threads
+     *
+     * \param[in] nthreads Threads used to parse changed charts (0 = one per core)
+     */
+    void set_load_threads(std::size_t nthreads);
+
+    /**
+     * Get Chart Cache Counters
+     *
+     * \return Hit/miss/eviction counters of open chart cache
+     */
+    chart_cache::stats get_chart_cache_stats() const;
+
     /**
      * Clear Chart Index
      */
@@ -61,6 +172,23 @@ public:
      */
     void load_charts(const std::string &enc_root);
 
+    /**
+     * Get Chart Set Generation
+     *
+     * Changes whenever any loaded chart (or its update files) is modified.
+     *
+     * \return Generation id (hex hash of chart paths, sizes and times)
+     */
+    std::string get_generation() const;
+
+    /**
+     * Get Chart Set Version
+     *
+     * \return Count of chart set replacements, a render that saw a different
+     *         value started on charts that have since changed
+     */
+    uint64_t get_version() const;
+
     /**
      * Load Single ENC Chart
      *
@@ -70,19 +198,36 @@ public:
     bool load_chart(const std::filesystem::path &path);
 
     /**
-     * Export ENC Data to Empty Dataset
+     * Apply Changed Chart Files
      *
-     * Creates specified layers in output dataset, populating with best data
-     * available for given bounding box and minimum presentation scale.
+     * Re-reads only the cells whose base or update (.001+) files are given,
+     * adding new cells and dropping deleted ones. Directories recheck every
+     * loaded cell under them. The new chart set replaces
+     * the old one atomically, renders in progress finish on the charts they
+     * started with. Cells that fail to parse keep their previous version.
      *
-     * \param[out] ds Output dataset
+     * \param[in] files Changed, added or removed chart files or directories
+     * \param[out] changed Bounding boxes of every changed cell, old and new (deg)
+     * \return False if no chart changed
+     */
+    bool update_charts(const std::vector<std::filesystem::path> &files,
+                       std::vector<OGREnvelope> &changed);
+
+    /**
+     * Export ENC Data for a Tile
+     *
+     * Adds specified layers to the tile, populating with best data available
+     * for given bounding box and minimum presentation scale.
+     *
+     * \param[out] data Tile features
      * \param[in] layers Specified ENC layers (S57)
      * \param[in] bbox Data bounding box (deg)
      * \param[in] scale_min Minimum data compilation scale
+     * \param[out] profile Selection and export timings (optional)
      * \return False if no data available
      */
-    bool export_data(GDALDataset *ods, std::vector<std::string> layers,
-                     OGREnvelope bbox, int scale_min);
+    bool export_data(tile_data &data, const std::vector<std::string> &layers,
+                     OGREnvelope bbox, int scale_min, render_profile *profile = nullptr);
 
 	/**
 	 * Print the contents of a layer
@@ -92,85 +237,105 @@ public:
 private:
 
     /**
-     * Save Single ENC Chart To Cache
+     * Save Chart Catalog
      *
-     * \param[in] path Path to ENC chart
+     * Writes metadata of all loaded charts to a single binary file.
+     *
+     * \param[in] charts Loaded charts
      * \return False on failure
      */
-    bool save_chart_cache(const metadata &meta);
+    bool save_catalog(const std::map<std::string, metadata> &charts) const;
 
     /**
-     * Load Single ENC Chart From Cache
+     * Load Chart Catalog
      *
-     * \param[in] path Path to ENC chart
-     * \return False on failure
+     * \return Previously saved chart metadata by path (empty if none/invalid)
      */
-    bool load_chart_cache(const std::filesystem::path &path);
+    std::map<std::string, metadata> load_catalog() const;
 
     /**
-     * Load Single ENC Chart From Disk
+     * Get Chart File Version
      *
      * \param[in] path Path to ENC chart
-     * \return False on failure
+     * \return Version of chart and its update files
      */
-    bool load_chart_disk(const std::filesystem::path &path);
+    static file_stamp read_stamp(const std::filesystem::path &path);
 
     /**
-     * Get OGR Integer Field
+     * Parse ENC Chart Metadata
      *
-     * \param[in] feat OGR feature
-     * \param[in] name Field name
-     * \return Requested value
+     * Opens its own dataset handle, so may be called from several threads.
+     *
+     * \param[in] path Path to ENC chart
+     * \param[in] stamp Version of chart files
+     * \return Chart metadata
      */
-    int get_feat_field_int(OGRFeature *feat, const char *name);
+    static metadata read_chart(const std::filesystem::path &path, const file_stamp &stamp);
 
     /**
-     * Create Temporary Dataset
+     * Parse Changed ENC Charts
      *
-     * \return Created dataset
+     * Charts are read on a temporary worker pool, and merged into the index
+     * in order once all are done.
+     *
+     * \param[in] cells Chart paths and file versions
+     * \param[in,out] charts Charts by name, parsed charts are added
      */
-    std::unique_ptr<GDALDataset> create_temp_dataset();
+    void read_charts(const std::vector<std::pair<std::filesystem::path, file_stamp>> &cells,
+                     std::map<std::string, metadata> &charts);
 
     /**
-     * Create Layer
+     * Get Current Chart Set
      *
-     * \param[out] ds Dataset for layer
-     * \param[in] name Name of layer
-     * \return Created dataset
+     * \return Chart set, stays valid while held
      */
-    OGRLayer *create_layer(GDALDataset *ds, const char *name);
+    std::shared_ptr<const chart_set> snapshot() const;
 
     /**
-     * Copy ENC Chart Coverage
+     * Index and Publish Chart Set
+     *
+     * Builds the spatial index and generation id, then replaces the current
+     * chart set.
      *
-     * \param[out] layer Output layer
-     * \param[in] ds Input dataset
+     * \param[in] next New chart set (charts filled in)
      */
-    void copy_chart_coverage(OGRLayer *layer, GDALDataset *ds);
+    void publish(std::shared_ptr<chart_set> next);
 
     /**
-     * Clear Layer Features
+     * Get Scale Band Plan
      *
-     * \param[out] layer OGR layer
+     * \param[in] set Chart set the plan belongs to
+     * \param[in] scale_min Minimum chart compilation scale
+     * \return Plan of charts at or above scale_min, valid while set is held
      */
-    void clear_layer(OGRLayer *layer);
+    scale_plan &get_plan(const chart_set &set, int scale_min) const;
 
     /**
-     * Bounding Box to Layer Feature
+     * Get OGR Integer Field
      *
-     * \param[out] layer GDAL output layer
-     * \param[in] bbox OGR Envelope
+     * \param[in] feat OGR feature
+     * \param[in] name Field name
+     * \return Requested value
      */
-    void create_bbox_feature(OGRLayer *layer, const OGREnvelope &bbox);
+    static int get_feat_field_int(OGRFeature *feat, const char *name);
+
+    /// Current chart set (read and replaced with std::atomic_load/store)
+    std::shared_ptr<const chart_set> set_;
 
-    /// Loaded chart metadata by chart name (stem)
-    std::map<std::string, metadata> charts_;
+    /// Chart set replacements so far
+    std::atomic<uint64_t> version_{0};
+
+    /// Serializes chart set changes (readers never take it)
+    std::mutex update_mutex_;
 
     /// Chart data cache location
     std::filesystem::path cache_;
 
-    /// GDAL memory driver handle
-    GDALDriver *mem_drv_;
+    /// Threads used to parse charts (0 = one per core)
+    std::size_t load_threads_{0};
+
+    /// Recently opened charts
+    mutable chart_cache chart_cache_;
 };
 
 }; // ~namespace encviz
@@ -8,13 +8,26 @@
  */
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <filesystem>
 #include <cairo.h>
+#include <encviz/chart_watcher.h>
+#include <encviz/coverage_index.h>
 #include <encviz/enc_dataset.h>
+#include <encviz/label_font.h>
+#include <encviz/memory_budget.h>
+#include <encviz/metrics.h>
+#include <encviz/mvt_encoder.h>
+#include <encviz/render_context.h>
+#include <encviz/render_profile.h>
 #include <encviz/style.h>
 #include <encviz/web_mercator.h>
+#include <encviz/single_flight.h>
 #include <encviz/svg_collection.h>
+#include <encviz/tile_cache.h>
+#include <encviz/tile_data.h>
+#include <encviz/tile_encoder.h>
 
 namespace encviz
 {
@@ -33,19 +46,284 @@ public:
     /**
      * Render Chart Data
      *
-     * \param[out] data PNG bytestream
+     * \param[out] data Encoded image bytestream
      * \param[in] tc Tile coordinate system (WMTS or XYZ)
      * \param[in] x Tile X coordinate (horizontal)
      * \param[in] y Tile Y coordinate (vertical)
      * \param[in] z Tile Z coordinate (zoom)
      * \param[in] style_name Name of style
+     * \param[in] fmt Tile format (MVT builds a vector tile)
+     * \param[out] profile Stage timings, added to (optional)
      * \return False if no data to render
+     *
+     * \note Safe to call from multiple threads at once. Each render reads
+     *       an enc_dataset::snapshot() of the chart index and shared,
+     *       immutable compiled charts, so charts may be swapped while a
+     *       render is in flight; it finishes on the ones it started with.
      */
     bool render(std::vector<uint8_t> &data, tile_coords tc,
-                int x, int y, int z, const char *style_name);
+                int x, int y, int z, const char *style_name,
+                tile_format fmt = tile_format::PNG,
+                render_profile *profile = nullptr);
+
+    /**
+     * Check Style
+     *
+     * \param[in] style_name Name of style
+     * \return True if the style is configured
+     */
+    bool has_style(const std::string &style_name) const;
+
+    /**
+     * Look Up Cached Tile
+     *
+     * \param[in] tc Tile coordinate system (WMTS or XYZ)
+     * \param[in] x Tile X coordinate (horizontal)
+     * \param[in] y Tile Y coordinate (vertical)
+     * \param[in] z Tile Z coordinate (zoom)
+     * \param[in] style_name Name of style
+     * \param[in] fmt Image format
+     * \param[in] as_file Disk cache hits may be an open file to send (tile->fd)
+     * \return Cached tile, or null if it must be rendered
+     */
+    tile_ptr cached_tile(tile_coords tc, int x, int y, int z,
+                         const char *style_name,
+                         tile_format fmt = tile_format::PNG,
+                         bool as_file = false);
+
+    /**
+     * Get Tile, Rendering and Caching if Needed
+     *
+     * \param[out] tile Encoded tile
+     * \param[in] tc Tile coordinate system (WMTS or XYZ)
+     * \param[in] x Tile X coordinate (horizontal)
+     * \param[in] y Tile Y coordinate (vertical)
+     * \param[in] z Tile Z coordinate (zoom)
+     * \param[in] style_name Name of style
+     * \param[in] fmt Image format
+     * \return False if no data to render
+     */
+    bool get_tile(tile_ptr &tile, tile_coords tc, int x, int y, int z,
+                  const char *style_name, tile_format fmt = tile_format::PNG);
+
+    /**
+     * Get Every Tile of a Metatile
+     *
+     * The metatile is rendered once and all of its tiles handed back, so
+     * callers writing each of them (ie - archive seeding) don't rely on the
+     * tile cache keeping them. Without metatiles this is the one tile.
+     *
+     * \param[out] tiles Tiles with data (XYZ keys)
+     * \param[in] x Tile X coordinate of any tile in the metatile (XYZ)
+     * \param[in] y Tile Y coordinate of any tile in the metatile (XYZ)
+     * \param[in] z Tile Z coordinate (zoom)
+     * \param[in] style_name Name of style
+     * \param[in] fmt Tile format
+     * \return False if no tile has data
+     */
+    bool get_metatile_tiles(std::vector<std::pair<tile_key, tile_ptr>> &tiles,
+                            int x, int y, int z, const char *style_name,
+                            tile_format fmt = tile_format::PNG);
+
+    /**
+     * Apply Changed Chart Files
+     *
+     * Re-indexes the changed cells and drops the cached tiles over them (all
+     * zooms, one tile of margin). Renders in progress finish on the charts
+     * they started with, and are not cached.
+     *
+     * \param[in] files Changed, added or removed chart files or directories
+     *
+     * \note Called from the chart watch thread when watch_charts is on.
+     */
+    void update_charts(const std::vector<std::filesystem::path> &files);
+
+    /**
+     * Get Tile Cache Counters
+     *
+     * \return Tile cache usage counters
+     */
+    tile_cache::stats get_tile_cache_stats() const;
+
+    /**
+     * Get Chart Set Generation
+     *
+     * \return Generation id of the loaded charts
+     */
+    std::string get_generation() const;
+
+    /**
+     * Get Metatile Size
+     *
+     * \return Tiles per metatile side (1 = off)
+     */
+    int get_metatile_size() const;
+
+    /**
+     * Check Disk Tile Cache
+     *
+     * \return False if rendered tiles are only kept in memory
+     */
+    bool has_tile_disk_cache() const;
+
+    /**
+     * Get Coalesced Request Count
+     *
+     * \return Tile requests that waited on a render already in progress
+     */
+    uint64_t get_joined_renders() const;
+
+    /**
+     * Write Prometheus Metrics
+     *
+     * Render stage and per layer latency histograms, plus tile and chart
+     * cache counters.
+     *
+     * \param[out] out Text exposition is appended
+     */
+    void write_metrics(std::string &out) const;
 
 private:
 
+    /// Per feature render routine (see renderer_for())
+    typedef void (enc_renderer::*feature_renderer)(cairo_t *cr, const tile_feature &feat,
+                                                   const web_mercator &wm,
+                                                   const layer_style &style,
+                                                   const coverage_index *coverage);
+
+    /**
+     * Get Render Routine for Object Class
+     *
+     * \param[in] object_class S57 object class of layer
+     * \return Routine to render each feature of the layer
+     */
+    static feature_renderer renderer_for(S57Class object_class);
+
+    /**
+     * Render Feature Geometry Only
+     *
+     * \param[out] cr Image context
+     * \param[in] feat Tile feature
+     * \param[in] wm Web Mercator point mapper
+     * \param[in] style Feature style
+     * \param[in] coverage Lines will not be rendered where they lie on
+     *                     coverage bounds
+     */
+    void draw_basic(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                    const layer_style &style, const coverage_index *coverage);
+
+    /**
+     * Render Coverage (M_COVR) Borders
+     *
+     * \copydetails draw_basic
+     */
+    void draw_coverage(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                       const layer_style &style, const coverage_index *coverage);
+
+    /**
+     * Render Depth Area (DEPARE, DRGARE)
+     *
+     * \copydetails draw_basic
+     */
+    void draw_depare(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                     const layer_style &style, const coverage_index *coverage);
+
+    /**
+     * Render Feature Geometry, Then a Symbol
+     *
+     * \tparam G Geometry type the symbol renderer takes
+     * \tparam symbol Symbol renderer
+     * \copydetails draw_basic
+     */
+    template <typename G, void (enc_renderer::*symbol)(cairo_t *, const G *,
+                                                       const web_mercator &,
+                                                       const layer_style &,
+                                                       const OGRFeature *)>
+    void draw_symbol(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                     const layer_style &style, const coverage_index *coverage);
+
+    /**
+     * Build Vector Tile
+     *
+     * Features of the style's layers, unstyled, so one tile serves every
+     * style variant on the client.
+     *
+     * \param[out] data Encoded MVT bytes
+     * \param[in] tc Tile coordinate system (WMTS or XYZ)
+     * \param[in] x Tile X coordinate (horizontal)
+     * \param[in] y Tile Y coordinate (vertical)
+     * \param[in] z Tile Z coordinate (zoom)
+     * \param[in] style_name Name of style (selects layers only)
+     * \param[out] profile Stage timings, added to (optional)
+     * \return False if no data in tile
+     */
+    bool render_vector(std::vector<uint8_t> &data, tile_coords tc,
+                       int x, int y, int z, const char *style_name,
+                       render_profile *profile);
+
+    /**
+     * Minimum Display Scale for Zoom
+     *
+     * \param[in] z Tile Z coordinate (zoom)
+     * \return Smallest chart compilation scale used at this zoom
+     */
+    static int min_display_scale(int z);
+
+    /**
+     * Render Chart Data to an Image
+     *
+     * \param[in] tc Tile coordinate system (WMTS or XYZ)
+     * \param[in] x Tile X coordinate (horizontal)
+     * \param[in] y Tile Y coordinate (vertical)
+     * \param[in] z Tile Z coordinate (zoom)
+     * \param[in] span Tiles per side (see web_mercator)
+     * \param[in] style_name Name of style
+     * \param[out] profile Stage timings, added to (optional)
+     * \return Context holding the ARGB32 image of (span * tile_size) pixels
+     *         per side, or null if no data to render
+     */
+    render_context_pool::lease render_surface(tile_coords tc, int x, int y, int z,
+                                              int span, const char *style_name,
+                                              render_profile *profile = nullptr);
+
+    /**
+     * Get Tile by Rendering its Metatile
+     *
+     * All tiles of the metatile are encoded and cached, concurrent requests
+     * for any of them wait on the one render.
+     *
+     * \param[out] tile Encoded tile
+     * \param[in] key Requested tile (XYZ)
+     * \return False if no data to render
+     */
+    bool get_metatile(tile_ptr &tile, const tile_key &key);
+
+    /// Encoded metatile tiles, row-major from the bottom left (null if empty)
+    typedef std::shared_ptr<const std::vector<tile_ptr>> metatile_ptr;
+
+    /**
+     * Render Metatile
+     *
+     * \param[in] meta Bottom left tile of the metatile (XYZ)
+     * \param[in] span Tiles per side
+     * \return Encoded tiles, row-major from the bottom left (null if empty)
+     */
+    metatile_ptr render_metatile(const tile_key &meta, int span);
+
+    /**
+     * Build Tile Cache Key
+     *
+     * \param[in] tc Tile coordinate system (WMTS or XYZ)
+     * \param[in] x Tile X coordinate (horizontal)
+     * \param[in] y Tile Y coordinate (vertical)
+     * \param[in] z Tile Z coordinate (zoom)
+     * \param[in] style_name Name of style
+     * \param[in] fmt Image format
+     * \return Cache key in XYZ coordinates
+     */
+    tile_key make_tile_key(tile_coords tc, int x, int y, int z,
+                           const char *style_name, tile_format fmt) const;
+
     /**
      * Render Feature Geometry
      *
@@ -54,13 +332,13 @@ private:
      * \param[in] wm Web Mercator point mapper
      * \param[in] style Feature style
      * \param[out] phase Phase tracking for multi-line strings
-     * \param[in] coverage_polygons Lines will not be rendered where they overlap with
-     *                              with coverage bounds
+     * \param[in] coverage Lines will not be rendered where they lie on
+     *                     coverage bounds
      */
     void render_geo(cairo_t *cr, const OGRGeometry *geo,
                     const web_mercator &wm, const layer_style &style,
                     double &phase,
-                    OGRGeometry *coverage_polygons);
+                    const coverage_index *coverage);
 
     /**
      * Render multi-polygons
@@ -144,12 +422,12 @@ private:
      * \param[in] geo Feature geometry
      * \param[in] wm Web Mercator point mapper
      * \param[in] style Feature style
-     * \param[in] coverage_polygons Lines will not be rendered where they overlap with
-     *                              with coverage bounds
+     * \param[in] coverage Lines will not be rendered where they lie on
+     *                     coverage bounds
      */
     void render_poly_borders(cairo_t *cr, const OGRPolygon *geo,
                              const web_mercator &wm, const layer_style &style,
-                             const OGRGeometry *coverage_polygons = nullptr);
+                             const coverage_index *coverage = nullptr);
 
     /**
      * Render depth areas with special colors
@@ -274,15 +552,54 @@ private:
     /// Min display scale at zoom=0
     double min_scale0_;
 
+    /// Memory limit shared by the caches below (declared first, so it outlives them)
+    memory_budget budget_;
+
     /// Chart collection
     enc_dataset enc_;
 
     /// Svg Collection
     svg_collection svg_;
 
+    /// Sounding label font
+    label_font sounding_font_{"monospace", CAIRO_FONT_WEIGHT_NORMAL, 10};
+
+    /// Place name label font
+    label_font name_font_{"monospace", CAIRO_FONT_WEIGHT_BOLD, 10};
+
     /// Loaded styles
     std::map<std::string, render_style> styles_;
 
+    /// Rendered tiles
+    tile_cache tiles_;
+
+    /// Tile image encoder
+    tile_encoder encoder_;
+
+    /// Vector tile settings
+    mvt_encoder::options mvt_opts_;
+
+    /// Line and ring simplification tolerance (pixels, 0 = duplicates only)
+    double simplify_px_{0.5};
+
+    /// Tiles per metatile side (1 = render tiles individually)
+    int metatile_size_{1};
+
+    /// Tile renders in progress
+    single_flight<tile_ptr> renders_;
+
+    /// Metatile renders in progress
+    single_flight<metatile_ptr> metatiles_;
+
+    /// Render stage histograms
+    render_metrics metrics_;
+
+    /// Reusable tile surfaces, one per concurrent render
+    render_context_pool contexts_;
+
+    /// Chart directory watch (null if off), last so it stops first
+    std::unique_ptr<chart_watcher> watcher_;
+
 };
 
 }; // ~namespace encviz
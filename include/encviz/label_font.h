@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Label Font
+ *
+ * Scaled font created once and shared by all render threads. Digits and the
+ * minus sign are shaped at construction, so sounding labels are laid out by
+ * table lookup and drawn with cairo_show_glyphs, bypassing the toy font
+ * lookup and text shaping of cairo_show_text.
+ */
+
+#include <vector>
+#include <cairo.h>
+
+namespace encviz
+{
+
+class label_font
+{
+public:
+
+    /**
+     * Constructor
+     *
+     * \param[in] family Font family (ie - "monospace")
+     * \param[in] weight Font weight
+     * \param[in] size Font size (pixels)
+     */
+    label_font(const char *family, cairo_font_weight_t weight, double size);
+
+    /**
+     * Destructor
+     */
+    ~label_font();
+
+    label_font(const label_font &) = delete;
+    label_font &operator=(const label_font &) = delete;
+
+    /**
+     * Lay Out Text
+     *
+     * Strings of digits and '-' come from the pre-shaped table, anything
+     * else is shaped by cairo.
+     *
+     * \param[in] text UTF-8 text
+     * \param[out] glyphs Glyphs positioned from a (0,0) origin
+     * \param[out] extents Ink extents, as from cairo_text_extents
+     */
+    void layout(const char *text, std::vector<cairo_glyph_t> &glyphs,
+                cairo_text_extents_t &extents) const;
+
+    /**
+     * Draw Laid Out Text
+     *
+     * \param[out] cr Image context (identity transform)
+     * \param[in] glyphs Glyphs from layout()
+     * \param[in] x Origin X (pixels)
+     * \param[in] y Origin Y, baseline (pixels)
+     */
+    void show(cairo_t *cr, const std::vector<cairo_glyph_t> &glyphs,
+              double x, double y) const;
+
+private:
+
+    /// Pre-shaped character
+    struct shaped_char
+    {
+        /// Glyph index in the font
+        unsigned long index{0};
+
+        /// Ink extents of the glyph alone
+        cairo_text_extents_t extents{};
+    };
+
+    /// Characters shaped at construction, in order
+    static constexpr const char *SHAPED = "0123456789-";
+
+    /// Number of shaped characters
+    static const int NSHAPED = 11;
+
+    /**
+     * Look Up Shaped Character
+     *
+     * \param[in] ch Character
+     * \return Index in shaped_, -1 if not shaped
+     */
+    static int shaped_index(char ch);
+
+    /// Font face
+    cairo_font_face_t *face_;
+
+    /// Scaled font (thread safe, cairo locks its glyph cache)
+    cairo_scaled_font_t *font_;
+
+    /// Shaped characters
+    shaped_char shaped_[NSHAPED];
+};
+
+}; // ~namespace encviz
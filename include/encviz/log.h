@@ -0,0 +1,74 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Logging
+ *
+ * Level filtered messages on stdout. Disabled levels cost one relaxed atomic
+ * load, arguments are not even evaluated, so per tile and per request
+ * messages can stay in the hot path at debug level.
+ */
+
+#include <atomic>
+#include <string>
+
+namespace encviz
+{
+
+/// Message severity, more verbose levels last
+enum class log_level
+{
+    error,  ///< Failures
+    warn,   ///< Degraded operation
+    info,   ///< Startup and summary messages (default)
+    debug,  ///< Per tile and per request detail
+};
+
+/// Most verbose level printed
+extern std::atomic<int> log_threshold;
+
+/**
+ * Check Log Level
+ *
+ * \param[in] level Message severity
+ * \return True if messages of this level are printed
+ */
+inline bool log_enabled(log_level level)
+{
+    return static_cast<int>(level) <= log_threshold.load(std::memory_order_relaxed);
+}
+
+/**
+ * Set Log Level
+ *
+ * \param[in] level Most verbose level printed
+ */
+void set_log_level(log_level level);
+
+/**
+ * Parse Log Level
+ *
+ * \param[in] name Level name ("error", "warn", "info", "debug")
+ * \param[out] level Parsed level
+ * \return False if not a level name
+ */
+bool parse_log_level(const std::string &name, log_level &level);
+
+/**
+ * Print Log Message (printf style)
+ *
+ * \param[in] fmt Format string
+ */
+void log_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+}; // ~namespace encviz
+
+/// Print a message if its level is enabled (ENCVIZ_LOG(debug, "x=%d\n", x))
+#define ENCVIZ_LOG(level, ...)                                          \
+    do                                                                  \
+    {                                                                   \
+        if (encviz::log_enabled(encviz::log_level::level))              \
+        {                                                               \
+            encviz::log_printf(__VA_ARGS__);                            \
+        }                                                               \
+    } while (0)
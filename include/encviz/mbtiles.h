@@ -0,0 +1,114 @@
+#pragma once
+
+/**
+ * \file
+ * \brief MBTiles Archive
+ *
+ * Tile archive in an SQLite database, following the MBTiles 1.3 layout.
+ */
+
+#include <mutex>
+#include <encviz/tile_archive.h>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace encviz
+{
+
+/// MBTiles archive being written
+class mbtiles_writer : public tile_archive_writer
+{
+public:
+
+    /**
+     * Constructor
+     *
+     * \param[in] path Database to create
+     * \param[in] info Archive description
+     * \param[in] keep_existing Add to existing database instead of replacing it
+     * \throw std::runtime_error if it cannot be created
+     */
+    mbtiles_writer(const std::filesystem::path &path, const archive_info &info,
+                   bool keep_existing);
+
+    /**
+     * Destructor (finishes archive)
+     */
+    ~mbtiles_writer() override;
+
+    mbtiles_writer(const mbtiles_writer &) = delete;
+    mbtiles_writer &operator=(const mbtiles_writer &) = delete;
+
+    void put(int z, int x, int y, const std::vector<uint8_t> &data) override;
+    void flush() override;
+    void finish() override;
+    bool can_resume() const override;
+
+private:
+
+    /**
+     * Run SQL Statement
+     *
+     * \param[in] sql Statement text
+     * \throw std::runtime_error on SQL error
+     */
+    void exec(const char *sql);
+
+    /// Serializes database access
+    std::mutex mutex_;
+
+    /// Database handle
+    sqlite3 *db_{nullptr};
+
+    /// Prepared tile insert
+    sqlite3_stmt *insert_{nullptr};
+
+    /// Tiles added since the last commit
+    std::size_t pending_{0};
+};
+
+/// MBTiles archive being served
+class mbtiles_reader : public tile_archive_reader
+{
+public:
+
+    /**
+     * Constructor
+     *
+     * \param[in] path Database to open
+     * \throw std::runtime_error if it cannot be opened
+     */
+    explicit mbtiles_reader(const std::filesystem::path &path);
+
+    /**
+     * Destructor
+     */
+    ~mbtiles_reader() override;
+
+    mbtiles_reader(const mbtiles_reader &) = delete;
+    mbtiles_reader &operator=(const mbtiles_reader &) = delete;
+
+    bool get(int z, int x, int y, archive_tile &tile) const override;
+    tile_format get_format() const override;
+    time_t get_modified() const override;
+
+private:
+
+    /// Serializes database access
+    mutable std::mutex mutex_;
+
+    /// Database handle
+    sqlite3 *db_{nullptr};
+
+    /// Prepared tile lookup
+    sqlite3_stmt *select_{nullptr};
+
+    /// Image format (from metadata)
+    tile_format format_{tile_format::PNG};
+
+    /// Database modification time
+    time_t modified_{0};
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,227 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Memory Budget
+ *
+ * One memory limit shared by the caches (compiled charts, rendered tiles,
+ * icon sprites, idle render surfaces), for deployments where the separate
+ * cache limits can't be tuned to the machine. Each cache reports its size
+ * and gets a share of the limit by weight. While the total is over the
+ * limit, the caches holding more than their share shed their least
+ * recently used entries, so a busy cache may borrow memory an idle one
+ * isn't using.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace encviz
+{
+
+class memory_budget
+{
+public:
+
+    /// Drops entries of a cache while it is over its share (see over())
+    typedef std::function<void()> trim_fn;
+
+    /// Cache footprint (for metrics)
+    struct usage
+    {
+        /// Cache name
+        std::string name;
+
+        /// Reported size (bytes)
+        std::size_t bytes;
+
+        /// Share of limit (bytes, 0 = no limit)
+        std::size_t share;
+
+        /// Times the cache was trimmed by enforce()
+        uint64_t trims;
+    };
+
+    /**
+     * Cache's Registration
+     *
+     * Holds the budget plumbing every cache needs, and does nothing until
+     * attached. The trim callback runs with the budget locked and takes the
+     * cache's own lock, so to keep the lock order one way round attach()
+     * and enforce() must be called without the cache locked. report() and
+     * over() are lock free, safe to call with it held.
+     */
+    class client
+    {
+    public:
+
+        client() = default;
+
+        client(const client &) = delete;
+        client &operator=(const client &) = delete;
+
+        /**
+         * Register With Budget
+         *
+         * \param[in] budget Budget to count against (must outlive the client)
+         * \param[in] name Cache name (for metrics)
+         * \param[in] weight Relative share of limit
+         * \param[in] trim Sheds entries while the cache is over its share
+         *
+         * \note Call without the cache's lock held.
+         */
+        void attach(memory_budget &budget, const std::string &name, double weight,
+                    trim_fn trim);
+
+        /**
+         * Report Cache Size
+         *
+         * \param[in] bytes Current size (bytes)
+         */
+        void report(std::size_t bytes);
+
+        /**
+         * Check Cache Should Shed
+         *
+         * \return True if the total is over the limit and the cache over its share
+         */
+        bool over() const;
+
+        /**
+         * Let Caches Over Their Share Shed
+         *
+         * Call after growing the cache, other caches may have to give way.
+         *
+         * \note Call without the cache's lock held, this cache may be trimmed.
+         */
+        void enforce();
+
+    private:
+
+        /// Budget counted against (null until attached)
+        memory_budget *budget_{nullptr};
+
+        /// Cache id in budget_
+        int id_{-1};
+    };
+
+    memory_budget() = default;
+
+    memory_budget(const memory_budget &) = delete;
+    memory_budget &operator=(const memory_budget &) = delete;
+
+    /**
+     * Set Limit
+     *
+     * \param[in] max_bytes Total size of all caches (0 disables)
+     */
+    void set_limit(std::size_t max_bytes);
+
+    /**
+     * Get Limit
+     *
+     * \return Total size of all caches (0 = no limit)
+     */
+    std::size_t get_limit() const;
+
+    /**
+     * Register Cache
+     *
+     * \param[in] name Cache name (for metrics)
+     * \param[in] weight Relative share of limit
+     * \param[in] trim Sheds entries while the cache is over its share,
+     *                 called without any lock of the cache held
+     * \return Cache id
+     */
+    int add(const std::string &name, double weight, trim_fn trim);
+
+    /**
+     * Report Cache Size
+     *
+     * Lock free, safe to call with the cache locked.
+     *
+     * \param[in] id Cache id
+     * \param[in] bytes Current size (bytes)
+     */
+    void update(int id, std::size_t bytes);
+
+    /**
+     * Check Cache Should Shed
+     *
+     * \param[in] id Cache id
+     * \return True if the total is over the limit and the cache over its share
+     */
+    bool over(int id) const;
+
+    /**
+     * Trim Caches Over Their Share
+     *
+     * Call after growing a cache, with none of its locks held. Does nothing
+     * under the limit, or if another thread is already trimming.
+     */
+    void enforce();
+
+    /**
+     * Get Cache Footprints
+     *
+     * \return Registered caches
+     */
+    std::vector<usage> get_usage() const;
+
+private:
+
+    /// Most caches that can be registered
+    static constexpr int MAX_CACHES = 8;
+
+    /// Registered cache
+    struct cache
+    {
+        /// Cache name
+        std::string name;
+
+        /// Relative share of limit
+        double weight{0};
+
+        /// Entry shedding callback
+        trim_fn trim;
+
+        /// Reported size (bytes)
+        std::atomic<std::size_t> bytes{0};
+
+        /// Times trimmed by enforce()
+        std::atomic<uint64_t> trims{0};
+    };
+
+    /**
+     * Share of Limit
+     *
+     * \param[in] id Cache id
+     * \return Bytes the cache may keep while over the limit
+     */
+    std::size_t share(int id) const;
+
+    /// Total size of all caches (bytes, 0 = no limit)
+    std::atomic<std::size_t> limit_{0};
+
+    /// Sum of reported sizes (bytes)
+    std::atomic<std::size_t> total_{0};
+
+    /// Sum of cache weights
+    std::atomic<double> weights_{0};
+
+    /// Registered caches, entries below count_ are never modified
+    cache caches_[MAX_CACHES];
+
+    /// Number of registered caches
+    std::atomic<int> count_{0};
+
+    /// Serializes registration and trimming
+    std::mutex mutex_;
+};
+
+}; // ~namespace encviz
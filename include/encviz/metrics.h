@@ -0,0 +1,145 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Render Metrics
+ *
+ * Latency histograms of the render stages, exported in the Prometheus text
+ * format. Recording is lock-free: each histogram is split in per-thread
+ * shards of relaxed atomic counters, which are only summed when scraped.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <encviz/render_profile.h>
+
+namespace encviz
+{
+
+/// Latency histogram with fixed buckets
+class histogram
+{
+public:
+
+    /// Number of finite buckets
+    static const int NBUCKETS = 16;
+
+    /// Bucket upper bounds (usec)
+    static const std::array<int64_t, NBUCKETS> BOUNDS_US;
+
+    /// Summed counts
+    struct snapshot
+    {
+        /// Observations per bucket, last is above all bounds (not cumulative)
+        std::array<uint64_t, NBUCKETS + 1> buckets{};
+
+        /// Number of observations
+        uint64_t count{0};
+
+        /// Sum of observations (usec)
+        int64_t sum_us{0};
+    };
+
+    /**
+     * Record Observation
+     *
+     * \param[in] usec Duration (usec)
+     */
+    void observe(int64_t usec);
+
+    /**
+     * Sum Shards
+     *
+     * \return Counts so far (shards read one at a time, not atomically)
+     */
+    snapshot read() const;
+
+private:
+
+    /// Number of shards, threads beyond this share them
+    static const int NSHARDS = 16;
+
+    /// Counters written by one thread (own cache lines)
+    struct alignas(64) shard
+    {
+        std::atomic<uint64_t> buckets[NBUCKETS + 1] = {};
+        std::atomic<uint64_t> count{0};
+        std::atomic<int64_t> sum_us{0};
+    };
+
+    /// Counter shards
+    std::array<shard, NSHARDS> shards_;
+};
+
+/// Render stage histograms
+class render_metrics
+{
+public:
+
+    render_metrics() = default;
+    render_metrics(const render_metrics &) = delete;
+    render_metrics &operator=(const render_metrics &) = delete;
+
+    /**
+     * Add Layer Histograms
+     *
+     * \param[in] layers Style layer names (duplicates ignored)
+     *
+     * \note Not thread safe, call before rendering starts.
+     */
+    void add_layers(const std::vector<std::string> &layers);
+
+    /**
+     * Record Render
+     *
+     * \param[in] profile Stage timings of the render
+     * \param[in] total_us Duration of the whole render (usec)
+     */
+    void record(const render_profile &profile, int64_t total_us);
+
+    /**
+     * Write Prometheus Text
+     *
+     * \param[out] out Text exposition is appended
+     */
+    void write(std::string &out) const;
+
+private:
+
+    /// Stages, in output order
+    enum stage
+    {
+        STAGE_RENDER,
+        STAGE_SELECT,
+        STAGE_OPEN,
+        STAGE_CLIP,
+        STAGE_ERASE,
+        STAGE_ICONS,
+        STAGE_ENCODE,
+        STAGE_COUNT
+    };
+
+    /// Histogram per stage
+    std::array<histogram, STAGE_COUNT> stages_;
+
+    /// Histogram per style layer (draw time, read-only once rendering)
+    std::map<std::string, std::unique_ptr<histogram>> layers_;
+};
+
+/**
+ * Write Prometheus Histogram
+ *
+ * \param[out] out Text exposition is appended
+ * \param[in] name Metric name
+ * \param[in] labels Label set without braces (ie - stage="select"), may be empty
+ * \param[in] counts Histogram counts
+ */
+void write_histogram(std::string &out, const std::string &name,
+                     const std::string &labels, const histogram::snapshot &counts);
+
+}; // ~namespace encviz
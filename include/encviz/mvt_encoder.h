@@ -0,0 +1,194 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Vector Tile Encoder
+ *
+ * Builds Mapbox Vector Tiles (MVT 2.1) from exported tile features, so
+ * clients can style chart data themselves instead of fetching one raster
+ * per style.
+ */
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <ogr_geometry.h>
+#include <ogr_feature.h>
+#include <encviz/web_mercator.h>
+
+namespace encviz
+{
+
+/// Vector tile builder for a single tile
+class mvt_encoder
+{
+public:
+
+    /// Encoder settings
+    struct options
+    {
+        /// Tile coordinate extent (units per tile side)
+        int extent{4096};
+
+        /// Geometry kept past each tile edge (tile units)
+        int buffer{64};
+
+        /// Line and ring simplification tolerance (tile units, 0 = off)
+        double tolerance{4.0};
+    };
+
+    /**
+     * Constructor
+     *
+     * \param[in] x Tile X coordinate (horizontal)
+     * \param[in] y Tile Y coordinate (vertical)
+     * \param[in] z Tile Z coordinate (zoom)
+     * \param[in] tc Tile coordinate system (WMTS or XYZ)
+     * \param[in] opts Encoder settings
+     */
+    mvt_encoder(int x, int y, int z, tile_coords tc, const options &opts);
+
+    mvt_encoder(const mvt_encoder &) = delete;
+    mvt_encoder &operator=(const mvt_encoder &) = delete;
+
+    /**
+     * Get Feature Bounding Box
+     *
+     * \return Tile bounds plus buffer (deg), the area to export
+     */
+    OGREnvelope get_bbox_deg() const;
+
+    /**
+     * Add Feature
+     *
+     * Geometry is clipped to the buffered tile, quantized to the tile extent
+     * and simplified. Features that collapse to nothing are dropped.
+     *
+     * \param[in] layer_name Output layer (S57 object class)
+     * \param[in] geo Feature geometry (deg)
+     * \param[in] attrs Feature attributes
+     */
+    void add_feature(const std::string &layer_name, const OGRGeometry *geo,
+                     const OGRFeature *attrs);
+
+    /**
+     * Encode Tile
+     *
+     * \param[out] data Encoded tile (protobuf)
+     * \return False if no feature was added
+     */
+    bool finish(std::vector<uint8_t> &data);
+
+private:
+
+    /// Tile coordinate
+    struct point
+    {
+        int64_t x;
+        int64_t y;
+
+        bool operator==(const point &other) const
+        {
+            return x == other.x && y == other.y;
+        }
+    };
+
+    /// Layer being built
+    struct layer
+    {
+        /// Layer name
+        std::string name;
+
+        /// Encoded features (repeated Layer.features fields)
+        std::vector<uint8_t> features;
+
+        /// Number of features
+        std::size_t count{0};
+
+        /// Attribute names, by index
+        std::vector<std::string> keys;
+
+        /// Attribute name indices
+        std::map<std::string, uint32_t> key_index;
+
+        /// Encoded attribute values, by index
+        std::vector<std::string> values;
+
+        /// Encoded attribute value indices
+        std::map<std::string, uint32_t> value_index;
+    };
+
+    /**
+     * Get Layer, Adding it if Needed
+     *
+     * \param[in] name Layer name
+     * \return Layer
+     */
+    layer &get_layer(const std::string &name);
+
+    /**
+     * Encode Feature Attributes
+     *
+     * \param[in,out] lyr Layer holding keys and values
+     * \param[in] attrs Feature attributes
+     * \param[out] tags Key / value index pairs
+     */
+    void encode_tags(layer &lyr, const OGRFeature *attrs, std::vector<uint32_t> &tags);
+
+    /**
+     * Encode Feature Geometry
+     *
+     * \param[in] geo Clipped geometry (deg)
+     * \param[out] type MVT geometry type
+     * \param[out] cmds Geometry command stream
+     * \return False if nothing is left after quantizing
+     */
+    bool encode_geometry(const OGRGeometry *geo, int &type, std::vector<uint32_t> &cmds);
+
+    /**
+     * Quantize Line or Ring
+     *
+     * \param[in] curve Line (deg)
+     * \param[in] ring Drop closing point, and require 3 points instead of 2
+     * \param[out] out Simplified tile coordinates
+     * \return False if the line collapsed
+     */
+    bool quantize(const OGRSimpleCurve *curve, bool ring, std::vector<point> &out) const;
+
+    /**
+     * Add Points to Command Stream
+     *
+     * \param[in] cmd Command (MoveTo, LineTo)
+     * \param[in] pts Tile coordinates
+     * \param[in] first First point to add
+     * \param[in] count Points to add
+     * \param[out] cmds Geometry command stream
+     */
+    void add_points(uint32_t cmd, const std::vector<point> &pts, std::size_t first,
+                    std::size_t count, std::vector<uint32_t> &cmds);
+
+    /// Encoder settings
+    options opts_;
+
+    /// Maps degrees to tile units (tile size = extent)
+    web_mercator wm_;
+
+    /// Buffered tile bounds (deg)
+    OGREnvelope bbox_;
+
+    /// Buffered tile bounds, for clipping
+    std::unique_ptr<OGRGeometry, decltype(&OGRGeometryFactory::destroyGeometry)> clip_;
+
+    /// Layers in order first seen
+    std::vector<layer> layers_;
+
+    /// Layer indices by name
+    std::map<std::string, std::size_t> layer_index_;
+
+    /// Command cursor (previous point of current feature)
+    point cursor_{0, 0};
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,180 @@
+#pragma once
+
+/**
+ * \file
+ * \brief PMTiles Archive
+ *
+ * Single file tile archive (PMTiles v3), served straight out of a read-only
+ * memory mapping.
+ */
+
+#include <cstdio>
+#include <mutex>
+#include <encviz/tile_archive.h>
+
+namespace encviz
+{
+
+/// PMTiles directory entry
+struct pmtiles_entry
+{
+    /// First tile id (zoom and Hilbert curve position)
+    uint64_t tile_id;
+
+    /// Tile data (or leaf directory) offset
+    uint64_t offset;
+
+    /// Tile data (or leaf directory) length
+    uint32_t length;
+
+    /// Consecutive tile ids sharing this data (0 = leaf directory)
+    uint32_t run_length;
+};
+
+/**
+ * PMTiles Tile Id
+ *
+ * \param[in] z Zoom
+ * \param[in] x Horizontal tile coordinate
+ * \param[in] y Vertical tile coordinate (XYZ, 0 at south)
+ * \return Tile id
+ */
+uint64_t pmtiles_tile_id(int z, int x, int y);
+
+/// PMTiles archive being written
+class pmtiles_writer : public tile_archive_writer
+{
+public:
+
+    /**
+     * Constructor
+     *
+     * Tiles are spooled next to the archive, which is only written by
+     * finish() once every tile id is known.
+     *
+     * \param[in] path Archive to create
+     * \param[in] info Archive description
+     * \throw std::runtime_error if it cannot be created
+     */
+    pmtiles_writer(const std::filesystem::path &path, const archive_info &info);
+
+    /**
+     * Destructor (finishes archive)
+     */
+    ~pmtiles_writer() override;
+
+    pmtiles_writer(const pmtiles_writer &) = delete;
+    pmtiles_writer &operator=(const pmtiles_writer &) = delete;
+
+    void put(int z, int x, int y, const std::vector<uint8_t> &data) override;
+    void flush() override;
+    void finish() override;
+    bool can_resume() const override;
+
+private:
+
+    /// Spooled tile
+    struct spooled
+    {
+        /// Tile id
+        uint64_t tile_id;
+
+        /// Offset in spool file
+        uint64_t offset;
+
+        /// Length of tile data
+        uint32_t length;
+
+        /// Content hash, to store repeated tiles once
+        uint64_t hash;
+    };
+
+    /**
+     * Write Archive
+     */
+    void write_archive();
+
+    /// Archive to create
+    std::filesystem::path path_;
+
+    /// Spool file path
+    std::filesystem::path spool_path_;
+
+    /// Archive description
+    archive_info info_;
+
+    /// Serializes spooling
+    std::mutex mutex_;
+
+    /// Spool file (null once finished)
+    FILE *spool_{nullptr};
+
+    /// Size of spool file
+    uint64_t spool_size_{0};
+
+    /// Spooled tiles
+    std::vector<spooled> tiles_;
+};
+
+/// PMTiles archive being served
+class pmtiles_reader : public tile_archive_reader
+{
+public:
+
+    /**
+     * Constructor
+     *
+     * \param[in] path Archive to open
+     * \throw std::runtime_error if it cannot be opened
+     */
+    explicit pmtiles_reader(const std::filesystem::path &path);
+
+    /**
+     * Destructor
+     */
+    ~pmtiles_reader() override;
+
+    pmtiles_reader(const pmtiles_reader &) = delete;
+    pmtiles_reader &operator=(const pmtiles_reader &) = delete;
+
+    bool get(int z, int x, int y, archive_tile &tile) const override;
+    tile_format get_format() const override;
+    time_t get_modified() const override;
+
+private:
+
+    /**
+     * Load Directory (and its leaves)
+     *
+     * \param[in] offset Directory offset in file
+     * \param[in] length Directory length
+     * \param[in] depth Leaf depth, to reject cycles
+     */
+    void load_directory(uint64_t offset, uint64_t length, int depth);
+
+    /// Archive mapping
+    const uint8_t *map_{nullptr};
+
+    /// Size of archive mapping
+    std::size_t map_size_{0};
+
+    /// Directory compression (PMTiles code)
+    uint8_t internal_compression_{0};
+
+    /// Leaf directories offset
+    uint64_t leaf_offset_{0};
+
+    /// Tile data offset
+    uint64_t data_offset_{0};
+
+    /// Every tile entry, sorted by tile id
+    std::vector<pmtiles_entry> entries_;
+
+    /// Image format
+    tile_format format_{tile_format::PNG};
+
+    /// Archive modification time
+    time_t modified_{0};
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,145 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Render Context
+ *
+ * Image surface and scratch buffers for rendering a tile (or metatile),
+ * pooled so steady state renders clear and reuse them rather than allocate
+ * a new surface for every tile.
+ */
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cairo.h>
+#include <encviz/coverage_index.h>
+#include <encviz/memory_budget.h>
+
+namespace encviz
+{
+
+class render_context
+{
+public:
+
+    render_context() = default;
+
+    /**
+     * Destructor
+     */
+    ~render_context();
+
+    render_context(const render_context &) = delete;
+    render_context &operator=(const render_context &) = delete;
+
+    /**
+     * Start Render
+     *
+     * The surface is kept when the size matches and cleared to transparent,
+     * scratch buffers are emptied (keeping their storage).
+     *
+     * \param[in] size Image width and height (pixels)
+     * \return Drawing context in its default state (valid until next begin)
+     */
+    cairo_t *begin(int size);
+
+    /**
+     * Get Image
+     *
+     * \return ARGB32 image drawn since begin()
+     */
+    cairo_surface_t *surface() const { return surface_; }
+
+    /**
+     * Get Estimated Footprint
+     *
+     * \return Memory held by the surface and point buffer (bytes)
+     */
+    std::size_t get_size() const;
+
+    /// Style layer names of the tile
+    std::vector<std::string> layers;
+
+    /// Coverage bounds of the tile (pixels)
+    coverage_index coverage;
+
+    /// Projected ring points (pixels)
+    std::vector<coord> points;
+
+private:
+
+    /// Reused image
+    cairo_surface_t *surface_{nullptr};
+
+    /// Drawing context of the current render
+    cairo_t *cr_{nullptr};
+
+    /// Image width and height (pixels)
+    int size_{0};
+};
+
+class render_context_pool
+{
+public:
+
+    /// Hands a leased context back to its pool
+    struct releaser
+    {
+        /// Owning pool
+        render_context_pool *pool;
+
+        /**
+         * Release Context
+         *
+         * \param[in] ctx Leased context
+         */
+        void operator()(render_context *ctx) const;
+    };
+
+    /// Context held by one render, returned to the pool when reset
+    typedef std::unique_ptr<render_context, releaser> lease;
+
+    /**
+     * Lease Context
+     *
+     * Reuses an idle context, one is created when all are in use. The pool
+     * grows to the number of concurrent renders.
+     *
+     * \return Context for exclusive use until the lease is reset
+     */
+    lease acquire();
+
+    /**
+     * Share Memory Budget
+     *
+     * Only idle contexts count, those in use are freed by trimming once
+     * they are returned.
+     *
+     * \param[in] budget Budget idle contexts count against (must outlive the pool)
+     * \param[in] weight Relative share of budget
+     */
+    void set_budget(memory_budget &budget, double weight);
+
+private:
+
+    /**
+     * Free Idle Contexts for Memory Budget
+     */
+    void trim();
+
+    /// Guards idle_ and idle_bytes_
+    std::mutex mutex_;
+
+    /// Contexts not leased
+    std::vector<std::unique_ptr<render_context>> idle_;
+
+    /// Size of idle contexts (bytes)
+    std::size_t idle_bytes_{0};
+
+    /// Share of the memory budget (none until attached)
+    memory_budget::client budget_;
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,78 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Render Profile
+ *
+ * Time spent in each stage of rendering one tile, filled in when a caller
+ * asks for it (benchmarks, slow tile debugging).
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace encviz
+{
+
+/// Stage timings of one tile render (usec)
+struct render_profile
+{
+    /// Chart selection (spatial index query and coverage pruning)
+    int64_t select_us{0};
+
+    /// Opening selected charts (compiling them on a chart cache miss)
+    int64_t open_us{0};
+
+    /// Feature export (clipping) by layer, summed over charts
+    std::map<std::string, int64_t> export_us;
+
+    /// Removing each chart's coverage from the area still to fill
+    int64_t erase_us{0};
+
+    /// Drawing by style layer, including its icons
+    std::map<std::string, int64_t> draw_us;
+
+    /// SVG icon drawing, all layers
+    int64_t icon_us{0};
+
+    /// Image (or vector tile) encoding
+    int64_t encode_us{0};
+
+    /**
+     * Add Timings of Another Render
+     *
+     * \param[in] other Timings to add
+     */
+    void add(const render_profile &other)
+    {
+        select_us += other.select_us;
+        open_us += other.open_us;
+        for (const auto &[layer, us] : other.export_us)
+        {
+            export_us[layer] += us;
+        }
+        erase_us += other.erase_us;
+        for (const auto &[layer, us] : other.draw_us)
+        {
+            draw_us[layer] += us;
+        }
+        icon_us += other.icon_us;
+        encode_us += other.encode_us;
+    }
+};
+
+/**
+ * Get Elapsed Time
+ *
+ * \param[in] start Start of stage
+ * \return Microseconds since start
+ */
+inline int64_t elapsed_us(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,153 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Scale Band Coverage Plan
+ *
+ * Loose quadtree over one scale band (charts at or above a minimum
+ * compilation scale), recording for each region which charts supply its
+ * data, most detailed first, and the part of the region each one is drawn
+ * in. Tiles look up the smallest region holding them instead of redoing
+ * chart selection and the coverage difference chain every time.
+ *
+ * Regions are resolved lazily, the first time a tile lands in them.
+ */
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <ogr_core.h>
+#include <ogr_geometry.h>
+
+namespace encviz
+{
+
+class scale_plan
+{
+public:
+
+    /// Chart in the band
+    struct chart
+    {
+        /// Chart bounding box (deg)
+        OGREnvelope bbox;
+
+        /// Simplified coverage, for selection (deg, null = no coverage)
+        std::shared_ptr<const OGRGeometry> coverage;
+
+        /// Caller defined chart id
+        std::size_t id;
+    };
+
+    /// Reads the exact coverage a chart is erased with (null if none)
+    typedef std::function<std::shared_ptr<const OGRGeometry>(std::size_t id)> coverage_fn;
+
+    /// Chart supplying part of a region
+    struct step
+    {
+        /// Chart
+        const chart *source;
+
+        /// Part of the region not covered by earlier steps (null = all of it)
+        std::shared_ptr<const OGRGeometry> mask;
+    };
+
+    /// Resolved region
+    struct region
+    {
+        /// Region bounds (deg)
+        OGREnvelope bbox;
+
+        /// Charts to draw, most detailed first
+        std::vector<step> steps;
+
+        /// True if the steps cover the whole region
+        bool complete{false};
+    };
+
+    /**
+     * Constructor
+     *
+     * \param[in] charts Charts in the band, ascending scale order
+     * \param[in] exact_coverage Reads erase coverage of a chart
+     */
+    scale_plan(std::vector<chart> charts, coverage_fn exact_coverage);
+
+    scale_plan(const scale_plan &) = delete;
+    scale_plan &operator=(const scale_plan &) = delete;
+
+    /**
+     * Find Region for Area
+     *
+     * Thread safe, regions are resolved on first use.
+     *
+     * \param[in] bbox Area (deg)
+     * \return Smallest region wholly containing the area
+     */
+    const region &find(const OGREnvelope &bbox);
+
+private:
+
+    /// Deepest quadtree level
+    static constexpr int MAX_DEPTH = 20;
+
+    /// Quadtree node
+    struct node
+    {
+        /// Cell bounds (deg), children split it in four
+        OGREnvelope cell;
+
+        /// Depth of node (root = 0)
+        int depth{0};
+
+        /// Charts whose bounds touch the loose bounds (indices into charts_)
+        std::vector<std::size_t> candidates;
+
+        /// Guards children
+        std::once_flag split_once;
+
+        /// Child cells (SW, SE, NW, NE)
+        std::unique_ptr<node> children[4];
+
+        /// Guards plan
+        std::once_flag plan_once;
+
+        /// Resolved region (loose bounds)
+        region plan;
+    };
+
+    /**
+     * Loose Bounds of Cell
+     *
+     * \param[in] cell Cell bounds (deg)
+     * \return Cell grown by half its size on each side
+     */
+    static OGREnvelope loosen(const OGREnvelope &cell);
+
+    /**
+     * Create Child Nodes
+     *
+     * \param[in,out] parent Node to split
+     */
+    void split(node &parent) const;
+
+    /**
+     * Resolve Region
+     *
+     * \param[in,out] n Node to plan
+     */
+    void resolve(node &n) const;
+
+    /// Charts in the band, ascending scale order
+    std::vector<chart> charts_;
+
+    /// Erase coverage reader
+    coverage_fn exact_coverage_;
+
+    /// Root node, the whole world
+    node root_;
+};
+
+}; // ~namespace encviz
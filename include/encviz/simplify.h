@@ -0,0 +1,46 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Line Simplification
+ *
+ * Decimates projected lines and rings, so vertices that land within a
+ * fraction of a pixel of each other (coastlines at low zoom) never reach
+ * cairo.
+ */
+
+#include <cstddef>
+#include <vector>
+#include <ogr_geometry.h>
+#include <encviz/common.h>
+#include <encviz/web_mercator.h>
+
+namespace encviz
+{
+
+/**
+ * Simplify Line (Douglas-Peucker)
+ *
+ * \param[in,out] pts Points, reduced in place (end points always kept)
+ * \param[in] tolerance Max distance of dropped points from the result (0 = off)
+ * \param[in,out] index Source index of each point, reduced alongside (optional)
+ */
+void simplify_line(std::vector<coord> &pts, double tolerance,
+                   std::vector<std::size_t> *index = nullptr);
+
+/**
+ * Project and Simplify Line
+ *
+ * Points closer than the tolerance to the last kept point are dropped
+ * first, which cheaply collapses dense runs, then the rest is simplified.
+ *
+ * \param[in] curve Line or ring (deg)
+ * \param[in] wm Web Mercator point mapper
+ * \param[in] tolerance Simplification tolerance (pixels, 0 = off)
+ * \param[out] out Projected points (pixels)
+ * \param[out] index Source index of each output point (optional)
+ */
+void project_line(const OGRSimpleCurve *curve, const web_mercator &wm, double tolerance,
+                  std::vector<coord> &out, std::vector<std::size_t> *index = nullptr);
+
+}; // ~namespace encviz
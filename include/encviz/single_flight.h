@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Single Flight
+ *
+ * Collapses concurrent calls for the same key into one, so duplicate tile
+ * requests wait on the first render instead of repeating it.
+ */
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace encviz
+{
+
+/// Runs at most one call per key at a time, sharing its result
+template <typename T>
+class single_flight
+{
+public:
+
+    /**
+     * Run Call, or Join the One in Progress
+     *
+     * \param[in] key Call key
+     * \param[in] fn Produces the result, only called if key isn't in flight
+     * \return Result of the call (exceptions are rethrown to every caller)
+     */
+    template <typename F>
+    T run(const std::string &key, F &&fn)
+    {
+        std::shared_ptr<call> c;
+        bool owner = false;
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            std::shared_ptr<call> &slot = calls_[key];
+            if (slot == nullptr)
+            {
+                slot = std::make_shared<call>();
+                slot->result = slot->done.get_future().share();
+                owner = true;
+            }
+            else
+            {
+                joined_++;
+            }
+            c = slot;
+        }
+
+        if (owner)
+        {
+            try
+            {
+                c->done.set_value(fn());
+            }
+            catch (...)
+            {
+                c->done.set_exception(std::current_exception());
+            }
+
+            // Later calls start over (results should be cached by then)
+            std::lock_guard<std::mutex> guard(mutex_);
+            calls_.erase(key);
+        }
+
+        return c->result.get();
+    }
+
+    /**
+     * Calls That Joined Another
+     *
+     * \return Number of calls served by one already in flight
+     */
+    uint64_t joined() const
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        return joined_;
+    }
+
+private:
+
+    /// Call in progress
+    struct call
+    {
+        /// Set by the owning caller
+        std::promise<T> done;
+
+        /// Waited on by every caller
+        std::shared_future<T> result;
+    };
+
+    /// Protects calls_ and joined_
+    mutable std::mutex mutex_;
+
+    /// Calls in progress by key
+    std::map<std::string, std::shared_ptr<call>> calls_;
+
+    /// Calls served by one already in flight
+    uint64_t joined_{0};
+};
+
+}; // ~namespace encviz
@@ -55,12 +55,48 @@ struct DepareColors
 
 typedef std::map<std::string, std::filesystem::path> IconStyle;
 
+/// S-57 object classes that get special rendering
+enum S57Class
+{
+	S57_OTHER,
+	S57_M_COVR,
+	S57_DEPARE,
+	S57_DRGARE,
+	S57_BOYCAR,
+	S57_BOYINB,
+	S57_BOYISD,
+	S57_BOYLAT,
+	S57_BOYSAW,
+	S57_BOYSPP,
+	S57_BCNCAR,
+	S57_BCNISD,
+	S57_BCNLAT,
+	S57_BCNSAW,
+	S57_BCNSPP,
+	S57_FOGSIG,
+	S57_LIGHTS,
+	S57_LNDMRK,
+	S57_SILTNK,
+	S57_UWTROC,
+	S57_OBSTRN,
+	S57_WRECKS,
+	S57_ACHBRT,
+	S57_TSSLPT,
+	S57_LNDARE,
+	S57_SEAARE,
+	S57_LNDRGN,
+	S57_BUAARE
+};
+
 /// Style for a single layer
 struct layer_style
 {
     /// Name of layer
     std::string layer_name;
 
+    /// Object class of layer (resolved from name)
+    S57Class object_class{S57_OTHER};
+
 	/// Verbose printing
 	bool verbose;
 
@@ -121,6 +157,14 @@ struct render_style
  */
 color parse_color(tinyxml2::XMLElement *node);
 
+/**
+ * Look Up S-57 Object Class
+ *
+ * \param[in] layer_name S57 layer (object class acronym)
+ * \return Object class, S57_OTHER if it has no special rendering
+ */
+S57Class parse_s57_class(const std::string &layer_name);
+
 /**
  * Parse Layer Style
  *
@@ -8,10 +8,15 @@
  * and render them to a cairo context when needed
  */
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <filesystem>
 #include <encviz/common.h>
+#include <encviz/memory_budget.h>
 #include <cairo.h>
 
 namespace encviz
@@ -27,6 +32,35 @@ public:
      */
     svg_collection();
 
+    /**
+     * Destructor
+     */
+    ~svg_collection();
+
+    svg_collection(const svg_collection &) = delete;
+    svg_collection &operator=(const svg_collection &) = delete;
+
+    /**
+     * Enable Pre-Rendered Icons
+     *
+     * When enabled each icon is rasterized once per stylesheet, size and
+     * (whole degree) rotation, and blitted at the nearest pixel after that.
+     *
+     * \param[in] enabled Use sprite cache
+     */
+    void set_sprite_cache(bool enabled);
+
+    /**
+     * Share Memory Budget
+     *
+     * Sprites and parsed documents (estimated from file size) both count.
+     * When trimmed, sprites are dropped first, then documents.
+     *
+     * \param[in] budget Budget icons count against (must outlive the collection)
+     * \param[in] weight Relative share of budget
+     */
+    void set_budget(memory_budget &budget, double weight);
+
     /**
      * Set Svg Path
      *
@@ -42,14 +76,94 @@ public:
     bool render_svg(cairo_t *cr, std::filesystem::path &svg_path,
 					coord center, double width, double height,
 					std::string stylesheet = "", double rotation = 0.0);
+
+    /**
+     * Get Icon Time of Calling Thread
+     *
+     * \return Total time this thread has spent in render_svg() (usec)
+     */
+    static int64_t thread_usec();
     
 private:
 
+    /// Parsed SVG document (defined with librsvg)
+    struct svg_handle;
+
+    /// Sprite key (path, stylesheet, width, height, rotation in degrees)
+    typedef std::tuple<std::string, std::string, double, double, int> sprite_key;
+
 	void render_svg_missing(cairo_t *cr, coord center);
 
+    /**
+     * Get Parsed SVG
+     *
+     * \param[in] full_path Path to SVG file
+     * \param[in] stylesheet CSS applied to the document
+     * \return Parsed document, or null if it cannot be loaded
+     */
+    std::shared_ptr<svg_handle> get_handle(const std::filesystem::path &full_path,
+                                           const std::string &stylesheet);
+
+    /**
+     * Draw Parsed SVG
+     *
+     * \param[out] cr Image context
+     * \param[in] svg Parsed document
+     * \param[in] center Image center (pixels)
+     * \param[in] width Image width (pixels)
+     * \param[in] height Image height (pixels)
+     * \param[in] rotation Rotation (deg)
+     * \return False on render error
+     */
+    bool draw_handle(cairo_t *cr, svg_handle &svg, coord center,
+                     double width, double height, double rotation);
+
+    /**
+     * Get Pre-Rendered Icon
+     *
+     * \param[in] key Sprite key
+     * \return Referenced square image (caller destroys), or null on error
+     */
+    cairo_surface_t *get_sprite(const sprite_key &key);
+
+    /**
+     * Drop All Pre-Rendered Icons
+     *
+     * \note Caller must hold mutex_
+     */
+    void clear_sprites();
+
+    /**
+     * Report Icon Footprint to Budget
+     *
+     * \note Caller must hold mutex_
+     */
+    void report_size();
+
     /// Root directory for searching for SVG files
     std::filesystem::path svg_root_path_;
-    
+
+    /// Use pre-rendered icons
+    bool use_sprites_{true};
+
+    /// Protects handles_ and sprites_
+    std::mutex mutex_;
+
+    /// Parsed documents by (path, stylesheet), null if they failed to load
+    std::map<std::pair<std::string, std::string>, std::shared_ptr<svg_handle>> handles_;
+
+    /// Pre-rendered icons (referenced), null if they failed to render
+    std::map<sprite_key, cairo_surface_t*> sprites_;
+
+    /// Size of pre-rendered icons (bytes)
+    std::size_t sprite_bytes_{0};
+
+    /// Estimated size of parsed documents (bytes)
+    std::size_t handle_bytes_{0};
+
+    /// Share of the memory budget (none until attached)
+    memory_budget::client budget_;
+
 };
 
 }; // ~namespace encviz
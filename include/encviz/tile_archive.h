@@ -0,0 +1,157 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Tile Archive
+ *
+ * Single file archives of rendered tiles (MBTiles or PMTiles), for rendering
+ * once and serving static tiles without the S-57 charts.
+ */
+
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <ogr_core.h>
+#include <encviz/tile_encoder.h>
+
+namespace encviz
+{
+
+/// Archive wide description
+struct archive_info
+{
+    /// Archive name (render style)
+    std::string name;
+
+    /// Image format of every tile
+    tile_format format{tile_format::PNG};
+
+    /// Lowest zoom
+    int min_zoom{0};
+
+    /// Highest zoom
+    int max_zoom{0};
+
+    /// Covered area (deg)
+    OGREnvelope bounds;
+};
+
+/// Tile read from an archive
+struct archive_tile
+{
+    /// Encoded image bytes (valid while the archive is open)
+    const uint8_t *data{nullptr};
+
+    /// Size of image (bytes)
+    std::size_t size{0};
+
+    /// Owns data when it couldn't be served in place (null if mapped)
+    std::shared_ptr<const std::vector<uint8_t>> copy;
+
+    /// HTTP entity tag (quoted)
+    std::string etag;
+};
+
+/// Archive being written (XYZ tile coordinates, 0,0 at southwest)
+class tile_archive_writer
+{
+public:
+
+    virtual ~tile_archive_writer() = default;
+
+    /**
+     * Add Tile
+     *
+     * \param[in] z Zoom
+     * \param[in] x Horizontal tile coordinate
+     * \param[in] y Vertical tile coordinate
+     * \param[in] data Encoded image bytes
+     *
+     * \note Safe to call from multiple threads at once.
+     */
+    virtual void put(int z, int x, int y, const std::vector<uint8_t> &data) = 0;
+
+    /**
+     * Keep Tiles Added So Far
+     *
+     * Once it returns, every tile put() so far survives an interrupted run
+     * (if the format can resume at all).
+     */
+    virtual void flush() = 0;
+
+    /**
+     * Complete Archive
+     *
+     * Nothing may be added afterwards.
+     */
+    virtual void finish() = 0;
+
+    /**
+     * Check Resume Support
+     *
+     * \return True if tiles from an earlier, interrupted run are kept
+     */
+    virtual bool can_resume() const = 0;
+};
+
+/// Archive being served (XYZ tile coordinates, 0,0 at southwest)
+class tile_archive_reader
+{
+public:
+
+    virtual ~tile_archive_reader() = default;
+
+    /**
+     * Look Up Tile
+     *
+     * \param[in] z Zoom
+     * \param[in] x Horizontal tile coordinate
+     * \param[in] y Vertical tile coordinate
+     * \param[out] tile Tile data
+     * \return False if the archive doesn't have this tile
+     *
+     * \note Safe to call from multiple threads at once.
+     */
+    virtual bool get(int z, int x, int y, archive_tile &tile) const = 0;
+
+    /**
+     * Get Tile Format
+     *
+     * \return Image format of every tile
+     */
+    virtual tile_format get_format() const = 0;
+
+    /**
+     * Get Modification Time
+     *
+     * \return Time archive was last written
+     */
+    virtual time_t get_modified() const = 0;
+};
+
+/**
+ * Create Tile Archive
+ *
+ * \param[in] path Archive to create (".mbtiles" or ".pmtiles")
+ * \param[in] info Archive description
+ * \param[in] keep_existing Add to an existing archive, if the format allows
+ * \return Archive writer
+ * \throw std::runtime_error if it cannot be created
+ */
+std::unique_ptr<tile_archive_writer> create_tile_archive(const std::filesystem::path &path,
+                                                         const archive_info &info,
+                                                         bool keep_existing = false);
+
+/**
+ * Open Tile Archive
+ *
+ * \param[in] path Archive to serve (".mbtiles" or ".pmtiles")
+ * \return Archive reader
+ * \throw std::runtime_error if it cannot be opened
+ */
+std::unique_ptr<tile_archive_reader> open_tile_archive(const std::filesystem::path &path);
+
+}; // ~namespace encviz
@@ -0,0 +1,305 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Tile Cache
+ *
+ * Two tier (memory + disk) cache of encoded tile images, so tiles are only
+ * re-rendered when the underlying chart set changes.
+ */
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <encviz/memory_budget.h>
+#include <encviz/tile_encoder.h>
+
+namespace encviz
+{
+
+/// Encoded tile image
+struct tile_blob
+{
+    tile_blob() = default;
+    tile_blob(const tile_blob &) = delete;
+    tile_blob &operator=(const tile_blob &) = delete;
+
+    /**
+     * Destructor
+     *
+     * Closes the tile file, if any.
+     */
+    ~tile_blob();
+
+    /// Encoded image bytes (empty if the tile is sent from its file)
+    std::vector<uint8_t> data;
+
+    /// Disk tier file holding the image (-1 if in data)
+    int fd{-1};
+
+    /// Size of image (bytes)
+    std::size_t size{0};
+
+    /// HTTP entity tag (quoted content hash)
+    std::string etag;
+
+    /// Time tile was rendered
+    time_t modified;
+};
+
+/// Shared, immutable tile image
+typedef std::shared_ptr<const tile_blob> tile_ptr;
+
+/// Tile cache key (XYZ tile coordinates, 0,0 at southwest)
+struct tile_key
+{
+    /// Render style name
+    std::string style;
+
+    /// Zoom
+    int z;
+
+    /// Horizontal tile coordinate
+    int x;
+
+    /// Vertical tile coordinate
+    int y;
+
+    /// Image format
+    tile_format format{tile_format::PNG};
+};
+
+/// Block of tiles at one zoom (XYZ, inclusive)
+struct tile_range
+{
+    /// Zoom
+    int z;
+
+    /// Horizontal tile coordinates
+    int x0, x1;
+
+    /// Vertical tile coordinates
+    int y0, y1;
+
+    /**
+     * Check Tile
+     *
+     * \param[in] key Tile key
+     * \return True if the tile is in this block
+     */
+    bool contains(const tile_key &key) const
+    {
+        return key.z == z && key.x >= x0 && key.x <= x1 && key.y >= y0 && key.y <= y1;
+    }
+};
+
+/// LRU memory cache in front of an on-disk tile directory
+class tile_cache
+{
+public:
+
+    /// Cache usage counters
+    struct stats
+    {
+        /// Requests served from memory
+        uint64_t memory_hits{0};
+
+        /// Requests served from disk
+        uint64_t disk_hits{0};
+
+        /// Requests not in either tier
+        uint64_t misses{0};
+
+        /// Tiles dropped from memory to stay under the size limit
+        uint64_t evictions{0};
+
+        /// Size of tiles held in memory (bytes)
+        std::size_t bytes{0};
+
+        /// Number of tiles held in memory
+        std::size_t entries{0};
+    };
+
+    /**
+     * Constructor
+     */
+    tile_cache();
+
+    tile_cache(const tile_cache &) = delete;
+    tile_cache &operator=(const tile_cache &) = delete;
+
+    /**
+     * Set Memory Size Limit
+     *
+     * \param[in] max_bytes Maximum size of tiles held in memory (0 disables)
+     */
+    void set_memory_limit(std::size_t max_bytes);
+
+    /**
+     * Share Memory Budget
+     *
+     * \param[in] budget Budget the memory tier counts against (must outlive the cache)
+     * \param[in] weight Relative share of budget
+     */
+    void set_budget(memory_budget &budget, double weight);
+
+    /**
+     * Set Disk Cache Location
+     *
+     * \param[in] path Tile directory (empty disables)
+     */
+    void set_disk_path(const std::filesystem::path &path);
+
+    /**
+     * Check Disk Tier
+     *
+     * \return False if tiles are only kept in memory
+     */
+    bool has_disk() const;
+
+    /**
+     * Set Chart Set Generation
+     *
+     * Any cached tiles from a different generation are discarded.
+     *
+     * \param[in] generation Chart set generation id
+     */
+    void set_generation(const std::string &generation);
+
+    /**
+     * Drop Tiles Over Changed Charts
+     *
+     * Removes the tiles from both tiers, in every style and format, then
+     * records the new generation on disk so the rest stay valid.
+     *
+     * \param[in] ranges Stale tiles
+     * \param[in] generation New chart set generation id
+     * \return Number of tiles dropped (a tile in both tiers counts once)
+     */
+    std::size_t invalidate(const std::vector<tile_range> &ranges,
+                           const std::string &generation);
+
+    /**
+     * Look Up Tile
+     *
+     * \param[in] key Tile key
+     * \param[in] as_file Disk hits may be returned as an open file (fd) rather
+     *                    than read in, for sendfile; they skip the memory tier
+     * \return Cached tile, or null if not cached
+     */
+    tile_ptr get(const tile_key &key, bool as_file = false);
+
+    /**
+     * Store Tile
+     *
+     * \param[in] key Tile key
+     * \param[in] data Encoded image bytes
+     * \return Stored tile
+     */
+    tile_ptr put(const tile_key &key, std::vector<uint8_t> data);
+
+    /**
+     * Get Usage Counters
+     *
+     * \return Snapshot of cache counters
+     */
+    stats get_stats() const;
+
+    /**
+     * Wrap Tile Without Storing
+     *
+     * \param[in] data Encoded image bytes
+     * \return Tile
+     */
+    static tile_ptr make_tile(std::vector<uint8_t> data);
+
+    /**
+     * Memory Cache Key
+     *
+     * \param[in] key Tile key
+     * \return Key string "style/z/x/y.ext"
+     */
+    static std::string key_string(const tile_key &key);
+
+private:
+
+    /// Tile held in memory
+    struct entry
+    {
+        /// Cache key
+        std::string key;
+
+        /// Tile coordinates
+        tile_key coords;
+
+        /// Tile data
+        tile_ptr tile;
+    };
+
+    /**
+     * Disk Cache Path
+     *
+     * \param[in] key Tile key
+     * \return Path to tile on disk
+     */
+    std::filesystem::path disk_path(const tile_key &key) const;
+
+    /**
+     * Insert Into Memory Tier
+     *
+     * \param[in] key Tile key
+     * \param[in] tile Tile data
+     */
+    void insert_memory(const tile_key &key, const tile_ptr &tile);
+
+    /**
+     * Evict Tiles Until Under Size Limit
+     *
+     * Also evicts while over the share of the memory budget.
+     *
+     * \note Caller must hold mutex_
+     */
+    void evict();
+
+    /**
+     * Evict Tiles for Memory Budget
+     */
+    void trim();
+
+    /// Protects memory tier and counters
+    mutable std::mutex mutex_;
+
+    /// Tiles in memory, most recently used first
+    std::list<entry> lru_;
+
+    /// Tiles in memory by key
+    std::unordered_map<std::string, std::list<entry>::iterator> index_;
+
+    /// Maximum size of tiles held in memory (bytes)
+    std::size_t max_bytes_;
+
+    /// Share of the memory budget (none until attached)
+    memory_budget::client budget_;
+
+    /// Tile directory (empty for none)
+    std::filesystem::path disk_path_;
+
+    /// Usage counters
+    stats stats_;
+};
+
+/**
+ * Compute Entity Tag
+ *
+ * \param[in] data Encoded image bytes
+ * \return Quoted 64 bit FNV-1a hash of the data
+ */
+std::string make_etag(const std::vector<uint8_t> &data);
+
+}; // ~namespace encviz
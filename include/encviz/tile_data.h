@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Tile Data
+ *
+ * Features selected for a single tile, handed from the chart dataset to the
+ * renderer without going through an intermediate GDAL dataset.
+ */
+
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include <ogr_geometry.h>
+#include <encviz/chart_store.h>
+
+namespace encviz
+{
+
+/// Feature selected for a tile
+struct tile_feature
+{
+    /// Geometry, clipped to the tile where needed
+    const OGRGeometry *geo;
+
+    /// Attributes (source feature in its chart store, never modified)
+    const OGRFeature *attrs;
+};
+
+/// Per request feature container
+class tile_data
+{
+public:
+
+    /// Features of one layer, in chart order
+    typedef std::pmr::vector<tile_feature> layer;
+
+    /**
+     * Constructor
+     */
+    tile_data();
+
+    tile_data(const tile_data &) = delete;
+    tile_data &operator=(const tile_data &) = delete;
+
+    /**
+     * Add Layer
+     *
+     * \param[in] name S57 layer name
+     * \return Layer (existing one if already added)
+     */
+    layer &add_layer(const std::string &name);
+
+    /**
+     * Get Layer
+     *
+     * \param[in] name S57 layer name
+     * \return Layer, or null if not exported
+     */
+    const layer *get_layer(const std::string &name) const;
+
+    /**
+     * Keep Chart Alive
+     *
+     * Features borrow geometry and attributes from their chart store, which
+     * must outlive this tile even if dropped from the chart cache.
+     *
+     * \param[in] store Compiled chart
+     */
+    void hold(std::shared_ptr<const chart_store> store);
+
+    /**
+     * Take Ownership of Derived Geometry
+     *
+     * \param[in] geo Geometry created for this tile (clip, union, ...)
+     * \return Same geometry, valid for the life of this tile
+     */
+    const OGRGeometry *keep(OGRGeometry *geo);
+
+private:
+
+    /// Backing memory for feature vectors, released all at once
+    std::pmr::monotonic_buffer_resource arena_;
+
+    /// Layers by name
+    std::map<std::string, layer> layers_;
+
+    /// Charts features are borrowed from
+    std::vector<std::shared_ptr<const chart_store>> charts_;
+
+    /// Geometry created for this tile
+    std::vector<std::unique_ptr<OGRGeometry>> owned_;
+};
+
+}; // ~namespace encviz
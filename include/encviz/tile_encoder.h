@@ -0,0 +1,140 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Tile Encoder
+ *
+ * Encodes rendered (cairo ARGB32) tiles to PNG or WebP, replacing cairo's
+ * fixed-setting PNG writer with a tunable one. Vector tiles (MVT) share the
+ * tile format plumbing, but are built by mvt_encoder instead.
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cairo.h>
+
+namespace encviz
+{
+
+/// Encoded tile format
+enum class tile_format
+{
+    PNG,
+    WEBP,
+    MVT ///< Mapbox Vector Tile, not an image
+};
+
+/**
+ * Parse Tile Format
+ *
+ * \param[in] ext File extension (without dot, ie - "png")
+ * \param[out] fmt Tile format
+ * \return False if extension is not a known tile format
+ */
+bool parse_tile_format(std::string_view ext, tile_format &fmt);
+
+/**
+ * Tile Format File Extension
+ *
+ * \param[in] fmt Tile format
+ * \return Extension without dot (ie - "png")
+ */
+const char *tile_format_extension(tile_format fmt);
+
+/**
+ * Tile Format MIME Type
+ *
+ * \param[in] fmt Tile format
+ * \return MIME type (ie - "image/png")
+ */
+const char *tile_format_mime(tile_format fmt);
+
+/// Rendered tile to image file encoder
+class tile_encoder
+{
+public:
+
+    /// Encoder settings
+    struct options
+    {
+        /// zlib compression level (0-9)
+        int png_level{6};
+
+        /// Write 8-bit palette PNGs (quantizing if over 256 colors)
+        bool png_palette{false};
+
+        /// WebP quality (0-100, 100 = lossless)
+        int webp_quality{90};
+    };
+
+    /**
+     * Set Encoder Settings
+     *
+     * \param[in] opts Encoder settings
+     */
+    void set_options(const options &opts);
+
+    /**
+     * Check Format Support
+     *
+     * \param[in] fmt Tile format
+     * \return False if this build can't produce the format
+     */
+    static bool supports(tile_format fmt);
+
+    /**
+     * Encode Tile Image
+     *
+     * \param[out] data Encoded image bytes
+     * \param[in] surface Rendered ARGB32 image surface
+     * \param[in] fmt Output format
+     * \return False on encode error
+     *
+     * \note Safe to call from multiple threads at once.
+     */
+    bool encode(std::vector<uint8_t> &data, cairo_surface_t *surface,
+                tile_format fmt) const;
+
+    /**
+     * Encode Raw Image
+     *
+     * \param[out] data Encoded image bytes
+     * \param[in] pixels Native endian, premultiplied ARGB32 pixels
+     * \param[in] width Image width (pixels)
+     * \param[in] height Image height (pixels)
+     * \param[in] stride Bytes per row
+     * \param[in] fmt Output format
+     * \return False on encode error
+     */
+    bool encode(std::vector<uint8_t> &data, const uint8_t *pixels,
+                int width, int height, int stride, tile_format fmt) const;
+
+private:
+
+    /**
+     * Encode RGBA Image as PNG
+     *
+     * \param[out] data Encoded image bytes
+     * \param[in] rgba Straight alpha RGBA pixels (width * 4 bytes per row)
+     * \param[in] width Image width (pixels)
+     * \param[in] height Image height (pixels)
+     * \return False on encode error
+     */
+    bool encode_png(std::vector<uint8_t> &data, const uint8_t *rgba,
+                    int width, int height) const;
+
+    /**
+     * Encode RGBA Image as WebP
+     *
+     * \copydetails encode_png
+     */
+    bool encode_webp(std::vector<uint8_t> &data, const uint8_t *rgba,
+                     int width, int height) const;
+
+    /// Encoder settings
+    options opts_;
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,147 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Tile Prefetcher
+ *
+ * Predicts the tiles a map client asks for next (the ring around a tile
+ * when panning, its four children when zooming in) and renders them into
+ * the tile cache as background work, so they are warm when requested.
+ * Each client gets a token bucket, so one busy client can't flood the
+ * background queue.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <encviz/tile_cache.h>
+#include <encviz/worker_pool.h>
+
+namespace encviz
+{
+
+class tile_prefetcher
+{
+public:
+
+    /// Renders a tile into the cache (called from a worker)
+    typedef std::function<void(const tile_key &)> fetch_fn;
+
+    /// Prefetch limits
+    struct options
+    {
+        /// Prefetches per second per client
+        double rate{12};
+
+        /// Prefetches a client may queue at once
+        double burst{24};
+
+        /// Clients tracked before idle ones are forgotten
+        std::size_t max_clients{4096};
+
+        /// Deepest zoom to prefetch children at
+        int max_zoom{30};
+    };
+
+    /// Prefetch counts (for metrics)
+    struct stats
+    {
+        /// Tiles handed to the worker pool
+        uint64_t queued;
+
+        /// Tiles skipped by client rate limits
+        uint64_t limited;
+
+        /// Tiles skipped with the background queue full
+        uint64_t full;
+    };
+
+    /**
+     * Constructor
+     *
+     * \param[in] pool Workers, prefetches use their background queue
+     * \param[in] fetch Tile render routine
+     * \param[in] opts Prefetch limits
+     */
+    tile_prefetcher(worker_pool &pool, fetch_fn fetch, const options &opts);
+
+    /**
+     * Note Requested Tile
+     *
+     * Queues prefetches of the tiles around it, as far as the client's
+     * budget allows.
+     *
+     * \param[in] client Client identity (ie - address)
+     * \param[in] key Requested tile
+     */
+    void requested(const std::string &client, const tile_key &key);
+
+    /**
+     * Get Prefetch Counts
+     *
+     * \return Counts since startup
+     */
+    stats get_stats() const;
+
+    /**
+     * Tiles Likely Requested Next
+     *
+     * \param[in] key Requested tile
+     * \param[in] max_zoom Deepest zoom of children
+     * \return The 8 neighbors (wrapping east-west), then the 4 children
+     */
+    static std::vector<tile_key> around(const tile_key &key, int max_zoom);
+
+private:
+
+    /// Client rate limit
+    struct bucket
+    {
+        /// Prefetches available
+        double tokens;
+
+        /// Last refill
+        std::chrono::steady_clock::time_point updated;
+    };
+
+    /**
+     * Forget Idle Clients
+     *
+     * Drops clients with a full budget, then the longest idle if still at
+     * max_clients.
+     *
+     * \param[in] now Current time
+     *
+     * \note Call with mutex_ held.
+     */
+    void prune(std::chrono::steady_clock::time_point now);
+
+    /// Workers
+    worker_pool &pool_;
+
+    /// Tile render routine
+    fetch_fn fetch_;
+
+    /// Prefetch limits
+    options opts_;
+
+    /// Guards buckets_ and pending_
+    std::mutex mutex_;
+
+    /// Rate limits by client
+    std::unordered_map<std::string, bucket> buckets_;
+
+    /// Tiles queued but not yet rendered (tile_cache::key_string)
+    std::unordered_set<std::string> pending_;
+
+    /// Counters for stats
+    std::atomic<uint64_t> queued_{0}, limited_{0}, full_{0};
+};
+
+}; // ~namespace encviz
@@ -0,0 +1,64 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Tile URL Parser
+ *
+ * Parses tile request paths (/<STYLE>/{z}/{y}/{x}[.ext], WMTS coordinates)
+ * in place, without allocating, and checks the tile exists before anything
+ * is looked up or rendered.
+ */
+
+#include <string_view>
+#include <encviz/tile_encoder.h>
+
+namespace encviz
+{
+
+/// Parsed tile request
+struct tile_url
+{
+    /// Deepest zoom served
+    static constexpr int MAX_ZOOM = 30;
+
+    /// Longest style name (characters)
+    static constexpr std::size_t MAX_STYLE = 64;
+
+    /// Style name (points into the parsed path)
+    std::string_view style;
+
+    /// Tile Z coordinate (zoom)
+    int z{0};
+
+    /// Tile Y coordinate (vertical, 0 at the north)
+    int y{0};
+
+    /// Tile X coordinate (horizontal)
+    int x{0};
+
+    /// Image format (PNG if there is no extension)
+    tile_format format{tile_format::PNG};
+};
+
+/// Tile URL parse result
+enum class tile_url_status
+{
+    OK,
+    INVALID,        ///< Not a tile path
+    OUT_OF_RANGE,   ///< Zoom, row or column outside the tile matrix
+    UNKNOWN_FORMAT  ///< Extension is not a tile format
+};
+
+/**
+ * Parse Tile URL
+ *
+ * Style names may hold letters, digits, '_' and '-' only, so they are safe
+ * to use in cache paths.
+ *
+ * \param[in] path Request path (without query string)
+ * \param[out] url Parsed tile, valid while path is
+ * \return Parse result, url is only set on OK
+ */
+tile_url_status parse_tile_url(std::string_view path, tile_url &url);
+
+}; // ~namespace encviz
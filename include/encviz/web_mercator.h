@@ -9,6 +9,7 @@
  */
 
 #include <cstddef>
+#include <cstdint>
 #include <ogr_core.h>
 #include <ogr_geometry.h>
 #include <encviz/common.h>
@@ -28,9 +29,12 @@ public:
      * \param[in] y Tile z coordinate
      * \param[in] tc Tile coordinate system (WTMS or XYZ)
      * \param[in] tile_size Tile side length in pixels
+     * \param[in] span Tiles per side, mapping a (span x span) block of tiles
+     *                 with x,y at its bottom left (XYZ) / top left (WTMS)
      */
     web_mercator(std::size_t x, std::size_t y, std::size_t z,
-                 tile_coords tc = tile_coords::XYZ, int tile_size = 256);
+                 tile_coords tc = tile_coords::XYZ, int tile_size = 256,
+                 std::size_t span = 1);
 
     /**
      * Get bounding box in meters (EPSG:3875)
@@ -78,6 +82,20 @@ public:
      */
     coord pixels_to_meters(const coord &in) const;
 
+    /**
+     * Convert coordinates from degrees to pixels (batch)
+     *
+     * Latitudes within the Web Mercator limits (+/-85.0511) go through a
+     * cubic interpolated table instead of log(tan()), in a loop the
+     * compiler can vectorize. Results are within 0.01 pixel of
+     * point_to_pixels() up to zoom 20.
+     *
+     * \param[in] in Input coordinates (deg)
+     * \param[out] out Output coordinates (pixels), may be the same as in
+     * \param[in] n Number of coordinates
+     */
+    void deg_to_pixels(const coord *in, coord *out, std::size_t n) const;
+
     /**
      * Convert OGR Point to pixels
      *
@@ -106,4 +124,14 @@ private:
     OGREnvelope bbox_m_;
 };
 
+/**
+ * Hilbert Curve Distance
+ *
+ * \param[in] order Curve covers (2^order x 2^order) cells
+ * \param[in] x Cell column
+ * \param[in] y Cell row
+ * \return Position of cell along the curve
+ */
+uint64_t hilbert_distance(int order, uint64_t x, uint64_t y);
+
 }; // ~namespace encviz
@@ -0,0 +1,139 @@
+#pragma once
+
+/**
+ * \file
+ * \brief Worker Pool
+ *
+ * Fixed size pool of worker threads servicing a bounded job queue, with a
+ * second low priority queue for speculative work (prefetch) that only runs
+ * when no foreground job is waiting.
+ */
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+
+namespace encviz
+{
+
+/// Fixed size thread pool with a bounded queue
+class worker_pool
+{
+public:
+
+    /// Unit of work
+    typedef std::function<void()> job;
+
+    /**
+     * Constructor
+     *
+     * \param[in] nthreads Number of worker threads (0 = one per core)
+     * \param[in] max_queue Maximum number of waiting jobs (0 = four per worker)
+     */
+    worker_pool(std::size_t nthreads = 0, std::size_t max_queue = 0);
+
+    /**
+     * Destructor
+     *
+     * Finishes any queued jobs before joining workers.
+     */
+    ~worker_pool();
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool &operator=(const worker_pool &) = delete;
+
+    /**
+     * Queue Job Without Blocking
+     *
+     * \param[in] j Job to run
+     * \return False if the queue is full
+     */
+    bool try_submit(job j);
+
+    /**
+     * Queue Background Job Without Blocking
+     *
+     * Background jobs start only while no foreground job is waiting, on at
+     * most half the workers, and are dropped on shutdown.
+     *
+     * \param[in] j Job to run
+     * \return False if the background queue is full
+     */
+    bool try_submit_background(job j);
+
+    /**
+     * Stop Workers
+     *
+     * Finishes any queued jobs and joins workers, later submits are refused.
+     * Safe to call more than once.
+     */
+    void shutdown();
+
+    /**
+     * Get Number of Workers
+     *
+     * \return Worker thread count
+     */
+    std::size_t size() const;
+
+    /**
+     * Get Queue Capacity
+     *
+     * \return Maximum number of waiting jobs
+     */
+    std::size_t capacity() const;
+
+    /**
+     * Get Number of Waiting Jobs
+     *
+     * \return Jobs queued but not yet started
+     */
+    std::size_t queued() const;
+
+private:
+
+    /**
+     * Worker Thread Main Loop
+     */
+    void run();
+
+    /**
+     * Check Background Job Can Start
+     *
+     * \return True if one is waiting and a background slot is free
+     */
+    bool background_ready() const;
+
+    /// Protects queue and stop flag
+    mutable std::mutex mutex_;
+
+    /// Signalled when jobs are queued or stopping
+    std::condition_variable wake_;
+
+    /// Waiting jobs
+    std::deque<job> queue_;
+
+    /// Maximum number of waiting jobs
+    std::size_t max_queue_;
+
+    /// Waiting background jobs (up to max_queue_)
+    std::deque<job> background_;
+
+    /// Background jobs running
+    std::size_t background_running_{0};
+
+    /// Most background jobs running at once
+    std::size_t max_background_;
+
+    /// Set when workers should exit
+    bool stop_{false};
+
+    /// Worker threads
+    std::vector<std::thread> workers_;
+};
+
+}; // ~namespace encviz
@@ -34,9 +34,8 @@ int main(int argc, char **argv)
     encviz::enc_dataset enc_dataset;
     enc_dataset.load_charts("/home/will/charts/RI_ENCs/ENC_ROOT");
 
-    // Create dataset
-    GDALDataset *enc_data = GetGDALDriverManager()->GetDriverByName("Memory")->
-      Create("", 0, 0, 0, GDT_Unknown, nullptr);
+    // Create tile feature container
+    encviz::tile_data enc_data;
 
     // Bounds and zoom
     OGREnvelope bbox;
@@ -50,10 +49,12 @@ int main(int argc, char **argv)
 
     std::cout << "-----------RESULT----------------" << std::endl;
 
-    OGRLayer *olayer = enc_data->GetLayerByName("LNDARE");
-    for (const auto &feat : olayer)
+    const encviz::tile_data::layer *olayer = enc_data.get_layer("LNDARE");
+    for (std::size_t i = 0; olayer != nullptr && i < olayer->size(); i++)
     {
-      std::cout << feat->DumpReadableAsString() << std::endl;
+      const encviz::tile_feature &feat = (*olayer)[i];
+      std::cout << feat.attrs->DumpReadableAsString() << std::endl;
+      std::cout << "  TILE GEOMETRY: " << feat.geo->exportToWkt() << std::endl;
     }
 
     GDALDestroy();
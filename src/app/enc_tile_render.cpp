@@ -25,7 +25,7 @@ void usage(int exit_code)
            "Options:\n"
            "  -h         - Show help\n"
            "  -c <path>  - Set config directory (default=~/.config)\n"
-           "  -o <file>  - Set output file (default=out.png)\n"
+           "  -o <file>  - Set output file, .png, .webp or .mvt (default=out.png)\n"
            "  -s <name>  - Set render style (default=default)\n"
            "\n"
            "Where:\n"
@@ -83,17 +83,26 @@ int main(int argc, char **argv)
     int y = std::atoi(argv[optind + 1]);
     int z = std::atoi(argv[optind + 2]);
 
+    // Image format from output extension
+    encviz::tile_format fmt = encviz::tile_format::PNG;
+    std::string ext = std::filesystem::path(out_file).extension().string();
+    if (!ext.empty() && !encviz::parse_tile_format(ext.substr(1), fmt))
+    {
+        printf("Unknown output format: %s\n", ext.c_str());
+        usage(1);
+    }
+
     // Global GDAL Initialization
     GDALAllRegister();
 
-    std::vector<uint8_t> png_bytes;
+    std::vector<uint8_t> tile_bytes;
     encviz::enc_renderer enc_rend(config_path);
-    enc_rend.render(png_bytes, tc, x, y, z, style_name);
+    enc_rend.render(tile_bytes, tc, x, y, z, style_name, fmt);
 
     // Dump to file
-    printf("Writing %lu bytes\n", png_bytes.size());
+    printf("Writing %lu bytes\n", tile_bytes.size());
     FILE *ohandle = fopen(out_file.c_str(), "wb");
-    fwrite(png_bytes.data(), 1, png_bytes.size(), ohandle);
+    fwrite(tile_bytes.data(), 1, tile_bytes.size(), ohandle);
     fclose(ohandle);
 
     GDALDestroy();
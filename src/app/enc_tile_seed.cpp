@@ -0,0 +1,462 @@
+/**
+ * \file
+ * \brief ENC Tile Seeder (Command Line)
+ *
+ * Pre-renders every tile of a bounding box over a range of zooms into the
+ * disk tile cache, so a server starts out warm after a chart update, or into
+ * an MBTiles / PMTiles archive for serving without the charts.
+ *
+ * Tiles (or metatiles) are visited in Hilbert curve order per zoom, so
+ * neighbouring work items share charts in the chart cache, and are spread
+ * across worker threads that share one renderer.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <gdal.h>
+#include <encviz/enc_renderer.h>
+#include <encviz/tile_archive.h>
+#include <encviz/web_mercator.h>
+
+namespace fs = std::filesystem;
+
+/// Seconds between progress reports
+static const int REPORT_INTERVAL = 5;
+
+/// One render request (XYZ tile coordinates)
+struct seed_item
+{
+    /// Index into style list
+    std::size_t style;
+
+    /// Zoom
+    int z;
+
+    /// Horizontal tile coordinate
+    int x;
+
+    /// Vertical tile coordinate
+    int y;
+};
+
+void usage(int exit_code)
+{
+    printf("Usage:\n"
+           "  enc_tile_seed [opts] <MIN_LON> <MIN_LAT> <MAX_LON> <MAX_LAT>\n"
+           "\n"
+           "Options:\n"
+           "  -h          - Show help\n"
+           "  -c <path>   - Set config file (default=~/.encviz/config.xml)\n"
+           "  -z <Z0-Z1>  - Set zoom range (default=6-16)\n"
+           "  -s <names>  - Set comma separated render styles (default=default)\n"
+           "  -f <fmt>    - Set tile format, png, webp or mvt (default=png)\n"
+           "  -t <num>    - Set worker threads (default=one per core)\n"
+           "  -r <file>   - Resume from / record progress in state file\n"
+           "  -o <file>   - Write tiles to .mbtiles or .pmtiles archive (one style)\n");
+    exit(exit_code);
+}
+
+/**
+ * Tile Containing Coordinate
+ *
+ * \param[in] lon Longitude (deg)
+ * \param[in] lat Latitude (deg)
+ * \param[in] z Zoom
+ * \param[out] x Tile column (XYZ)
+ * \param[out] y Tile row (XYZ, 0 at south)
+ */
+static void deg_to_tile(double lon, double lat, int z, int &x, int &y)
+{
+    encviz::web_mercator world(0, 0, 0);
+    OGREnvelope bbox = world.get_bbox_meters();
+    encviz::coord m = world.deg_to_meters({lon, lat});
+
+    int ntiles = 1 << z;
+    double fx = (m.x - bbox.MinX) / (bbox.MaxX - bbox.MinX);
+    double fy = (m.y - bbox.MinY) / (bbox.MaxY - bbox.MinY);
+    x = std::clamp(int(std::floor(fx * ntiles)), 0, ntiles - 1);
+    y = std::clamp(int(std::floor(fy * ntiles)), 0, ntiles - 1);
+}
+
+/**
+ * Split Comma Separated List
+ */
+static std::vector<std::string> split_list(const std::string &input)
+{
+    std::vector<std::string> tokens;
+    std::stringstream ss(input);
+    std::string token;
+    while (std::getline(ss, token, ','))
+    {
+        if (!token.empty())
+        {
+            tokens.push_back(token);
+        }
+    }
+    return tokens;
+}
+
+/**
+ * Read Resume State
+ *
+ * \param[in] path State file
+ * \param[in] job Job description, state is ignored if it doesn't match
+ * \return Number of leading work items already done
+ */
+static std::size_t read_state(const fs::path &path, const std::string &job)
+{
+    std::ifstream handle(path.string().c_str());
+    std::string saved_job;
+    std::size_t done = 0;
+    if (!std::getline(handle, saved_job) || !(handle >> done) || saved_job != job)
+    {
+        return 0;
+    }
+    return done;
+}
+
+/**
+ * Write Resume State
+ *
+ * \param[in] path State file
+ * \param[in] job Job description
+ * \param[in] done Number of leading work items done
+ */
+static void write_state(const fs::path &path, const std::string &job, std::size_t done)
+{
+    // Replace atomically, an interrupted write must not lose progress
+    fs::path tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream handle(tmp_path.string().c_str());
+        handle << job << "\n" << done << "\n";
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+}
+
+int main(int argc, char **argv)
+{
+    int opt;
+    const char *config_file = nullptr;
+    int z_min = 6;
+    int z_max = 16;
+    std::vector<std::string> styles = {"default"};
+    encviz::tile_format fmt = encviz::tile_format::PNG;
+    std::size_t nthreads = 0;
+    fs::path state_path;
+    fs::path archive_path;
+
+    // Parse args
+    while ((opt = getopt(argc, argv, "hc:z:s:f:t:r:o:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h':
+                // Help text
+                usage(0);
+                break;
+
+            case 'c':
+                // Set config path
+                config_file = optarg;
+                break;
+
+            case 'z':
+                // Set zoom range
+                if (sscanf(optarg, "%d-%d", &z_min, &z_max) == 1)
+                {
+                    z_max = z_min;
+                }
+                break;
+
+            case 's':
+                // Set styles
+                styles = split_list(optarg);
+                break;
+
+            case 'f':
+                // Set tile format
+                if (!encviz::parse_tile_format(optarg, fmt) ||
+                    !encviz::tile_encoder::supports(fmt))
+                {
+                    printf("Unsupported tile format: %s\n", optarg);
+                    usage(1);
+                }
+                break;
+
+            case 't':
+                // Set worker count
+                nthreads = std::atoi(optarg);
+                break;
+
+            case 'r':
+                // Set resume state file
+                state_path = optarg;
+                break;
+
+            case 'o':
+                // Set output archive
+                archive_path = optarg;
+                break;
+
+            default:
+                // Invalid arg / missing argument
+                usage(1);
+                break;
+        }
+    }
+    if ((argc - optind) < 4 || styles.empty() ||
+        z_min < 0 || z_max < z_min || z_max > 30)
+    {
+        usage(1);
+    }
+    if (!archive_path.empty() && styles.size() != 1)
+    {
+        printf("An archive holds a single style\n");
+        usage(1);
+    }
+    double min_lon = std::atof(argv[optind + 0]);
+    double min_lat = std::atof(argv[optind + 1]);
+    double max_lon = std::atof(argv[optind + 2]);
+    double max_lat = std::atof(argv[optind + 3]);
+    if (nthreads == 0)
+    {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Global GDAL Initialization
+    GDALAllRegister();
+
+    encviz::enc_renderer enc_rend(config_file);
+    if (archive_path.empty() && !enc_rend.has_tile_disk_cache())
+    {
+        printf("No disk tile cache configured (tile_cache_path), nothing to seed\n");
+        return 1;
+    }
+
+    // Work list, one item per tile or metatile
+    std::vector<seed_item> items;
+    int metatile = enc_rend.get_metatile_size();
+    for (std::size_t style = 0; style < styles.size(); style++)
+    {
+        for (int z = z_min; z <= z_max; z++)
+        {
+            int x0, y0, x1, y1;
+            deg_to_tile(min_lon, min_lat, z, x0, y0);
+            deg_to_tile(max_lon, max_lat, z, x1, y1);
+
+            // Each item is a whole metatile, vector tiles included (they are
+            // rendered one at a time within it)
+            int span = std::min(metatile, 1 << z);
+            x0 -= x0 % span;
+            y0 -= y0 % span;
+
+            std::vector<std::pair<uint64_t, seed_item>> level;
+            for (int x = x0; x <= x1; x += span)
+            {
+                for (int y = y0; y <= y1; y += span)
+                {
+                    uint64_t d = encviz::hilbert_distance(z, x / span, y / span);
+                    level.push_back({d, seed_item{style, z, x, y}});
+                }
+            }
+            std::sort(level.begin(), level.end(),
+                      [](const auto &a, const auto &b) { return a.first < b.first; });
+            for (const auto &it : level)
+            {
+                items.push_back(it.second);
+            }
+        }
+    }
+
+    // Resume where a previous run (with the same job and charts) stopped
+    std::ostringstream job;
+    job << enc_rend.get_generation() << " " << tile_format_extension(fmt) << " "
+        << z_min << "-" << z_max << " " << min_lon << "," << min_lat << ","
+        << max_lon << "," << max_lat << " metatile=" << metatile;
+    for (const std::string &style : styles)
+    {
+        job << " " << style;
+    }
+    if (!archive_path.empty())
+    {
+        job << " " << archive_path.string();
+    }
+    std::size_t start = state_path.empty() ? 0 : read_state(state_path, job.str());
+
+    // Open archive, only kept across runs if its format allows
+    std::unique_ptr<encviz::tile_archive_writer> archive;
+    if (!archive_path.empty())
+    {
+        encviz::archive_info info;
+        info.name = styles.front();
+        info.format = fmt;
+        info.min_zoom = z_min;
+        info.max_zoom = z_max;
+        info.bounds.MinX = min_lon;
+        info.bounds.MinY = min_lat;
+        info.bounds.MaxX = max_lon;
+        info.bounds.MaxY = max_lat;
+        try
+        {
+            archive = encviz::create_tile_archive(archive_path, info, start > 0);
+        }
+        catch (const std::exception &e)
+        {
+            printf("%s\n", e.what());
+            return 1;
+        }
+        if (start > 0 && !archive->can_resume())
+        {
+            printf("Cannot resume into %s, starting over\n", archive_path.string().c_str());
+            start = 0;
+        }
+    }
+    start = std::min(start, items.size());
+    printf("Seeding %lu work items (%lu already done) with %lu threads\n",
+           items.size(), start, nthreads);
+
+    // Workers pull items in order, the first unfinished one bounds the resume point
+    std::atomic<std::size_t> next{start};
+    std::vector<char> finished(items.size(), 0);
+    std::mutex progress_mutex;
+    std::size_t watermark = start;
+    std::size_t rendered = 0;
+    std::size_t empty = 0;
+    std::size_t tiles_done = 0;
+    std::atomic<bool> failed{false};
+
+    auto worker = [&]() {
+        while (!failed)
+        {
+            std::size_t i = next++;
+            if (i >= items.size())
+            {
+                break;
+            }
+
+            // Every tile of the metatile, from one render (vector tiles
+            // one at a time), so none are skipped because one is cached
+            const seed_item &item = items[i];
+            std::vector<std::pair<encviz::tile_key, encviz::tile_ptr>> tiles;
+            bool have_data = false;
+            try
+            {
+                have_data = enc_rend.get_metatile_tiles(tiles, item.x, item.y, item.z,
+                                                        styles[item.style].c_str(), fmt);
+                if (archive != nullptr)
+                {
+                    for (const auto &[key, sub] : tiles)
+                    {
+                        archive->put(key.z, key.x, key.y, sub->data);
+                    }
+                }
+            }
+            catch (const std::exception &e)
+            {
+                printf("Render error (%s %d/%d/%d): %s\n", styles[item.style].c_str(),
+                       item.z, item.x, item.y, e.what());
+                failed = true;
+                break;
+            }
+
+            std::lock_guard<std::mutex> lock(progress_mutex);
+            finished[i] = 1;
+            (have_data ? rendered : empty)++;
+            tiles_done += tiles.size();
+            while (watermark < items.size() && finished[watermark])
+            {
+                watermark++;
+            }
+        }
+    };
+
+    auto seed_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < nthreads; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    // Report on progress until workers finish
+    auto report = [&](bool final) {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                       seed_start).count();
+        std::size_t done = rendered + empty;
+        double rate = (elapsed > 0) ? done / elapsed : 0;
+        double tile_rate = (elapsed > 0) ? tiles_done / elapsed : 0;
+        std::size_t remaining = items.size() - start - done;
+        printf("Seed %s: %lu/%lu items, %.1f items/sec (%.1f tiles/sec), "
+               "%lu empty, ETA %.0f sec\n", final ? "done" : "progress",
+               start + done, items.size(), rate, tile_rate, empty,
+               (rate > 0) ? remaining / rate : 0.0);
+        if (!state_path.empty())
+        {
+            // Items below the watermark are done, commit their tiles first
+            try
+            {
+                if (archive != nullptr)
+                {
+                    archive->flush();
+                }
+                write_state(state_path, job.str(), watermark);
+            }
+            catch (const std::exception &e)
+            {
+                printf("Archive error, progress not saved: %s\n", e.what());
+                failed = true;
+            }
+        }
+    };
+    while (true)
+    {
+        for (int i = 0; i < REPORT_INTERVAL * 10; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (next >= items.size() + nthreads || failed)
+            {
+                break;
+            }
+        }
+        if (next >= items.size() + nthreads || failed)
+        {
+            break;
+        }
+        report(false);
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    report(true);
+
+    if (archive != nullptr)
+    {
+        try
+        {
+            archive->finish();
+        }
+        catch (const std::exception &e)
+        {
+            printf("%s\n", e.what());
+            failed = true;
+        }
+    }
+
+    GDALDestroy();
+    return failed ? 1 : 0;
+}
@@ -8,23 +8,106 @@
  * NOTE: Set your tile server to:
  *   http://127.0.0.1:8888/<STYLE>/{z}/{y}/{x}.png
  *
+ * or {x}.webp for WebP tiles (when built with libwebp), {x}.mvt for vector
+ * tiles.
+ *
  * Where "STYLE" is one of the defined chart styles (ie - "default"), and X/Y/Z
  * refer to the WTMS tile coordinates.
+ *
+ * Connections are served by a few epoll event loop threads. Renders are
+ * handed to a fixed size worker pool while the connection is suspended, so
+ * neither idle keep-alive connections nor slow renders hold a thread. When
+ * the worker queue is full the server answers with 503 so clients back off.
+ * Identical requests that arrive while a tile is rendering share that render.
+ * Idle workers prefetch the neighbors and children of requested tiles, rate
+ * limited per client, so panning and zooming in mostly hit the cache.
+ *
+ * Styles can also be served from MBTiles / PMTiles archives (-m), rendering
+ * live only for tiles the archive doesn't have. PMTiles tiles are sent
+ * straight out of the archive mapping without copying.
+ *
+ * Render latency histograms and cache counters are served at /metrics in
+ * the Prometheus text format. The server runs until SIGINT or SIGTERM.
+ *
+ * Response bodies are never copied: rendered tiles are sent from the cached
+ * buffer (held until MHD is done with it) and disk cache hits go out with
+ * sendfile().
  */
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <ctime>
 #include <iostream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
 #include <sys/types.h>
 #include <sys/select.h>
 #include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
 #include <microhttpd.h>
 #include <encviz/enc_renderer.h>
+#include <encviz/log.h>
+#include <encviz/tile_archive.h>
+#include <encviz/tile_prefetcher.h>
+#include <encviz/tile_url.h>
+#include <encviz/worker_pool.h>
 
 #define PORT 8888
 
+/// State shared by all connections
+struct server_context
+{
+    /// Tile renderer (thread safe)
+    encviz::enc_renderer *renderer;
+
+    /// Render workers
+    encviz::worker_pool *pool;
+
+    /// Cache-Control max-age for tiles (seconds)
+    int max_age;
+
+    /// Pre-rendered tile archives, by style name
+    std::map<std::string, std::unique_ptr<encviz::tile_archive_reader>> archives;
+
+    /// Background renders around requested tiles (null if off)
+    encviz::tile_prefetcher *prefetch;
+
+    /// Proxy address whose X-Forwarded-For is believed (empty = none)
+    std::string trusted_proxy;
+};
+
+/// HTTP status codes counted for /metrics
+static const std::array<int, 7> COUNTED_CODES = {200, 304, 400, 404, 500, 503, 0};
+
+/// Responses sent, by COUNTED_CODES index (0 = any other code)
+static std::array<std::atomic<uint64_t>, COUNTED_CODES.size()> responses;
+
+/**
+ * Count Response
+ *
+ * \param[in] code HTTP status code
+ */
+static void count_response(int code)
+{
+    std::size_t i = 0;
+    while (i + 1 < COUNTED_CODES.size() && COUNTED_CODES[i] != code)
+    {
+        i++;
+    }
+    responses[i].fetch_add(1, std::memory_order_relaxed);
+    ENCVIZ_LOG(debug, " - HTTP %d\n", code);
+}
+
 void usage(int exit_code)
 {
     printf("Usage:\n"
@@ -32,80 +115,431 @@ void usage(int exit_code)
            "\n"
            "Options:\n"
            "  -h         - Show help\n"
-           "  -c <path>  - Set config file (default=~/.encviz/config.xml)\n");
+           "  -c <path>  - Set config file (default=~/.encviz/config.xml)\n"
+           "  -t <num>   - Set render worker threads (default=one per core)\n"
+           "  -q <num>   - Set max queued renders before 503 (default=4x threads)\n"
+           "  -a <sec>   - Set tile Cache-Control max-age (default=3600)\n"
+           "  -n <num>   - Set connection threads (default=2)\n"
+           "  -k <sec>   - Set idle keep-alive connection timeout (default=60)\n"
+           "  -p <num>   - Set prefetch renders per second per client (default=12, 0=off)\n"
+           "  -x <addr>  - Trust X-Forwarded-For from this proxy address\n"
+           "  -m <style>:<path> - Serve style from .mbtiles/.pmtiles archive (repeatable)\n");
     exit(exit_code);
 }
 
-std::vector<std::string> string_split(std::string input)
+/**
+ * Create Response Owning Its Body
+ *
+ * MHD sends straight from the buffer and deletes the owner once the response
+ * is destroyed, possibly after the handler has returned.
+ *
+ * \param[in] owner Heap allocated object keeping data alive (taken over)
+ * \param[in] data Body bytes
+ * \param[in] size Body size (bytes)
+ * \return Response, or null on failure
+ */
+template <typename T>
+MHD_Response *owned_response(T *owner, const void *data, size_t size)
 {
-    std::vector<std::string> tokens;
-    size_t pos;
-    while ((pos = input.find('/')) != std::string::npos)
+    MHD_Response *resp = MHD_create_response_from_buffer_with_free_callback_cls(
+        size, data, [](void *cls) { delete (T*)cls; }, owner);
+    if (resp == nullptr)
     {
-        tokens.push_back(input.substr(0, pos));
-        input = input.substr(pos + 1);
+        delete owner;
     }
-    tokens.push_back(input);
-
-    return tokens;
+    return resp;
 }
 
 MHD_Result request_reply(MHD_Connection *conn, int code, const void *data, int len)
 {
-    MHD_Response *resp = MHD_create_response_from_buffer(len, (void*)data, MHD_RESPMEM_MUST_COPY);
+    // Messages are string literals
+    MHD_Response *resp = MHD_create_response_from_buffer(len, (void*)data, MHD_RESPMEM_PERSISTENT);
+    MHD_Result ret = MHD_queue_response(conn, code, resp);
+    MHD_destroy_response(resp);
+    count_response(code);
+    return ret;
+}
+
+MHD_Result image_reply(MHD_Connection *conn, const std::function<MHD_Response*()> &make_body,
+                       const std::string &etag, time_t modified,
+                       encviz::tile_format fmt, int max_age)
+{
+    // Client may already have this exact tile
+    const char *if_none_match = MHD_lookup_connection_value(conn, MHD_HEADER_KIND,
+                                                            MHD_HTTP_HEADER_IF_NONE_MATCH);
+    bool not_modified = (if_none_match != nullptr) &&
+        (strstr(if_none_match, etag.c_str()) != nullptr ||
+         strcmp(if_none_match, "*") == 0);
+
+    int code = MHD_HTTP_OK;
+    MHD_Response *resp = nullptr;
+    if (not_modified)
+    {
+        code = MHD_HTTP_NOT_MODIFIED;
+        resp = MHD_create_response_from_buffer(0, nullptr, MHD_RESPMEM_PERSISTENT);
+    }
+    else
+    {
+        // Body only built when it will be sent
+        resp = make_body();
+        if (resp == nullptr)
+        {
+            ENCVIZ_LOG(error, "Cannot create tile response\n");
+            return MHD_NO;
+        }
+        MHD_add_response_header(resp, MHD_HTTP_HEADER_CONTENT_TYPE,
+                                encviz::tile_format_mime(fmt));
+    }
+
+    // Validators and freshness
+    char last_modified[64];
+    struct tm gmt;
+    gmtime_r(&modified, &gmt);
+    strftime(last_modified, sizeof(last_modified), "%a, %d %b %Y %H:%M:%S GMT", &gmt);
+    std::string cache_control = "public, max-age=" + std::to_string(max_age);
+    MHD_add_response_header(resp, MHD_HTTP_HEADER_ETAG, etag.c_str());
+    MHD_add_response_header(resp, MHD_HTTP_HEADER_LAST_MODIFIED, last_modified);
+    MHD_add_response_header(resp, MHD_HTTP_HEADER_CACHE_CONTROL, cache_control.c_str());
+
     MHD_Result ret = MHD_queue_response(conn, code, resp);
     MHD_destroy_response(resp);
-    printf(" - HTTP %d\n", code);
+    count_response(code);
     return ret;
 }
 
+MHD_Result tile_reply(MHD_Connection *conn, const encviz::tile_ptr &tile,
+                      encviz::tile_format fmt, int max_age)
+{
+    auto make_body = [&]() -> MHD_Response* {
+        if (tile->fd >= 0)
+        {
+            // Disk cache file, sent by the kernel (MHD closes its descriptor)
+            int fd = dup(tile->fd);
+            if (fd < 0)
+            {
+                return nullptr;
+            }
+            MHD_Response *resp = MHD_create_response_from_fd(tile->size, fd);
+            if (resp == nullptr)
+            {
+                close(fd);
+            }
+            return resp;
+        }
+
+        // Rendered / memory cached buffer, kept alive until sent
+        return owned_response(new encviz::tile_ptr(tile), tile->data.data(), tile->data.size());
+    };
+    return image_reply(conn, make_body, tile->etag, tile->modified, fmt, max_age);
+}
+
+MHD_Result metrics_reply(MHD_Connection *conn, const server_context *ctx)
+{
+    std::string *body = new std::string;
+    std::string &text = *body;
+    ctx->renderer->write_metrics(text);
+
+    char line[128];
+    text += "# HELP encviz_http_responses_total HTTP responses by status code.\n";
+    text += "# TYPE encviz_http_responses_total counter\n";
+    for (std::size_t i = 0; i < COUNTED_CODES.size(); i++)
+    {
+        std::string code = COUNTED_CODES[i] ? std::to_string(COUNTED_CODES[i]) : "other";
+        snprintf(line, sizeof(line), "encviz_http_responses_total{code=\"%s\"} %lu\n",
+                 code.c_str(), (unsigned long)responses[i].load(std::memory_order_relaxed));
+        text += line;
+    }
+    snprintf(line, sizeof(line),
+             "# HELP encviz_render_queue Renders waiting for a worker.\n"
+             "# TYPE encviz_render_queue gauge\n"
+             "encviz_render_queue %lu\n", ctx->pool->queued());
+    text += line;
+
+    if (ctx->prefetch != nullptr)
+    {
+        encviz::tile_prefetcher::stats stats = ctx->prefetch->get_stats();
+        snprintf(line, sizeof(line),
+                 "# HELP encviz_prefetch_total Background prefetches by result.\n"
+                 "# TYPE encviz_prefetch_total counter\n"
+                 "encviz_prefetch_total{result=\"queued\"} %lu\n"
+                 "encviz_prefetch_total{result=\"limited\"} %lu\n"
+                 "encviz_prefetch_total{result=\"full\"} %lu\n",
+                 (unsigned long)stats.queued, (unsigned long)stats.limited,
+                 (unsigned long)stats.full);
+        text += line;
+    }
+
+    MHD_Response *resp = owned_response(body, text.data(), text.size());
+    if (resp == nullptr)
+    {
+        return MHD_NO;
+    }
+    MHD_add_response_header(resp, MHD_HTTP_HEADER_CONTENT_TYPE,
+                            "text/plain; version=0.0.4");
+    MHD_Result ret = MHD_queue_response(conn, MHD_HTTP_OK, resp);
+    MHD_destroy_response(resp);
+    count_response(MHD_HTTP_OK);
+    return ret;
+}
+
+/**
+ * Identify Client
+ *
+ * \param[in] conn Connection
+ * \param[in] trusted_proxy Proxy address whose X-Forwarded-For is believed
+ * \return Client address
+ */
+std::string client_id(MHD_Connection *conn, const std::string &trusted_proxy)
+{
+    char addr[INET6_ADDRSTRLEN] = "";
+    const MHD_ConnectionInfo *info =
+        MHD_get_connection_info(conn, MHD_CONNECTION_INFO_CLIENT_ADDRESS);
+    if (info != nullptr && info->client_addr != nullptr)
+    {
+        const sockaddr *sa = info->client_addr;
+        if (sa->sa_family == AF_INET)
+        {
+            inet_ntop(AF_INET, &((const sockaddr_in*)sa)->sin_addr, addr, sizeof(addr));
+        }
+        else if (sa->sa_family == AF_INET6)
+        {
+            inet_ntop(AF_INET6, &((const sockaddr_in6*)sa)->sin6_addr, addr, sizeof(addr));
+        }
+    }
+    if (trusted_proxy.empty() || trusted_proxy != addr)
+    {
+        // Anyone else could make up a new identity per request
+        return addr;
+    }
+
+    // Behind the proxy every request comes from it, use the hop it added
+    // (earlier ones were sent by the client and may be made up)
+    const char *forwarded = MHD_lookup_connection_value(conn, MHD_HEADER_KIND,
+                                                        "X-Forwarded-For");
+    if (forwarded == nullptr)
+    {
+        return addr;
+    }
+    std::string hops(forwarded);
+    std::size_t end = hops.find_last_not_of(" \t");
+    if (end == std::string::npos)
+    {
+        return addr;
+    }
+    std::size_t start = hops.find_last_of(", \t", end);
+    start = (start == std::string::npos) ? 0 : start + 1;
+    return hops.substr(start, end + 1 - start);
+}
+
+/// Render handed to the worker pool, kept across suspend / resume
+struct render_request
+{
+    /// Style name
+    std::string style;
+
+    /// Requested tile (WMTS)
+    int x, y, z;
+
+    /// Image format
+    encviz::tile_format fmt;
+
+    /// Rendered tile (null if nothing to render)
+    encviz::tile_ptr tile;
+
+    /// Set if the worker queue was full
+    bool busy{false};
+
+    /// Set if the render failed
+    bool failed{false};
+};
+
+MHD_Result render_result_reply(MHD_Connection *conn, const render_request *req,
+                               const server_context *ctx)
+{
+    if (req->busy)
+    {
+        // Too much work backed up, ask client to retry later
+        const char *msg = "Server busy";
+        MHD_Response *resp = MHD_create_response_from_buffer(strlen(msg), (void*)msg,
+                                                             MHD_RESPMEM_PERSISTENT);
+        MHD_add_response_header(resp, "Retry-After", "1");
+        MHD_Result ret = MHD_queue_response(conn, MHD_HTTP_SERVICE_UNAVAILABLE, resp);
+        MHD_destroy_response(resp);
+        count_response(MHD_HTTP_SERVICE_UNAVAILABLE);
+        return ret;
+    }
+    if (req->failed)
+    {
+        const char *msg = "Render error";
+        return request_reply(conn, MHD_HTTP_INTERNAL_SERVER_ERROR, msg, strlen(msg));
+    }
+    if (req->tile)
+    {
+        // Respond with rendered data
+        return tile_reply(conn, req->tile, req->fmt, ctx->max_age);
+    }
+
+    // Nothing available, so 404 ...
+    return request_reply(conn, MHD_HTTP_NOT_FOUND, nullptr, 0);
+}
+
+void request_completed(void *cls, struct MHD_Connection *connection,
+                       void **req_cls, enum MHD_RequestTerminationCode toe)
+{
+    delete (render_request*)*req_cls;
+    *req_cls = nullptr;
+}
+
 MHD_Result request_handler(void *cls, struct MHD_Connection *connection,
 			   const char *url, const char *method,
 			   const char *version, const char *upload_data,
 			   size_t *upload_data_size, void **req_cls)
 {
-    // Parse URL
-    printf("URL: %s\n", url);
-    std::vector<std::string> tokens = string_split(url);
-    if (tokens.size() != 5)
+    // Get shared server state
+    server_context *ctx = (server_context*)cls;
+
+    // Resumed once the worker pool is done with our render
+    if (*req_cls != nullptr)
+    {
+        return render_result_reply(connection, (render_request*)*req_cls, ctx);
+    }
+
+    // Metrics are not tiles (and not counted as responses)
+    if (strcmp(url, "/metrics") == 0)
     {
-	const char *msg = "Invalid URL";
-	return request_reply(connection, MHD_HTTP_BAD_REQUEST,
-			     msg, strlen(msg));
+        return metrics_reply(connection, ctx);
     }
-    std::string style_name = tokens[1];
-    int z = std::stoi(tokens[2]);
-    int y = std::stoi(tokens[3]);
-    int x = std::stoi(tokens[4]);
 
-    // Get passed SQLite DB
-    encviz::enc_renderer *enc_rend = (encviz::enc_renderer*)cls;
+    // Parse URL, tiles outside the matrix never reach the renderer
+    ENCVIZ_LOG(debug, "URL: %s\n", url);
+    encviz::tile_url tile_url;
+    switch (encviz::parse_tile_url(url, tile_url))
+    {
+        case encviz::tile_url_status::OK:
+            break;
+
+        case encviz::tile_url_status::OUT_OF_RANGE:
+        {
+            const char *msg = "Tile out of range";
+            return request_reply(connection, MHD_HTTP_NOT_FOUND, msg, strlen(msg));
+        }
 
-    // Render requested tile
-    std::vector<uint8_t> out_bytes;
-    printf("Tile X=%d, Y=%d, Z=%d\n", x, y, z);
-    if (enc_rend->render(out_bytes, encviz::tile_coords::WTMS, x, y, z,
-                         style_name.c_str()))
+        case encviz::tile_url_status::UNKNOWN_FORMAT:
+        {
+            const char *msg = "Unsupported tile format";
+            return request_reply(connection, MHD_HTTP_NOT_FOUND, msg, strlen(msg));
+        }
+
+        default:
+        {
+            const char *msg = "Invalid URL";
+            return request_reply(connection, MHD_HTTP_BAD_REQUEST, msg, strlen(msg));
+        }
+    }
+    std::string style_name(tile_url.style);
+    int x = tile_url.x, y = tile_url.y, z = tile_url.z;
+    encviz::tile_format fmt = tile_url.format;
+    if (!encviz::tile_encoder::supports(fmt))
     {
-        // Respond with rendered data
-        return request_reply(connection, MHD_HTTP_OK,
-                             out_bytes.data(), out_bytes.size());
+        const char *msg = "Unsupported tile format";
+        return request_reply(connection, MHD_HTTP_NOT_FOUND, msg, strlen(msg));
     }
-    else
+
+    // Archived tiles are served as stored
+    ENCVIZ_LOG(debug, "Tile X=%d, Y=%d, Z=%d\n", x, y, z);
+    auto archive = ctx->archives.find(style_name);
+    if (archive != ctx->archives.end() && archive->second->get_format() == fmt)
+    {
+        // Archives count rows from the south (XYZ)
+        encviz::archive_tile stored;
+        if (archive->second->get(z, x, (1 << z) - 1 - y, stored))
+        {
+            // Mapped archive data outlives the response, copies are held by it
+            auto make_body = [&]() -> MHD_Response* {
+                if (stored.copy == nullptr)
+                {
+                    return MHD_create_response_from_buffer(stored.size, (void*)stored.data,
+                                                           MHD_RESPMEM_PERSISTENT);
+                }
+                return owned_response(new std::shared_ptr<const std::vector<uint8_t>>(stored.copy),
+                                      stored.data, stored.size);
+            };
+            return image_reply(connection, make_body, stored.etag,
+                               archive->second->get_modified(), fmt, ctx->max_age);
+        }
+    }
+
+    if (!ctx->renderer->has_style(style_name))
+    {
+        const char *msg = "Unknown style";
+        return request_reply(connection, MHD_HTTP_NOT_FOUND, msg, strlen(msg));
+    }
+
+    // Warm the tiles this client will likely ask for next (cache keys are XYZ)
+    if (ctx->prefetch != nullptr)
+    {
+        encviz::tile_key key;
+        key.style = style_name;
+        key.z = z;
+        key.x = x;
+        key.y = (1 << z) - 1 - y;
+        key.format = fmt;
+        ctx->prefetch->requested(client_id(connection, ctx->trusted_proxy), key);
+    }
+
+    // Cached tiles don't need a worker (disk hits are sent from their file)
+    encviz::tile_ptr tile = ctx->renderer->cached_tile(encviz::tile_coords::WTMS,
+                                                       x, y, z, style_name.c_str(), fmt, true);
+    if (tile)
     {
-        // Nothing available, so 404 ...
-        return request_reply(connection, MHD_HTTP_NOT_FOUND,
-                             nullptr, 0);
+        return tile_reply(connection, tile, fmt, ctx->max_age);
     }
+
+    // Park the connection and hand the render to the worker pool, this
+    // thread goes back to serving other connections meanwhile
+    render_request *req = new render_request{style_name, x, y, z, fmt};
+    *req_cls = req;
+    MHD_suspend_connection(connection);
+    bool queued = ctx->pool->try_submit([req, ctx, connection]() {
+        try
+        {
+            ctx->renderer->get_tile(req->tile, encviz::tile_coords::WTMS,
+                                    req->x, req->y, req->z, req->style.c_str(), req->fmt);
+        }
+        catch (const std::exception &e)
+        {
+            ENCVIZ_LOG(error, "Render error: %s\n", e.what());
+            req->failed = true;
+        }
+        catch (...)
+        {
+            req->failed = true;
+        }
+        MHD_resume_connection(connection);
+    });
+    if (!queued)
+    {
+        req->busy = true;
+        MHD_resume_connection(connection);
+    }
+    return MHD_YES;
 }
 
 int main(int argc, char **argv)
 {
     int opt;
     const char *config_file = nullptr;
+    std::size_t nthreads = 0;
+    std::size_t max_queue = 0;
+    int max_age = 3600;
+    unsigned int conn_threads = 2;
+    unsigned int idle_timeout = 60;
+    double prefetch_rate = 12;
+    std::string trusted_proxy;
+    std::vector<std::pair<std::string, std::string>> archive_paths;
 
     // Parse args
-    while ((opt = getopt(argc, argv, "hc:")) != -1)
+    while ((opt = getopt(argc, argv, "hc:t:q:a:n:k:p:x:m:")) != -1)
     {
         switch (opt)
         {
@@ -119,6 +553,53 @@ int main(int argc, char **argv)
                 config_file = optarg;
                 break;
 
+            case 't':
+                // Set worker count
+                nthreads = std::atoi(optarg);
+                break;
+
+            case 'q':
+                // Set queue depth
+                max_queue = std::atoi(optarg);
+                break;
+
+            case 'a':
+                // Set client cache lifetime
+                max_age = std::atoi(optarg);
+                break;
+
+            case 'n':
+                // Set connection threads
+                conn_threads = std::max(1, std::atoi(optarg));
+                break;
+
+            case 'k':
+                // Set keep-alive timeout
+                idle_timeout = std::max(0, std::atoi(optarg));
+                break;
+
+            case 'p':
+                // Set prefetch rate
+                prefetch_rate = std::atof(optarg);
+                break;
+
+            case 'x':
+                // Set trusted proxy
+                trusted_proxy = optarg;
+                break;
+
+            case 'm':
+            {
+                // Add style archive
+                const char *sep = strchr(optarg, ':');
+                if (sep == nullptr)
+                {
+                    usage(1);
+                }
+                archive_paths.push_back({std::string(optarg, sep - optarg), sep + 1});
+                break;
+            }
+
             default:
                 // Invalid arg / missing argument
                 usage(1);
@@ -126,16 +607,69 @@ int main(int argc, char **argv)
         }
     }
 
+    // Logs reach docker / journald as they happen, with or without a tty
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    // Shutdown signals are taken by sigwait() below, block them before any
+    // threads start so they all inherit the mask
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
     // Global GDAL Initialization
     GDALAllRegister();
 
     // ENC renderer context
     encviz::enc_renderer enc_rend(config_file);
 
-    // Start MHD
-    MHD_Daemon *daemon = MHD_start_daemon(MHD_USE_AUTO | MHD_USE_THREAD_PER_CONNECTION,
+    // Render workers
+    encviz::worker_pool pool(nthreads, max_queue);
+    server_context ctx = { &enc_rend, &pool, max_age, {}, nullptr, trusted_proxy };
+    printf("Render workers: %lu\n", pool.size());
+
+    // Prefetch on idle workers, a burst covers the tiles around two requests
+    std::unique_ptr<encviz::tile_prefetcher> prefetch;
+    if (prefetch_rate > 0)
+    {
+        encviz::tile_prefetcher::options opts;
+        opts.rate = prefetch_rate;
+        opts.burst = 2 * prefetch_rate;
+        prefetch = std::make_unique<encviz::tile_prefetcher>(pool, [&](const encviz::tile_key &key) {
+            encviz::tile_ptr tile;
+            enc_rend.get_tile(tile, encviz::tile_coords::XYZ, key.x, key.y, key.z,
+                              key.style.c_str(), key.format);
+        }, opts);
+        ctx.prefetch = prefetch.get();
+        printf("Prefetch: %g tiles/sec per client\n", prefetch_rate);
+    }
+
+    // Tile archives
+    for (const auto &it : archive_paths)
+    {
+        try
+        {
+            ctx.archives[it.first] = encviz::open_tile_archive(it.second);
+            printf("Serving style %s from %s\n", it.first.c_str(), it.second.c_str());
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Start MHD with a few epoll event loop threads, connections waiting on
+    // a render are suspended so idle keep-alive connections cost no thread
+    MHD_Daemon *daemon = MHD_start_daemon(MHD_USE_EPOLL_INTERNAL_THREAD |
+                                          MHD_ALLOW_SUSPEND_RESUME,
 					  PORT, NULL, NULL,
-					  &request_handler, &enc_rend, MHD_OPTION_END);
+					  &request_handler, &ctx,
+					  MHD_OPTION_THREAD_POOL_SIZE, conn_threads,
+					  MHD_OPTION_CONNECTION_TIMEOUT, idle_timeout,
+					  MHD_OPTION_NOTIFY_COMPLETED, &request_completed, nullptr,
+					  MHD_OPTION_END);
     if (daemon == nullptr)
     {
 		std::cerr << "Failed to start MHD Daemon!" << std::endl;
@@ -143,10 +677,13 @@ int main(int argc, char **argv)
     }
 
 	std::cerr << "Daemon Running, waiting for requests!" << std::endl;
-    // Wait for input
-    (void)getchar();
+    // Wait for Ctrl-C / docker stop
+    int sig = 0;
+    sigwait(&stop_signals, &sig);
+    printf("Signal %d, stopping\n", sig);
 
-    // Cleanup
+    // Finish renders first, MHD can't stop with connections still suspended
+    pool.shutdown();
     MHD_stop_daemon (daemon);
     return 0;
 }
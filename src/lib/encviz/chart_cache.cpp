@@ -0,0 +1,218 @@
+/**
+ * \file
+ * \brief ENC Chart Cache
+ *
+ * Memory bounded cache of compiled ENC(S-57) charts, so repeated requests over
+ * the same cells can skip the ISO 8211 parse done by the S57 driver.
+ */
+
+#include <stdexcept>
+#include <encviz/chart_cache.h>
+
+namespace encviz
+{
+
+/**
+ * Cache Key
+ *
+ * \param[in] path Path to ENC chart
+ * \param[in] version Version of chart files
+ * \return "path#version"
+ */
+static std::string cache_key(const std::filesystem::path &path, uint64_t version)
+{
+    return path.string() + "#" + std::to_string(version);
+}
+
+/**
+ * Constructor
+ *
+ * \param[in] max_bytes Maximum estimated size of cached charts
+ */
+chart_cache::chart_cache(std::size_t max_bytes)
+    : max_bytes_(max_bytes)
+{
+}
+
+/**
+ * Set Size Limit
+ *
+ * \param[in] max_bytes Maximum estimated size of cached charts (0 disables)
+ */
+void chart_cache::set_max_bytes(std::size_t max_bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_bytes_ = max_bytes;
+    evict();
+}
+
+/**
+ * Share Memory Budget
+ *
+ * \param[in] budget Budget charts count against (must outlive the cache)
+ * \param[in] weight Relative share of budget
+ */
+void chart_cache::set_budget(memory_budget &budget, double weight)
+{
+    budget_.attach(budget, "charts", weight, [this]() { trim(); });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_.report(stats_.bytes);
+}
+
+/**
+ * Set Layers to Keep
+ *
+ * \param[in] keep Layer names (empty = all)
+ */
+void chart_cache::set_layers(const chart_store::layer_filter &keep)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    keep_ = keep.empty() ? nullptr : std::make_shared<const chart_store::layer_filter>(keep);
+
+    // Cached copies may be missing layers now wanted
+    lru_.clear();
+    index_.clear();
+    stats_.bytes = 0;
+    evict();
+}
+
+/**
+ * Open Chart (or reuse cached copy)
+ *
+ * Compiled charts are read-only, so may be used by several threads at
+ * once, and stay valid after being evicted until the last user is done.
+ *
+ * \param[in] path Path to ENC chart
+ * \param[in] version Version of chart files, a changed chart is a new entry
+ * \return Compiled chart, or null if it cannot be opened
+ */
+std::shared_ptr<const chart_store> chart_cache::acquire(const std::filesystem::path &path,
+                                                        uint64_t version)
+{
+    std::string key = cache_key(path, version);
+
+    // Reuse a compiled copy if we have one
+    std::shared_ptr<const chart_store::layer_filter> keep;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            stats_.hits++;
+            return it->second->store;
+        }
+        stats_.misses++;
+        keep = keep_;
+    }
+
+    // Otherwise open and compile it (outside lock, this is the slow part)
+    std::shared_ptr<const chart_store> store = keep ? chart_store::open(path, *keep) :
+        chart_store::open(path);
+    if (store == nullptr)
+    {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            // Another thread compiled it at the same time, share theirs
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->store;
+        }
+        if (max_bytes_ == 0 || keep != keep_)
+        {
+            // Not cached, or compiled for layers no longer wanted
+            return store;
+        }
+        lru_.push_front({key, store, store->get_size()});
+        index_[key] = lru_.begin();
+        stats_.bytes += store->get_size();
+        evict();
+    }
+
+    budget_.enforce();
+    return store;
+}
+
+/**
+ * Drop Cached Chart
+ *
+ * Users holding the chart keep it until they are done.
+ *
+ * \param[in] path Path to ENC chart
+ * \param[in] version Version of chart files
+ */
+void chart_cache::erase(const std::filesystem::path &path, uint64_t version)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(cache_key(path, version));
+    if (it != index_.end())
+    {
+        stats_.bytes -= it->second->size;
+        lru_.erase(it->second);
+        index_.erase(it);
+        evict();
+    }
+}
+
+/**
+ * Get Usage Counters
+ *
+ * \return Snapshot of cache counters
+ */
+chart_cache::stats chart_cache::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+/**
+ * Drop All Cached Charts
+ */
+void chart_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    stats_.bytes = 0;
+    evict();
+}
+
+/**
+ * Evict Charts Until Under Size Limit
+ *
+ * Also evicts while over the share of the memory budget.
+ *
+ * \note Caller must hold mutex_
+ */
+void chart_cache::evict()
+{
+    while (!lru_.empty() && (stats_.bytes > max_bytes_ || budget_.over()))
+    {
+        // Least recently used is at the back
+        entry &e = lru_.back();
+        index_.erase(e.key);
+        stats_.bytes -= e.size;
+        stats_.evictions++;
+        lru_.pop_back();
+        budget_.report(stats_.bytes);
+    }
+    stats_.entries = lru_.size();
+    budget_.report(stats_.bytes);
+}
+
+/**
+ * Evict Charts for Memory Budget
+ */
+void chart_cache::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict();
+}
+
+}; // ~namespace encviz
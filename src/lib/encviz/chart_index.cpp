@@ -0,0 +1,169 @@
+/**
+ * \file
+ * \brief Chart Index
+ *
+ * Packed R-tree over chart bounding boxes, for finding the charts that
+ * cover a tile without scanning the whole catalog.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <encviz/chart_index.h>
+
+namespace encviz
+{
+
+/**
+ * Sort-Tile-Recursive Ordering
+ *
+ * Sorts entries into vertical slices by X center, then each slice by Y
+ * center, so consecutive runs of node_size entries are spatially compact.
+ *
+ * \param[in,out] entries Entries with a bbox member
+ * \param[in] node_size Entries per node
+ */
+template <typename T>
+static void str_sort(std::vector<T> &entries, std::size_t node_size)
+{
+    auto center_x = [](const T &a) { return a.bbox.MinX + a.bbox.MaxX; };
+    auto center_y = [](const T &a) { return a.bbox.MinY + a.bbox.MaxY; };
+
+    std::sort(entries.begin(), entries.end(), [&](const T &a, const T &b) {
+        return center_x(a) < center_x(b); });
+
+    std::size_t nnodes = (entries.size() + node_size - 1) / node_size;
+    std::size_t nslices = (std::size_t)std::ceil(std::sqrt((double)nnodes));
+    std::size_t slice_len = nslices * node_size;
+    for (std::size_t i = 0; i < entries.size(); i += slice_len)
+    {
+        auto first = entries.begin() + i;
+        auto last = entries.begin() + std::min(entries.size(), i + slice_len);
+        std::sort(first, last, [&](const T &a, const T &b) {
+            return center_y(a) < center_y(b); });
+    }
+}
+
+/**
+ * Build Index
+ *
+ * Replaces any existing contents, using Sort-Tile-Recursive packing.
+ *
+ * \param[in] items Charts to index
+ */
+void chart_index::build(std::vector<item> items)
+{
+    items_ = std::move(items);
+    nodes_.clear();
+    if (items_.empty())
+    {
+        return;
+    }
+
+    // Pack charts into leaves
+    str_sort(items_, node_size);
+    std::vector<node> level;
+    for (std::size_t i = 0; i < items_.size(); i += node_size)
+    {
+        node leaf = {OGREnvelope(), 0, i, std::min(node_size, items_.size() - i), true};
+        for (std::size_t j = leaf.first; j < leaf.first + leaf.count; j++)
+        {
+            leaf.bbox.Merge(items_[j].bbox);
+            leaf.scale_max = std::max(leaf.scale_max, items_[j].scale);
+        }
+        level.push_back(leaf);
+    }
+
+    // Pack each level into parents until a single root remains
+    while (level.size() > 1)
+    {
+        str_sort(level, node_size);
+        std::size_t base = nodes_.size();
+        nodes_.insert(nodes_.end(), level.begin(), level.end());
+
+        std::vector<node> parents;
+        for (std::size_t i = 0; i < level.size(); i += node_size)
+        {
+            node parent = {OGREnvelope(), 0, base + i, std::min(node_size, level.size() - i), false};
+            for (std::size_t j = i; j < i + parent.count; j++)
+            {
+                parent.bbox.Merge(level[j].bbox);
+                parent.scale_max = std::max(parent.scale_max, level[j].scale_max);
+            }
+            parents.push_back(parent);
+        }
+        level = std::move(parents);
+    }
+    nodes_.push_back(level[0]);
+}
+
+/**
+ * Find Charts
+ *
+ * \param[in] bbox Query bounding box (deg)
+ * \param[in] scale_min Minimum chart compilation scale
+ * \return Ids of intersecting charts, in ascending scale order
+ */
+std::vector<std::size_t> chart_index::query(const OGREnvelope &bbox, int scale_min) const
+{
+    std::vector<const item*> found;
+    if (!nodes_.empty())
+    {
+        std::vector<std::size_t> stack = { nodes_.size() - 1 };
+        while (!stack.empty())
+        {
+            const node &n = nodes_[stack.back()];
+            stack.pop_back();
+
+            // Skip whole subtrees that are too small scale or out of bounds
+            if (n.scale_max < scale_min || !bbox.Intersects(n.bbox))
+            {
+                continue;
+            }
+
+            for (std::size_t i = n.first; i < n.first + n.count; i++)
+            {
+                if (!n.leaf)
+                {
+                    stack.push_back(i);
+                }
+                else if (scale_min <= items_[i].scale && bbox.Intersects(items_[i].bbox))
+                {
+                    found.push_back(&items_[i]);
+                }
+            }
+        }
+    }
+
+    // Ascending scale order (most detailed first), id to keep it stable
+    std::sort(found.begin(), found.end(), [](const item *a, const item *b) {
+        return (a->scale != b->scale) ? (a->scale < b->scale) : (a->id < b->id); });
+
+    std::vector<std::size_t> ids;
+    ids.reserve(found.size());
+    for (const item *i : found)
+    {
+        ids.push_back(i->id);
+    }
+    return ids;
+}
+
+/**
+ * Get Number of Indexed Charts
+ *
+ * \return Chart count
+ */
+std::size_t chart_index::size() const
+{
+    return items_.size();
+}
+
+/**
+ * Remove All Charts
+ */
+void chart_index::clear()
+{
+    items_.clear();
+    nodes_.clear();
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,165 @@
+/**
+ * \file
+ * \brief ENC Chart Store
+ *
+ * Read-only, in-memory copy of an ENC(S-57) chart's features, compiled once
+ * when the chart is opened so tile exports only need envelope tests and
+ * geometry slicing.
+ */
+
+#include <stdexcept>
+#include <encviz/chart_store.h>
+
+/// Allocation overhead per stored feature (bytes), beyond its fields and geometry
+#define FEATURE_OVERHEAD 64
+
+namespace encviz
+{
+
+/**
+ * Layer Constructor
+ *
+ * \param[in] source Field definitions to copy
+ */
+chart_store::layer::layer(const OGRFeatureDefn *source)
+    : defn(source->Clone())
+{
+    defn->Reference();
+}
+
+/**
+ * Layer Destructor
+ */
+chart_store::layer::~layer()
+{
+    // Features hold references to the definition, drop them first
+    features.clear();
+    defn->Release();
+}
+
+/**
+ * Compile Chart
+ *
+ * \param[in] ds Opened chart dataset
+ * \param[in] keep Layers to copy (M_COVR is always kept)
+ */
+chart_store::chart_store(GDALDataset *ds, const layer_filter &keep)
+{
+    for (int i = 0; i < ds->GetLayerCount(); i++)
+    {
+        OGRLayer *ilayer = ds->GetLayer(i);
+        std::string name = ilayer->GetName();
+        if (!keep.empty() && keep.count(name) == 0 && name != "M_COVR")
+        {
+            // Not drawn by any style, don't hold on to it
+            continue;
+        }
+        auto next = std::make_unique<layer>(ilayer->GetLayerDefn());
+
+        // Copy features against our own definition, so they outlive the dataset
+        ilayer->ResetReading();
+        for (const auto &feat : ilayer)
+        {
+            const OGRGeometry *geo = feat->GetGeometryRef();
+            if (geo == nullptr)
+            {
+                continue;
+            }
+
+            feature copy = { std::make_unique<OGRFeature>(next->defn), OGREnvelope() };
+            if (copy.feat->SetFrom(feat.get()) != OGRERR_NONE)
+            {
+                throw std::runtime_error("Cannot copy chart feature");
+            }
+            copy.feat->SetFID(feat->GetFID());
+            geo->getEnvelope(&copy.bbox);
+
+            // WKB is about as large as the geometry held in memory
+            size_ += sizeof(feature) + sizeof(OGRFeature) + FEATURE_OVERHEAD +
+                next->defn->GetFieldCount() * sizeof(OGRField) + geo->WkbSize();
+            next->features.push_back(std::move(copy));
+        }
+
+        layers_[name] = std::move(next);
+    }
+
+    // Merge "coverage available" (CATCOV=1) areas once, rather than per tile
+    const layer *covr = get_layer("M_COVR");
+    if (covr != nullptr)
+    {
+        int catcov = covr->defn->GetFieldIndex("CATCOV");
+        for (const feature &f : covr->features)
+        {
+            if (catcov == -1 || f.feat->GetFieldAsInteger(catcov) != 1)
+            {
+                continue;
+            }
+
+            const OGRGeometry *geo = f.feat->GetGeometryRef();
+            coverage_.reset(coverage_ ? coverage_->Union(geo) : geo->clone());
+            if (coverage_ == nullptr)
+            {
+                throw std::runtime_error("Cannot merge chart coverage");
+            }
+        }
+        if (coverage_ != nullptr)
+        {
+            size_ += coverage_->WkbSize();
+        }
+    }
+}
+
+/**
+ * Open and Compile Chart
+ *
+ * \param[in] path Path to ENC chart
+ * \param[in] keep Layers to copy (M_COVR is always kept)
+ * \return Compiled chart, or null if it cannot be opened
+ */
+std::shared_ptr<const chart_store> chart_store::open(const std::filesystem::path &path,
+                                                     const layer_filter &keep)
+{
+    const char *const drivers[] = { "S57", nullptr };
+    std::unique_ptr<GDALDataset> ds(GDALDataset::Open(path.string().c_str(),
+                                                      GDAL_OF_VECTOR | GDAL_OF_READONLY,
+                                                      drivers, nullptr, nullptr));
+    if (ds == nullptr)
+    {
+        return nullptr;
+    }
+    return std::make_shared<const chart_store>(ds.get(), keep);
+}
+
+/**
+ * Get Layer
+ *
+ * \param[in] name S57 layer name
+ * \return Layer, or null if the chart doesn't have it
+ */
+const chart_store::layer *chart_store::get_layer(const std::string &name) const
+{
+    auto it = layers_.find(name);
+    return (it == layers_.end()) ? nullptr : it->second.get();
+}
+
+/**
+ * Get Chart Coverage
+ *
+ * \return Union of "coverage available" M_COVR areas (null if none)
+ */
+const OGRGeometry *chart_store::get_coverage() const
+{
+    return coverage_.get();
+}
+
+/**
+ * Get Estimated Footprint
+ *
+ * \return Approximate memory held by the compiled features (bytes)
+ */
+std::size_t chart_store::get_size() const
+{
+    return size_;
+}
+
+}; // ~namespace encviz
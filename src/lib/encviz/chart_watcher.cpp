@@ -0,0 +1,200 @@
+/**
+ * \file
+ * \brief Chart Directory Watcher
+ *
+ * Watches a chart directory tree with inotify and reports changed files in
+ * batches, once writes have gone quiet.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <encviz/chart_watcher.h>
+#include <encviz/log.h>
+
+namespace fs = std::filesystem;
+
+/// Events that may change a chart (files are reported once fully written)
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE)
+
+namespace encviz
+{
+
+/**
+ * Constructor
+ *
+ * Starts watching right away.
+ *
+ * \param[in] root Chart directory (watched recursively)
+ * \param[in] on_change Change handler
+ * \param[in] quiet Time without changes before a batch is reported
+ */
+chart_watcher::chart_watcher(const fs::path &root, callback on_change,
+                             std::chrono::milliseconds quiet)
+    : root_(root), on_change_(std::move(on_change)), quiet_(quiet)
+{
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0)
+    {
+        throw std::runtime_error(std::string("Cannot start chart watch: ") + strerror(errno));
+    }
+    stop_fd_ = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd_ < 0)
+    {
+        close(inotify_fd_);
+        throw std::runtime_error(std::string("Cannot start chart watch: ") + strerror(errno));
+    }
+
+    add_tree(root_, nullptr);
+    ENCVIZ_LOG(info, "Watching %lu chart directories under %s\n",
+               watches_.size(), root_.string().c_str());
+    thread_ = std::thread(&chart_watcher::run, this);
+}
+
+/**
+ * Destructor
+ *
+ * Stops the watch thread, pending changes are dropped.
+ */
+chart_watcher::~chart_watcher()
+{
+    uint64_t one = 1;
+    if (write(stop_fd_, &one, sizeof(one)) != sizeof(one))
+    {
+        ENCVIZ_LOG(error, "Cannot stop chart watch: %s\n", strerror(errno));
+    }
+    thread_.join();
+    close(stop_fd_);
+    close(inotify_fd_);
+}
+
+/**
+ * Watch Thread
+ */
+void chart_watcher::run()
+{
+    std::set<fs::path> pending;
+    auto last_change = std::chrono::steady_clock::now();
+    alignas(struct inotify_event) char buffer[64 * 1024];
+
+    while (true)
+    {
+        // Sleep until an event, or the quiet time after the last one is up
+        int timeout = -1;
+        if (!pending.empty())
+        {
+            auto waited = std::chrono::steady_clock::now() - last_change;
+            timeout = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                               quiet_ - waited).count());
+        }
+        pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+        if (poll(fds, 2, timeout) < 0 && errno != EINTR)
+        {
+            ENCVIZ_LOG(error, "Chart watch failed: %s\n", strerror(errno));
+            return;
+        }
+        if (fds[1].revents != 0)
+        {
+            return;
+        }
+
+        // Collect changed paths
+        ssize_t len;
+        while ((fds[0].revents & POLLIN) &&
+               (len = read(inotify_fd_, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *p = buffer; p < buffer + len; )
+            {
+                const struct inotify_event *ev = (const struct inotify_event*)p;
+                p += sizeof(struct inotify_event) + ev->len;
+                last_change = std::chrono::steady_clock::now();
+
+                if (ev->mask & IN_Q_OVERFLOW)
+                {
+                    // Lost events, recheck everything
+                    ENCVIZ_LOG(warn, "Chart watch queue overflow, rescanning %s\n",
+                               root_.string().c_str());
+                    pending.insert(root_);
+                    add_tree(root_, &pending);
+                    continue;
+                }
+                if (ev->mask & IN_IGNORED)
+                {
+                    watches_.erase(ev->wd);
+                    continue;
+                }
+
+                auto dir = watches_.find(ev->wd);
+                if (dir == watches_.end() || ev->len == 0)
+                {
+                    continue;
+                }
+                fs::path path = dir->second / ev->name;
+
+                if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+                {
+                    // New directory, may already hold charts
+                    add_tree(path, &pending);
+                }
+                else if (!(ev->mask & IN_CREATE) || (ev->mask & IN_ISDIR))
+                {
+                    // Files are reported when closed, directories when gone
+                    pending.insert(path);
+                }
+            }
+        }
+
+        // Report once quiet
+        if (!pending.empty() && std::chrono::steady_clock::now() - last_change >= quiet_)
+        {
+            std::vector<fs::path> files(pending.begin(), pending.end());
+            pending.clear();
+            try
+            {
+                on_change_(files);
+            }
+            catch (const std::exception &e)
+            {
+                ENCVIZ_LOG(error, "Cannot apply chart changes: %s\n", e.what());
+            }
+        }
+    }
+}
+
+/**
+ * Watch Directory Tree
+ *
+ * \param[in] dir Directory to watch, with all subdirectories
+ * \param[out] found Files already in the tree are added (optional)
+ */
+void chart_watcher::add_tree(const fs::path &dir, std::set<fs::path> *found)
+{
+    int wd = inotify_add_watch(inotify_fd_, dir.string().c_str(), WATCH_EVENTS | IN_ONLYDIR);
+    if (wd < 0)
+    {
+        ENCVIZ_LOG(warn, "Cannot watch %s: %s\n", dir.string().c_str(), strerror(errno));
+        return;
+    }
+    watches_[wd] = dir;
+
+    std::error_code ec;
+    for (const fs::directory_entry &entry : fs::directory_iterator(dir, ec))
+    {
+        if (entry.is_directory(ec))
+        {
+            add_tree(entry.path(), found);
+        }
+        else if (found != nullptr)
+        {
+            found->insert(entry.path());
+        }
+    }
+}
+
+}; // ~namespace encviz
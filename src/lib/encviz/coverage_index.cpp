@@ -0,0 +1,181 @@
+/**
+ * \file
+ * \brief Coverage Boundary Index
+ *
+ * Chart coverage (M_COVR) ring segments in pixel space, bucketed on a
+ * uniform grid.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <encviz/coverage_index.h>
+
+namespace encviz
+{
+
+/**
+ * Add Coverage Ring
+ *
+ * \param[in] ring Ring points (pixels)
+ *
+ * \note Call build() once all rings are added.
+ */
+void coverage_index::add_ring(const std::vector<coord> &ring)
+{
+    if (ring.size() == 1)
+    {
+        segs_.push_back({ring[0], ring[0]});
+    }
+    for (std::size_t i = 1; i < ring.size(); i++)
+    {
+        segs_.push_back({ring[i-1], ring[i]});
+    }
+}
+
+/**
+ * Build Grid
+ *
+ * Read-only afterwards, touches() may be called from any thread.
+ */
+void coverage_index::build()
+{
+    cell_start_.clear();
+    cell_segs_.clear();
+    nx_ = ny_ = 0;
+    if (segs_.empty())
+    {
+        return;
+    }
+
+    // Grid covers every segment, plus tolerance
+    double x0 = segs_[0].a.x, x1 = x0, y0 = segs_[0].a.y, y1 = y0;
+    for (const segment &s : segs_)
+    {
+        x0 = std::min({x0, s.a.x, s.b.x});
+        x1 = std::max({x1, s.a.x, s.b.x});
+        y0 = std::min({y0, s.a.y, s.b.y});
+        y1 = std::max({y1, s.a.y, s.b.y});
+    }
+    origin_ = {x0 - TOLERANCE_PX, y0 - TOLERANCE_PX};
+    double extent = std::max(x1 - x0, y1 - y0) + 2 * TOLERANCE_PX;
+    cell_ = std::max(MIN_CELL_PX, extent / MAX_CELLS);
+    nx_ = std::min(MAX_CELLS, (int)((x1 - x0 + 2 * TOLERANCE_PX) / cell_) + 1);
+    ny_ = std::min(MAX_CELLS, (int)((y1 - y0 + 2 * TOLERANCE_PX) / cell_) + 1);
+
+    // Count, then fill, segments per cell
+    cell_start_.assign(nx_ * ny_ + 1, 0);
+    for (const segment &s : segs_)
+    {
+        for_cells(s, [&](int cell) { cell_start_[cell + 1]++; });
+    }
+    for (int i = 0; i < nx_ * ny_; i++)
+    {
+        cell_start_[i + 1] += cell_start_[i];
+    }
+
+    cell_segs_.resize(cell_start_.back());
+    fill_.assign(cell_start_.begin(), cell_start_.end() - 1);
+    for (uint32_t i = 0; i < segs_.size(); i++)
+    {
+        for_cells(segs_[i], [&](int cell) { cell_segs_[fill_[cell]++] = i; });
+    }
+}
+
+/**
+ * Remove All Rings
+ *
+ * Storage is kept for the next tile.
+ */
+void coverage_index::clear()
+{
+    segs_.clear();
+    cell_start_.clear();
+    cell_segs_.clear();
+    nx_ = ny_ = 0;
+}
+
+/**
+ * Check Point Against Coverage Bounds
+ *
+ * \param[in] c Point (pixels)
+ * \return True if within TOLERANCE_PX of any coverage ring
+ */
+bool coverage_index::touches(const coord &c) const
+{
+    if (nx_ == 0)
+    {
+        return false;
+    }
+
+    double fx = std::floor((c.x - origin_.x) / cell_);
+    double fy = std::floor((c.y - origin_.y) / cell_);
+    if (fx < 0 || fy < 0 || fx >= nx_ || fy >= ny_)
+    {
+        return false;
+    }
+
+    int cell = (int)fy * nx_ + (int)fx;
+    for (uint32_t i = cell_start_[cell]; i < cell_start_[cell + 1]; i++)
+    {
+        const segment &s = segs_[cell_segs_[i]];
+
+        // Distance to closest point of segment
+        double dx = s.b.x - s.a.x;
+        double dy = s.b.y - s.a.y;
+        double len2 = dx * dx + dy * dy;
+        double t = 0;
+        if (len2 > 0)
+        {
+            t = ((c.x - s.a.x) * dx + (c.y - s.a.y) * dy) / len2;
+            t = std::clamp(t, 0.0, 1.0);
+        }
+        double ex = s.a.x + t * dx - c.x;
+        double ey = s.a.y + t * dy - c.y;
+        if (ex * ex + ey * ey <= TOLERANCE_PX * TOLERANCE_PX)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Visit Cells Near Segment
+ *
+ * Walks the grid rows the segment spans, visiting only the columns the
+ * segment crosses within each row (widened by the tolerance).
+ *
+ * \param[in] s Segment
+ * \param[in] visit Called with each cell index within tolerance
+ */
+template <typename F>
+void coverage_index::for_cells(const segment &s, F visit) const
+{
+    double ymin = std::min(s.a.y, s.b.y);
+    double ymax = std::max(s.a.y, s.b.y);
+    double dy = s.b.y - s.a.y;
+
+    int row0 = std::max(0, (int)std::floor((ymin - TOLERANCE_PX - origin_.y) / cell_));
+    int row1 = std::min(ny_ - 1, (int)std::floor((ymax + TOLERANCE_PX - origin_.y) / cell_));
+    for (int row = row0; row <= row1; row++)
+    {
+        // Part of the segment within tolerance of this row
+        double band0 = std::max(ymin, origin_.y + row * cell_ - TOLERANCE_PX);
+        double band1 = std::min(ymax, origin_.y + (row + 1) * cell_ + TOLERANCE_PX);
+        double xa = s.a.x, xb = s.b.x;
+        if (dy != 0)
+        {
+            xa = s.a.x + (band0 - s.a.y) * (s.b.x - s.a.x) / dy;
+            xb = s.a.x + (band1 - s.a.y) * (s.b.x - s.a.x) / dy;
+        }
+
+        int col0 = std::max(0, (int)std::floor((std::min(xa, xb) - TOLERANCE_PX - origin_.x) / cell_));
+        int col1 = std::min(nx_ - 1, (int)std::floor((std::max(xa, xb) + TOLERANCE_PX - origin_.x) / cell_));
+        for (int col = col0; col <= col1; col++)
+        {
+            visit(row * nx_ + col);
+        }
+    }
+}
+
+}; // ~namespace encviz
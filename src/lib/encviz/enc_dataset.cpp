@@ -12,7 +12,20 @@
 #include <algorithm>
 #include <filesystem>
 #include <memory>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <encviz/enc_dataset.h>
+#include <encviz/log.h>
+#include <encviz/worker_pool.h>
+#include <set>
+#include <unordered_map>
 
 // Helper macro for data presence
 #define CHECKNULL(ptr, msg) if ((ptr) == nullptr) throw std::runtime_error((msg))
@@ -20,13 +33,157 @@
 typedef std::unique_ptr<OGRGeometry, decltype(&OGRGeometryFactory::destroyGeometry)> GeoPtr;
 typedef std::unique_ptr<OGRFeature, decltype(&OGRFeature::DestroyFeature)> FeatPtr;
 
+// Coverage simplification tolerance (deg, roughly 1m)
+#define COVERAGE_TOLERANCE 1e-5
+
+// Chart catalog file (in cache directory) and format identification
+#define CATALOG_NAME "catalog.bin"
+#define CATALOG_MAGIC "ENCVZCAT"
+#define CATALOG_VERSION 1
+#define CATALOG_BYTE_ORDER 0x01020304
+
 namespace encviz
 {
 
+/// Chart catalog file header
+struct catalog_header
+{
+    /// File type (CATALOG_MAGIC, not terminated)
+    char magic[8];
+
+    /// Format version (CATALOG_VERSION)
+    uint32_t version;
+
+    /// Native byte order check (CATALOG_BYTE_ORDER)
+    uint32_t byte_order;
+
+    /// Number of chart records that follow
+    uint64_t count;
+};
+
+/// Chart catalog record, followed by path and coverage WKB
+struct catalog_record
+{
+    /// Base cell file size
+    uint64_t size;
+
+    /// Base cell modification time
+    int64_t mtime;
+
+    /// Update file hash
+    uint64_t updates;
+
+    /// Bounding box (MinX, MaxX, MinY, MaxY)
+    double bbox[4];
+
+    /// Compilation scale
+    int32_t scale;
+
+    /// Length of path
+    uint32_t path_len;
+
+    /// Length of coverage WKB
+    uint64_t wkb_len;
+};
+
+/**
+ * Check for S-57 Cell or Update File Extension
+ *
+ * \param[in] ext File extension (".000" - ".999")
+ * \return True if a chart file
+ */
+static bool is_chart_file(const std::string &ext)
+{
+    return ext.size() == 4 && isdigit(ext[1]) && isdigit(ext[2]) && isdigit(ext[3]);
+}
+
+/**
+ * File Version String
+ *
+ * \param[in] entry Chart file
+ * \return "path:size:mtime"
+ */
+static std::string file_version(const std::filesystem::directory_entry &entry)
+{
+    auto mtime = entry.last_write_time().time_since_epoch().count();
+    return entry.path().string() + ":" + std::to_string(entry.file_size()) + ":" +
+        std::to_string(mtime);
+}
+
+/**
+ * Hash File Versions
+ *
+ * \param[in] versions File version strings, in any order
+ * \return FNV-1a hash of sorted versions (0 if none)
+ */
+static uint64_t hash_versions(std::vector<std::string> versions)
+{
+    if (versions.empty())
+    {
+        return 0;
+    }
+
+    // Hash in sorted order, directory order is not guaranteed
+    std::sort(versions.begin(), versions.end());
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const std::string &version : versions)
+    {
+        for (char c : version)
+        {
+            hash ^= (uint8_t)c;
+            hash *= 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * Bounding Box to Polygon
+ *
+ * \param[in] bbox OGR Envelope
+ * \return Rectangular polygon
+ */
+static std::unique_ptr<OGRPolygon> bbox_to_polygon(const OGREnvelope &bbox)
+{
+    // Define polygon boundary first
+    OGRLinearRing geo_ring;
+    geo_ring.addPoint(bbox.MinX, bbox.MinY);
+    geo_ring.addPoint(bbox.MaxX, bbox.MinY);
+    geo_ring.addPoint(bbox.MaxX, bbox.MaxY);
+    geo_ring.addPoint(bbox.MinX, bbox.MaxY);
+    geo_ring.addPoint(bbox.MinX, bbox.MinY);
+
+    // Define the polygon
+    auto geo_poly = std::make_unique<OGRPolygon>();
+    geo_poly->addRing(&geo_ring);
+    return geo_poly;
+}
+
+/**
+ * Chart Set Generation
+ *
+ * \param[in] charts Loaded charts
+ * \return Hex hash of chart paths and file versions
+ */
+static std::string make_generation(const std::map<std::string, enc_dataset::metadata> &charts)
+{
+    std::vector<std::string> versions;
+    for (const auto &[name, chart] : charts)
+    {
+        versions.push_back(chart.path.string() + ":" + std::to_string(chart.stamp.size) + ":" +
+                           std::to_string(chart.stamp.mtime) + ":" +
+                           std::to_string(chart.stamp.updates));
+    }
+    char text[20];
+    snprintf(text, sizeof(text), "%016lx", (unsigned long)hash_versions(versions));
+    return text;
+}
+
 /**
  * Constructor
  */
 enc_dataset::enc_dataset()
+    : set_(std::make_shared<chart_set>())
 {
     // Cache location
     char *phome = getenv("HOME");
@@ -35,10 +192,6 @@ enc_dataset::enc_dataset()
         cache_ = phome;
         cache_ += "/.encviz";
     }
-
-    // Get GDAL driver
-    mem_drv_ = GetGDALDriverManager()->GetDriverByName("Memory");
-    CHECKNULL(mem_drv_, "Cannot load OGR memory driver");
 }
 
 /**
@@ -51,12 +204,65 @@ void enc_dataset::set_cache_path(const std::filesystem::path &cache_path)
     cache_ = cache_path;
 }
 
+/**
+ * Set Chart Cache Size
+ *
+ * \param[in] max_bytes Maximum estimated size of open charts (0 disables)
+ */
+void enc_dataset::set_chart_cache_size(std::size_t max_bytes)
+{
+    chart_cache_.set_max_bytes(max_bytes);
+}
+
+/**
+ * Share Memory Budget
+ *
+ * \param[in] budget Budget compiled charts count against (must outlive the dataset)
+ * \param[in] weight Relative share of budget
+ */
+void enc_dataset::set_memory_budget(memory_budget &budget, double weight)
+{
+    chart_cache_.set_budget(budget, weight);
+}
+
+/**
+ * Set Chart Layers to Keep
+ *
+ * \param[in] keep Layer names (empty = all)
+ */
+void enc_dataset::set_chart_layers(const chart_store::layer_filter &keep)
+{
+    chart_cache_.set_layers(keep);
+}
+
+/**
+ * Set Chart Loading Threads
+ *
+ * \param[in] nthreads Threads used to parse changed charts (0 = one per core)
+ */
+void enc_dataset::set_load_threads(std::size_t nthreads)
+{
+    load_threads_ = nthreads;
+}
+
+/**
+ * Get Chart Cache Counters
+ *
+ * \return Hit/miss/eviction counters of open chart cache
+ */
+chart_cache::stats enc_dataset::get_chart_cache_stats() const
+{
+    return chart_cache_.get_stats();
+}
+
 /**
  * Clear Chart Index
  */
 void enc_dataset::clear()
 {
-    charts_.clear();
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    publish(std::make_shared<chart_set>());
+    chart_cache_.clear();
 }
 
 /**
@@ -66,119 +272,366 @@ void enc_dataset::clear()
  */
 void enc_dataset::load_charts(const std::string &enc_root)
 {
+    std::lock_guard<std::mutex> lock(update_mutex_);
+
+    // Base cell versions, and their update file versions, by base cell path
+    std::map<std::filesystem::path, file_stamp> cells;
+    std::map<std::filesystem::path, std::vector<std::string>> updates;
+
     auto rdi = std::filesystem::recursive_directory_iterator(enc_root);
     for (const std::filesystem::directory_entry &entry : rdi)
     {
-        if (entry.path().extension() == ".000")
+        std::string ext = entry.path().extension().string();
+        if (!is_chart_file(ext))
         {
-           load_chart(entry.path());
+            continue;
+        }
+
+        std::string version = file_version(entry);
+        std::filesystem::path base = entry.path();
+        base.replace_extension(".000");
+        if (ext == ".000")
+        {
+            cells[base].size = entry.file_size();
+            cells[base].mtime = entry.last_write_time().time_since_epoch().count();
+        }
+        else
+        {
+            updates[base].push_back(version);
+        }
+    }
+
+    // Only parse charts that have changed since the catalog was saved
+    std::map<std::string, metadata> catalog = load_catalog();
+    auto next = std::make_shared<chart_set>();
+    std::vector<std::pair<std::filesystem::path, file_stamp>> changed;
+    std::size_t reused = 0;
+    for (auto &[path, stamp] : cells)
+    {
+        auto upd = updates.find(path);
+        if (upd != updates.end())
+        {
+            stamp.updates = hash_versions(upd->second);
+        }
+
+        auto cached = catalog.find(path.string());
+        if (cached != catalog.end() && cached->second.stamp == stamp)
+        {
+            next->charts[path.stem().string()] = cached->second;
+            reused++;
+        }
+        else
+        {
+            changed.emplace_back(path, stamp);
         }
     }
+    read_charts(changed, next->charts);
+
+    // Catalog is stale if anything was parsed, or charts have gone away
+    if (reused != cells.size() || reused != catalog.size())
+    {
+        save_catalog(next->charts);
+    }
+
+    publish(next);
+    std::shared_ptr<const chart_set> set = snapshot();
+    printf("%lu charts loaded, %lu from catalog (generation %s)\n",
+           set->charts.size(), reused, set->generation.c_str());
+}
+
+/**
+ * Get Chart Set Generation
+ *
+ * \return Generation id (hex hash of chart paths, sizes and times)
+ */
+std::string enc_dataset::get_generation() const
+{
+    return snapshot()->generation;
+}
 
-    printf("%lu charts loaded\n", charts_.size());
+/**
+ * Get Chart Set Version
+ *
+ * \return Count of chart set replacements, a render that saw a different
+ *         value started on charts that have since changed
+ */
+uint64_t enc_dataset::get_version() const
+{
+    return version_.load();
 }
 
 /**
  * Load Single ENC Chart
  *
  * \param[in] path Path to ENC chart
+ * \return False on failure
  */
 bool enc_dataset::load_chart(const std::filesystem::path &path)
 {
-    return load_chart_cache(path) || load_chart_disk(path);
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    auto next = std::make_shared<chart_set>();
+    next->charts = snapshot()->charts;
+    next->charts[path.stem().string()] = read_chart(path, read_stamp(path));
+    publish(next);
+    return true;
+}
+
+/**
+ * Apply Changed Chart Files
+ *
+ * Re-reads only the cells whose base or update (.001+) files are given,
+ * adding new cells and dropping deleted ones. Directories recheck every
+ * loaded cell under them. The new chart set replaces
+ * the old one atomically, renders in progress finish on the charts they
+ * started with. Cells that fail to parse keep their previous version.
+ *
+ * \param[in] files Changed, added or removed chart files or directories
+ * \param[out] changed Bounding boxes of every changed cell, old and new (deg)
+ * \return False if no chart changed
+ */
+bool enc_dataset::update_charts(const std::vector<std::filesystem::path> &files,
+                                std::vector<OGREnvelope> &changed)
+{
+    std::lock_guard<std::mutex> lock(update_mutex_);
+
+    // Base cells touched by any of the files, or under any directory
+    std::shared_ptr<const chart_set> current = snapshot();
+    std::set<std::filesystem::path> cells;
+    for (const std::filesystem::path &file : files)
+    {
+        if (is_chart_file(file.extension().string()))
+        {
+            std::filesystem::path base = file;
+            base.replace_extension(".000");
+            cells.insert(base);
+            continue;
+        }
+
+        std::string prefix = (file / "").string();
+        for (const auto &[name, chart] : current->charts)
+        {
+            if (chart.path.string().compare(0, prefix.size(), prefix) == 0)
+            {
+                cells.insert(chart.path);
+            }
+        }
+    }
+
+    auto next = std::make_shared<chart_set>();
+    next->charts = current->charts;
+    std::vector<const metadata*> replaced;
+    std::size_t added = 0, updated = 0, removed = 0;
+    for (const std::filesystem::path &cell : cells)
+    {
+        std::string name = cell.stem().string();
+        auto it = current->charts.find(name);
+        const metadata *old = nullptr;
+        if (it != current->charts.end() && it->second.path == cell)
+        {
+            old = &it->second;
+        }
+
+        // Cell deleted
+        std::error_code ec;
+        if (!std::filesystem::exists(cell, ec))
+        {
+            if (old != nullptr)
+            {
+                changed.push_back(old->bbox);
+                replaced.push_back(old);
+                next->charts.erase(name);
+                removed++;
+            }
+            continue;
+        }
+
+        // Cell (or update files) changed, or new
+        try
+        {
+            file_stamp stamp = read_stamp(cell);
+            if (old != nullptr && old->stamp == stamp)
+            {
+                continue;
+            }
+            metadata chart = read_chart(cell, stamp);
+            if (old != nullptr)
+            {
+                changed.push_back(old->bbox);
+                replaced.push_back(old);
+                updated++;
+            }
+            else
+            {
+                added++;
+            }
+            changed.push_back(chart.bbox);
+            next->charts[name] = std::move(chart);
+        }
+        catch (const std::exception &e)
+        {
+            ENCVIZ_LOG(warn, "Cannot update chart %s: %s\n", cell.string().c_str(), e.what());
+        }
+    }
+
+    if (added + updated + removed == 0)
+    {
+        return false;
+    }
+
+    save_catalog(next->charts);
+    publish(next);
+
+    // Nothing indexes the old versions now, free them early
+    for (const metadata *old : replaced)
+    {
+        chart_cache_.erase(old->path, old->stamp.version());
+    }
+
+    ENCVIZ_LOG(info, "Charts updated: %lu added, %lu changed, %lu removed (generation %s)\n",
+               added, updated, removed, get_generation().c_str());
+    return true;
 }
 
 /**
- * Export ENC Data to Empty Dataset
+ * Export ENC Data for a Tile
  *
- * Creates specified layers in output dataset, populating with best data
- * available for given bounding box and minimum presentation scale.
+ * Adds specified layers to the tile, populating with best data available
+ * for given bounding box and minimum presentation scale.
  *
- * \param[out] ds Output dataset
+ * \param[out] data Tile features
  * \param[in] layers Specified ENC layers (S57)
  * \param[in] bbox Data bounding box (deg)
  * \param[in] scale_min Minimum data compilation scale
+ * \param[out] profile Selection and export timings (optional)
  * \return False if no data available
  */
-bool enc_dataset::export_data(GDALDataset *ods, std::vector<std::string> layers,
-                              OGREnvelope bbox, int scale_min)
+bool enc_dataset::export_data(tile_data &data, const std::vector<std::string> &layers,
+                              OGREnvelope bbox, int scale_min, render_profile *profile)
 {
-    printf("Filter: Scale=%d, BBOX=(%g to %g),(%g to %g)\n",
-           scale_min, bbox.MinX, bbox.MaxX, bbox.MinY, bbox.MaxY);
+    ENCVIZ_LOG(debug, "Filter: Scale=%d, BBOX=(%g to %g),(%g to %g)\n",
+               scale_min, bbox.MinX, bbox.MaxX, bbox.MinY, bbox.MaxY);
+    auto select_start = std::chrono::steady_clock::now();
+
+    // Charts as of now, updates replace the set rather than change it
+    std::shared_ptr<const chart_set> set = snapshot();
+
+    // Charts of the scale band around this tile, most detailed first, and
+    // the part of the region each is drawn in
+    const scale_plan::region &region = get_plan(*set, scale_min).find(bbox);
+    if (profile != nullptr)
+    {
+        profile->select_us += elapsed_us(select_start);
+    }
+
+    // Narrow the region's plan to the tile
+    struct selection
+    {
+        /// Chart
+        const metadata *chart;
+
+        /// Part of tile drawn from chart (null = all of it)
+        GeoPtr mask;
 
-    // Build list of suitable charts
-    std::vector<const metadata*> selected;
-    for (const auto &[name, chart] : charts_)
+        /// Bounds of mask (deg)
+        OGREnvelope mask_bbox;
+    };
+    std::vector<selection> selected;
+    auto erase_start = std::chrono::steady_clock::now();
+    GeoPtr tile_poly(bbox_to_polygon(bbox).release(), &OGRGeometryFactory::destroyGeometry);
+    for (const scale_plan::step &step : region.steps)
     {
-        if ((scale_min <= chart.scale) && bbox.Intersects(chart.bbox))
+        selection sel{set->indexed[step.source->id], GeoPtr(nullptr, &OGRGeometryFactory::destroyGeometry), bbox};
+        if (step.mask != nullptr)
         {
-            selected.push_back(&chart);
+            OGREnvelope region_mask_bbox;
+            step.mask->getEnvelope(&region_mask_bbox);
+            if (!region_mask_bbox.Intersects(bbox))
+            {
+                continue;
+            }
+            sel.mask.reset(step.mask->Intersection(tile_poly.get()));
+            CHECKNULL(sel.mask, "Cannot perform coverage difference");
+            if (sel.mask->IsEmpty())
+            {
+                continue;
+            }
+            sel.mask->getEnvelope(&sel.mask_bbox);
+        }
+
+        // Skip charts that would be hidden under more detailed coverage
+        const OGRGeometry *visible = (sel.mask != nullptr) ? sel.mask.get() : tile_poly.get();
+        if (!step.source->coverage->Intersects(visible))
+        {
+            continue;
         }
+        selected.push_back(std::move(sel));
+    }
+    if (profile != nullptr)
+    {
+        profile->erase_us += elapsed_us(erase_start);
     }
     if (selected.empty())
     {
         return false;
     }
 
-    // Sort in ascending scale order (most detailed first)
-    std::sort(selected.begin(), selected.end(),
-              [](const metadata* a, const metadata* b) {
-                  return a->scale < b->scale;});
-
     // Dump what we have to screen
-    printf("Selected %lu/%lu charts:\n", selected.size(), charts_.size());
-    for (const auto &chart : selected)
+    ENCVIZ_LOG(debug, "Selected %lu/%lu charts (%lu in region):\n",
+               selected.size(), set->charts.size(), region.steps.size());
+    for (const selection &sel : selected)
     {
-        printf(" - (%d) %s\n", chart->scale, chart->path.c_str());
+        ENCVIZ_LOG(debug, " - (%d) %s\n", sel.chart->scale, sel.chart->path.c_str());
+    }
+    if (region.complete)
+    {
+        ENCVIZ_LOG(debug, " - Complete coverage\n");
     }
 
-    // Create a new temp dataset for working
-    auto temp_ds = create_temp_dataset();
-
-    // Create layers in output dataset
+    // Create layers in output
     for (const std::string &layer_name : layers)
     {
-        create_layer(ods, layer_name.c_str());
+        data.add_layer(layer_name);
     };
 
-    // Going to need 3 working layers
-    OGRLayer *clip_layer = create_layer(temp_ds.get(), "");
-    OGRLayer *coverage_layer = create_layer(temp_ds.get(), "");
-    OGRLayer *result_layer = create_layer(temp_ds.get(), "");
-
-    // Clip layer will track missing coverage
-    create_bbox_feature(clip_layer, bbox);
+    // Features copied whole, by FID, for layers that are not clipped
+    std::map<std::string, std::unordered_map<GIntBig, std::size_t>> whole_fids;
 
     // Process charts one at a time to reduce repeated S57 parses
-    for (const auto &chart : selected)
+    for (const selection &sel : selected)
     {
-        // Open input data set
-        printf(" - Process: %s\n", chart->path.stem().string().c_str());
-        GDALDataset *ids = GDALDataset::Open(chart->path.string().c_str(),
-                                             GDAL_OF_VECTOR | GDAL_OF_READONLY,
-                                             nullptr, nullptr, nullptr);
-        CHECKNULL(ids, "Cannot open input data set");
+        // Area of the tile not covered by a more detailed chart
+        const metadata *chart = sel.chart;
+        const OGRGeometry *missing = (sel.mask != nullptr) ? sel.mask.get() : tile_poly.get();
+        const OGREnvelope &missing_bbox = sel.mask_bbox;
+        bool missing_is_bbox = (sel.mask == nullptr);
+
+        // Get compiled chart (or compile it now)
+        ENCVIZ_LOG(debug, " - Process: %s\n", chart->path.stem().string().c_str());
+        auto open_start = std::chrono::steady_clock::now();
+        std::shared_ptr<const chart_store> store = chart_cache_.acquire(chart->path,
+                                                                         chart->stamp.version());
+        CHECKNULL(store, "Cannot open input data set");
+        data.hold(store);
+        if (profile != nullptr)
+        {
+            profile->open_us += elapsed_us(open_start);
+        }
 
         // Process chart's layers
         for (const std::string &layer_name : layers)
         {
-            // NOTE: Some OGR drivers need to be done in sequence, and don't
-            // like us jumping around betwen layers, like KML ...
-            OGRLayer *olayer = ods->GetLayerByName(layer_name.c_str());
-            if (olayer == nullptr)
-            {
-                throw std::runtime_error("Cannot open output layer (OGR interleaving issue?)");
-            }
+            auto layer_start = std::chrono::steady_clock::now();
+            tile_data::layer &olayer = data.add_layer(layer_name);
 
             // Get input layer
-            OGRLayer *ilayer = ids->GetLayerByName(layer_name.c_str());
+            const chart_store::layer *ilayer = store->get_layer(layer_name);
             if (ilayer == nullptr)
             {
                 // Inland charts may not have certain features like depth
                 // contours. If not present, just skip and move on
                 continue;
             }
-            
+
             // Certain layers we need to take the centroid of the polygon
             // so we can't crop out only the part we need
             if (layer_name == "TSSLPT"
@@ -191,73 +644,70 @@ bool enc_dataset::export_data(GDALDataset *ods, std::vector<std::string> layers,
                 || layer_name == "M_COVR")
             {
                 // Copy all features from this layer
-                for (const auto &feat : ilayer)
+                std::unordered_map<GIntBig, std::size_t> &fids = whole_fids[layer_name];
+                for (const chart_store::feature &f : ilayer->features)
                 {
                     // TODO! - This needs to check if the feature already exists
                     // from a neighboring chart and merge the geometry if it does
                     // instead of wholesale replacing the feature
-                    GIntBig ifid = feat->GetFID();
-
-                    // Get copy of the output feature
-                    FeatPtr ofeat(olayer->GetFeature(ifid), &OGRFeature::DestroyFeature);
-                    if (ofeat)
+                    const OGRFeature *feat = f.feat.get();
+                    auto [it, added] = fids.emplace(feat->GetFID(), olayer.size());
+                    if (!added)
                     {
                         // already have this feature, merge the geometries
-                        //std::cout << "repeat feature: " << ifid << std::endl;
-
-                        // Steal geometry from output feature
-                        GeoPtr ogeo(ofeat->StealGeometry(), &OGRGeometryFactory::destroyGeometry);
-                        // Merge the geometries
-                        OGRGeometry *uniongeo = ogeo->Union(feat->GetGeometryRef());
-                        // Give the output feature copy its geometry back
-                        ofeat->SetGeometryDirectly(uniongeo);
-                        // Replace output layer feature with one with new geo
-                        if (olayer->SetFeature(ofeat.get()) != OGRERR_NONE)
-                        {
-                            throw std::runtime_error("Cannot copy feature to output layer");
-                        }
-                        // ogeo is deleted, uniongeo now owned by the feature
+                        tile_feature &ofeat = olayer[it->second];
+                        OGRGeometry *uniongeo = ofeat.geo->Union(feat->GetGeometryRef());
+                        CHECKNULL(uniongeo, "Cannot merge feature geometry");
+                        ofeat.geo = data.keep(uniongeo);
                     }
                     else
                     {
-                        // no feature in the output layer yet, just copy it over
-                        if (olayer->SetFeature(feat.get()) != OGRERR_NONE)
-                        {
-                            throw std::runtime_error("Cannot copy feature to output layer");
-                        }
+                        // no feature in the output layer yet, just borrow it
+                        olayer.push_back({feat->GetGeometryRef(), feat});
                     }
-                    
                 }
             }
             else
             {
                 // Clip out only the features in this tile for most layers
-                if (ilayer->Clip(clip_layer, olayer) != OGRERR_NONE)
+                for (const chart_store::feature &f : ilayer->features)
                 {
-                    throw std::runtime_error("Cannot perform layer clip operation");
+                    // Cheap rejection before any geometry work
+                    if (!missing_bbox.Intersects(f.bbox))
+                    {
+                        continue;
+                    }
+
+                    // Anything wholly inside an untouched tile needs no clipping
+                    const OGRGeometry *geo = f.feat->GetGeometryRef();
+                    if (missing_is_bbox && bbox.Contains(f.bbox))
+                    {
+                        olayer.push_back({geo, f.feat.get()});
+                        continue;
+                    }
+
+                    GeoPtr clipped(geo->Intersection(missing), &OGRGeometryFactory::destroyGeometry);
+                    if (clipped == nullptr || clipped->IsEmpty())
+                    {
+                        continue;
+                    }
+                    olayer.push_back({data.keep(clipped.release()), f.feat.get()});
                 }
             }
-        }
 
-        // Remove any coverage from the clipping layer
-        copy_chart_coverage(coverage_layer, ids);
-        if (clip_layer->Erase(coverage_layer, result_layer) != OGRERR_NONE)
-        {
-            throw std::runtime_error("Cannot perform layer erase operation");
+            if (profile != nullptr)
+            {
+                profile->export_us[layer_name] += elapsed_us(layer_start);
+            }
         }
-        std::swap(clip_layer, result_layer);
-        clear_layer(coverage_layer);
-        clear_layer(result_layer);
-
-        // Close input dataset
-        delete ids;
+    }
 
-        // Stop if all coverage is accounted for ...
-        if (clip_layer->GetFeatureCount() == 0)
-        {
-            printf(" - Complete coverage (STOP)\n");
-            break;
-        }
+    if (log_enabled(log_level::debug))
+    {
+        chart_cache::stats cstats = chart_cache_.get_stats();
+        log_printf(" - Chart cache: hits=%lu, misses=%lu, evictions=%lu, open=%lu (%lu MB)\n",
+                   cstats.hits, cstats.misses, cstats.evictions, cstats.entries,
+                   cstats.bytes / (1024 * 1024));
     }
 
     return true;
@@ -293,84 +743,207 @@ void enc_dataset::print_layer(OGRLayer *layer)
 }
 
 /**
- * Save Single ENC Chart To Cache
+ * Save Chart Catalog
  *
- * \param[in] path Path to ENC chart
+ * Writes metadata of all loaded charts to a single binary file.
+ *
+ * \param[in] charts Loaded charts
  * \return False on failure
  */
-bool enc_dataset::save_chart_cache(const metadata &meta)
+bool enc_dataset::save_catalog(const std::map<std::string, metadata> &charts) const
 {
     // Ensure cache directory exists
-    if (!std::filesystem::exists(cache_) &&
-        !std::filesystem::create_directories(cache_))
+    std::error_code ec;
+    std::filesystem::create_directories(cache_, ec);
+
+    // Write to a temp file and rename, so a crash never leaves half a catalog
+    std::filesystem::path path = cache_ / CATALOG_NAME;
+    std::filesystem::path tmp_path = path.string() + ".tmp";
+    {
+        std::ofstream handle(tmp_path.string().c_str(), std::ios::binary);
+        catalog_header header = {{}, CATALOG_VERSION, CATALOG_BYTE_ORDER, charts.size()};
+        memcpy(header.magic, CATALOG_MAGIC, sizeof(header.magic));
+        handle.write((const char*)&header, sizeof(header));
+
+        std::vector<unsigned char> wkb;
+        for (const auto &[name, chart] : charts)
+        {
+            OGRGeometryCollection empty;
+            const OGRGeometry *coverage = chart.coverage ? chart.coverage.get() : &empty;
+            wkb.resize(coverage->WkbSize());
+            coverage->exportToWkb(wkbNDR, wkb.data());
+
+            std::string chart_path = chart.path.string();
+            catalog_record record = {
+                chart.stamp.size, chart.stamp.mtime, chart.stamp.updates,
+                { chart.bbox.MinX, chart.bbox.MaxX, chart.bbox.MinY, chart.bbox.MaxY },
+                chart.scale, (uint32_t)chart_path.size(), wkb.size()
+            };
+            handle.write((const char*)&record, sizeof(record));
+            handle.write(chart_path.data(), chart_path.size());
+            handle.write((const char*)wkb.data(), wkb.size());
+        }
+
+        if (!handle.good())
+        {
+            printf("Cannot write chart catalog %s\n", tmp_path.string().c_str());
+            handle.close();
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
     {
+        printf("Cannot write chart catalog %s: %s\n",
+               path.string().c_str(), ec.message().c_str());
+        std::filesystem::remove(tmp_path, ec);
         return false;
     }
 
-    // Save to /path/to/cache/NAME ...
-    std::filesystem::path cached_path = cache_ / meta.path.stem();
-    std::ofstream handle(cached_path.string().c_str());
-    if (handle.good())
+    return true;
+}
+
+/**
+ * Load Chart Catalog
+ *
+ * \return Previously saved chart metadata by path (empty if none/invalid)
+ */
+std::map<std::string, enc_dataset::metadata> enc_dataset::load_catalog() const
+{
+    std::map<std::string, metadata> catalog;
+
+    // Map the whole file in one go
+    std::filesystem::path path = cache_ / CATALOG_NAME;
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return catalog;
+    }
+    struct stat info;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        base = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return catalog;
+    }
+
+    // Check the header matches what we'd write
+    const uint8_t *data = (const uint8_t*)base;
+    std::size_t len = info.st_size;
+    std::size_t pos = sizeof(catalog_header);
+    catalog_header header;
+    bool valid = (len >= sizeof(header));
+    if (valid)
+    {
+        memcpy(&header, data, sizeof(header));
+        valid = (memcmp(header.magic, CATALOG_MAGIC, sizeof(header.magic)) == 0) &&
+            (header.version == CATALOG_VERSION) &&
+            (header.byte_order == CATALOG_BYTE_ORDER);
+    }
+
+    // Read each record, never trusting lengths past the end of the file
+    for (uint64_t i = 0; valid && i < header.count; i++)
+    {
+        catalog_record record;
+        if (len - pos < sizeof(record))
+        {
+            valid = false;
+            break;
+        }
+        memcpy(&record, data + pos, sizeof(record));
+        pos += sizeof(record);
+        if (record.path_len > len - pos || record.wkb_len > len - pos - record.path_len)
+        {
+            valid = false;
+            break;
+        }
+
+        metadata next;
+        next.path = std::string((const char*)data + pos, record.path_len);
+        pos += record.path_len;
+
+        OGRGeometry *coverage = nullptr;
+        if (OGRGeometryFactory::createFromWkb(data + pos, nullptr, &coverage,
+                                              record.wkb_len) != OGRERR_NONE)
+        {
+            valid = false;
+            break;
+        }
+        next.coverage.reset(coverage);
+        pos += record.wkb_len;
+
+        next.scale = record.scale;
+        next.bbox.MinX = record.bbox[0];
+        next.bbox.MaxX = record.bbox[1];
+        next.bbox.MinY = record.bbox[2];
+        next.bbox.MaxY = record.bbox[3];
+        next.stamp = { record.size, record.mtime, record.updates };
+        catalog[next.path.string()] = next;
+    }
+    munmap(base, len);
+
+    if (!valid)
     {
-        handle << meta.path << "\n" << meta.scale << "\n"
-               << meta.bbox.MinX << "\n" << meta.bbox.MaxX << "\n"
-               << meta.bbox.MinY << "\n" << meta.bbox.MaxY << "\n";
+        printf("Ignoring invalid chart catalog %s\n", path.string().c_str());
+        catalog.clear();
     }
 
-    return handle.good();
+    return catalog;
 }
 
 /**
- * Load Single ENC Chart from Cache
+ * Get Chart File Version
  *
  * \param[in] path Path to ENC chart
- * \return False on failure
+ * \return Version of chart and its update files
  */
-bool enc_dataset::load_chart_cache(const std::filesystem::path &path)
+enc_dataset::file_stamp enc_dataset::read_stamp(const std::filesystem::path &path)
 {
-    // Look for /path/to/cache/NAME ...
-    std::filesystem::path cached_path = cache_ / path.stem();
-    if (std::filesystem::exists(cached_path))
+    file_stamp stamp;
+    stamp.size = std::filesystem::file_size(path);
+    stamp.mtime = std::filesystem::last_write_time(path).time_since_epoch().count();
+
+    // Update files live alongside the base cell
+    std::vector<std::string> versions;
+    for (const auto &entry : std::filesystem::directory_iterator(path.parent_path()))
     {
-        // Try and read it
-        std::ifstream handle(cached_path.string().c_str());
-        if (handle.good())
+        std::string ext = entry.path().extension().string();
+        if (entry.path().stem() == path.stem() && is_chart_file(ext) && ext != ".000")
         {
-            metadata next;
-            handle >> next.path >> next.scale
-                   >> next.bbox.MinX >> next.bbox.MaxX
-                   >> next.bbox.MinY >> next.bbox.MaxY;
-
-            // Ensure no EOF, and path matches before saving metadata
-            if (handle.good() && (path == next.path))
-            {
-                std::cout << "Load Chart bounds from cache: " << path << std::endl;
-                charts_[path.stem().string()] = next;
-                return true;
-            }
+            versions.push_back(file_version(entry));
         }
     }
+    stamp.updates = hash_versions(versions);
 
-    // Failed to load
-    return false;
+    return stamp;
 }
 
 /**
- * Load Single ENC Chart from Disk
+ * Parse ENC Chart Metadata
+ *
+ * Opens its own dataset handle, so may be called from several threads.
  *
  * \param[in] path Path to ENC chart
- * \return False on failure
+ * \param[in] stamp Version of chart files
+ * \return Chart metadata
  */
-bool enc_dataset::load_chart_disk(const std::filesystem::path &path)
+enc_dataset::metadata enc_dataset::read_chart(const std::filesystem::path &path,
+                                              const file_stamp &stamp)
 {
     metadata next = {path};
+    next.stamp = stamp;
 
     // Open dataset
-    std::cout << "Open Chart: " << path.string() << std::endl;
     const char *const drivers[] = { "S57", nullptr };
-    GDALDataset *ds = GDALDataset::Open(path.string().c_str(),
-                                        GDAL_OF_VECTOR | GDAL_OF_READONLY,
-                                        drivers, nullptr, nullptr);
+    std::unique_ptr<GDALDataset> ds(GDALDataset::Open(path.string().c_str(),
+                                                      GDAL_OF_VECTOR | GDAL_OF_READONLY,
+                                                      drivers, nullptr, nullptr));
     CHECKNULL(ds, "Cannot open OGR dataset");
 
     // Get Compilation Scale of Chart
@@ -386,7 +959,6 @@ bool enc_dataset::load_chart_disk(const std::filesystem::path &path)
 
         // .. that has "Dataset Parameter" (DSPM) "Compilation of Scale" (CSCL)
         next.scale = get_feat_field_int(feat.get(), "DSPM_CSCL");
-    std::cout << "  scale: " << next.scale << std::endl;
     }
 
     // Get Chart Coverage Bounds
@@ -397,6 +969,7 @@ bool enc_dataset::load_chart_disk(const std::filesystem::path &path)
 
         // There's probably only one coverage feature,
         // but just in case, combine any we find
+        GeoPtr coverage(nullptr, &OGRGeometryFactory::destroyGeometry);
         for (auto &feat : layer)
         {
             // "Category of Coverage" (CATCOV) may be:
@@ -407,162 +980,224 @@ bool enc_dataset::load_chart_disk(const std::filesystem::path &path)
 
             // Get coverage for this feature
             OGRGeometry *geo = feat->GetGeometryRef();
-            CHECKNULL(layer, "Cannot get feature geometry");
+            CHECKNULL(geo, "Cannot get feature geometry");
 
             // There's probably only one coverage feature,
             // but in case there's not merge each one
             OGREnvelope covr;
             geo->getEnvelope(&covr);
             next.bbox.Merge(covr);
+            coverage.reset(coverage ? coverage->Union(geo) : geo->clone());
+            CHECKNULL(coverage, "Cannot merge chart coverage");
         }
 
-    std::cout << "  coverage X: " << next.bbox.MinX << "," << next.bbox.MaxX << std::endl;
-    std::cout << "  coverage Y: " << next.bbox.MinY << "," << next.bbox.MaxY << std::endl;
+        // Keep a simplified copy for chart selection
+        if (coverage)
+        {
+            OGRGeometry *simple = coverage->SimplifyPreserveTopology(COVERAGE_TOLERANCE);
+            next.coverage.reset(simple ? simple : coverage.release());
+        }
+        else
+        {
+            next.coverage = std::make_shared<OGRGeometryCollection>();
+        }
     }
 
-    // Cleanup
-    delete ds;
+    // One line per chart, since charts may be read in parallel
+    printf("Open Chart: %s (scale %d, X=%g,%g Y=%g,%g)\n", path.string().c_str(),
+           next.scale, next.bbox.MinX, next.bbox.MaxX, next.bbox.MinY, next.bbox.MaxY);
 
-    // Save
-    charts_[path.stem().string()] = next;
-    save_chart_cache(next);
-
-    return true;
+    return next;
 }
 
 /**
- * Get OGR Integer Field
+ * Parse Changed ENC Charts
  *
- * \param[in] feat OGR feature
- * \param[in] name Field name
- * \return Requested value
+ * Charts are read on a temporary worker pool, and merged into the index
+ * in order once all are done.
+ *
+ * \param[in] cells Chart paths and file versions
+ * \param[in,out] charts Charts by name, parsed charts are added
  */
-int enc_dataset::get_feat_field_int(OGRFeature *feat, const char *name)
+void enc_dataset::read_charts(const std::vector<std::pair<std::filesystem::path, file_stamp>> &cells,
+                              std::map<std::string, metadata> &charts)
 {
-    // See if field even exists
-    int idx = feat->GetFieldIndex(name);
-    if (idx == -1)
+    if (cells.empty())
     {
-        std::ostringstream oss;
-        oss << "Feature does not have field \"" << name << "\"";
-        throw std::runtime_error(oss.str());
+        return;
     }
 
-    // Check that the field is really an integer
-    OGRFieldDefn *defn = feat->GetFieldDefnRef(idx);
-    CHECKNULL(defn, "Cannot get feature field definition");
-    if (defn->GetType() != OGRFieldType::OFTInteger)
+    std::size_t nthreads = load_threads_;
+    if (nthreads == 0)
     {
-        std::ostringstream oss;
-        oss << "Feature field \"" << name << "\" is not an integer";
-        throw std::runtime_error(oss.str());
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
     }
+    nthreads = std::min(nthreads, cells.size());
 
-    // Safe to call now
-    return feat->GetFieldAsInteger(idx);
-}
+    // Each chart gets its own result slot, so no locking needed
+    std::vector<metadata> results(cells.size());
+    std::vector<std::exception_ptr> errors(cells.size());
+    std::atomic<std::size_t> done{0};
+    std::size_t step = std::max<std::size_t>(1, cells.size() / 20);
+    auto start = std::chrono::steady_clock::now();
+    auto parse = [&](std::size_t i) {
+        try
+        {
+            results[i] = read_chart(cells[i].first, cells[i].second);
+        }
+        catch (...)
+        {
+            errors[i] = std::current_exception();
+        }
+        std::size_t count = ++done;
+        if ((count % step) == 0 || count == cells.size())
+        {
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf(" - Parsed %lu/%lu charts (%.0f%%, %.1f s)\n", count, cells.size(),
+                   100.0 * count / cells.size(), secs);
+        }
+    };
 
-/**
- * Create Temporary Dataset
- *
- * \return Created dataset
- */
-std::unique_ptr<GDALDataset> enc_dataset::create_temp_dataset()
-{
-    GDALDataset *ptr = mem_drv_->Create("", 0, 0, 0, GDT_Unknown, nullptr);
-    CHECKNULL(ptr, "Cannot create temporary dataset");
-    return std::unique_ptr<GDALDataset>(ptr);
+    if (nthreads == 1)
+    {
+        for (std::size_t i = 0; i < cells.size(); i++)
+        {
+            parse(i);
+        }
+    }
+    else
+    {
+        // Queue sized to hold every chart, pool drains it before joining
+        worker_pool pool(nthreads, cells.size());
+        for (std::size_t i = 0; i < cells.size(); i++)
+        {
+            if (!pool.try_submit([&parse, i]() { parse(i); }))
+            {
+                throw std::runtime_error("Cannot queue chart for loading");
+            }
+        }
+    }
+
+    // Merge in discovery order, first failure aborts as for serial loading
+    for (std::size_t i = 0; i < cells.size(); i++)
+    {
+        if (errors[i])
+        {
+            std::rethrow_exception(errors[i]);
+        }
+        charts[cells[i].first.stem().string()] = std::move(results[i]);
+    }
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Parsed %lu charts in %.1f s (%lu threads)\n", cells.size(), secs, nthreads);
 }
 
 /**
- * Create Temporary Layer
+ * Get Current Chart Set
  *
- * \param[out] ds Dataset for layer
- * \param[in] name Name of layer
- * \return Created dataset
+ * \return Chart set, stays valid while held
  */
-OGRLayer *enc_dataset::create_layer(GDALDataset *ds, const char *name)
+std::shared_ptr<const enc_dataset::chart_set> enc_dataset::snapshot() const
 {
-    OGRLayer *ptr = ds->CreateLayer(name);
-    CHECKNULL(ptr, "Cannot create dataset layer");
-    return ptr;
+    return std::atomic_load(&set_);
 }
 
-
 /**
- * Copy ENC Chart Coverage
+ * Index and Publish Chart Set
+ *
+ * Builds the spatial index and generation id, then replaces the current
+ * chart set.
  *
- * \param[out] layer Output layer
- * \param[in] ds Input dataset
+ * \param[in] next New chart set (charts filled in)
  */
-void enc_dataset::copy_chart_coverage(OGRLayer *layer, GDALDataset *ds)
+void enc_dataset::publish(std::shared_ptr<chart_set> next)
 {
-    // Get "Coverage" (M_COVR) data
-    OGRLayer *ilayer = ds->GetLayerByName("M_COVR");
-    CHECKNULL(ilayer, "Cannot open M_COVR layer");
-
-    // Copy any defined coverage features
-    for (auto &feat : ilayer)
+    std::vector<chart_index::item> items;
+    for (const auto &[name, chart] : next->charts)
     {
-        // "Category of Coverage" (CATCOV) may be:
-        //  - "coverage available" (1)
-        //  - "no coverage available" (2)
-        if (get_feat_field_int(feat.get(), "CATCOV") != 1)
-            continue;
-
-        // Create output feature
-        if (layer->CreateFeature(feat.get()) != OGRERR_NONE)
-        {
-            throw std::runtime_error("Cannot create coverage feature");
-        }
+        items.push_back({chart.bbox, chart.scale, next->indexed.size()});
+        next->indexed.push_back(&chart);
     }
+    next->index.build(std::move(items));
+    next->generation = make_generation(next->charts);
+
+    // Set first, a render that reads the old version may use either set
+    std::atomic_store(&set_, std::shared_ptr<const chart_set>(std::move(next)));
+    version_++;
 }
 
 /**
- * Clear Layer Features
+ * Get Scale Band Plan
  *
- * \param[out] layer OGR layer
+ * \param[in] set Chart set the plan belongs to
+ * \param[in] scale_min Minimum chart compilation scale
+ * \return Plan of charts at or above scale_min, valid while set is held
  */
-void enc_dataset::clear_layer(OGRLayer *layer)
+scale_plan &enc_dataset::get_plan(const chart_set &set, int scale_min) const
 {
-    for (auto &feat : layer)
+    std::lock_guard<std::mutex> lock(set.plans_mutex);
+    std::unique_ptr<scale_plan> &plan = set.plans[scale_min];
+    if (plan == nullptr)
     {
-        if (layer->DeleteFeature(feat->GetFID()) != OGRERR_NONE)
+        // Band charts, already in ascending scale order (most detailed first)
+        OGREnvelope world;
+        world.MinX = world.MinY = -360;
+        world.MaxX = world.MaxY = 360;
+        std::vector<scale_plan::chart> charts;
+        for (std::size_t id : set.index.query(world, scale_min))
         {
-            throw std::runtime_error("Cannot delete layer feature");
+            charts.push_back({set.indexed[id]->bbox, set.indexed[id]->coverage, id});
         }
+
+        // Charts are erased with their full compiled coverage, as drawn
+        auto exact_coverage = [this, &set](std::size_t id) -> std::shared_ptr<const OGRGeometry> {
+            const metadata *chart = set.indexed[id];
+            std::shared_ptr<const chart_store> store = chart_cache_.acquire(chart->path,
+                                                                             chart->stamp.version());
+            CHECKNULL(store, "Cannot open input data set");
+            const OGRGeometry *coverage = store->get_coverage();
+            if (coverage == nullptr)
+            {
+                return nullptr;
+            }
+            return std::shared_ptr<const OGRGeometry>(store, coverage);
+        };
+        ENCVIZ_LOG(debug, "Planning scale band %d (%lu charts)\n", scale_min, charts.size());
+        plan = std::make_unique<scale_plan>(std::move(charts), exact_coverage);
     }
+    return *plan;
 }
 
 /**
- * Bounding Box to Layer Feature
+ * Get OGR Integer Field
  *
- * \param[out] layer GDAL output layer
- * \param[in] bbox OGR Envelope
+ * \param[in] feat OGR feature
+ * \param[in] name Field name
+ * \return Requested value
  */
-void enc_dataset::create_bbox_feature(OGRLayer *layer, const OGREnvelope &bbox)
+int enc_dataset::get_feat_field_int(OGRFeature *feat, const char *name)
 {
-    // Define polygon boundary first
-    OGRLinearRing geo_ring;
-    geo_ring.addPoint(bbox.MinX, bbox.MinY);
-    geo_ring.addPoint(bbox.MaxX, bbox.MinY);
-    geo_ring.addPoint(bbox.MaxX, bbox.MaxY);
-    geo_ring.addPoint(bbox.MinX, bbox.MaxY);
-    geo_ring.addPoint(bbox.MinX, bbox.MinY);
-
-    // Define the polygon
-    OGRPolygon geo_poly;
-    geo_poly.addRing(&geo_ring);
-
-    // Create a feature based on the output layer
-    OGRFeature feat(layer->GetLayerDefn());
-    feat.SetGeometry(&geo_poly);
+    // See if field even exists
+    int idx = feat->GetFieldIndex(name);
+    if (idx == -1)
+    {
+        std::ostringstream oss;
+        oss << "Feature does not have field \"" << name << "\"";
+        throw std::runtime_error(oss.str());
+    }
 
-    // Add to layer
-    if (layer->CreateFeature(&feat) != OGRERR_NONE)
+    // Check that the field is really an integer
+    OGRFieldDefn *defn = feat->GetFieldDefnRef(idx);
+    CHECKNULL(defn, "Cannot get feature field definition");
+    if (defn->GetType() != OGRFieldType::OFTInteger)
     {
-        throw std::runtime_error("Cannot create layer feature");
+        std::ostringstream oss;
+        oss << "Feature field \"" << name << "\" is not an integer";
+        throw std::runtime_error(oss.str());
     }
+
+    // Safe to call now
+    return feat->GetFieldAsInteger(idx);
 }
 
 }; // ~namespace encviz
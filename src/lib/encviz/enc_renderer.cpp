@@ -6,13 +6,29 @@
  */
 
 #include <encviz/enc_renderer.h>
+#include <encviz/log.h>
+#include <encviz/simplify.h>
 #include <encviz/xml_config.h>
 #include <librsvg/rsvg.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 namespace fs = std::filesystem;
 
 typedef std::unique_ptr<OGRGeometry, decltype(&OGRGeometryFactory::destroyGeometry)> GeoPtr;
 
+// Deepest zoom served, cached tiles are dropped down to it
+#define MAX_ZOOM 30
+
+// Largest metatile (tiles per side)
+#define MAX_METATILE 64
+
+// Shares of the memory budget (relative weights)
+#define BUDGET_CHARTS 0.6
+#define BUDGET_TILES 0.25
+#define BUDGET_SURFACES 0.1
+#define BUDGET_ICONS 0.05
+
 namespace encviz
 {
 
@@ -36,27 +52,6 @@ const std::map<int, std::string> ENC_COLORS = {
     {13, "pink"}
 };
 
-/**
- * Cairo Stream Callback
- *
- * \param[out] closure Pointer to std::vector<uint8_t> output stream
- * \param[in] data Data buffer
- * \param[in] length Length of data buffer
- */
-static cairo_status_t cairo_write_to_vector(void *closure,
-                                            const unsigned char *data,
-                                            unsigned int length)
-{
-    // TODO - Can probably make this better
-    std::vector<uint8_t> *output = (std::vector<uint8_t>*)closure;
-    output->reserve(output->size() + length);
-    for (unsigned int i = 0; i < length; i++)
-    {
-        output->push_back(data[i]);
-    }
-    return CAIRO_STATUS_SUCCESS;
-}
-
 /**
  * Constructor
  *
@@ -82,46 +77,119 @@ enc_renderer::enc_renderer(const char *config_file)
 /**
  * Render Chart Data
  *
- * \param[out] data PNG bytestream
+ * \param[out] data Encoded image bytestream
  * \param[in] tc Tile coordinate system (WMTS or XYZ)
  * \param[in] x Tile X coordinate (horizontal)
  * \param[in] y Tile Y coordinate (vertical)
  * \param[in] z Tile Z coordinate (zoom)
  * \param[in] style Tile styling data
+ * \param[in] fmt Image format
+ * \param[out] profile Stage timings, added to (optional)
  * \return False if no data to render
  */
 bool enc_renderer::render(std::vector<uint8_t> &data, tile_coords tc,
-                          int x, int y, int z, const char *style_name)
+                          int x, int y, int z, const char *style_name,
+                          tile_format fmt, render_profile *profile)
 {
-    // Grab the style we need
-    if (styles_.find(style_name) == styles_.end())
+    // Stage timings of this render alone, for the histograms
+    auto start = std::chrono::steady_clock::now();
+    render_profile timings;
+    bool rendered = false;
+    if (fmt == tile_format::MVT)
+    {
+        rendered = render_vector(data, tc, x, y, z, style_name, &timings);
+    }
+    else
+    {
+        render_context_pool::lease ctx = render_surface(tc, x, y, z, 1, style_name, &timings);
+        if (ctx)
+        {
+            // Write out image
+            auto encode_start = std::chrono::steady_clock::now();
+            rendered = encoder_.encode(data, ctx->surface(), fmt);
+            timings.encode_us += elapsed_us(encode_start);
+            ENCVIZ_LOG(debug, "%s Size: %lu (%ld usec)\n", tile_format_extension(fmt),
+                       data.size(), (long)timings.encode_us);
+        }
+    }
+
+    metrics_.record(timings, elapsed_us(start));
+    if (profile != nullptr)
+    {
+        profile->add(timings);
+    }
+    return rendered;
+}
+
+/**
+ * Build Vector Tile
+ *
+ * \param[out] data Encoded MVT bytes
+ * \param[in] tc Tile coordinate system (WMTS or XYZ)
+ * \param[in] x Tile X coordinate (horizontal)
+ * \param[in] y Tile Y coordinate (vertical)
+ * \param[in] z Tile Z coordinate (zoom)
+ * \param[in] style_name Name of style (selects layers only)
+ * \param[out] profile Stage timings, added to (optional)
+ * \return False if no data in tile
+ */
+bool enc_renderer::render_vector(std::vector<uint8_t> &data, tile_coords tc,
+                                 int x, int y, int z, const char *style_name,
+                                 render_profile *profile)
+{
+    auto style_it = styles_.find(style_name);
+    if (style_it == styles_.end())
     {
         return false;
     }
-    const render_style &style = styles_[style_name];
 
-    // Collect the layers we need
+    // Each layer once, styles may draw a layer more than once
     std::vector<std::string> layers;
-    for (const layer_style &lstyle : style.layers)
+    for (const layer_style &lstyle : style_it->second.layers)
     {
-        layers.push_back(lstyle.layer_name);
+        if (std::find(layers.begin(), layers.end(), lstyle.layer_name) == layers.end())
+        {
+            layers.push_back(lstyle.layer_name);
+        }
     }
 
-    // Get base tile boundaries
-    encviz::web_mercator wm(x, y, z, tc, tile_size_);
-    OGREnvelope bbox = wm.get_bbox_deg();
+    // Same charts a raster tile would use at this zoom
+    mvt_encoder mvt(x, y, z, tc, mvt_opts_);
+    tile_data features;
+    if (!enc_.export_data(features, layers, mvt.get_bbox_deg(), min_display_scale(z), profile))
+    {
+        ENCVIZ_LOG(debug, "No chart data for tile\n");
+        return false;
+    }
 
-    // Oversample a bit so not clip text between tiles
+    auto encode_start = std::chrono::high_resolution_clock::now();
+    for (const std::string &layer_name : layers)
     {
-        double oversample = 0.2;
-        double width = bbox.MaxX - bbox.MinX;
-        double height = bbox.MaxY - bbox.MinY;
-        bbox.MinX -= oversample * (width/2);
-        bbox.MaxX += oversample * (width/2);
-        bbox.MinY -= oversample * (height/2);
-        bbox.MaxY += oversample * (height/2);
+        const tile_data::layer *tile_layer = features.get_layer(layer_name);
+        for (const tile_feature &feat : *tile_layer)
+        {
+            mvt.add_feature(layer_name, feat.geo, feat.attrs);
+        }
+    }
+    bool have_data = mvt.finish(data);
+    auto encode_end = std::chrono::high_resolution_clock::now();
+    auto encode_duration = std::chrono::duration_cast<std::chrono::microseconds>(encode_end - encode_start);
+    ENCVIZ_LOG(debug, "mvt Size: %lu (%ld usec)\n", data.size(), (long)encode_duration.count());
+    if (profile != nullptr)
+    {
+        profile->encode_us += encode_duration.count();
     }
+    return have_data;
+}
 
+/**
+ * Minimum Display Scale for Zoom
+ *
+ * \param[in] z Tile Z coordinate (zoom)
+ * \return Smallest chart compilation scale used at this zoom
+ */
+int enc_renderer::min_display_scale(int z)
+{
     // Compute minimum presentation scale, based on average latitude and zoom
     // TODO - Is this the right computation?
     //double avgLat = (bbox.MinY + bbox.MaxY) / 2;
@@ -139,21 +207,69 @@ bool enc_renderer::render(std::vector<uint8_t> &data, tile_coords tc,
         scale_min = 22000 - 1;
     if (z >= 14)
         scale_min = 12000;
-            
+    return scale_min;
+}
+
+/**
+ * Render Chart Data to an Image
+ *
+ * \param[in] tc Tile coordinate system (WMTS or XYZ)
+ * \param[in] x Tile X coordinate (horizontal)
+ * \param[in] y Tile Y coordinate (vertical)
+ * \param[in] z Tile Z coordinate (zoom)
+ * \param[in] span Tiles per side (see web_mercator)
+ * \param[in] style_name Name of style
+ * \param[out] profile Stage timings, added to (optional)
+ * \return Context holding the ARGB32 image of (span * tile_size) pixels
+ *         per side, or null if no data to render
+ */
+render_context_pool::lease enc_renderer::render_surface(tile_coords tc, int x, int y, int z,
+                                                        int span, const char *style_name,
+                                                        render_profile *profile)
+{
+    // Grab the style we need (without modifying styles_, may be threaded)
+    auto style_it = styles_.find(style_name);
+    if (style_it == styles_.end())
+    {
+        return nullptr;
+    }
+    const render_style &style = style_it->second;
+
+    // Surface and scratch buffers from an earlier render
+    render_context_pool::lease ctx = contexts_.acquire();
+    cairo_t *cr = ctx->begin(tile_size_ * span);
+
+    // Collect the layers we need
+    std::vector<std::string> &layers = ctx->layers;
+    for (const layer_style &lstyle : style.layers)
+    {
+        layers.push_back(lstyle.layer_name);
+    }
+
+    // Get base tile boundaries
+    encviz::web_mercator wm(x, y, z, tc, tile_size_, span);
+    OGREnvelope bbox = wm.get_bbox_deg();
+
+    // Oversample a bit (a fifth of one tile) so not clip text between tiles
+    {
+        double oversample = 0.2 / span;
+        double width = bbox.MaxX - bbox.MinX;
+        double height = bbox.MaxY - bbox.MinY;
+        bbox.MinX -= oversample * (width/2);
+        bbox.MaxX += oversample * (width/2);
+        bbox.MinY -= oversample * (height/2);
+        bbox.MaxY += oversample * (height/2);
+    }
+
     // Export all data in this tile
-    GDALDataset *tile_data = GetGDALDriverManager()->GetDriverByName("Memory")->
-        Create("", 0, 0, 0, GDT_Unknown, nullptr);
-    if (!enc_.export_data(tile_data, layers, bbox, scale_min))
+    int scale_min = min_display_scale(z);
+    tile_data features;
+    if (!enc_.export_data(features, layers, bbox, scale_min, profile))
     {
-    printf("Error exporting tile data\n");
-        return false;
+        ENCVIZ_LOG(debug, "No chart data for tile\n");
+        return nullptr;
     }
 
-    // Create a cairo surface
-    cairo_surface_t *surface =
-        cairo_image_surface_create(CAIRO_FORMAT_ARGB32, tile_size_, tile_size_);
-    cairo_t *cr = cairo_create(surface);
-                                                          
     // Flood background w/ fixed color
     if (style.background.has_value())
     {
@@ -161,39 +277,49 @@ bool enc_renderer::render(std::vector<uint8_t> &data, tile_coords tc,
         cairo_paint(cr);
     }
 
-    // M_COVR polygons...
-    OGRLayer *coverage_layer = tile_data->GetLayerByName("M_COVR");
-    // New geometry collection to compile all coverage polygons
-    GeoPtr coverage_multi_poly(OGRGeometryFactory::createGeometry(wkbMultiPolygon), &OGRGeometryFactory::destroyGeometry);
+    // M_COVR polygon rings, indexed in pixel space once per tile so
+    // borders can skip edges on the coverage bounds cheaply
+    coverage_index &coverage = ctx->coverage;
+    const tile_data::layer *coverage_layer = features.get_layer("M_COVR");
     if (coverage_layer)
     {
-        for (const auto &feat : coverage_layer)
+        std::vector<coord> &ring_pts = ctx->points;
+        auto add_polygon = [&](const OGRPolygon *poly)
         {
-            OGRGeometry *geo = feat->GetGeometryRef();
+            for (const OGRLinearRing *ring : *poly)
+            {
+                project_line(ring, wm, 0, ring_pts);
+                coverage.add_ring(ring_pts);
+            }
+        };
+        for (const tile_feature &feat : *coverage_layer)
+        {
+            const OGRGeometry *geo = feat.geo;
             OGRwkbGeometryType gtype = geo->getGeometryType();
             switch (gtype)
             {
-                case wkbPolygon: // 6
-                    // Copy all coverage polygons on this layer into one geometry object
-                    coverage_multi_poly->toMultiPolygon()->addGeometry(geo);
-                    break;
+            case wkbPolygon: // 6
+                add_polygon(geo->toPolygon());
+                break;
             case wkbMultiPolygon: // 10
                 for (const OGRPolygon *child : geo->toMultiPolygon())
                 {
-                    // Copy all coverage polygons on this layer into one geometry object
-                    coverage_multi_poly->toMultiPolygon()->addGeometry(child);
+                    add_polygon(child);
                 }
                 break;
             default:
                 break;
             }
-            
         }
     }
+    coverage.build();
 
-    std::cout << "Render Tile: " << std::endl;
-    std::cout << " min scale: " << scale_min << std::endl;
+    ENCVIZ_LOG(debug, "Render Tile:\n");
+    if (span > 1)
+        ENCVIZ_LOG(debug, " metatile: %dx%d\n", span, span);
+    ENCVIZ_LOG(debug, " min scale: %d\n", scale_min);
     auto render_start = std::chrono::high_resolution_clock::now();
+    int64_t icon_start = svg_collection::thread_usec();
     std::string longest_layer = "";
     std::chrono::microseconds longest_layer_duration = std::chrono::microseconds(0);
     
@@ -204,142 +330,21 @@ bool enc_renderer::render(std::vector<uint8_t> &data, tile_coords tc,
         if (lstyle.verbose)
             printf("  Layer: %s\n", lstyle.layer_name.c_str());
     
-        // Render feature geometry in this layer
-        OGRLayer *tile_layer = tile_data->GetLayerByName(lstyle.layer_name.c_str());
-        for (const auto &feat : tile_layer)
+        // Render feature geometry in this layer, with the routine for its
+        // object class (resolved when the style was loaded)
+        feature_renderer draw = renderer_for(lstyle.object_class);
+        const tile_data::layer *tile_layer = features.get_layer(lstyle.layer_name);
+        for (const tile_feature &feat : *tile_layer)
         {
-            OGRGeometry *geo = feat->GetGeometryRef();
-            
-            // Render M_COVR
-            if (std::string(feat->GetDefnRef()->GetName()) == "M_COVR")
-            {
-                OGRwkbGeometryType gtype = geo->getGeometryType();
-                switch (gtype)
-                {
-                case wkbPolygon: // 6
-                    render_poly_borders(cr, geo->toPolygon(), wm, lstyle);
-                    break;
-                case wkbMultiPolygon: // 10
-                    for (const OGRPolygon *child : geo->toMultiPolygon())
-                    {
-                        render_poly_borders(cr, child, wm, lstyle);
-                    }
-                    break;
-                default:
-                    break;
-                }
-            }
-            // Render DEPARE
-            else if (std::string(feat->GetDefnRef()->GetName()) == "DEPARE"
-                     || std::string(feat->GetDefnRef()->GetName()) == "DRGARE")
-            {
-                OGRwkbGeometryType gtype = geo->getGeometryType();
-                switch (gtype)
-                {
-                case wkbPolygon: // 6
-                    render_depare(cr, geo->toPolygon(), wm, lstyle, feat.get());
-                    break;
-                case wkbMultiPolygon: // 10
-                    for (const OGRPolygon *child : geo->toMultiPolygon())
-                    {
-                        render_depare(cr, child, wm, lstyle, feat.get());
-                    }
-                    break;
-                default:
-                    break;
-                }
-            }
-            else
-            {
-                // render basic geometries
-                double phase = 0;
-                render_geo(cr, geo, wm, lstyle, phase, coverage_multi_poly.get());
-            }
-            
-            // Render anything with a buoy shape as a buoy
-            int buoy_shape_idx = feat->GetFieldIndex("BOYSHP");
-            if (buoy_shape_idx != -1)
-            {
-                render_buoy(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-
-            // Render anything with a beacon shape as a beacon
-            int beacon_shape_idx = feat->GetFieldIndex("BCNSHP");
-            if (beacon_shape_idx != -1)
-            {
-                render_beacon(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-
-            // Render Fog Signals
-            if (std::string(feat->GetDefnRef()->GetName()) == "FOGSIG")
-            {
-                render_fog(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render Lights
-            else if (std::string(feat->GetDefnRef()->GetName()) == "LIGHTS")
-            {
-                render_light(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render Landmark
-            else if (std::string(feat->GetDefnRef()->GetName()) == "LNDMRK")
-            {
-                render_landmark(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render Silo/Tank
-            else if (std::string(feat->GetDefnRef()->GetName()) == "SILTNK")
-            {
-                render_silotank(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render Rocks
-            else if (std::string(feat->GetDefnRef()->GetName()) == "UWTROC")
-            {
-                render_rock(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render Obstructions
-            else if (std::string(feat->GetDefnRef()->GetName()) == "OBSTRN")
-            {
-                render_obstruction(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render Wrecks
-            else if (std::string(feat->GetDefnRef()->GetName()) == "WRECKS")
-            {
-                render_wreck(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render Anchor Berths
-            else if (std::string(feat->GetDefnRef()->GetName()) == "ACHBRT")
-            {
-                render_anchor(cr, geo->toPoint(), wm, lstyle, feat.get());
-            }
-            // Render traffic separation scheme parts
-            else if (std::string(feat->GetDefnRef()->GetName()) == "TSSLPT")
-            {
-                render_traffic_sep_part(cr, geo->toPolygon(), wm, lstyle, feat.get());
-            }
-            // Render name of a land area
-            else if (std::string(feat->GetDefnRef()->GetName()) == "LNDARE")
-            {
-                render_named_area(cr, geo->toPolygon(), wm, lstyle, feat.get());
-            }
-            // Render name of a sea areas
-            else if (std::string(feat->GetDefnRef()->GetName()) == "SEAARE")
-            {
-                render_named_area(cr, geo->toPolygon(), wm, lstyle, feat.get());
-            }
-            // Render name of a land regions
-            else if (std::string(feat->GetDefnRef()->GetName()) == "LNDRGN")
-            {
-                render_named_area(cr, geo->toPolygon(), wm, lstyle, feat.get());
-            }
-            // Render name of a cities
-            else if (std::string(feat->GetDefnRef()->GetName()) == "BUAARE")
-            {
-                render_named_area(cr, geo->toPolygon(), wm, lstyle, feat.get());
-            }
-            
+            (this->*draw)(cr, feat, wm, lstyle, &coverage);
         }
 
         auto layer_end = std::chrono::high_resolution_clock::now();
         auto layer_duration = std::chrono::duration_cast<std::chrono::microseconds>(layer_end - layer_start);
+        if (profile != nullptr)
+        {
+            profile->draw_us[lstyle.layer_name] += layer_duration.count();
+        }
 
         if (layer_duration > longest_layer_duration)
         {
@@ -354,30 +359,622 @@ bool enc_renderer::render(std::vector<uint8_t> &data, tile_coords tc,
 
     }
 
-    // Write out image
-    data.clear();
-    cairo_status_t rc =
-        cairo_surface_write_to_png_stream(surface,
-                                          cairo_write_to_vector,
-                                          &data);
-    if (rc)
-    {
-        printf("Cairo write error %d : %s\n", rc,
-               cairo_status_to_string(rc));
-    }
-
-    printf("Png Size: %lu\n", data.size());
     auto render_end = std::chrono::high_resolution_clock::now();
     auto render_duration = std::chrono::duration_cast<std::chrono::microseconds>(render_end - render_start);
-    std::cout << "Render Time: " << render_duration.count() << " usec" << std::endl;
-    std::cout << "Longest Layer: " << longest_layer << " " << longest_layer_duration.count() << " usec" << std::endl;
+    ENCVIZ_LOG(debug, "Render Time: %ld usec\n", (long)render_duration.count());
+    ENCVIZ_LOG(debug, "Longest Layer: %s %ld usec\n", longest_layer.c_str(),
+               (long)longest_layer_duration.count());
+    if (profile != nullptr)
+    {
+        profile->icon_us += svg_collection::thread_usec() - icon_start;
+    }
     
-    // Cleanup
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
-    GDALClose(tile_data);
+    return ctx;
+}
+
+/**
+ * Get Render Routine for Object Class
+ *
+ * \param[in] object_class S57 object class of layer
+ * \return Routine to render each feature of the layer
+ */
+enc_renderer::feature_renderer enc_renderer::renderer_for(S57Class object_class)
+{
+    switch (object_class)
+    {
+        case S57_M_COVR:
+            return &enc_renderer::draw_coverage;
+
+        case S57_DEPARE:
+        case S57_DRGARE:
+            return &enc_renderer::draw_depare;
+
+        case S57_BOYCAR:
+        case S57_BOYINB:
+        case S57_BOYISD:
+        case S57_BOYLAT:
+        case S57_BOYSAW:
+        case S57_BOYSPP:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_buoy>;
+
+        case S57_BCNCAR:
+        case S57_BCNISD:
+        case S57_BCNLAT:
+        case S57_BCNSAW:
+        case S57_BCNSPP:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_beacon>;
+
+        case S57_FOGSIG:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_fog>;
+
+        case S57_LIGHTS:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_light>;
+
+        case S57_LNDMRK:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_landmark>;
+
+        case S57_SILTNK:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_silotank>;
+
+        case S57_UWTROC:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_rock>;
+
+        case S57_OBSTRN:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_obstruction>;
+
+        case S57_WRECKS:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_wreck>;
+
+        case S57_ACHBRT:
+            return &enc_renderer::draw_symbol<OGRPoint, &enc_renderer::render_anchor>;
+
+        case S57_TSSLPT:
+            return &enc_renderer::draw_symbol<OGRPolygon, &enc_renderer::render_traffic_sep_part>;
+
+        case S57_LNDARE:
+        case S57_SEAARE:
+        case S57_LNDRGN:
+        case S57_BUAARE:
+            return &enc_renderer::draw_symbol<OGRPolygon, &enc_renderer::render_named_area>;
+
+        default:
+            return &enc_renderer::draw_basic;
+    }
+}
+
+/**
+ * Render Feature Geometry Only
+ *
+ * \param[out] cr Image context
+ * \param[in] feat Tile feature
+ * \param[in] wm Web Mercator point mapper
+ * \param[in] style Feature style
+ * \param[in] coverage Lines will not be rendered where they lie on
+ *                     coverage bounds
+ */
+void enc_renderer::draw_basic(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                              const layer_style &style, const coverage_index *coverage)
+{
+    // render basic geometries
+    double phase = 0;
+    render_geo(cr, feat.geo, wm, style, phase, coverage);
+}
+
+/**
+ * Render Coverage (M_COVR) Borders
+ */
+void enc_renderer::draw_coverage(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                                 const layer_style &style, const coverage_index *coverage)
+{
+    OGRwkbGeometryType gtype = feat.geo->getGeometryType();
+    switch (gtype)
+    {
+    case wkbPolygon: // 6
+        render_poly_borders(cr, feat.geo->toPolygon(), wm, style);
+        break;
+    case wkbMultiPolygon: // 10
+        for (const OGRPolygon *child : feat.geo->toMultiPolygon())
+        {
+            render_poly_borders(cr, child, wm, style);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Render Depth Area (DEPARE, DRGARE)
+ */
+void enc_renderer::draw_depare(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                               const layer_style &style, const coverage_index *coverage)
+{
+    OGRwkbGeometryType gtype = feat.geo->getGeometryType();
+    switch (gtype)
+    {
+    case wkbPolygon: // 6
+        render_depare(cr, feat.geo->toPolygon(), wm, style, feat.attrs);
+        break;
+    case wkbMultiPolygon: // 10
+        for (const OGRPolygon *child : feat.geo->toMultiPolygon())
+        {
+            render_depare(cr, child, wm, style, feat.attrs);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Cast Geometry for Symbol Renderer
+ */
+static const OGRPoint *symbol_geometry(const OGRGeometry *geo, const OGRPoint *)
+{
+    return geo->toPoint();
+}
+
+static const OGRPolygon *symbol_geometry(const OGRGeometry *geo, const OGRPolygon *)
+{
+    return geo->toPolygon();
+}
+
+/**
+ * Render Feature Geometry, Then a Symbol
+ */
+template <typename G, void (enc_renderer::*symbol)(cairo_t *, const G *,
+                                                   const web_mercator &,
+                                                   const layer_style &,
+                                                   const OGRFeature *)>
+void enc_renderer::draw_symbol(cairo_t *cr, const tile_feature &feat, const web_mercator &wm,
+                               const layer_style &style, const coverage_index *coverage)
+{
+    draw_basic(cr, feat, wm, style, coverage);
+    (this->*symbol)(cr, symbol_geometry(feat.geo, (const G*)nullptr), wm, style, feat.attrs);
+}
+
+/**
+ * Check Style
+ *
+ * \param[in] style_name Name of style
+ * \return True if the style is configured
+ */
+bool enc_renderer::has_style(const std::string &style_name) const
+{
+    return styles_.find(style_name) != styles_.end();
+}
+
+/**
+ * Look Up Cached Tile
+ *
+ * \param[in] tc Tile coordinate system (WMTS or XYZ)
+ * \param[in] x Tile X coordinate (horizontal)
+ * \param[in] y Tile Y coordinate (vertical)
+ * \param[in] z Tile Z coordinate (zoom)
+ * \param[in] style_name Name of style
+ * \param[in] fmt Image format
+ * \param[in] as_file Disk cache hits may be an open file to send (tile->fd)
+ * \return Cached tile, or null if it must be rendered
+ */
+tile_ptr enc_renderer::cached_tile(tile_coords tc, int x, int y, int z,
+                                   const char *style_name, tile_format fmt,
+                                   bool as_file)
+{
+    // Only known styles, the name ends up in cache paths
+    if (styles_.find(style_name) == styles_.end())
+    {
+        return nullptr;
+    }
+    return tiles_.get(make_tile_key(tc, x, y, z, style_name, fmt), as_file);
+}
+
+/**
+ * Get Tile, Rendering and Caching if Needed
+ *
+ * \param[out] tile Encoded tile
+ * \param[in] tc Tile coordinate system (WMTS or XYZ)
+ * \param[in] x Tile X coordinate (horizontal)
+ * \param[in] y Tile Y coordinate (vertical)
+ * \param[in] z Tile Z coordinate (zoom)
+ * \param[in] style_name Name of style
+ * \param[in] fmt Image format
+ * \return False if no data to render
+ */
+bool enc_renderer::get_tile(tile_ptr &tile, tile_coords tc, int x, int y, int z,
+                            const char *style_name, tile_format fmt)
+{
+    tile = cached_tile(tc, x, y, z, style_name, fmt);
+    if (tile)
+    {
+        return true;
+    }
+
+    tile_key key = make_tile_key(tc, x, y, z, style_name, fmt);
+    if (metatile_size_ > 1 && fmt != tile_format::MVT)
+    {
+        return get_metatile(tile, key);
+    }
+
+    // Duplicate requests wait on the first render and share its bytes
+    tile = renders_.run(tile_cache::key_string(key), [&]() -> tile_ptr {
+        uint64_t version = enc_.get_version();
+        std::vector<uint8_t> data;
+        if (!render(data, tc, x, y, z, style_name, fmt))
+        {
+            return nullptr;
+        }
+        if (enc_.get_version() != version)
+        {
+            // Charts changed under the render, serve it but don't keep it
+            return tile_cache::make_tile(std::move(data));
+        }
+        return tiles_.put(key, std::move(data));
+    });
+    return tile != nullptr;
+}
+
+/**
+ * Get Every Tile of a Metatile
+ *
+ * \param[out] tiles Tiles with data (XYZ keys)
+ * \param[in] x Tile X coordinate of any tile in the metatile (XYZ)
+ * \param[in] y Tile Y coordinate of any tile in the metatile (XYZ)
+ * \param[in] z Tile Z coordinate (zoom)
+ * \param[in] style_name Name of style
+ * \param[in] fmt Tile format
+ * \return False if no tile has data
+ */
+bool enc_renderer::get_metatile_tiles(std::vector<std::pair<tile_key, tile_ptr>> &tiles,
+                                      int x, int y, int z, const char *style_name,
+                                      tile_format fmt)
+{
+    tiles.clear();
+    int span = std::min(metatile_size_, 1 << z);
+    tile_key meta = make_tile_key(tile_coords::XYZ, x - x % span, y - y % span, z,
+                                  style_name, fmt);
+
+    // Use cached copies if every tile is there
+    std::vector<tile_ptr> found;
+    for (int i = 0; i < span * span; i++)
+    {
+        tile_ptr tile = cached_tile(tile_coords::XYZ, meta.x + i % span, meta.y + i / span,
+                                    z, style_name, fmt);
+        if (!tile)
+        {
+            break;
+        }
+        found.push_back(tile);
+    }
+
+    if (found.size() != std::size_t(span * span))
+    {
+        found.assign(span * span, nullptr);
+        if (metatile_size_ > 1 && fmt != tile_format::MVT)
+        {
+            // One render, whatever the tile cache keeps of it
+            metatile_ptr rendered = render_metatile(meta, span);
+            found = *rendered;
+        }
+        else
+        {
+            // Vector tiles are rendered one at a time
+            for (int i = 0; i < span * span; i++)
+            {
+                get_tile(found[i], tile_coords::XYZ, meta.x + i % span, meta.y + i / span,
+                         z, style_name, fmt);
+            }
+        }
+    }
 
-    return true;
+    for (int i = 0; i < span * span; i++)
+    {
+        if (found[i])
+        {
+            tile_key sub = meta;
+            sub.x += i % span;
+            sub.y += i / span;
+            tiles.push_back({sub, found[i]});
+        }
+    }
+    return !tiles.empty();
+}
+
+/**
+ * Get Tile by Rendering its Metatile
+ *
+ * \param[out] tile Encoded tile
+ * \param[in] key Requested tile (XYZ)
+ * \return False if no data to render
+ */
+bool enc_renderer::get_metatile(tile_ptr &tile, const tile_key &key)
+{
+    // Metatile containing this tile (smaller at low zoom)
+    int span = std::min(metatile_size_, 1 << key.z);
+    tile_key meta = key;
+    meta.x -= key.x % span;
+    meta.y -= key.y % span;
+
+    metatile_ptr tiles = render_metatile(meta, span);
+    tile = (*tiles)[(key.y - meta.y) * span + (key.x - meta.x)];
+    return tile != nullptr;
+}
+
+/**
+ * Render Metatile
+ *
+ * \param[in] meta Bottom left tile of the metatile (XYZ)
+ * \param[in] span Tiles per side
+ * \return Encoded tiles, row-major from the bottom left (null if empty)
+ */
+enc_renderer::metatile_ptr enc_renderer::render_metatile(const tile_key &meta, int span)
+{
+    // Requests anywhere in the metatile wait on one render
+    return metatiles_.run(tile_cache::key_string(meta), [&]() -> metatile_ptr {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t version = enc_.get_version();
+        render_profile timings;
+        auto result = std::make_shared<std::vector<tile_ptr>>(span * span);
+        render_context_pool::lease ctx = render_surface(tile_coords::XYZ, meta.x, meta.y,
+                                                        meta.z, span, meta.style.c_str(), &timings);
+        if (!ctx)
+        {
+            metrics_.record(timings, elapsed_us(start));
+            return result;
+        }
+
+        // Slice in place, surface rows run top (max y) to bottom
+        cairo_surface_t *surface = ctx->surface();
+        cairo_surface_flush(surface);
+        const uint8_t *pixels = cairo_image_surface_get_data(surface);
+        int stride = cairo_image_surface_get_stride(surface);
+        for (int row = 0; row < span; row++)
+        {
+            for (int col = 0; col < span; col++)
+            {
+                const uint8_t *origin = pixels +
+                    std::size_t(row) * tile_size_ * stride +
+                    std::size_t(col) * tile_size_ * 4;
+
+                std::vector<uint8_t> data;
+                auto encode_start = std::chrono::steady_clock::now();
+                bool encoded = encoder_.encode(data, origin, tile_size_, tile_size_,
+                                               stride, meta.format);
+                timings.encode_us += elapsed_us(encode_start);
+                if (!encoded)
+                {
+                    continue;
+                }
+
+                tile_key sub = meta;
+                sub.x += col;
+                sub.y += span - row - 1;
+                (*result)[(sub.y - meta.y) * span + col] = (enc_.get_version() == version) ?
+                    tiles_.put(sub, std::move(data)) : tile_cache::make_tile(std::move(data));
+            }
+        }
+        ctx.reset();
+        metrics_.record(timings, elapsed_us(start));
+        return result;
+    });
+}
+
+/**
+ * Tiles Over Area
+ *
+ * \param[in] bbox Area (deg)
+ * \param[in] z Zoom
+ * \param[in] margin Extra tiles on each side
+ * \return Tiles touching the area (XYZ)
+ */
+static tile_range tiles_over(const OGREnvelope &bbox, int z, int margin)
+{
+    // Web Mercator tile coordinates, 0,0 at the northwest
+    double n = 1 << z;
+    auto tile_x = [&](double lon) { return (int)std::floor((lon + 180.0) / 360.0 * n); };
+    auto tile_y = [&](double lat) {
+        double rad = std::clamp(lat, -85.0511, 85.0511) * M_PI / 180.0;
+        return (int)std::floor((1.0 - std::asinh(std::tan(rad)) / M_PI) / 2.0 * n);
+    };
+
+    int max = (1 << z) - 1;
+    tile_range range;
+    range.z = z;
+    range.x0 = std::clamp(tile_x(bbox.MinX) - margin, 0, max);
+    range.x1 = std::clamp(tile_x(bbox.MaxX) + margin, 0, max);
+
+    // Flip to XYZ, 0,0 at the southwest
+    range.y0 = std::clamp(max - tile_y(bbox.MinY) - margin, 0, max);
+    range.y1 = std::clamp(max - tile_y(bbox.MaxY) + margin, 0, max);
+    return range;
+}
+
+/**
+ * Apply Changed Chart Files
+ *
+ * Re-indexes the changed cells and drops the cached tiles over them (all
+ * zooms, one tile of margin). Renders in progress finish on the charts
+ * they started with, and are not cached.
+ *
+ * \param[in] files Changed, added or removed chart files or directories
+ *
+ * \note Called from the chart watch thread when watch_charts is on.
+ */
+void enc_renderer::update_charts(const std::vector<fs::path> &files)
+{
+    std::vector<OGREnvelope> changed;
+    if (!enc_.update_charts(files, changed))
+    {
+        return;
+    }
+
+    // Neighbor tiles too, for labels and icons drawn across tile edges
+    std::vector<tile_range> ranges;
+    for (const OGREnvelope &bbox : changed)
+    {
+        for (int z = 0; z <= MAX_ZOOM; z++)
+        {
+            ranges.push_back(tiles_over(bbox, z, 1));
+        }
+    }
+    std::size_t dropped = tiles_.invalidate(ranges, enc_.get_generation());
+    ENCVIZ_LOG(info, "Dropped %lu cached tiles over %lu changed charts\n",
+               dropped, changed.size());
+}
+
+/**
+ * Get Tile Cache Counters
+ *
+ * \return Tile cache usage counters
+ */
+tile_cache::stats enc_renderer::get_tile_cache_stats() const
+{
+    return tiles_.get_stats();
+}
+
+/**
+ * Get Chart Set Generation
+ *
+ * \return Generation id of the loaded charts
+ */
+std::string enc_renderer::get_generation() const
+{
+    return enc_.get_generation();
+}
+
+/**
+ * Get Metatile Size
+ *
+ * \return Tiles per metatile side (1 = off)
+ */
+int enc_renderer::get_metatile_size() const
+{
+    return metatile_size_;
+}
+
+/**
+ * Check Disk Tile Cache
+ *
+ * \return False if rendered tiles are only kept in memory
+ */
+bool enc_renderer::has_tile_disk_cache() const
+{
+    return tiles_.has_disk();
+}
+
+/**
+ * Get Coalesced Request Count
+ *
+ * \return Tile requests that waited on a render already in progress
+ */
+uint64_t enc_renderer::get_joined_renders() const
+{
+    return renders_.joined() + metatiles_.joined();
+}
+
+/**
+ * Write Prometheus Metrics
+ *
+ * Render stage and per layer latency histograms, plus tile and chart
+ * cache counters.
+ *
+ * \param[out] out Text exposition is appended
+ */
+void enc_renderer::write_metrics(std::string &out) const
+{
+    metrics_.write(out);
+
+    char text[1024];
+    tile_cache::stats tstats = tiles_.get_stats();
+    snprintf(text, sizeof(text),
+             "# HELP encviz_tile_cache_requests_total Tile cache lookups by result.\n"
+             "# TYPE encviz_tile_cache_requests_total counter\n"
+             "encviz_tile_cache_requests_total{result=\"memory_hit\"} %lu\n"
+             "encviz_tile_cache_requests_total{result=\"disk_hit\"} %lu\n"
+             "encviz_tile_cache_requests_total{result=\"miss\"} %lu\n"
+             "# HELP encviz_tile_cache_evictions_total Tiles dropped from memory.\n"
+             "# TYPE encviz_tile_cache_evictions_total counter\n"
+             "encviz_tile_cache_evictions_total %lu\n"
+             "# HELP encviz_tile_cache_bytes Size of tiles held in memory.\n"
+             "# TYPE encviz_tile_cache_bytes gauge\n"
+             "encviz_tile_cache_bytes %lu\n",
+             (unsigned long)tstats.memory_hits, (unsigned long)tstats.disk_hits,
+             (unsigned long)tstats.misses, (unsigned long)tstats.evictions,
+             (unsigned long)tstats.bytes);
+    out += text;
+
+    chart_cache::stats cstats = enc_.get_chart_cache_stats();
+    snprintf(text, sizeof(text),
+             "# HELP encviz_chart_cache_requests_total Chart cache lookups by result.\n"
+             "# TYPE encviz_chart_cache_requests_total counter\n"
+             "encviz_chart_cache_requests_total{result=\"hit\"} %lu\n"
+             "encviz_chart_cache_requests_total{result=\"miss\"} %lu\n"
+             "# HELP encviz_chart_cache_evictions_total Compiled charts dropped.\n"
+             "# TYPE encviz_chart_cache_evictions_total counter\n"
+             "encviz_chart_cache_evictions_total %lu\n"
+             "# HELP encviz_chart_cache_bytes Estimated size of compiled charts.\n"
+             "# TYPE encviz_chart_cache_bytes gauge\n"
+             "encviz_chart_cache_bytes %lu\n"
+             "# HELP encviz_joined_renders_total Tile requests that shared a render in progress.\n"
+             "# TYPE encviz_joined_renders_total counter\n"
+             "encviz_joined_renders_total %lu\n",
+             (unsigned long)cstats.hits, (unsigned long)cstats.misses,
+             (unsigned long)cstats.evictions, (unsigned long)cstats.bytes,
+             (unsigned long)get_joined_renders());
+    out += text;
+
+    snprintf(text, sizeof(text),
+             "# HELP encviz_memory_limit_bytes Memory budget shared by the caches (0 = none).\n"
+             "# TYPE encviz_memory_limit_bytes gauge\n"
+             "encviz_memory_limit_bytes %lu\n",
+             (unsigned long)budget_.get_limit());
+    out += text;
+
+    std::vector<memory_budget::usage> usage = budget_.get_usage();
+    out += "# HELP encviz_memory_bytes Estimated memory held by each cache.\n"
+        "# TYPE encviz_memory_bytes gauge\n";
+    for (const memory_budget::usage &u : usage)
+    {
+        snprintf(text, sizeof(text), "encviz_memory_bytes{cache=\"%s\"} %lu\n",
+                 u.name.c_str(), (unsigned long)u.bytes);
+        out += text;
+    }
+    out += "# HELP encviz_memory_share_bytes Budget each cache keeps while over the limit.\n"
+        "# TYPE encviz_memory_share_bytes gauge\n";
+    for (const memory_budget::usage &u : usage)
+    {
+        snprintf(text, sizeof(text), "encviz_memory_share_bytes{cache=\"%s\"} %lu\n",
+                 u.name.c_str(), (unsigned long)u.share);
+        out += text;
+    }
+    out += "# HELP encviz_memory_trims_total Caches trimmed to make room for others.\n"
+        "# TYPE encviz_memory_trims_total counter\n";
+    for (const memory_budget::usage &u : usage)
+    {
+        snprintf(text, sizeof(text), "encviz_memory_trims_total{cache=\"%s\"} %lu\n",
+                 u.name.c_str(), (unsigned long)u.trims);
+        out += text;
+    }
+}
+
+/**
+ * Build Tile Cache Key
+ *
+ * \param[in] tc Tile coordinate system (WMTS or XYZ)
+ * \param[in] x Tile X coordinate (horizontal)
+ * \param[in] y Tile Y coordinate (vertical)
+ * \param[in] z Tile Z coordinate (zoom)
+ * \param[in] style_name Name of style
+ * \param[in] fmt Image format
+ * \return Cache key in XYZ coordinates
+ */
+tile_key enc_renderer::make_tile_key(tile_coords tc, int x, int y, int z,
+                                     const char *style_name, tile_format fmt) const
+{
+    if (tc == tile_coords::WTMS)
+    {
+        y = (1 << z) - y - 1;
+    }
+    return tile_key{style_name, z, x, y, fmt};
 }
 
 /**
@@ -393,7 +990,7 @@ bool enc_renderer::render(std::vector<uint8_t> &data, tile_coords tc,
 void enc_renderer::render_geo(cairo_t *cr, const OGRGeometry *geo,
                               const web_mercator &wm, const layer_style &style,
                               double &phase,
-                              OGRGeometry *coverage_polygons)
+                              const coverage_index *coverage)
 {
     if (style.verbose)
         std::cout << "Render GEO: " << geo->getGeometryName() << std::endl;
@@ -443,27 +1040,27 @@ void enc_renderer::render_geo(cairo_t *cr, const OGRGeometry *geo,
         case wkbMultiLineString: // 5
             for (const OGRGeometry *child : geo->toMultiLineString())
             {
-                render_geo(cr, child, wm, style, phase, coverage_polygons);
+                render_geo(cr, child, wm, style, phase, coverage);
             }
             break;
 
         case wkbPolygon: // 6
             render_poly(cr, geo->toPolygon(), wm, style);
-            render_poly_borders(cr, geo->toPolygon(), wm, style, coverage_polygons);
+            render_poly_borders(cr, geo->toPolygon(), wm, style, coverage);
             break;
 
         case wkbMultiPolygon: // 10
             for (const OGRPolygon *child : geo->toMultiPolygon())
             {
                 render_poly(cr, child, wm, style);
-                render_poly_borders(cr, child, wm, style, coverage_polygons);
+                render_poly_borders(cr, child, wm, style, coverage);
             }
             break;
 
         case wkbGeometryCollection: // 7
             for (const OGRGeometry *child : geo->toGeometryCollection())
             {
-                render_geo(cr, child, wm, style, phase, coverage_polygons);
+                render_geo(cr, child, wm, style, phase, coverage);
             }
             break;
 
@@ -525,26 +1122,20 @@ void enc_renderer::render_depth(cairo_t *cr, const OGRPoint *geo, double depth,
     char dm_text[64] = {};
     snprintf(dm_text, sizeof(dm_text)-1, "%d", depth_dm);
 
-    // Set text style
-    set_color(cr, style.line_color);
-    cairo_select_font_face(cr, "monospace",
-                           CAIRO_FONT_SLANT_NORMAL,
-                           CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_font_size(cr, 10);
-    
-    // Determine text render size
+    // Lay out text from the pre-shaped digits
+    thread_local std::vector<cairo_glyph_t> m_glyphs, dm_glyphs;
     cairo_text_extents_t m_extents = {};
-    cairo_text_extents(cr, m_text, &m_extents);
+    sounding_font_.layout(m_text, m_glyphs, m_extents);
 
     cairo_text_extents_t dm_extents = {};
-    cairo_text_extents(cr, dm_text, &dm_extents);
+    sounding_font_.layout(dm_text, dm_glyphs, dm_extents);
 
     // Draw text
+    set_color(cr, style.line_color);
     if (depth_dm == 0)
     {
         // draw sounding text without a subscript
-        cairo_move_to(cr, c.x - m_extents.width/2, c.y + m_extents.height/2);
-        cairo_show_text(cr, m_text);
+        sounding_font_.show(cr, m_glyphs, c.x - m_extents.width/2, c.y + m_extents.height/2);
     }
     else
     {
@@ -556,11 +1147,9 @@ void enc_renderer::render_depth(cairo_t *cr, const OGRPoint *geo, double depth,
         float x = c.x - width / 2;
         float y = c.y + height / 2;
         // big number
-        cairo_move_to(cr, x, y);
-        cairo_show_text(cr, m_text);
+        sounding_font_.show(cr, m_glyphs, x, y);
         // subscript is to the right and half way down the big number
-        cairo_move_to(cr, x + m_extents.width, y + m_extents.height / 2);
-        cairo_show_text(cr, dm_text);
+        sounding_font_.show(cr, dm_glyphs, x + m_extents.width, y + m_extents.height / 2);
     }
 }
 
@@ -621,15 +1210,14 @@ void enc_renderer::render_line(cairo_t *cr, const OGRLineString *geo,
         || style.line_width == 0)
         return;
     
-    // Pass OGR points to cairo
+    // Pass decimated pixel coordinates to cairo
+    thread_local std::vector<coord> pts;
+    project_line(geo, wm, simplify_px_, pts);
     bool first = true;
     coord prev;
     double new_phase = phase;
-    for (auto &point : geo)
+    for (const coord &c : pts)
     {
-        // Convert lat/lon to pixel coordinates
-        coord c = wm.point_to_pixels(point);
-
         // Mark first point as pen-down
         if (first)
         {
@@ -734,13 +1322,12 @@ void enc_renderer::render_wavy_line(cairo_t *cr, const OGRLineString *geo,
                                     const web_mercator &wm, const layer_style &style,
                                     double &phase)
 {
+    thread_local std::vector<coord> pts;
+    project_line(geo, wm, simplify_px_, pts);
     bool first = true;
     coord prev;
-    for (auto &point : geo)
+    for (const coord &c : pts)
     {
-        // Convert lat/lon to pixel coordinates
-        coord c = wm.point_to_pixels(point);
-
         // Mark first point as pen-down
         if (first)
         {
@@ -802,13 +1389,12 @@ void enc_renderer::render_poly(cairo_t *cr, const OGRPolygon *geo,
         //throw std::runtime_error("Unhandled polygon with interior rings");
     }
 
-    // Pass OGR points to cairo
+    // Pass decimated pixel coordinates to cairo
+    thread_local std::vector<coord> pts;
+    project_line(geo->getExteriorRing(), wm, simplify_px_, pts);
     bool first = true;
-    for (auto &point : geo->getExteriorRing())
+    for (const coord &c : pts)
     {
-        // Convert lat/lon to pixel coordinates
-        coord c = wm.point_to_pixels(point);
-
         // Mark first point as pen-down
         if (first)
         {
@@ -833,12 +1419,12 @@ void enc_renderer::render_poly(cairo_t *cr, const OGRPolygon *geo,
  * \param[in] geo Feature geometry
  * \param[in] wm Web Mercator point mapper
  * \param[in] style Feature style
- * \param[in] coverage_polygons Lines will not be rendered where they overlap with
- *                              with coverage bounds
+ * \param[in] coverage Lines will not be rendered where they lie on
+ *                     coverage bounds
  */
 void enc_renderer::render_poly_borders(cairo_t *cr, const OGRPolygon *geo,
                                        const web_mercator &wm, const layer_style &style,
-                                       const OGRGeometry *coverage_polygons)
+                                       const coverage_index *coverage)
 {
     if (geo->IsEmpty() || !geo->IsValid()
         || style.line_color.alpha == 0
@@ -851,48 +1437,36 @@ void enc_renderer::render_poly_borders(cairo_t *cr, const OGRPolygon *geo,
         //throw std::runtime_error("Unhandled polygon with interior rings");
     }
 
-    bool clip_coverage = (coverage_polygons != nullptr && !coverage_polygons->IsEmpty());
+    bool clip_coverage = (coverage != nullptr && !coverage->empty());
 
-    // Pass OGR points to cairo
-    bool first = true;
-    OGRPoint last_point;
-    for (auto &point : geo->getExteriorRing())
+    // Pass decimated pixel coordinates to cairo, kept points are exact
+    // projections of their source points, as are the coverage rings
+    const OGRLinearRing *ring = geo->getExteriorRing();
+    thread_local std::vector<coord> pts;
+    project_line(ring, wm, simplify_px_, pts);
+    bool last_touches = false;
+    for (std::size_t i = 0; i < pts.size(); i++)
     {
-        // Convert lat/lon to pixel coordinates
-        coord c = wm.point_to_pixels(point);
+        const coord &c = pts[i];
+        bool this_touches = clip_coverage && coverage->touches(c);
 
         // Mark first point as pen-down
-        if (first)
+        if (i == 0)
         {
             cairo_move_to(cr, c.x, c.y);
-            first = false;
+        }
+        else if (last_touches && this_touches)
+        {
+            // don't draw the line on the border between maps
+            cairo_move_to(cr, c.x, c.y);
         }
         else
         {
-            if (clip_coverage)
-            {
-                bool last_touches = false;
-                bool this_touches = false;
-                for (const OGRPolygon *child : coverage_polygons->toMultiPolygon())
-                {
-                    last_touches = last_touches || child->Touches(&last_point);
-                    this_touches = this_touches || child->Touches(&point);
-                }
-                
-                if (last_touches && this_touches)
-                    // don't draw the line on the border between maps
-                    cairo_move_to(cr, c.x, c.y);
-                else
-                    // line not co-linear with the border
-                    cairo_line_to(cr, c.x, c.y);
-            }
-            else
-            {
-                cairo_line_to(cr, c.x, c.y);
-            }
+            // line not co-linear with the border
+            cairo_line_to(cr, c.x, c.y);
         }
 
-        last_point = point;
+        last_touches = this_touches;
     }
 
     // Draw the border
@@ -1522,23 +2096,14 @@ void enc_renderer::render_named_area(cairo_t *cr, const OGRPolygon *geo,
 
     if (place_name != "")
     {
-        char name[place_name.length() + 1];
-        strcpy(name, place_name.c_str());
-
-        // Set text style
-        set_color(cr, style.line_color);
-        cairo_select_font_face(cr, "monospace",
-                               CAIRO_FONT_SLANT_NORMAL,
-                               CAIRO_FONT_WEIGHT_BOLD);
-        cairo_set_font_size(cr, 10);
-    
         // Determine text render size
+        thread_local std::vector<cairo_glyph_t> glyphs;
         cairo_text_extents_t name_extents = {};
-        cairo_text_extents(cr, name, &name_extents);
+        name_font_.layout(place_name.c_str(), glyphs, name_extents);
 
         // Draw text
-        cairo_move_to(cr, c.x - name_extents.width/2, c.y + name_extents.height/2);
-        cairo_show_text(cr, name);
+        set_color(cr, style.line_color);
+        name_font_.show(cr, glyphs, c.x - name_extents.width/2, c.y + name_extents.height/2);
     }
 }
 
@@ -1585,6 +2150,122 @@ void enc_renderer::load_config(const fs::path &config_file)
     tile_size_ = atoi(xml_text(xml_query(root, "tile_size")));
     min_scale0_ = atof(xml_text(xml_query(root, "scale_base")));
 
+    // Optional size of open chart cache (MB)
+    std::size_t chart_cache_mb = 512;
+    if (root->FirstChildElement("chart_cache_mb"))
+    {
+        chart_cache_mb = atol(xml_text(xml_query(root, "chart_cache_mb")));
+    }
+
+    // Optional chart parsing threads (0 = one per core)
+    std::size_t load_threads = 0;
+    if (root->FirstChildElement("load_threads"))
+    {
+        load_threads = atol(xml_text(xml_query(root, "load_threads")));
+    }
+
+    // Optional size of rendered tile memory cache (MB)
+    std::size_t tile_cache_mb = 256;
+    if (root->FirstChildElement("tile_cache_mb"))
+    {
+        tile_cache_mb = atol(xml_text(xml_query(root, "tile_cache_mb")));
+    }
+
+    // Optional rendered tile disk cache (empty disables)
+    std::optional<fs::path> tile_path;
+    if (tinyxml2::XMLElement *node = root->FirstChildElement("tile_cache_path"))
+    {
+        tile_path = node->GetText() ? node->GetText() : "";
+    }
+
+    // Optional tile encoder settings
+    tile_encoder::options encode_opts;
+    if (root->FirstChildElement("png_level"))
+    {
+        encode_opts.png_level = atoi(xml_text(xml_query(root, "png_level")));
+    }
+    if (tinyxml2::XMLElement *node = root->FirstChildElement("png_palette"))
+    {
+        node->QueryBoolText(&encode_opts.png_palette);
+    }
+    if (root->FirstChildElement("webp_quality"))
+    {
+        encode_opts.webp_quality = atoi(xml_text(xml_query(root, "webp_quality")));
+    }
+
+    // Optional line simplification after projection (pixels, 0 = off)
+    if (root->FirstChildElement("simplify_tolerance"))
+    {
+        simplify_px_ = std::max(0.0, atof(xml_text(xml_query(root, "simplify_tolerance"))));
+    }
+
+    // Optional vector tile settings
+    if (root->FirstChildElement("mvt_extent"))
+    {
+        mvt_opts_.extent = std::max(256, atoi(xml_text(xml_query(root, "mvt_extent"))));
+    }
+    if (root->FirstChildElement("mvt_buffer"))
+    {
+        mvt_opts_.buffer = std::max(0, atoi(xml_text(xml_query(root, "mvt_buffer"))));
+    }
+    if (root->FirstChildElement("mvt_tolerance"))
+    {
+        mvt_opts_.tolerance = atof(xml_text(xml_query(root, "mvt_tolerance")));
+    }
+
+    // Optional metatile size (tiles per side, 1 = off)
+    if (root->FirstChildElement("metatile_size"))
+    {
+        // Must divide the tile grid at every zoom, or blocks run off its edge
+        metatile_size_ = atoi(xml_text(xml_query(root, "metatile_size")));
+        if (metatile_size_ < 1 || metatile_size_ > MAX_METATILE ||
+            (metatile_size_ & (metatile_size_ - 1)) != 0)
+        {
+            throw std::runtime_error("metatile_size must be a power of two up to " +
+                                     std::to_string(MAX_METATILE));
+        }
+    }
+
+    // Optional pre-rendered icons (default on)
+    bool icon_sprites = true;
+    if (tinyxml2::XMLElement *node = root->FirstChildElement("icon_sprites"))
+    {
+        node->QueryBoolText(&icon_sprites);
+    }
+
+    // Optional memory limit shared by all caches (MB, 0 = off)
+    std::size_t memory_budget_mb = 0;
+    if (root->FirstChildElement("memory_budget_mb"))
+    {
+        memory_budget_mb = atol(xml_text(xml_query(root, "memory_budget_mb")));
+    }
+
+    // Optional low memory profile, charts keep only styled layers (default off)
+    bool low_memory = false;
+    if (tinyxml2::XMLElement *node = root->FirstChildElement("low_memory"))
+    {
+        node->QueryBoolText(&low_memory);
+    }
+
+    // Optional chart directory watch (default off)
+    bool watch_charts = false;
+    if (tinyxml2::XMLElement *node = root->FirstChildElement("watch_charts"))
+    {
+        node->QueryBoolText(&watch_charts);
+    }
+
+    // Optional log verbosity (default info, debug prints every tile)
+    if (root->FirstChildElement("log_level"))
+    {
+        std::string name = xml_text(xml_query(root, "log_level"));
+        log_level level;
+        if (!parse_log_level(name, level))
+        {
+            throw std::runtime_error("Invalid log_level: " + name);
+        }
+        set_log_level(level);
+    }
+
     // Ensure paths are absolute
     if (chart_path.is_relative())
         chart_path = config_path / chart_path;
@@ -1594,6 +2275,10 @@ void enc_renderer::load_config(const fs::path &config_file)
         style_path = config_path / style_path;
     if (svg_path.is_relative())
         svg_path = config_path / svg_path;
+    if (!tile_path.has_value())
+        tile_path = (meta_path / "..").lexically_normal() / "tiles";
+    else if (!tile_path->empty() && tile_path->is_relative())
+        tile_path = config_path / *tile_path;
 
     printf(" - Charts: %s\n", chart_path.string().c_str());
     printf(" - Metadata: %s\n", meta_path.string().c_str());
@@ -1601,13 +2286,52 @@ void enc_renderer::load_config(const fs::path &config_file)
     printf(" - SVGs: %s\n", svg_path.string().c_str());
     printf(" - Tile Size: %d\n", tile_size_);
     printf(" - Scale Base: %g\n", min_scale0_);
+    printf(" - Chart Cache: %lu MB\n", chart_cache_mb);
+    printf(" - Load Threads: %lu\n", load_threads);
+    printf(" - Tile Cache: %lu MB, %s\n", tile_cache_mb,
+           tile_path->empty() ? "(no disk)" : tile_path->string().c_str());
+    printf(" - Metatiles: %dx%d\n", metatile_size_, metatile_size_);
+    printf(" - Icon Sprites: %s\n", icon_sprites ? "on" : "off");
+    printf(" - PNG: level %d%s, WebP: %s\n", encode_opts.png_level,
+           encode_opts.png_palette ? ", palette" : "",
+           tile_encoder::supports(tile_format::WEBP) ?
+           std::to_string(encode_opts.webp_quality).c_str() : "unavailable");
+    printf(" - Simplify: %g px\n", simplify_px_);
+    printf(" - MVT: extent %d, buffer %d, tolerance %g\n", mvt_opts_.extent,
+           mvt_opts_.buffer, mvt_opts_.tolerance);
+    printf(" - Watch Charts: %s\n", watch_charts ? "on" : "off");
+    if (memory_budget_mb > 0)
+    {
+        printf(" - Memory Budget: %lu MB\n", memory_budget_mb);
+    }
+    else
+    {
+        printf(" - Memory Budget: off\n");
+    }
+    printf(" - Low Memory: %s\n", low_memory ? "on" : "off");
+
+    // Caches count against one budget, whatever their own limits
+    budget_.set_limit(memory_budget_mb * 1024 * 1024);
+    enc_.set_memory_budget(budget_, BUDGET_CHARTS);
+    tiles_.set_budget(budget_, BUDGET_TILES);
+    contexts_.set_budget(budget_, BUDGET_SURFACES);
+    svg_.set_budget(budget_, BUDGET_ICONS);
 
     // Load charts
     enc_.set_cache_path(meta_path);
+    enc_.set_chart_cache_size(chart_cache_mb * 1024 * 1024);
+    enc_.set_load_threads(load_threads);
     enc_.load_charts(chart_path);
 
+    // Cached tiles are only good for this set of charts
+    tiles_.set_memory_limit(tile_cache_mb * 1024 * 1024);
+    tiles_.set_disk_path(*tile_path);
+    tiles_.set_generation(enc_.get_generation());
+
     // Set up svg load path
     //svg_.set_svg_path(svg_path);
+    svg_.set_sprite_cache(icon_sprites);
+    encoder_.set_options(encode_opts);
 
     // Load styles
     for (const fs::directory_entry &entry : fs::directory_iterator(style_path))
@@ -1618,6 +2342,39 @@ void enc_renderer::load_config(const fs::path &config_file)
             styles_[p.stem().string()] = load_style(p.string(), svg_path);
         }
     }
+
+    // Draw time histograms for every style layer
+    for (const auto &[name, style] : styles_)
+    {
+        std::vector<std::string> layers;
+        for (const layer_style &lstyle : style.layers)
+        {
+            layers.push_back(lstyle.layer_name);
+        }
+        metrics_.add_layers(layers);
+    }
+
+    // Charts are compiled on first use, so only the styled layers are kept
+    if (low_memory)
+    {
+        chart_store::layer_filter keep;
+        for (const auto &[name, style] : styles_)
+        {
+            for (const layer_style &lstyle : style.layers)
+            {
+                keep.insert(lstyle.layer_name);
+            }
+        }
+        enc_.set_chart_layers(keep);
+    }
+
+    // Pick up chart updates without a restart
+    if (watch_charts)
+    {
+        watcher_ = std::make_unique<chart_watcher>(chart_path, [this](const std::vector<fs::path> &files) {
+            update_charts(files);
+        });
+    }
 }
 
 }; // ~namespace encviz
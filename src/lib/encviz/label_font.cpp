@@ -0,0 +1,185 @@
+/**
+ * \file
+ * \brief Label Font
+ *
+ * Scaled font created once and shared by all render threads, with digits
+ * pre-shaped for sounding labels.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <encviz/label_font.h>
+
+namespace encviz
+{
+
+/**
+ * Constructor
+ *
+ * \param[in] family Font family (ie - "monospace")
+ * \param[in] weight Font weight
+ * \param[in] size Font size (pixels)
+ */
+label_font::label_font(const char *family, cairo_font_weight_t weight, double size)
+{
+    face_ = cairo_toy_font_face_create(family, CAIRO_FONT_SLANT_NORMAL, weight);
+
+    cairo_matrix_t font_matrix, ctm;
+    cairo_matrix_init_scale(&font_matrix, size, size);
+    cairo_matrix_init_identity(&ctm);
+
+    // Same options an image surface gives cairo_show_text
+    cairo_font_options_t *options = cairo_font_options_create();
+    cairo_font_options_set_hint_metrics(options, CAIRO_HINT_METRICS_ON);
+    font_ = cairo_scaled_font_create(face_, &font_matrix, &ctm, options);
+    cairo_font_options_destroy(options);
+
+    if (cairo_scaled_font_status(font_) != CAIRO_STATUS_SUCCESS)
+    {
+        cairo_scaled_font_destroy(font_);
+        cairo_font_face_destroy(face_);
+        throw std::runtime_error(std::string("Cannot create font: ") + family);
+    }
+
+    // Shape each character once
+    for (int i = 0; i < NSHAPED; i++)
+    {
+        char text[2] = { SHAPED[i], '\0' };
+        cairo_glyph_t *glyphs = nullptr;
+        int count = 0;
+        if (cairo_scaled_font_text_to_glyphs(font_, 0, 0, text, 1, &glyphs, &count,
+                                             nullptr, nullptr, nullptr) != CAIRO_STATUS_SUCCESS ||
+            count != 1)
+        {
+            cairo_glyph_free(glyphs);
+            cairo_scaled_font_destroy(font_);
+            cairo_font_face_destroy(face_);
+            throw std::runtime_error(std::string("Cannot shape digits in font: ") + family);
+        }
+        shaped_[i].index = glyphs[0].index;
+        cairo_scaled_font_glyph_extents(font_, glyphs, 1, &shaped_[i].extents);
+        cairo_glyph_free(glyphs);
+    }
+}
+
+/**
+ * Destructor
+ */
+label_font::~label_font()
+{
+    cairo_scaled_font_destroy(font_);
+    cairo_font_face_destroy(face_);
+}
+
+/**
+ * Lay Out Text
+ *
+ * Strings of digits and '-' come from the pre-shaped table, anything
+ * else is shaped by cairo.
+ *
+ * \param[in] text UTF-8 text
+ * \param[out] glyphs Glyphs positioned from a (0,0) origin
+ * \param[out] extents Ink extents, as from cairo_text_extents
+ */
+void label_font::layout(const char *text, std::vector<cairo_glyph_t> &glyphs,
+                        cairo_text_extents_t &extents) const
+{
+    glyphs.clear();
+    extents = {};
+
+    bool shaped = true;
+    for (const char *p = text; *p != '\0'; p++)
+    {
+        if (shaped_index(*p) < 0)
+        {
+            shaped = false;
+            break;
+        }
+    }
+
+    if (!shaped)
+    {
+        cairo_glyph_t *out = nullptr;
+        int count = 0;
+        if (cairo_scaled_font_text_to_glyphs(font_, 0, 0, text, -1, &out, &count,
+                                             nullptr, nullptr, nullptr) == CAIRO_STATUS_SUCCESS)
+        {
+            glyphs.assign(out, out + count);
+            cairo_scaled_font_glyph_extents(font_, out, count, &extents);
+        }
+        cairo_glyph_free(out);
+        return;
+    }
+
+    // Union of the pre-computed glyph boxes, placed by advance
+    double pen = 0;
+    double x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+    for (const char *p = text; *p != '\0'; p++)
+    {
+        const shaped_char &sc = shaped_[shaped_index(*p)];
+        glyphs.push_back({sc.index, pen, 0});
+
+        double gx0 = pen + sc.extents.x_bearing;
+        double gx1 = gx0 + sc.extents.width;
+        double gy0 = sc.extents.y_bearing;
+        double gy1 = gy0 + sc.extents.height;
+        if (glyphs.size() == 1)
+        {
+            x0 = gx0; x1 = gx1; y0 = gy0; y1 = gy1;
+        }
+        else
+        {
+            x0 = std::min(x0, gx0);
+            x1 = std::max(x1, gx1);
+            y0 = std::min(y0, gy0);
+            y1 = std::max(y1, gy1);
+        }
+        pen += sc.extents.x_advance;
+    }
+
+    extents.x_bearing = x0;
+    extents.y_bearing = y0;
+    extents.width = x1 - x0;
+    extents.height = y1 - y0;
+    extents.x_advance = pen;
+}
+
+/**
+ * Draw Laid Out Text
+ *
+ * \param[out] cr Image context (identity transform)
+ * \param[in] glyphs Glyphs from layout()
+ * \param[in] x Origin X (pixels)
+ * \param[in] y Origin Y, baseline (pixels)
+ */
+void label_font::show(cairo_t *cr, const std::vector<cairo_glyph_t> &glyphs,
+                      double x, double y) const
+{
+    thread_local std::vector<cairo_glyph_t> placed;
+    placed.resize(glyphs.size());
+    for (size_t i = 0; i < glyphs.size(); i++)
+    {
+        placed[i] = { glyphs[i].index, glyphs[i].x + x, glyphs[i].y + y };
+    }
+
+    cairo_set_scaled_font(cr, font_);
+    cairo_show_glyphs(cr, placed.data(), placed.size());
+}
+
+/**
+ * Look Up Shaped Character
+ *
+ * \param[in] ch Character
+ * \return Index in shaped_, -1 if not shaped
+ */
+int label_font::shaped_index(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+    {
+        return ch - '0';
+    }
+    return ch == '-' ? NSHAPED - 1 : -1;
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,67 @@
+/**
+ * \file
+ * \brief Logging
+ *
+ * Level filtered messages on stdout.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <encviz/log.h>
+
+namespace encviz
+{
+
+/// Most verbose level printed
+std::atomic<int> log_threshold{static_cast<int>(log_level::info)};
+
+/**
+ * Set Log Level
+ *
+ * \param[in] level Most verbose level printed
+ */
+void set_log_level(log_level level)
+{
+    log_threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+/**
+ * Parse Log Level
+ *
+ * \param[in] name Level name ("error", "warn", "info", "debug")
+ * \param[out] level Parsed level
+ * \return False if not a level name
+ */
+bool parse_log_level(const std::string &name, log_level &level)
+{
+    static const std::pair<const char*, log_level> names[] = {
+        {"error", log_level::error},
+        {"warn", log_level::warn},
+        {"info", log_level::info},
+        {"debug", log_level::debug},
+    };
+    for (const auto &[text, value] : names)
+    {
+        if (name == text)
+        {
+            level = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Print Log Message (printf style)
+ *
+ * \param[in] fmt Format string
+ */
+void log_printf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,315 @@
+/**
+ * \file
+ * \brief MBTiles Archive
+ *
+ * Tile archive in an SQLite database, following the MBTiles 1.3 layout.
+ */
+
+#include <cstdio>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sqlite3.h>
+#include <encviz/mbtiles.h>
+#include <encviz/tile_cache.h>
+
+namespace fs = std::filesystem;
+
+namespace encviz
+{
+
+/// Tiles per write transaction
+static const std::size_t COMMIT_INTERVAL = 512;
+
+/**
+ * Constructor
+ *
+ * \param[in] path Database to create
+ * \param[in] info Archive description
+ * \param[in] keep_existing Add to existing database instead of replacing it
+ */
+mbtiles_writer::mbtiles_writer(const fs::path &path, const archive_info &info,
+                               bool keep_existing)
+{
+    std::error_code ec;
+    if (!keep_existing)
+    {
+        fs::remove(path, ec);
+    }
+
+    if (sqlite3_open(path.string().c_str(), &db_) != SQLITE_OK)
+    {
+        std::string msg = "Cannot create MBTiles " + path.string() + ": " + sqlite3_errmsg(db_);
+        sqlite3_close(db_);
+        throw std::runtime_error(msg);
+    }
+
+    // Bulk load, the archive is only useful once finished anyway
+    exec("PRAGMA synchronous = OFF");
+    exec("PRAGMA journal_mode = MEMORY");
+    exec("CREATE TABLE IF NOT EXISTS metadata (name TEXT, value TEXT)");
+    exec("CREATE UNIQUE INDEX IF NOT EXISTS metadata_index ON metadata (name)");
+    exec("CREATE TABLE IF NOT EXISTS tiles (zoom_level INTEGER, tile_column INTEGER, "
+         "tile_row INTEGER, tile_data BLOB)");
+    exec("CREATE UNIQUE INDEX IF NOT EXISTS tile_index ON tiles "
+         "(zoom_level, tile_column, tile_row)");
+
+    // Describe archive
+    char bounds[128];
+    snprintf(bounds, sizeof(bounds), "%.6f,%.6f,%.6f,%.6f", info.bounds.MinX,
+             info.bounds.MinY, info.bounds.MaxX, info.bounds.MaxY);
+    const std::pair<std::string, std::string> metadata[] = {
+        {"name", info.name},
+        {"format", (info.format == tile_format::MVT) ? "pbf" : tile_format_extension(info.format)},
+        {"type", (info.format == tile_format::MVT) ? "overlay" : "baselayer"},
+        {"version", "1.3"},
+        {"bounds", bounds},
+        {"minzoom", std::to_string(info.min_zoom)},
+        {"maxzoom", std::to_string(info.max_zoom)},
+    };
+    sqlite3_stmt *stmt = nullptr;
+    sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO metadata (name, value) VALUES (?, ?)",
+                       -1, &stmt, nullptr);
+    for (const auto &it : metadata)
+    {
+        sqlite3_bind_text(stmt, 1, it.first.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, it.second.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO tiles "
+                           "(zoom_level, tile_column, tile_row, tile_data) VALUES (?, ?, ?, ?)",
+                           -1, &insert_, nullptr) != SQLITE_OK)
+    {
+        std::string msg = std::string("Cannot prepare MBTiles insert: ") + sqlite3_errmsg(db_);
+        sqlite3_close(db_);
+        throw std::runtime_error(msg);
+    }
+    exec("BEGIN");
+}
+
+/**
+ * Destructor (finishes archive)
+ */
+mbtiles_writer::~mbtiles_writer()
+{
+    try
+    {
+        finish();
+    }
+    catch (const std::exception &e)
+    {
+        printf("MBTiles error: %s\n", e.what());
+    }
+}
+
+/**
+ * Add Tile
+ *
+ * \param[in] z Zoom
+ * \param[in] x Horizontal tile coordinate
+ * \param[in] y Vertical tile coordinate
+ * \param[in] data Encoded image bytes
+ */
+void mbtiles_writer::put(int z, int x, int y, const std::vector<uint8_t> &data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (db_ == nullptr)
+    {
+        throw std::runtime_error("MBTiles archive already finished");
+    }
+
+    // MBTiles rows count from the south, same as XYZ
+    sqlite3_bind_int(insert_, 1, z);
+    sqlite3_bind_int(insert_, 2, x);
+    sqlite3_bind_int(insert_, 3, y);
+    sqlite3_bind_blob(insert_, 4, data.data(), data.size(), SQLITE_STATIC);
+    int rc = sqlite3_step(insert_);
+    sqlite3_reset(insert_);
+    if (rc != SQLITE_DONE)
+    {
+        throw std::runtime_error(std::string("MBTiles insert error: ") + sqlite3_errmsg(db_));
+    }
+
+    // Commit now and then, so an interrupted run keeps most of its tiles
+    if (++pending_ >= COMMIT_INTERVAL)
+    {
+        exec("COMMIT");
+        exec("BEGIN");
+        pending_ = 0;
+    }
+}
+
+/**
+ * Keep Tiles Added So Far
+ */
+void mbtiles_writer::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (db_ == nullptr || pending_ == 0)
+    {
+        return;
+    }
+    exec("COMMIT");
+    exec("BEGIN");
+    pending_ = 0;
+}
+
+/**
+ * Complete Archive
+ */
+void mbtiles_writer::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (db_ == nullptr)
+    {
+        return;
+    }
+    exec("COMMIT");
+    sqlite3_finalize(insert_);
+    sqlite3_close(db_);
+    insert_ = nullptr;
+    db_ = nullptr;
+}
+
+/**
+ * Check Resume Support
+ *
+ * \return True, tiles are committed as they go
+ */
+bool mbtiles_writer::can_resume() const
+{
+    return true;
+}
+
+/**
+ * Run SQL Statement
+ *
+ * \param[in] sql Statement text
+ */
+void mbtiles_writer::exec(const char *sql)
+{
+    char *err = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &err) != SQLITE_OK)
+    {
+        std::string msg = std::string("MBTiles error (") + sql + "): " + (err ? err : "");
+        sqlite3_free(err);
+        throw std::runtime_error(msg);
+    }
+}
+
+/**
+ * Constructor
+ *
+ * \param[in] path Database to open
+ */
+mbtiles_reader::mbtiles_reader(const fs::path &path)
+{
+    if (sqlite3_open_v2(path.string().c_str(), &db_,
+                        SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+    {
+        std::string msg = "Cannot open MBTiles " + path.string() + ": " + sqlite3_errmsg(db_);
+        sqlite3_close(db_);
+        throw std::runtime_error(msg);
+    }
+
+    // Image format from metadata
+    sqlite3_stmt *stmt = nullptr;
+    if (sqlite3_prepare_v2(db_, "SELECT value FROM metadata WHERE name = 'format'",
+                           -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const char *value = (const char*)sqlite3_column_text(stmt, 0);
+        if (value == nullptr || !parse_tile_format(value, format_))
+        {
+            sqlite3_finalize(stmt);
+            sqlite3_close(db_);
+            throw std::runtime_error("Unsupported MBTiles format in " + path.string());
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    if (sqlite3_prepare_v2(db_, "SELECT tile_data FROM tiles WHERE zoom_level = ? AND "
+                           "tile_column = ? AND tile_row = ?", -1, &select_, nullptr) != SQLITE_OK)
+    {
+        std::string msg = "Not an MBTiles archive: " + path.string();
+        sqlite3_close(db_);
+        throw std::runtime_error(msg);
+    }
+
+    struct stat info;
+    if (stat(path.string().c_str(), &info) == 0)
+    {
+        modified_ = info.st_mtime;
+    }
+}
+
+/**
+ * Destructor
+ */
+mbtiles_reader::~mbtiles_reader()
+{
+    sqlite3_finalize(select_);
+    sqlite3_close(db_);
+}
+
+/**
+ * Look Up Tile
+ *
+ * \param[in] z Zoom
+ * \param[in] x Horizontal tile coordinate
+ * \param[in] y Vertical tile coordinate
+ * \param[out] tile Tile data
+ * \return False if the archive doesn't have this tile
+ */
+bool mbtiles_reader::get(int z, int x, int y, archive_tile &tile) const
+{
+    std::shared_ptr<std::vector<uint8_t>> copy;
+    {
+        // Blob is only valid until the statement is reset, so copy it out
+        std::lock_guard<std::mutex> lock(mutex_);
+        sqlite3_bind_int(select_, 1, z);
+        sqlite3_bind_int(select_, 2, x);
+        sqlite3_bind_int(select_, 3, y);
+        if (sqlite3_step(select_) == SQLITE_ROW)
+        {
+            const uint8_t *blob = (const uint8_t*)sqlite3_column_blob(select_, 0);
+            int size = sqlite3_column_bytes(select_, 0);
+            copy = std::make_shared<std::vector<uint8_t>>(blob, blob + size);
+        }
+        sqlite3_reset(select_);
+    }
+    if (copy == nullptr)
+    {
+        return false;
+    }
+
+    tile.data = copy->data();
+    tile.size = copy->size();
+    tile.etag = make_etag(*copy);
+    tile.copy = std::move(copy);
+    return true;
+}
+
+/**
+ * Get Tile Format
+ *
+ * \return Image format of every tile
+ */
+tile_format mbtiles_reader::get_format() const
+{
+    return format_;
+}
+
+/**
+ * Get Modification Time
+ *
+ * \return Time archive was last written
+ */
+time_t mbtiles_reader::get_modified() const
+{
+    return modified_;
+}
+
+}; // ~namespace encviz
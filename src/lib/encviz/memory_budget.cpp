@@ -0,0 +1,203 @@
+/**
+ * \file
+ * \brief Memory Budget
+ *
+ * One memory limit shared by the caches, split between them by weight.
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <encviz/memory_budget.h>
+
+namespace encviz
+{
+
+/**
+ * Set Limit
+ *
+ * \param[in] max_bytes Total size of all caches (0 disables)
+ */
+void memory_budget::set_limit(std::size_t max_bytes)
+{
+    limit_.store(max_bytes, std::memory_order_relaxed);
+    enforce();
+}
+
+/**
+ * Get Limit
+ *
+ * \return Total size of all caches (0 = no limit)
+ */
+std::size_t memory_budget::get_limit() const
+{
+    return limit_.load(std::memory_order_relaxed);
+}
+
+/**
+ * Register Cache
+ *
+ * \param[in] name Cache name (for metrics)
+ * \param[in] weight Relative share of limit
+ * \param[in] trim Sheds entries while the cache is over its share
+ * \return Cache id
+ */
+int memory_budget::add(const std::string &name, double weight, trim_fn trim)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = count_.load(std::memory_order_relaxed);
+    if (id >= MAX_CACHES)
+    {
+        throw std::runtime_error("Too many caches in memory budget");
+    }
+
+    caches_[id].name = name;
+    caches_[id].weight = std::max(0.0, weight);
+    caches_[id].trim = std::move(trim);
+    weights_.store(weights_.load(std::memory_order_relaxed) + caches_[id].weight,
+                   std::memory_order_relaxed);
+
+    // Publish the entry only once it is filled in
+    count_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+/**
+ * Report Cache Size
+ *
+ * \param[in] id Cache id
+ * \param[in] bytes Current size (bytes)
+ */
+void memory_budget::update(int id, std::size_t bytes)
+{
+    // Unsigned wraparound makes this a signed adjustment
+    std::size_t old = caches_[id].bytes.exchange(bytes, std::memory_order_relaxed);
+    total_.fetch_add(bytes - old, std::memory_order_relaxed);
+}
+
+/**
+ * Check Cache Should Shed
+ *
+ * \param[in] id Cache id
+ * \return True if the total is over the limit and the cache over its share
+ */
+bool memory_budget::over(int id) const
+{
+    std::size_t limit = limit_.load(std::memory_order_relaxed);
+    return limit > 0 && total_.load(std::memory_order_relaxed) > limit &&
+        caches_[id].bytes.load(std::memory_order_relaxed) > share(id);
+}
+
+/**
+ * Trim Caches Over Their Share
+ */
+void memory_budget::enforce()
+{
+    std::size_t limit = limit_.load(std::memory_order_relaxed);
+    if (limit == 0 || total_.load(std::memory_order_relaxed) <= limit)
+    {
+        return;
+    }
+
+    // One trimmer at a time is enough, the others carry on
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        return;
+    }
+
+    int count = count_.load(std::memory_order_acquire);
+    for (int id = 0; id < count; id++)
+    {
+        if (over(id) && caches_[id].trim)
+        {
+            caches_[id].trims.fetch_add(1, std::memory_order_relaxed);
+            caches_[id].trim();
+        }
+    }
+}
+
+/**
+ * Get Cache Footprints
+ *
+ * \return Registered caches
+ */
+std::vector<memory_budget::usage> memory_budget::get_usage() const
+{
+    std::vector<usage> out;
+    int count = count_.load(std::memory_order_acquire);
+    for (int id = 0; id < count; id++)
+    {
+        const cache &c = caches_[id];
+        out.push_back({c.name, c.bytes.load(std::memory_order_relaxed), share(id),
+                       c.trims.load(std::memory_order_relaxed)});
+    }
+    return out;
+}
+
+/**
+ * Share of Limit
+ *
+ * \param[in] id Cache id
+ * \return Bytes the cache may keep while over the limit
+ */
+std::size_t memory_budget::share(int id) const
+{
+    double weights = weights_.load(std::memory_order_relaxed);
+    if (weights <= 0)
+    {
+        return 0;
+    }
+    return static_cast<std::size_t>(limit_.load(std::memory_order_relaxed) *
+                                    (caches_[id].weight / weights));
+}
+
+/**
+ * Register With Budget
+ *
+ * \param[in] budget Budget to count against (must outlive the client)
+ * \param[in] name Cache name (for metrics)
+ * \param[in] weight Relative share of limit
+ * \param[in] trim Sheds entries while the cache is over its share
+ */
+void memory_budget::client::attach(memory_budget &budget, const std::string &name,
+                                   double weight, trim_fn trim)
+{
+    id_ = budget.add(name, weight, std::move(trim));
+    budget_ = &budget;
+}
+
+/**
+ * Report Cache Size
+ *
+ * \param[in] bytes Current size (bytes)
+ */
+void memory_budget::client::report(std::size_t bytes)
+{
+    if (budget_ != nullptr)
+    {
+        budget_->update(id_, bytes);
+    }
+}
+
+/**
+ * Check Cache Should Shed
+ *
+ * \return True if the total is over the limit and the cache over its share
+ */
+bool memory_budget::client::over() const
+{
+    return budget_ != nullptr && budget_->over(id_);
+}
+
+/**
+ * Let Caches Over Their Share Shed
+ */
+void memory_budget::client::enforce()
+{
+    if (budget_ != nullptr)
+    {
+        budget_->enforce();
+    }
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,192 @@
+/**
+ * \file
+ * \brief Render Metrics
+ *
+ * Latency histograms of the render stages, exported in the Prometheus text
+ * format.
+ */
+
+#include <cstdio>
+#include <encviz/metrics.h>
+
+namespace encviz
+{
+
+/// Bucket upper bounds (usec), 100 usec to 10 sec
+const std::array<int64_t, histogram::NBUCKETS> histogram::BOUNDS_US = {
+    100, 250, 500,
+    1000, 2500, 5000,
+    10000, 25000, 50000,
+    100000, 250000, 500000,
+    1000000, 2500000, 5000000,
+    10000000
+};
+
+/// Source of thread shard indices
+static std::atomic<unsigned> next_thread{0};
+
+/// Shard index of calling thread
+static thread_local unsigned thread_index = next_thread.fetch_add(1, std::memory_order_relaxed);
+
+/**
+ * Record Observation
+ *
+ * \param[in] usec Duration (usec)
+ */
+void histogram::observe(int64_t usec)
+{
+    int bucket = 0;
+    while (bucket < NBUCKETS && usec > BOUNDS_US[bucket])
+    {
+        bucket++;
+    }
+
+    shard &s = shards_[thread_index % NSHARDS];
+    s.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.sum_us.fetch_add(usec, std::memory_order_relaxed);
+}
+
+/**
+ * Sum Shards
+ *
+ * \return Counts so far (shards read one at a time, not atomically)
+ */
+histogram::snapshot histogram::read() const
+{
+    snapshot total;
+    for (const shard &s : shards_)
+    {
+        for (int i = 0; i <= NBUCKETS; i++)
+        {
+            total.buckets[i] += s.buckets[i].load(std::memory_order_relaxed);
+        }
+        total.count += s.count.load(std::memory_order_relaxed);
+        total.sum_us += s.sum_us.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * Add Layer Histograms
+ *
+ * \param[in] layers Style layer names (duplicates ignored)
+ *
+ * \note Not thread safe, call before rendering starts.
+ */
+void render_metrics::add_layers(const std::vector<std::string> &layers)
+{
+    for (const std::string &layer : layers)
+    {
+        if (layers_.find(layer) == layers_.end())
+        {
+            layers_[layer] = std::make_unique<histogram>();
+        }
+    }
+}
+
+/**
+ * Record Render
+ *
+ * \param[in] profile Stage timings of the render
+ * \param[in] total_us Duration of the whole render (usec)
+ */
+void render_metrics::record(const render_profile &profile, int64_t total_us)
+{
+    int64_t clip_us = 0;
+    for (const auto &[layer, us] : profile.export_us)
+    {
+        clip_us += us;
+    }
+
+    stages_[STAGE_RENDER].observe(total_us);
+    stages_[STAGE_SELECT].observe(profile.select_us);
+    stages_[STAGE_OPEN].observe(profile.open_us);
+    stages_[STAGE_CLIP].observe(clip_us);
+    stages_[STAGE_ERASE].observe(profile.erase_us);
+    stages_[STAGE_ENCODE].observe(profile.encode_us);
+    if (!profile.draw_us.empty())
+    {
+        // Vector tiles draw nothing
+        stages_[STAGE_ICONS].observe(profile.icon_us);
+    }
+
+    for (const auto &[layer, us] : profile.draw_us)
+    {
+        auto it = layers_.find(layer);
+        if (it != layers_.end())
+        {
+            it->second->observe(us);
+        }
+    }
+}
+
+/**
+ * Write Prometheus Text
+ *
+ * \param[out] out Text exposition is appended
+ */
+void render_metrics::write(std::string &out) const
+{
+    static const char *names[STAGE_COUNT] = {
+        "render", "select", "open", "clip", "erase", "icons", "encode"
+    };
+
+    out += "# HELP encviz_stage_seconds Time per tile render spent in each stage.\n";
+    out += "# TYPE encviz_stage_seconds histogram\n";
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+        write_histogram(out, "encviz_stage_seconds",
+                        std::string("stage=\"") + names[i] + "\"", stages_[i].read());
+    }
+
+    out += "# HELP encviz_layer_draw_seconds Time per tile render spent drawing each style layer.\n";
+    out += "# TYPE encviz_layer_draw_seconds histogram\n";
+    for (const auto &[layer, hist] : layers_)
+    {
+        write_histogram(out, "encviz_layer_draw_seconds", "layer=\"" + layer + "\"",
+                        hist->read());
+    }
+}
+
+/**
+ * Write Prometheus Histogram
+ *
+ * \param[out] out Text exposition is appended
+ * \param[in] name Metric name
+ * \param[in] labels Label set without braces (ie - stage="select"), may be empty
+ * \param[in] counts Histogram counts
+ */
+void write_histogram(std::string &out, const std::string &name,
+                     const std::string &labels, const histogram::snapshot &counts)
+{
+    std::string sep = labels.empty() ? "" : ",";
+    char line[256];
+    uint64_t cumulative = 0;
+    for (int i = 0; i <= histogram::NBUCKETS; i++)
+    {
+        cumulative += counts.buckets[i];
+        if (i < histogram::NBUCKETS)
+        {
+            snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%g\"} %lu\n", name.c_str(),
+                     labels.c_str(), sep.c_str(), histogram::BOUNDS_US[i] / 1e6,
+                     (unsigned long)cumulative);
+        }
+        else
+        {
+            snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name.c_str(),
+                     labels.c_str(), sep.c_str(), (unsigned long)cumulative);
+        }
+        out += line;
+    }
+
+    std::string braces = labels.empty() ? "" : "{" + labels + "}";
+    snprintf(line, sizeof(line), "%s_sum%s %.6f\n", name.c_str(), braces.c_str(),
+             counts.sum_us / 1e6);
+    out += line;
+    snprintf(line, sizeof(line), "%s_count%s %lu\n", name.c_str(), braces.c_str(),
+             (unsigned long)counts.count);
+    out += line;
+}
+
+}; // ~namespace encviz
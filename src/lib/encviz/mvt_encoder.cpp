@@ -0,0 +1,536 @@
+/**
+ * \file
+ * \brief Vector Tile Encoder
+ *
+ * Builds Mapbox Vector Tiles (MVT 2.1) from exported tile features, so
+ * clients can style chart data themselves instead of fetching one raster
+ * per style.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <encviz/mvt_encoder.h>
+#include <encviz/simplify.h>
+
+namespace encviz
+{
+
+/// MVT geometry types
+enum { MVT_POINT = 1, MVT_LINESTRING = 2, MVT_POLYGON = 3 };
+
+/// MVT geometry commands
+enum { CMD_MOVE_TO = 1, CMD_LINE_TO = 2, CMD_CLOSE_PATH = 7 };
+
+/// Protobuf wire types
+enum { WIRE_VARINT = 0, WIRE_FIXED64 = 1, WIRE_BYTES = 2 };
+
+/**
+ * Append Varint
+ */
+static void put_varint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+/**
+ * Append Field Key
+ */
+static void put_key(std::vector<uint8_t> &out, int field, int wire_type)
+{
+    put_varint(out, (uint64_t(field) << 3) | wire_type);
+}
+
+/**
+ * Append Length Delimited Field
+ */
+static void put_bytes(std::vector<uint8_t> &out, int field, const void *data, std::size_t size)
+{
+    put_key(out, field, WIRE_BYTES);
+    put_varint(out, size);
+    out.insert(out.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+}
+
+/**
+ * Append Packed Varint Field
+ */
+static void put_packed(std::vector<uint8_t> &out, int field, const std::vector<uint32_t> &values)
+{
+    std::vector<uint8_t> packed;
+    for (uint32_t v : values)
+    {
+        put_varint(packed, v);
+    }
+    put_bytes(out, field, packed.data(), packed.size());
+}
+
+/**
+ * Zigzag Encode Signed Value
+ */
+static uint64_t zigzag(int64_t value)
+{
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+/**
+ * Constructor
+ *
+ * \param[in] x Tile X coordinate (horizontal)
+ * \param[in] y Tile Y coordinate (vertical)
+ * \param[in] z Tile Z coordinate (zoom)
+ * \param[in] tc Tile coordinate system (WMTS or XYZ)
+ * \param[in] opts Encoder settings
+ */
+mvt_encoder::mvt_encoder(int x, int y, int z, tile_coords tc, const options &opts)
+    : opts_(opts), wm_(x, y, z, tc, opts.extent),
+      clip_(nullptr, &OGRGeometryFactory::destroyGeometry)
+{
+    // Grow tile by the buffer on each side
+    bbox_ = wm_.get_bbox_deg();
+    double margin = double(opts_.buffer) / opts_.extent;
+    double width = bbox_.MaxX - bbox_.MinX;
+    double height = bbox_.MaxY - bbox_.MinY;
+    bbox_.MinX -= margin * width;
+    bbox_.MaxX += margin * width;
+    bbox_.MinY -= margin * height;
+    bbox_.MaxY += margin * height;
+
+    OGRLinearRing ring;
+    ring.addPoint(bbox_.MinX, bbox_.MinY);
+    ring.addPoint(bbox_.MaxX, bbox_.MinY);
+    ring.addPoint(bbox_.MaxX, bbox_.MaxY);
+    ring.addPoint(bbox_.MinX, bbox_.MaxY);
+    ring.addPoint(bbox_.MinX, bbox_.MinY);
+    OGRPolygon *poly = new OGRPolygon();
+    poly->addRing(&ring);
+    clip_.reset(poly);
+}
+
+/**
+ * Get Feature Bounding Box
+ *
+ * \return Tile bounds plus buffer (deg), the area to export
+ */
+OGREnvelope mvt_encoder::get_bbox_deg() const
+{
+    return bbox_;
+}
+
+/**
+ * Add Feature
+ *
+ * \param[in] layer_name Output layer (S57 object class)
+ * \param[in] geo Feature geometry (deg)
+ * \param[in] attrs Feature attributes
+ */
+void mvt_encoder::add_feature(const std::string &layer_name, const OGRGeometry *geo,
+                              const OGRFeature *attrs)
+{
+    if (geo == nullptr || geo->IsEmpty())
+    {
+        return;
+    }
+
+    // Only clip what sticks out of the tile (whole layers aren't clipped on export)
+    OGREnvelope env;
+    geo->getEnvelope(&env);
+    if (!bbox_.Intersects(env))
+    {
+        return;
+    }
+    std::unique_ptr<OGRGeometry, decltype(&OGRGeometryFactory::destroyGeometry)>
+        clipped(nullptr, &OGRGeometryFactory::destroyGeometry);
+    if (!bbox_.Contains(env))
+    {
+        clipped.reset(geo->Intersection(clip_.get()));
+        if (clipped == nullptr || clipped->IsEmpty())
+        {
+            return;
+        }
+        geo = clipped.get();
+    }
+
+    // A feature has one geometry type, split up mixed collections
+    if (wkbFlatten(geo->getGeometryType()) == wkbGeometryCollection)
+    {
+        for (const OGRGeometry *child : geo->toGeometryCollection())
+        {
+            add_feature(layer_name, child, attrs);
+        }
+        return;
+    }
+
+    int type = 0;
+    std::vector<uint32_t> cmds;
+    if (!encode_geometry(geo, type, cmds))
+    {
+        return;
+    }
+
+    layer &lyr = get_layer(layer_name);
+    std::vector<uint32_t> tags;
+    encode_tags(lyr, attrs, tags);
+
+    std::vector<uint8_t> feature;
+    if (attrs != nullptr && attrs->GetFID() >= 0)
+    {
+        put_key(feature, 1, WIRE_VARINT);
+        put_varint(feature, attrs->GetFID());
+    }
+    if (!tags.empty())
+    {
+        put_packed(feature, 2, tags);
+    }
+    put_key(feature, 3, WIRE_VARINT);
+    put_varint(feature, type);
+    put_packed(feature, 4, cmds);
+
+    put_bytes(lyr.features, 2, feature.data(), feature.size());
+    lyr.count++;
+}
+
+/**
+ * Encode Tile
+ *
+ * \param[out] data Encoded tile (protobuf)
+ * \return False if no feature was added
+ */
+bool mvt_encoder::finish(std::vector<uint8_t> &data)
+{
+    data.clear();
+    for (const layer &lyr : layers_)
+    {
+        if (lyr.count == 0)
+        {
+            continue;
+        }
+
+        std::vector<uint8_t> msg;
+        put_key(msg, 15, WIRE_VARINT);
+        put_varint(msg, 2);
+        put_bytes(msg, 1, lyr.name.data(), lyr.name.size());
+        msg.insert(msg.end(), lyr.features.begin(), lyr.features.end());
+        for (const std::string &key : lyr.keys)
+        {
+            put_bytes(msg, 3, key.data(), key.size());
+        }
+        for (const std::string &value : lyr.values)
+        {
+            put_bytes(msg, 4, value.data(), value.size());
+        }
+        put_key(msg, 5, WIRE_VARINT);
+        put_varint(msg, opts_.extent);
+
+        put_bytes(data, 3, msg.data(), msg.size());
+    }
+    return !data.empty();
+}
+
+/**
+ * Get Layer, Adding it if Needed
+ *
+ * \param[in] name Layer name
+ * \return Layer
+ */
+mvt_encoder::layer &mvt_encoder::get_layer(const std::string &name)
+{
+    auto it = layer_index_.find(name);
+    if (it == layer_index_.end())
+    {
+        it = layer_index_.emplace(name, layers_.size()).first;
+        layers_.emplace_back();
+        layers_.back().name = name;
+    }
+    return layers_[it->second];
+}
+
+/**
+ * Encode Feature Attributes
+ *
+ * \param[in,out] lyr Layer holding keys and values
+ * \param[in] attrs Feature attributes
+ * \param[out] tags Key / value index pairs
+ */
+void mvt_encoder::encode_tags(layer &lyr, const OGRFeature *attrs, std::vector<uint32_t> &tags)
+{
+    if (attrs == nullptr)
+    {
+        return;
+    }
+
+    for (int i = 0; i < attrs->GetFieldCount(); i++)
+    {
+        if (!attrs->IsFieldSetAndNotNull(i))
+        {
+            continue;
+        }
+
+        // Encoded Value message, doubling as its dedup key
+        std::vector<uint8_t> value;
+        const OGRFieldDefn *defn = attrs->GetFieldDefnRef(i);
+        switch (defn->GetType())
+        {
+            case OFTInteger:
+            case OFTInteger64:
+                put_key(value, 6, WIRE_VARINT);
+                put_varint(value, zigzag(attrs->GetFieldAsInteger64(i)));
+                break;
+
+            case OFTReal:
+            {
+                double d = attrs->GetFieldAsDouble(i);
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(bits));
+                put_key(value, 3, WIRE_FIXED64);
+                for (int b = 0; b < 8; b++)
+                {
+                    value.push_back(uint8_t(bits >> (8 * b)));
+                }
+                break;
+            }
+
+            case OFTStringList:
+            {
+                // Comma separated, like S-57 list attributes
+                std::string joined;
+                for (char **s = attrs->GetFieldAsStringList(i); s && *s; s++)
+                {
+                    joined += (joined.empty() ? "" : ",") + std::string(*s);
+                }
+                put_bytes(value, 1, joined.data(), joined.size());
+                break;
+            }
+
+            case OFTIntegerList:
+            {
+                int count = 0;
+                const int *list = attrs->GetFieldAsIntegerList(i, &count);
+                std::string joined;
+                for (int j = 0; j < count; j++)
+                {
+                    joined += (j ? "," : "") + std::to_string(list[j]);
+                }
+                put_bytes(value, 1, joined.data(), joined.size());
+                break;
+            }
+
+            default:
+            {
+                const char *s = attrs->GetFieldAsString(i);
+                put_bytes(value, 1, s, strlen(s));
+                break;
+            }
+        }
+
+        std::string key = defn->GetNameRef();
+        auto kit = lyr.key_index.find(key);
+        if (kit == lyr.key_index.end())
+        {
+            kit = lyr.key_index.emplace(key, lyr.keys.size()).first;
+            lyr.keys.push_back(key);
+        }
+        std::string encoded(value.begin(), value.end());
+        auto vit = lyr.value_index.find(encoded);
+        if (vit == lyr.value_index.end())
+        {
+            vit = lyr.value_index.emplace(encoded, lyr.values.size()).first;
+            lyr.values.push_back(encoded);
+        }
+        tags.push_back(kit->second);
+        tags.push_back(vit->second);
+    }
+}
+
+/**
+ * Encode Feature Geometry
+ *
+ * \param[in] geo Clipped geometry (deg)
+ * \param[out] type MVT geometry type
+ * \param[out] cmds Geometry command stream
+ * \return False if nothing is left after quantizing
+ */
+bool mvt_encoder::encode_geometry(const OGRGeometry *geo, int &type,
+                                  std::vector<uint32_t> &cmds)
+{
+    cursor_ = {0, 0};
+    std::vector<point> pts;
+    switch (wkbFlatten(geo->getGeometryType()))
+    {
+        case wkbPoint:
+        case wkbMultiPoint:
+        {
+            type = MVT_POINT;
+            auto add = [&](const OGRPoint *p) {
+                coord c = wm_.point_to_pixels(*p);
+                pts.push_back({std::llround(c.x), std::llround(c.y)});
+            };
+            if (wkbFlatten(geo->getGeometryType()) == wkbPoint)
+            {
+                add(geo->toPoint());
+            }
+            else
+            {
+                for (const OGRPoint *p : geo->toMultiPoint())
+                {
+                    add(p);
+                }
+            }
+            if (pts.empty())
+            {
+                return false;
+            }
+            add_points(CMD_MOVE_TO, pts, 0, pts.size(), cmds);
+            return true;
+        }
+
+        case wkbLineString:
+        case wkbMultiLineString:
+        {
+            type = MVT_LINESTRING;
+            auto add = [&](const OGRLineString *line) {
+                if (quantize(line, false, pts))
+                {
+                    add_points(CMD_MOVE_TO, pts, 0, 1, cmds);
+                    add_points(CMD_LINE_TO, pts, 1, pts.size() - 1, cmds);
+                }
+            };
+            if (wkbFlatten(geo->getGeometryType()) == wkbLineString)
+            {
+                add(geo->toLineString());
+            }
+            else
+            {
+                for (const OGRLineString *line : geo->toMultiLineString())
+                {
+                    add(line);
+                }
+            }
+            return !cmds.empty();
+        }
+
+        case wkbPolygon:
+        case wkbMultiPolygon:
+        {
+            type = MVT_POLYGON;
+            auto add = [&](const OGRPolygon *poly) {
+                bool exterior = true;
+                for (const OGRLinearRing *ring : poly)
+                {
+                    if (!quantize(ring, true, pts))
+                    {
+                        // Holes go with a collapsed exterior
+                        if (exterior)
+                        {
+                            return;
+                        }
+                        continue;
+                    }
+
+                    // Exterior rings have positive area in tile units (y down)
+                    double area = 0;
+                    for (std::size_t i = 0; i < pts.size(); i++)
+                    {
+                        const point &a = pts[i];
+                        const point &b = pts[(i + 1) % pts.size()];
+                        area += double(a.x) * b.y - double(b.x) * a.y;
+                    }
+                    if (area == 0)
+                    {
+                        if (exterior)
+                        {
+                            return;
+                        }
+                        continue;
+                    }
+                    if ((area > 0) != exterior)
+                    {
+                        std::reverse(pts.begin(), pts.end());
+                    }
+
+                    add_points(CMD_MOVE_TO, pts, 0, 1, cmds);
+                    add_points(CMD_LINE_TO, pts, 1, pts.size() - 1, cmds);
+                    cmds.push_back(CMD_CLOSE_PATH | (1 << 3));
+                    exterior = false;
+                }
+            };
+            if (wkbFlatten(geo->getGeometryType()) == wkbPolygon)
+            {
+                add(geo->toPolygon());
+            }
+            else
+            {
+                for (const OGRPolygon *poly : geo->toMultiPolygon())
+                {
+                    add(poly);
+                }
+            }
+            return !cmds.empty();
+        }
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * Quantize Line or Ring
+ *
+ * \param[in] curve Line (deg)
+ * \param[in] ring Drop closing point, and require 3 points instead of 2
+ * \param[out] out Simplified tile coordinates
+ * \return False if the line collapsed
+ */
+bool mvt_encoder::quantize(const OGRSimpleCurve *curve, bool ring, std::vector<point> &out) const
+{
+    // Project to tile units, then simplify before rounding
+    std::vector<coord> pts;
+    project_line(curve, wm_, opts_.tolerance, pts);
+
+    // Repeated points are invisible at this zoom
+    out.clear();
+    for (const coord &c : pts)
+    {
+        point p = {std::llround(c.x), std::llround(c.y)};
+        if (out.empty() || !(out.back() == p))
+        {
+            out.push_back(p);
+        }
+    }
+    if (ring)
+    {
+        while (out.size() > 1 && out.back() == out.front())
+        {
+            out.pop_back();
+        }
+        return out.size() >= 3;
+    }
+    return out.size() >= 2;
+}
+
+/**
+ * Add Points to Command Stream
+ *
+ * \param[in] cmd Command (MoveTo, LineTo)
+ * \param[in] pts Tile coordinates
+ * \param[in] first First point to add
+ * \param[in] count Points to add
+ * \param[out] cmds Geometry command stream
+ */
+void mvt_encoder::add_points(uint32_t cmd, const std::vector<point> &pts, std::size_t first,
+                             std::size_t count, std::vector<uint32_t> &cmds)
+{
+    cmds.push_back(cmd | uint32_t(count << 3));
+    for (std::size_t i = first; i < first + count; i++)
+    {
+        cmds.push_back(zigzag(pts[i].x - cursor_.x));
+        cmds.push_back(zigzag(pts[i].y - cursor_.y));
+        cursor_ = pts[i];
+    }
+}
+
+}; // ~namespace encviz
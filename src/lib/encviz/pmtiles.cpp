@@ -0,0 +1,727 @@
+/**
+ * \file
+ * \brief PMTiles Archive
+ *
+ * Single file tile archive (PMTiles v3), served straight out of a read-only
+ * memory mapping.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <encviz/pmtiles.h>
+#include <encviz/web_mercator.h>
+
+namespace fs = std::filesystem;
+
+namespace encviz
+{
+
+/// Fixed header size
+static const std::size_t HEADER_SIZE = 127;
+
+/// Header and root directory must fit in the first 16 KiB
+static const std::size_t ROOT_SIZE = 16384 - HEADER_SIZE;
+
+/// PMTiles compression codes
+enum { PMT_COMPRESSION_UNKNOWN = 0, PMT_COMPRESSION_NONE = 1, PMT_COMPRESSION_GZIP = 2 };
+
+/// PMTiles tile type codes
+enum { PMT_TYPE_MVT = 1, PMT_TYPE_PNG = 2, PMT_TYPE_WEBP = 4 };
+
+/// Deepest leaf directory nesting accepted
+static const int MAX_DEPTH = 4;
+
+/**
+ * PMTiles Tile Id
+ *
+ * \param[in] z Zoom
+ * \param[in] x Horizontal tile coordinate
+ * \param[in] y Vertical tile coordinate (XYZ, 0 at south)
+ * \return Tile id
+ */
+uint64_t pmtiles_tile_id(int z, int x, int y)
+{
+    // Tiles of all lower zooms come first, curve runs from the north west
+    uint64_t base = ((uint64_t(1) << (2 * z)) - 1) / 3;
+    uint64_t row = (uint64_t(1) << z) - 1 - y;
+    return base + hilbert_distance(z, x, row);
+}
+
+/**
+ * Append Little Endian Integer
+ */
+static void put_le(std::vector<uint8_t> &out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        out.push_back(uint8_t(value >> (8 * i)));
+    }
+}
+
+/**
+ * Read Little Endian Integer
+ */
+static uint64_t get_le(const uint8_t *in, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+    {
+        value |= uint64_t(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Append Varint
+ */
+static void put_varint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+/**
+ * Read Varint
+ *
+ * \param[in,out] pos Read position, advanced past the varint
+ * \param[in] end End of buffer
+ * \return Value
+ */
+static uint64_t get_varint(const uint8_t *&pos, const uint8_t *end)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= end)
+        {
+            throw std::runtime_error("Truncated PMTiles directory");
+        }
+        uint8_t byte = *pos++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Invalid PMTiles varint");
+}
+
+/**
+ * Serialize Directory
+ *
+ * \param[in] entries Directory entries, sorted by tile id
+ * \return Uncompressed directory bytes
+ */
+static std::vector<uint8_t> serialize_directory(const std::vector<pmtiles_entry> &entries)
+{
+    // Columns of delta and run-length friendly varints
+    std::vector<uint8_t> out;
+    put_varint(out, entries.size());
+    uint64_t last_id = 0;
+    for (const pmtiles_entry &e : entries)
+    {
+        put_varint(out, e.tile_id - last_id);
+        last_id = e.tile_id;
+    }
+    for (const pmtiles_entry &e : entries)
+    {
+        put_varint(out, e.run_length);
+    }
+    for (const pmtiles_entry &e : entries)
+    {
+        put_varint(out, e.length);
+    }
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        // Zero means "right after the previous entry"
+        if (i > 0 && entries[i].offset == entries[i - 1].offset + entries[i - 1].length)
+        {
+            put_varint(out, 0);
+        }
+        else
+        {
+            put_varint(out, entries[i].offset + 1);
+        }
+    }
+    return out;
+}
+
+/**
+ * Parse Directory
+ *
+ * \param[in] data Uncompressed directory bytes
+ * \param[in] size Size of directory
+ * \return Directory entries
+ */
+static std::vector<pmtiles_entry> parse_directory(const uint8_t *data, std::size_t size)
+{
+    const uint8_t *pos = data;
+    const uint8_t *end = data + size;
+    uint64_t count = get_varint(pos, end);
+    if (count > size)
+    {
+        throw std::runtime_error("Invalid PMTiles directory size");
+    }
+
+    std::vector<pmtiles_entry> entries(count);
+    uint64_t last_id = 0;
+    for (pmtiles_entry &e : entries)
+    {
+        last_id += get_varint(pos, end);
+        e.tile_id = last_id;
+    }
+    for (pmtiles_entry &e : entries)
+    {
+        e.run_length = get_varint(pos, end);
+    }
+    for (pmtiles_entry &e : entries)
+    {
+        e.length = get_varint(pos, end);
+    }
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        uint64_t value = get_varint(pos, end);
+        if (value == 0 && i > 0)
+        {
+            entries[i].offset = entries[i - 1].offset + entries[i - 1].length;
+        }
+        else
+        {
+            entries[i].offset = value - 1;
+        }
+    }
+    return entries;
+}
+
+/**
+ * Inflate Gzip Directory
+ *
+ * \param[in] data Compressed bytes
+ * \param[in] size Size of compressed bytes
+ * \return Uncompressed bytes
+ */
+static std::vector<uint8_t> gunzip(const uint8_t *data, std::size_t size)
+{
+    z_stream zs = {};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK)
+    {
+        throw std::runtime_error("Cannot init zlib");
+    }
+
+    std::vector<uint8_t> out(size * 4 + 1024);
+    zs.next_in = (Bytef*)data;
+    zs.avail_in = size;
+    int rc = Z_OK;
+    while (rc == Z_OK)
+    {
+        if (zs.total_out == out.size())
+        {
+            out.resize(out.size() * 2);
+        }
+        zs.next_out = out.data() + zs.total_out;
+        zs.avail_out = out.size() - zs.total_out;
+        rc = inflate(&zs, Z_NO_FLUSH);
+    }
+    out.resize(zs.total_out);
+    inflateEnd(&zs);
+    if (rc != Z_STREAM_END)
+    {
+        throw std::runtime_error("Corrupt PMTiles directory");
+    }
+    return out;
+}
+
+/**
+ * FNV-1a Hash
+ */
+static uint64_t fnv_hash(const uint8_t *data, std::size_t size,
+                         uint64_t hash = 1469598103934665603ULL)
+{
+    for (std::size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Constructor
+ *
+ * \param[in] path Archive to create
+ * \param[in] info Archive description
+ */
+pmtiles_writer::pmtiles_writer(const fs::path &path, const archive_info &info)
+    : path_(path), info_(info)
+{
+    spool_path_ = path;
+    spool_path_ += ".spool";
+    spool_ = fopen(spool_path_.string().c_str(), "w+b");
+    if (spool_ == nullptr)
+    {
+        throw std::runtime_error("Cannot create PMTiles spool " + spool_path_.string());
+    }
+}
+
+/**
+ * Destructor (finishes archive)
+ */
+pmtiles_writer::~pmtiles_writer()
+{
+    try
+    {
+        finish();
+    }
+    catch (const std::exception &e)
+    {
+        printf("PMTiles error: %s\n", e.what());
+    }
+}
+
+/**
+ * Add Tile
+ *
+ * \param[in] z Zoom
+ * \param[in] x Horizontal tile coordinate
+ * \param[in] y Vertical tile coordinate
+ * \param[in] data Encoded image bytes
+ */
+void pmtiles_writer::put(int z, int x, int y, const std::vector<uint8_t> &data)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spool_ == nullptr)
+    {
+        throw std::runtime_error("PMTiles archive already finished");
+    }
+    if (fwrite(data.data(), 1, data.size(), spool_) != data.size())
+    {
+        throw std::runtime_error("PMTiles spool write error");
+    }
+    tiles_.push_back({pmtiles_tile_id(z, x, y), spool_size_, uint32_t(data.size()),
+                      fnv_hash(data.data(), data.size())});
+    spool_size_ += data.size();
+}
+
+/**
+ * Keep Tiles Added So Far
+ *
+ * Nothing to do, the archive is only written once complete.
+ */
+void pmtiles_writer::flush()
+{
+}
+
+/**
+ * Complete Archive
+ */
+void pmtiles_writer::finish()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spool_ == nullptr)
+    {
+        return;
+    }
+
+    try
+    {
+        write_archive();
+    }
+    catch (...)
+    {
+        fclose(spool_);
+        spool_ = nullptr;
+        fs::remove(spool_path_);
+        throw;
+    }
+    fclose(spool_);
+    spool_ = nullptr;
+    fs::remove(spool_path_);
+}
+
+/**
+ * Check Resume Support
+ *
+ * \return False, the archive is only written once complete
+ */
+bool pmtiles_writer::can_resume() const
+{
+    return false;
+}
+
+/**
+ * Write Archive
+ */
+void pmtiles_writer::write_archive()
+{
+    // Tile id order, last put wins for repeats
+    std::stable_sort(tiles_.begin(), tiles_.end(),
+                     [](const spooled &a, const spooled &b) { return a.tile_id < b.tile_id; });
+    std::vector<spooled> unique;
+    for (const spooled &t : tiles_)
+    {
+        if (!unique.empty() && unique.back().tile_id == t.tile_id)
+        {
+            unique.back() = t;
+        }
+        else
+        {
+            unique.push_back(t);
+        }
+    }
+
+    // Lay out tile data once per distinct content, runs of repeats share an entry
+    fflush(spool_);
+    std::vector<uint8_t> a, b;
+    auto same_bytes = [&](const spooled &x, const spooled &y) {
+        a.resize(x.length);
+        b.resize(y.length);
+        if (pread(fileno(spool_), a.data(), a.size(), x.offset) != ssize_t(a.size()) ||
+            pread(fileno(spool_), b.data(), b.size(), y.offset) != ssize_t(b.size()))
+        {
+            throw std::runtime_error("PMTiles spool read error");
+        }
+        return a == b;
+    };
+
+    // Hash picks candidates, the bytes decide (a collision must not share data)
+    std::unordered_map<uint64_t, std::vector<std::size_t>> by_hash;
+    std::vector<uint64_t> content_offset;
+    std::vector<pmtiles_entry> entries;
+    std::vector<const spooled*> contents;
+    uint64_t data_size = 0;
+    for (const spooled &t : unique)
+    {
+        std::vector<std::size_t> &candidates = by_hash[t.hash ^ (uint64_t(t.length) << 32)];
+        uint64_t offset = data_size;
+        bool found = false;
+        for (std::size_t idx : candidates)
+        {
+            if (contents[idx]->length == t.length && same_bytes(*contents[idx], t))
+            {
+                offset = content_offset[idx];
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            candidates.push_back(contents.size());
+            content_offset.push_back(offset);
+            contents.push_back(&t);
+            data_size += t.length;
+        }
+
+        if (!entries.empty() && entries.back().offset == offset &&
+            entries.back().tile_id + entries.back().run_length == t.tile_id)
+        {
+            entries.back().run_length++;
+        }
+        else
+        {
+            entries.push_back({t.tile_id, offset, t.length, 1});
+        }
+    }
+
+    // Root directory, spilling into leaves when it doesn't fit
+    std::vector<uint8_t> root = serialize_directory(entries);
+    std::vector<uint8_t> leaves;
+    for (std::size_t leaf_size = 4096; root.size() > ROOT_SIZE; leaf_size *= 2)
+    {
+        std::vector<pmtiles_entry> root_entries;
+        leaves.clear();
+        for (std::size_t i = 0; i < entries.size(); i += leaf_size)
+        {
+            std::vector<pmtiles_entry> chunk(entries.begin() + i,
+                                             entries.begin() + std::min(i + leaf_size, entries.size()));
+            std::vector<uint8_t> leaf = serialize_directory(chunk);
+            root_entries.push_back({chunk.front().tile_id, leaves.size(),
+                                    uint32_t(leaf.size()), 0});
+            leaves.insert(leaves.end(), leaf.begin(), leaf.end());
+        }
+        root = serialize_directory(root_entries);
+    }
+
+    // Same format and type names as the MBTiles metadata
+    bool vector = (info_.format == tile_format::MVT);
+    std::string metadata = "{\"name\":\"" + info_.name + "\",\"format\":\"" +
+        (vector ? "pbf" : tile_format_extension(info_.format)) + "\",\"type\":\"" +
+        (vector ? "overlay" : "baselayer") + "\"}";
+
+    // Header, then root, metadata, leaves and tile data back to back
+    uint64_t root_offset = HEADER_SIZE;
+    uint64_t metadata_offset = root_offset + root.size();
+    uint64_t leaf_offset = metadata_offset + metadata.size();
+    uint64_t data_offset = leaf_offset + leaves.size();
+    uint64_t addressed = 0;
+    for (const pmtiles_entry &e : entries)
+    {
+        addressed += e.run_length;
+    }
+
+    std::vector<uint8_t> header;
+    header.insert(header.end(), {'P', 'M', 'T', 'i', 'l', 'e', 's', 3});
+    put_le(header, root_offset, 8);
+    put_le(header, root.size(), 8);
+    put_le(header, metadata_offset, 8);
+    put_le(header, metadata.size(), 8);
+    put_le(header, leaf_offset, 8);
+    put_le(header, leaves.size(), 8);
+    put_le(header, data_offset, 8);
+    put_le(header, data_size, 8);
+    put_le(header, addressed, 8);
+    put_le(header, entries.size(), 8);
+    put_le(header, contents.size(), 8);
+    header.push_back(1); // clustered
+    header.push_back(PMT_COMPRESSION_NONE); // internal
+    header.push_back(PMT_COMPRESSION_NONE); // tiles
+    header.push_back((info_.format == tile_format::WEBP) ? PMT_TYPE_WEBP :
+                     (info_.format == tile_format::MVT) ? PMT_TYPE_MVT : PMT_TYPE_PNG);
+    header.push_back(info_.min_zoom);
+    header.push_back(info_.max_zoom);
+    put_le(header, uint32_t(int32_t(std::lround(info_.bounds.MinX * 1e7))), 4);
+    put_le(header, uint32_t(int32_t(std::lround(info_.bounds.MinY * 1e7))), 4);
+    put_le(header, uint32_t(int32_t(std::lround(info_.bounds.MaxX * 1e7))), 4);
+    put_le(header, uint32_t(int32_t(std::lround(info_.bounds.MaxY * 1e7))), 4);
+    header.push_back(info_.min_zoom);
+    put_le(header, uint32_t(int32_t(std::lround((info_.bounds.MinX + info_.bounds.MaxX) * 0.5e7))), 4);
+    put_le(header, uint32_t(int32_t(std::lround((info_.bounds.MinY + info_.bounds.MaxY) * 0.5e7))), 4);
+
+    // Write to a temp file and rename, so servers never see a partial archive
+    fs::path tmp_path = path_;
+    tmp_path += ".tmp";
+    FILE *out = fopen(tmp_path.string().c_str(), "wb");
+    if (out == nullptr)
+    {
+        throw std::runtime_error("Cannot create PMTiles " + tmp_path.string());
+    }
+    bool ok = fwrite(header.data(), 1, header.size(), out) == header.size() &&
+        fwrite(root.data(), 1, root.size(), out) == root.size() &&
+        fwrite(metadata.data(), 1, metadata.size(), out) == metadata.size() &&
+        fwrite(leaves.data(), 1, leaves.size(), out) == leaves.size();
+
+    // Tile data in tile id order, from the spool
+    std::vector<uint8_t> buffer;
+    for (std::size_t i = 0; ok && i < contents.size(); i++)
+    {
+        buffer.resize(contents[i]->length);
+        ok = pread(fileno(spool_), buffer.data(), buffer.size(),
+                   contents[i]->offset) == ssize_t(buffer.size()) &&
+            fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+    }
+    ok = (fclose(out) == 0) && ok;
+    if (!ok)
+    {
+        fs::remove(tmp_path);
+        throw std::runtime_error("PMTiles write error " + tmp_path.string());
+    }
+    fs::rename(tmp_path, path_);
+
+    printf("PMTiles %s: %lu tiles, %lu distinct, %lu bytes\n", path_.string().c_str(),
+           (unsigned long)addressed, (unsigned long)contents.size(),
+           (unsigned long)(data_offset + data_size));
+}
+
+/**
+ * Constructor
+ *
+ * \param[in] path Archive to open
+ */
+pmtiles_reader::pmtiles_reader(const fs::path &path)
+{
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open PMTiles " + path.string());
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)HEADER_SIZE)
+    {
+        close(fd);
+        throw std::runtime_error("Not a PMTiles archive: " + path.string());
+    }
+    modified_ = info.st_mtime;
+    map_size_ = info.st_size;
+    void *map = mmap(nullptr, map_size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map PMTiles " + path.string());
+    }
+    map_ = (const uint8_t*)map;
+
+    try
+    {
+        if (memcmp(map_, "PMTiles", 7) != 0 || map_[7] != 3)
+        {
+            throw std::runtime_error("Not a PMTiles v3 archive: " + path.string());
+        }
+
+        uint64_t root_offset = get_le(map_ + 8, 8);
+        uint64_t root_length = get_le(map_ + 16, 8);
+        leaf_offset_ = get_le(map_ + 40, 8);
+        data_offset_ = get_le(map_ + 56, 8);
+        internal_compression_ = map_[97];
+        uint8_t tile_compression = map_[98];
+        uint8_t tile_type = map_[99];
+
+        if (tile_compression != PMT_COMPRESSION_NONE &&
+            tile_compression != PMT_COMPRESSION_UNKNOWN)
+        {
+            throw std::runtime_error("Compressed PMTiles tiles not supported: " + path.string());
+        }
+        if (tile_type == PMT_TYPE_PNG)
+        {
+            format_ = tile_format::PNG;
+        }
+        else if (tile_type == PMT_TYPE_WEBP)
+        {
+            format_ = tile_format::WEBP;
+        }
+        else if (tile_type == PMT_TYPE_MVT)
+        {
+            format_ = tile_format::MVT;
+        }
+        else
+        {
+            throw std::runtime_error("Unsupported PMTiles tile type: " + path.string());
+        }
+
+        // Flatten root and leaf directories into one sorted index
+        load_directory(root_offset, root_length, 0);
+        std::sort(entries_.begin(), entries_.end(),
+                  [](const pmtiles_entry &a, const pmtiles_entry &b) {
+                      return a.tile_id < b.tile_id;
+                  });
+    }
+    catch (...)
+    {
+        munmap((void*)map_, map_size_);
+        throw;
+    }
+}
+
+/**
+ * Destructor
+ */
+pmtiles_reader::~pmtiles_reader()
+{
+    munmap((void*)map_, map_size_);
+}
+
+/**
+ * Load Directory (and its leaves)
+ *
+ * \param[in] offset Directory offset in file
+ * \param[in] length Directory length
+ * \param[in] depth Leaf depth, to reject cycles
+ */
+void pmtiles_reader::load_directory(uint64_t offset, uint64_t length, int depth)
+{
+    if (depth > MAX_DEPTH || offset > map_size_ || length > map_size_ - offset)
+    {
+        throw std::runtime_error("Invalid PMTiles directory");
+    }
+
+    std::vector<pmtiles_entry> entries;
+    if (internal_compression_ == PMT_COMPRESSION_GZIP)
+    {
+        std::vector<uint8_t> raw = gunzip(map_ + offset, length);
+        entries = parse_directory(raw.data(), raw.size());
+    }
+    else if (internal_compression_ == PMT_COMPRESSION_NONE ||
+             internal_compression_ == PMT_COMPRESSION_UNKNOWN)
+    {
+        entries = parse_directory(map_ + offset, length);
+    }
+    else
+    {
+        throw std::runtime_error("Unsupported PMTiles directory compression");
+    }
+
+    for (const pmtiles_entry &e : entries)
+    {
+        if (e.run_length == 0)
+        {
+            load_directory(leaf_offset_ + e.offset, e.length, depth + 1);
+        }
+        else if (data_offset_ + e.offset + e.length <= map_size_)
+        {
+            entries_.push_back(e);
+        }
+    }
+}
+
+/**
+ * Look Up Tile
+ *
+ * \param[in] z Zoom
+ * \param[in] x Horizontal tile coordinate
+ * \param[in] y Vertical tile coordinate
+ * \param[out] tile Tile data
+ * \return False if the archive doesn't have this tile
+ */
+bool pmtiles_reader::get(int z, int x, int y, archive_tile &tile) const
+{
+    if (z < 0 || z > 30 || x < 0 || y < 0 || x >= (1 << z) || y >= (1 << z))
+    {
+        return false;
+    }
+
+    // Last entry starting at or before this id
+    uint64_t id = pmtiles_tile_id(z, x, y);
+    auto it = std::upper_bound(entries_.begin(), entries_.end(), id,
+                               [](uint64_t v, const pmtiles_entry &e) { return v < e.tile_id; });
+    if (it == entries_.begin())
+    {
+        return false;
+    }
+    --it;
+    if (id >= it->tile_id + it->run_length)
+    {
+        return false;
+    }
+
+    // Served in place, same data always has the same offset
+    tile.data = map_ + data_offset_ + it->offset;
+    tile.size = it->length;
+    tile.copy.reset();
+    char etag[24];
+    uint64_t hash = fnv_hash((const uint8_t*)&it->offset, sizeof(it->offset),
+                             fnv_hash((const uint8_t*)&modified_, sizeof(modified_)));
+    snprintf(etag, sizeof(etag), "\"%016lx\"", (unsigned long)hash);
+    tile.etag = etag;
+    return true;
+}
+
+/**
+ * Get Tile Format
+ *
+ * \return Image format of every tile
+ */
+tile_format pmtiles_reader::get_format() const
+{
+    return format_;
+}
+
+/**
+ * Get Modification Time
+ *
+ * \return Time archive was last written
+ */
+time_t pmtiles_reader::get_modified() const
+{
+    return modified_;
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,169 @@
+/**
+ * \file
+ * \brief Render Context
+ *
+ * Image surface and scratch buffers for rendering a tile (or metatile),
+ * pooled for reuse between renders.
+ */
+
+#include <stdexcept>
+#include <encviz/render_context.h>
+
+namespace encviz
+{
+
+/**
+ * Destructor
+ */
+render_context::~render_context()
+{
+    if (cr_ != nullptr)
+    {
+        cairo_destroy(cr_);
+    }
+    if (surface_ != nullptr)
+    {
+        cairo_surface_destroy(surface_);
+    }
+}
+
+/**
+ * Start Render
+ *
+ * \param[in] size Image width and height (pixels)
+ * \return Drawing context in its default state (valid until next begin)
+ */
+cairo_t *render_context::begin(int size)
+{
+    // Drawing state is not carried between renders, only the (small)
+    // cairo_t is recreated
+    if (cr_ != nullptr)
+    {
+        cairo_destroy(cr_);
+        cr_ = nullptr;
+    }
+
+    if (surface_ != nullptr && size_ != size)
+    {
+        cairo_surface_destroy(surface_);
+        surface_ = nullptr;
+    }
+
+    bool fresh = (surface_ == nullptr);
+    if (fresh)
+    {
+        surface_ = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+        if (cairo_surface_status(surface_) != CAIRO_STATUS_SUCCESS)
+        {
+            cairo_surface_destroy(surface_);
+            surface_ = nullptr;
+            throw std::runtime_error("Cannot create tile image");
+        }
+        size_ = size;
+    }
+
+    cr_ = cairo_create(surface_);
+    if (!fresh)
+    {
+        // New surfaces start out transparent, reused ones are wiped
+        cairo_set_operator(cr_, CAIRO_OPERATOR_CLEAR);
+        cairo_paint(cr_);
+        cairo_set_operator(cr_, CAIRO_OPERATOR_OVER);
+    }
+
+    layers.clear();
+    coverage.clear();
+    points.clear();
+    return cr_;
+}
+
+/**
+ * Get Estimated Footprint
+ *
+ * \return Memory held by the surface and point buffer (bytes)
+ */
+std::size_t render_context::get_size() const
+{
+    std::size_t size = points.capacity() * sizeof(coord);
+    if (surface_ != nullptr)
+    {
+        size += cairo_image_surface_get_stride(surface_) * cairo_image_surface_get_height(surface_);
+    }
+    return size;
+}
+
+/**
+ * Release Context
+ *
+ * \param[in] ctx Leased context
+ */
+void render_context_pool::releaser::operator()(render_context *ctx) const
+{
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex_);
+        pool->idle_.emplace_back(ctx);
+        pool->idle_bytes_ += ctx->get_size();
+        pool->budget_.report(pool->idle_bytes_);
+    }
+    pool->budget_.enforce();
+}
+
+/**
+ * Lease Context
+ *
+ * \return Context for exclusive use until the lease is reset
+ */
+render_context_pool::lease render_context_pool::acquire()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!idle_.empty())
+        {
+            // Most recently used first, its memory is likely still warm
+            render_context *ctx = idle_.back().release();
+            idle_.pop_back();
+            idle_bytes_ -= ctx->get_size();
+            budget_.report(idle_bytes_);
+            return lease(ctx, releaser{this});
+        }
+    }
+    return lease(new render_context, releaser{this});
+}
+
+/**
+ * Share Memory Budget
+ *
+ * \param[in] budget Budget idle contexts count against (must outlive the pool)
+ * \param[in] weight Relative share of budget
+ */
+void render_context_pool::set_budget(memory_budget &budget, double weight)
+{
+    budget_.attach(budget, "surfaces", weight, [this]() { trim(); });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_.report(idle_bytes_);
+}
+
+/**
+ * Free Idle Contexts for Memory Budget
+ */
+void render_context_pool::trim()
+{
+    // Destroyed once the lock is released
+    std::vector<std::unique_ptr<render_context>> freed;
+    {
+        // Least recently used are at the front
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = idle_.begin();
+        while (it != idle_.end() && budget_.over())
+        {
+            idle_bytes_ -= (*it)->get_size();
+            freed.push_back(std::move(*it));
+            ++it;
+            budget_.report(idle_bytes_);
+        }
+        idle_.erase(idle_.begin(), it);
+    }
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,195 @@
+/**
+ * \file
+ * \brief Scale Band Coverage Plan
+ *
+ * Loose quadtree over one scale band, recording which charts supply each
+ * region and where.
+ */
+
+#include <stdexcept>
+#include <encviz/scale_plan.h>
+
+namespace encviz
+{
+
+typedef std::unique_ptr<OGRGeometry, decltype(&OGRGeometryFactory::destroyGeometry)> GeoPtr;
+
+/**
+ * Bounding Box to Polygon
+ *
+ * \param[in] bbox OGR Envelope
+ * \return Rectangular polygon
+ */
+static GeoPtr bbox_to_polygon(const OGREnvelope &bbox)
+{
+    OGRLinearRing ring;
+    ring.addPoint(bbox.MinX, bbox.MinY);
+    ring.addPoint(bbox.MaxX, bbox.MinY);
+    ring.addPoint(bbox.MaxX, bbox.MaxY);
+    ring.addPoint(bbox.MinX, bbox.MaxY);
+    ring.addPoint(bbox.MinX, bbox.MinY);
+
+    OGRPolygon *poly = new OGRPolygon;
+    poly->addRing(&ring);
+    return GeoPtr(poly, &OGRGeometryFactory::destroyGeometry);
+}
+
+/**
+ * Constructor
+ *
+ * \param[in] charts Charts in the band, ascending scale order
+ * \param[in] exact_coverage Reads erase coverage of a chart
+ */
+scale_plan::scale_plan(std::vector<chart> charts, coverage_fn exact_coverage)
+    : charts_(std::move(charts)), exact_coverage_(std::move(exact_coverage))
+{
+    // Square root cell, so cells stay square (lat beyond +/-90 is empty)
+    root_.cell.MinX = root_.cell.MinY = -180;
+    root_.cell.MaxX = root_.cell.MaxY = 180;
+    for (std::size_t i = 0; i < charts_.size(); i++)
+    {
+        root_.candidates.push_back(i);
+    }
+}
+
+/**
+ * Find Region for Area
+ *
+ * \param[in] bbox Area (deg)
+ * \return Smallest region wholly containing the area
+ */
+const scale_plan::region &scale_plan::find(const OGREnvelope &bbox)
+{
+    // Descend toward the area's center while a child still holds all of it
+    double cx = (bbox.MinX + bbox.MaxX) / 2;
+    double cy = (bbox.MinY + bbox.MaxY) / 2;
+    node *n = &root_;
+    while (n->depth < MAX_DEPTH && n->candidates.size() > 1)
+    {
+        std::call_once(n->split_once, [&]() { split(*n); });
+
+        double mx = (n->cell.MinX + n->cell.MaxX) / 2;
+        double my = (n->cell.MinY + n->cell.MaxY) / 2;
+        node *child = n->children[(cx >= mx ? 1 : 0) + (cy >= my ? 2 : 0)].get();
+        if (!loosen(child->cell).Contains(bbox))
+        {
+            break;
+        }
+        n = child;
+    }
+
+    std::call_once(n->plan_once, [&]() { resolve(*n); });
+    return n->plan;
+}
+
+/**
+ * Loose Bounds of Cell
+ *
+ * \param[in] cell Cell bounds (deg)
+ * \return Cell grown by half its size on each side
+ */
+OGREnvelope scale_plan::loosen(const OGREnvelope &cell)
+{
+    double dx = (cell.MaxX - cell.MinX) / 2;
+    double dy = (cell.MaxY - cell.MinY) / 2;
+    OGREnvelope loose = cell;
+    loose.MinX -= dx;
+    loose.MaxX += dx;
+    loose.MinY -= dy;
+    loose.MaxY += dy;
+    return loose;
+}
+
+/**
+ * Create Child Nodes
+ *
+ * \param[in,out] parent Node to split
+ */
+void scale_plan::split(node &parent) const
+{
+    double mx = (parent.cell.MinX + parent.cell.MaxX) / 2;
+    double my = (parent.cell.MinY + parent.cell.MaxY) / 2;
+    for (int i = 0; i < 4; i++)
+    {
+        auto child = std::make_unique<node>();
+        child->depth = parent.depth + 1;
+        child->cell.MinX = (i & 1) ? mx : parent.cell.MinX;
+        child->cell.MaxX = (i & 1) ? parent.cell.MaxX : mx;
+        child->cell.MinY = (i & 2) ? my : parent.cell.MinY;
+        child->cell.MaxY = (i & 2) ? parent.cell.MaxY : my;
+
+        // Order is kept, so candidates stay most detailed first
+        OGREnvelope loose = loosen(child->cell);
+        for (std::size_t idx : parent.candidates)
+        {
+            if (charts_[idx].bbox.Intersects(loose))
+            {
+                child->candidates.push_back(idx);
+            }
+        }
+        parent.children[i] = std::move(child);
+    }
+}
+
+/**
+ * Resolve Region
+ *
+ * Runs the selection (simplified coverage) and erase (exact coverage)
+ * chains once over the whole region.
+ *
+ * \param[in,out] n Node to plan
+ */
+void scale_plan::resolve(node &n) const
+{
+    region plan;
+    plan.bbox = loosen(n.cell);
+
+    GeoPtr missing = bbox_to_polygon(plan.bbox);
+    GeoPtr erased = bbox_to_polygon(plan.bbox);
+    std::shared_ptr<const OGRGeometry> mask;
+    for (std::size_t i = 0; i < n.candidates.size(); i++)
+    {
+        const chart &c = charts_[n.candidates[i]];
+        if (c.coverage == nullptr || !c.coverage->Intersects(missing.get()))
+        {
+            continue;
+        }
+        plan.steps.push_back({&c, mask});
+
+        // Geometry failure, don't guess and keep the rest
+        GeoPtr remaining(missing->Difference(c.coverage.get()), &OGRGeometryFactory::destroyGeometry);
+        if (remaining == nullptr)
+        {
+            for (std::size_t j = i + 1; j < n.candidates.size(); j++)
+            {
+                plan.steps.push_back({&charts_[n.candidates[j]], mask});
+            }
+            break;
+        }
+        missing = std::move(remaining);
+
+        // Nothing further needs to be drawn
+        if (missing->IsEmpty())
+        {
+            plan.complete = true;
+            break;
+        }
+
+        // Later charts are drawn where this one isn't
+        std::shared_ptr<const OGRGeometry> coverage = exact_coverage_(c.id);
+        if (coverage != nullptr)
+        {
+            GeoPtr rest(erased->Difference(coverage.get()), &OGRGeometryFactory::destroyGeometry);
+            if (rest == nullptr)
+            {
+                throw std::runtime_error("Cannot perform coverage difference");
+            }
+            erased = std::move(rest);
+            mask = std::shared_ptr<const OGRGeometry>(erased->clone(),
+                                                      &OGRGeometryFactory::destroyGeometry);
+        }
+    }
+    n.plan = std::move(plan);
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,147 @@
+/**
+ * \file
+ * \brief Line Simplification
+ *
+ * Decimates projected lines and rings, so vertices that land within a
+ * fraction of a pixel of each other (coastlines at low zoom) never reach
+ * cairo.
+ */
+
+#include <encviz/simplify.h>
+
+namespace encviz
+{
+
+/**
+ * Simplify Line (Douglas-Peucker)
+ *
+ * \param[in,out] pts Points, reduced in place (end points always kept)
+ * \param[in] tolerance Max distance of dropped points from the result (0 = off)
+ * \param[in,out] index Source index of each point, reduced alongside (optional)
+ */
+void simplify_line(std::vector<coord> &pts, double tolerance,
+                   std::vector<std::size_t> *index)
+{
+    if (pts.size() < 3 || tolerance <= 0)
+    {
+        return;
+    }
+
+    std::vector<char> keep(pts.size(), 0);
+    keep.front() = keep.back() = 1;
+    std::vector<std::pair<std::size_t, std::size_t>> stack = {{0, pts.size() - 1}};
+    double tol2 = tolerance * tolerance;
+    while (!stack.empty())
+    {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+
+        // Farthest point from the chord between both ends
+        double dx = pts[last].x - pts[first].x;
+        double dy = pts[last].y - pts[first].y;
+        double len2 = dx * dx + dy * dy;
+        double max_d2 = 0;
+        std::size_t max_i = first;
+        for (std::size_t i = first + 1; i < last; i++)
+        {
+            double px = pts[i].x - pts[first].x;
+            double py = pts[i].y - pts[first].y;
+            double d2;
+            if (len2 == 0)
+            {
+                d2 = px * px + py * py;
+            }
+            else
+            {
+                double cross = px * dy - py * dx;
+                d2 = cross * cross / len2;
+            }
+            if (d2 > max_d2)
+            {
+                max_d2 = d2;
+                max_i = i;
+            }
+        }
+
+        if (max_d2 > tol2)
+        {
+            keep[max_i] = 1;
+            stack.push_back({first, max_i});
+            stack.push_back({max_i, last});
+        }
+    }
+
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < pts.size(); i++)
+    {
+        if (keep[i])
+        {
+            pts[n] = pts[i];
+            if (index != nullptr)
+            {
+                (*index)[n] = (*index)[i];
+            }
+            n++;
+        }
+    }
+    pts.resize(n);
+    if (index != nullptr)
+    {
+        index->resize(n);
+    }
+}
+
+/**
+ * Project and Simplify Line
+ *
+ * \param[in] curve Line or ring (deg)
+ * \param[in] wm Web Mercator point mapper
+ * \param[in] tolerance Simplification tolerance (pixels, 0 = off)
+ * \param[out] out Projected points (pixels)
+ * \param[out] index Source index of each output point (optional)
+ */
+void project_line(const OGRSimpleCurve *curve, const web_mercator &wm, double tolerance,
+                  std::vector<coord> &out, std::vector<std::size_t> *index)
+{
+    out.clear();
+    if (index != nullptr)
+    {
+        index->clear();
+    }
+
+    // Project the whole line at once
+    int npoints = curve->getNumPoints();
+    thread_local std::vector<coord> pts;
+    pts.resize(npoints);
+    if (npoints > 0)
+    {
+        curve->getPoints(&pts[0].x, sizeof(coord), &pts[0].y, sizeof(coord));
+        wm.deg_to_pixels(pts.data(), pts.data(), npoints);
+    }
+
+    double tol2 = tolerance * tolerance;
+    for (int i = 0; i < npoints; i++)
+    {
+        const coord &c = pts[i];
+
+        // Drop points next to the last one kept, but always keep the end
+        if (!out.empty() && i != npoints - 1)
+        {
+            double dx = c.x - out.back().x;
+            double dy = c.y - out.back().y;
+            if (dx * dx + dy * dy <= tol2)
+            {
+                continue;
+            }
+        }
+        out.push_back(c);
+        if (index != nullptr)
+        {
+            index->push_back(i);
+        }
+    }
+
+    simplify_line(out, tolerance, index);
+}
+
+}; // ~namespace encviz
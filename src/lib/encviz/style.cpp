@@ -106,6 +106,29 @@ color parse_color(tinyxml2::XMLElement *node)
     return parsed;
 }
 
+/**
+ * Look Up S-57 Object Class
+ *
+ * \param[in] layer_name S57 layer (object class acronym)
+ * \return Object class, S57_OTHER if it has no special rendering
+ */
+S57Class parse_s57_class(const std::string &layer_name)
+{
+    static const std::map<std::string, S57Class> classes = {
+        {"M_COVR", S57_M_COVR}, {"DEPARE", S57_DEPARE}, {"DRGARE", S57_DRGARE},
+        {"BOYCAR", S57_BOYCAR}, {"BOYINB", S57_BOYINB}, {"BOYISD", S57_BOYISD},
+        {"BOYLAT", S57_BOYLAT}, {"BOYSAW", S57_BOYSAW}, {"BOYSPP", S57_BOYSPP},
+        {"BCNCAR", S57_BCNCAR}, {"BCNISD", S57_BCNISD}, {"BCNLAT", S57_BCNLAT},
+        {"BCNSAW", S57_BCNSAW}, {"BCNSPP", S57_BCNSPP}, {"FOGSIG", S57_FOGSIG},
+        {"LIGHTS", S57_LIGHTS}, {"LNDMRK", S57_LNDMRK}, {"SILTNK", S57_SILTNK},
+        {"UWTROC", S57_UWTROC}, {"OBSTRN", S57_OBSTRN}, {"WRECKS", S57_WRECKS},
+        {"ACHBRT", S57_ACHBRT}, {"TSSLPT", S57_TSSLPT}, {"LNDARE", S57_LNDARE},
+        {"SEAARE", S57_SEAARE}, {"LNDRGN", S57_LNDRGN}, {"BUAARE", S57_BUAARE}
+    };
+    auto it = classes.find(layer_name);
+    return (it == classes.end()) ? S57_OTHER : it->second;
+}
+
 /**
  * Parse Layer Style
  *
@@ -123,6 +146,7 @@ layer_style parse_layer(tinyxml2::XMLElement *node, const std::filesystem::path
     // Parse layer XML
     layer_style parsed;
     parsed.layer_name = xml_text(xml_query(node, "layer_name"));
+    parsed.object_class = parse_s57_class(parsed.layer_name);
 	tinyxml2::XMLElement* verbose = node->FirstChildElement("verbose");
 	if (verbose)
 	{
@@ -7,6 +7,8 @@
 
 #include <encviz/svg_collection.h>
 #include <librsvg/rsvg.h>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 namespace fs = std::filesystem;
 
@@ -30,12 +32,74 @@ typedef std::unique_ptr<GFile, GObjectDeleter> GFilePtr;
 namespace encviz
 {
 
+/// Most pre-rendered icons kept before the sprite cache is reset
+static const std::size_t MAX_SPRITES = 4096;
+
+/// Parsed document size, relative to its file (librsvg keeps a full node tree)
+static const std::size_t HANDLE_SIZE_FACTOR = 4;
+
+/// Time spent in render_svg() by this thread (usec)
+static thread_local int64_t icon_usec = 0;
+
+/// Adds the lifetime of a scope to icon_usec
+struct icon_timer
+{
+    /// Start of scope
+    std::chrono::steady_clock::time_point start{std::chrono::steady_clock::now()};
+
+    ~icon_timer()
+    {
+        icon_usec += std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+/// Parsed SVG document, librsvg handles are used by one thread at a time
+struct svg_collection::svg_handle
+{
+    /// Parsed document (stylesheet applied)
+    RsvgHandlePtr handle;
+
+    /// Serializes rendering
+    std::mutex lock;
+};
+
 svg_collection::svg_collection()
 	: svg_root_path_("")
 {
 
 }
 
+svg_collection::~svg_collection()
+{
+    clear_sprites();
+}
+
+void svg_collection::set_sprite_cache(bool enabled)
+{
+    use_sprites_ = enabled;
+}
+
+void svg_collection::set_budget(memory_budget &budget, double weight)
+{
+    budget_.attach(budget, "icons", weight, [this]() {
+        // Sprites are cheap to redraw, start over like a full cache does
+        std::lock_guard<std::mutex> guard(mutex_);
+        clear_sprites();
+
+        // Documents are parsed again on next use
+        if (budget_.over())
+        {
+            handles_.clear();
+            handle_bytes_ = 0;
+            report_size();
+        }
+    });
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    report_size();
+}
+
 void svg_collection::set_svg_path(const std::filesystem::path &svg_path)
 {
     svg_root_path_ = svg_path;
@@ -45,45 +109,136 @@ bool svg_collection::render_svg(cairo_t *cr, std::filesystem::path &svg_path,
 								coord center, double width, double height,
 								std::string stylesheet, double rotation)
 {
+    icon_timer timer;
     fs::path full_path = svg_root_path_;
     full_path /= svg_path;
-    
+
+    if (use_sprites_)
+    {
+        // Bucket rotation to whole degrees
+        int degrees = static_cast<int>(std::lround(rotation)) % 360;
+        if (degrees < 0)
+        {
+            degrees += 360;
+        }
+
+        cairo_surface_t *sprite = get_sprite(sprite_key(full_path.string(), stylesheet,
+                                                        width, height, degrees));
+        if (sprite == nullptr)
+        {
+            render_svg_missing(cr, center);
+            return false;
+        }
+
+        // Blit at the nearest pixel so the icon stays sharp
+        int half = cairo_image_surface_get_width(sprite) / 2;
+        cairo_save(cr);
+        cairo_set_source_surface(cr, sprite,
+                                 std::round(center.x) - half,
+                                 std::round(center.y) - half);
+        cairo_paint(cr);
+        cairo_restore(cr);
+        cairo_surface_destroy(sprite);
+        return true;
+    }
+
+    std::shared_ptr<svg_handle> svg = get_handle(full_path, stylesheet);
+    if (svg == nullptr)
+    {
+		render_svg_missing(cr, center);
+		return false;
+    }
+
+    std::lock_guard<std::mutex> guard(svg->lock);
+    if (!draw_handle(cr, *svg, center, width, height, rotation))
+    {
+		render_svg_missing(cr, center);
+		return false;
+    }
+    return true;
+}
+
+/**
+ * Get Icon Time of Calling Thread
+ *
+ * \return Total time this thread has spent in render_svg() (usec)
+ */
+int64_t svg_collection::thread_usec()
+{
+    return icon_usec;
+}
+
+std::shared_ptr<svg_collection::svg_handle> svg_collection::get_handle(
+    const std::filesystem::path &full_path, const std::string &stylesheet)
+{
+    auto key = std::make_pair(full_path.string(), stylesheet);
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = handles_.find(key);
+        if (it != handles_.end())
+        {
+            return it->second;
+        }
+    }
+
+    // Parse outside the cache lock, so other icons aren't held up
+    std::shared_ptr<svg_handle> svg;
     GError *error = NULL;
     GFilePtr file(g_file_new_for_path(full_path.string().c_str()));
-
-    //RsvgHandle *handle = rsvg_handle_new_from_gfile_sync(file, RSVG_HANDLE_FLAGS_NONE, NULL, &error);
 	RsvgHandlePtr handle(rsvg_handle_new_from_gfile_sync(file.get(), RSVG_HANDLE_FLAGS_NONE, NULL, &error));
 
     if (!handle)
     {
 		g_printerr ("Error loading SVG `%s`: %s\n", full_path.string().c_str(), error->message);
-		render_svg_missing(cr, center);
-		return false;
+		g_clear_error(&error);
+    }
+    else
+    {
+        rsvg_handle_set_dpi(handle.get(), 96.0);
+
+        if (stylesheet.size() > 0)
+        {
+            bool set_style;
+            set_style = rsvg_handle_set_stylesheet (handle.get(),
+                                                    reinterpret_cast<const uint8_t*>(stylesheet.c_str()),
+                                                    stylesheet.size(),
+                                                    &error);
+            if (!set_style)
+            {
+                g_printerr ("error setting style: %s\n", error->message);
+                g_clear_error(&error);
+            }
+        }
+
+        svg = std::make_shared<svg_handle>();
+        svg->handle = std::move(handle);
     }
 
-    rsvg_handle_set_dpi(handle.get(), 96.0);
-
-	if (stylesheet.size() > 0)
-	{
-		bool set_style;
-		set_style = rsvg_handle_set_stylesheet (handle.get(),
-												reinterpret_cast<const uint8_t*>(stylesheet.c_str()),
-												stylesheet.size(),
-												&error);
-		if (!set_style)
-		{
-			g_printerr ("error setting style: %s\n", error->message);
-		}
-		else
-		{
-			//std::cout << "Using style sheet:" << stylesheet << std::endl;
-		}
-	}
-
-    // Get native size to maintain aspect ratio
-    //double native_width, native_height;
-    //rsvg_handle_get_intrinsic_size_in_pixels (handle, &native_width, &native_height);
+    std::error_code ec;
+    std::size_t size = fs::file_size(full_path, ec);
+    size = ec ? 0 : size * HANDLE_SIZE_FACTOR;
 
+    // Failures are cached too, so each one is only reported once; if
+    // another thread parsed it meanwhile, the first copy is kept
+    std::shared_ptr<svg_handle> out;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto inserted = handles_.emplace(key, svg);
+        if (inserted.second && svg != nullptr)
+        {
+            handle_bytes_ += sizeof(svg_handle) + size;
+            report_size();
+        }
+        out = inserted.first->second;
+    }
+
+    budget_.enforce();
+    return out;
+}
+
+bool svg_collection::draw_handle(cairo_t *cr, svg_handle &svg, coord center,
+                                 double width, double height, double rotation)
+{
     // Always render centered on lat/lon.
     // SVG should be set up so the reference marker
     // is at the center of the image
@@ -101,20 +256,110 @@ bool svg_collection::render_svg(cairo_t *cr, std::filesystem::path &svg_path,
 	cairo_translate(cr, center.x, center.y);
 	cairo_rotate(cr, rotation * G_PI / 180.0);
 
-    if (!rsvg_handle_render_document (handle.get(), cr, &viewport, &error))
+    GError *error = NULL;
+    if (!rsvg_handle_render_document (svg.handle.get(), cr, &viewport, &error))
     {
 		g_printerr ("could not render: %s\n", error->message);
-		render_svg_missing(cr, center);
+		g_clear_error(&error);
 		cairo_restore(cr);
 		return false;
     }
 
 	cairo_restore(cr);
-    //std::cout << "Rendered SVG: " << full_path.string() << std::endl;
-
     return true;
 }
 
+cairo_surface_t *svg_collection::get_sprite(const sprite_key &key)
+{
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = sprites_.find(key);
+        if (it != sprites_.end())
+        {
+            return it->second ? cairo_surface_reference(it->second) : nullptr;
+        }
+    }
+
+    // Rasterize outside the cache lock, only the document itself is serialized
+    cairo_surface_t *sprite = nullptr;
+    std::shared_ptr<svg_handle> svg = get_handle(std::get<0>(key), std::get<1>(key));
+    if (svg != nullptr)
+    {
+        double width = std::get<2>(key);
+        double height = std::get<3>(key);
+
+        // Square and even sized, so any rotation fits around an exact center
+        int size = 2 * static_cast<int>(std::ceil(std::hypot(width, height) / 2.0)) + 2;
+        sprite = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+        cairo_t *sc = cairo_create(sprite);
+
+        bool ok;
+        {
+            std::lock_guard<std::mutex> guard(svg->lock);
+            ok = draw_handle(sc, *svg, coord{size / 2.0, size / 2.0},
+                             width, height, std::get<4>(key));
+        }
+        cairo_destroy(sc);
+
+        if (!ok)
+        {
+            cairo_surface_destroy(sprite);
+            sprite = nullptr;
+        }
+    }
+
+    cairo_surface_t *out = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(mutex_);
+        auto it = sprites_.find(key);
+        if (it != sprites_.end())
+        {
+            // Another thread got there first
+            if (sprite != nullptr)
+            {
+                cairo_surface_destroy(sprite);
+            }
+            return it->second ? cairo_surface_reference(it->second) : nullptr;
+        }
+
+        if (sprites_.size() >= MAX_SPRITES || budget_.over())
+        {
+            clear_sprites();
+        }
+
+        sprites_[key] = sprite;
+        if (sprite != nullptr)
+        {
+            sprite_bytes_ += cairo_image_surface_get_stride(sprite) *
+                cairo_image_surface_get_height(sprite);
+            report_size();
+            out = cairo_surface_reference(sprite);
+        }
+    }
+
+    budget_.enforce();
+    return out;
+}
+
+void svg_collection::clear_sprites()
+{
+    for (auto &old : sprites_)
+    {
+        if (old.second != nullptr)
+        {
+            cairo_surface_destroy(old.second);
+        }
+    }
+    sprites_.clear();
+    sprite_bytes_ = 0;
+    report_size();
+}
+
+void svg_collection::report_size()
+{
+    budget_.report(sprite_bytes_ + handle_bytes_);
+}
+
 /**
  * Plot a Big ? when we cant render an SVG
  */
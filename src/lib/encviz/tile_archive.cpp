@@ -0,0 +1,63 @@
+/**
+ * \file
+ * \brief Tile Archive
+ *
+ * Single file archives of rendered tiles (MBTiles or PMTiles), for rendering
+ * once and serving static tiles without the S-57 charts.
+ */
+
+#include <stdexcept>
+#include <encviz/tile_archive.h>
+#include <encviz/mbtiles.h>
+#include <encviz/pmtiles.h>
+
+namespace fs = std::filesystem;
+
+namespace encviz
+{
+
+/**
+ * Create Tile Archive
+ *
+ * \param[in] path Archive to create (".mbtiles" or ".pmtiles")
+ * \param[in] info Archive description
+ * \param[in] keep_existing Add to an existing archive, if the format allows
+ * \return Archive writer
+ */
+std::unique_ptr<tile_archive_writer> create_tile_archive(const fs::path &path,
+                                                         const archive_info &info,
+                                                         bool keep_existing)
+{
+    if (path.extension() == ".mbtiles")
+    {
+        return std::make_unique<mbtiles_writer>(path, info, keep_existing);
+    }
+    else if (path.extension() == ".pmtiles")
+    {
+        return std::make_unique<pmtiles_writer>(path, info);
+    }
+    throw std::runtime_error("Unknown tile archive type (.mbtiles or .pmtiles): " +
+                             path.string());
+}
+
+/**
+ * Open Tile Archive
+ *
+ * \param[in] path Archive to serve (".mbtiles" or ".pmtiles")
+ * \return Archive reader
+ */
+std::unique_ptr<tile_archive_reader> open_tile_archive(const fs::path &path)
+{
+    if (path.extension() == ".mbtiles")
+    {
+        return std::make_unique<mbtiles_reader>(path);
+    }
+    else if (path.extension() == ".pmtiles")
+    {
+        return std::make_unique<pmtiles_reader>(path);
+    }
+    throw std::runtime_error("Unknown tile archive type (.mbtiles or .pmtiles): " +
+                             path.string());
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,534 @@
+/**
+ * \file
+ * \brief Tile Cache
+ *
+ * Two tier (memory + disk) cache of encoded tile images, so tiles are only
+ * re-rendered when the underlying chart set changes.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <encviz/tile_cache.h>
+
+namespace fs = std::filesystem;
+
+// Extended attribute holding the entity tag of a tile on disk
+#define ETAG_XATTR "user.encviz.etag"
+
+namespace encviz
+{
+
+/**
+ * Destructor
+ *
+ * Closes the tile file, if any.
+ */
+tile_blob::~tile_blob()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/**
+ * Constructor
+ */
+tile_cache::tile_cache()
+    : max_bytes_(0)
+{
+}
+
+/**
+ * Set Memory Size Limit
+ *
+ * \param[in] max_bytes Maximum size of tiles held in memory (0 disables)
+ */
+void tile_cache::set_memory_limit(std::size_t max_bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_bytes_ = max_bytes;
+    evict();
+}
+
+/**
+ * Share Memory Budget
+ *
+ * \param[in] budget Budget the memory tier counts against (must outlive the cache)
+ * \param[in] weight Relative share of budget
+ */
+void tile_cache::set_budget(memory_budget &budget, double weight)
+{
+    budget_.attach(budget, "tiles", weight, [this]() { trim(); });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_.report(stats_.bytes);
+}
+
+/**
+ * Set Disk Cache Location
+ *
+ * \param[in] path Tile directory (empty disables)
+ */
+void tile_cache::set_disk_path(const fs::path &path)
+{
+    disk_path_ = path;
+}
+
+/**
+ * Check Disk Tier
+ *
+ * \return False if tiles are only kept in memory
+ */
+bool tile_cache::has_disk() const
+{
+    return !disk_path_.empty();
+}
+
+/**
+ * Set Chart Set Generation
+ *
+ * Any cached tiles from a different generation are discarded.
+ *
+ * \param[in] generation Chart set generation id
+ */
+void tile_cache::set_generation(const std::string &generation)
+{
+    // Drop memory tier
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lru_.clear();
+        index_.clear();
+        stats_.bytes = 0;
+        evict();
+    }
+
+    if (disk_path_.empty())
+    {
+        return;
+    }
+
+    // Check generation of what's on disk
+    fs::path gen_path = disk_path_ / "GENERATION";
+    std::string disk_generation;
+    {
+        std::ifstream handle(gen_path.string().c_str());
+        handle >> disk_generation;
+    }
+    if (disk_generation == generation)
+    {
+        return;
+    }
+
+    // Refuse to clear out a directory we didn't create
+    std::error_code ec;
+    if (disk_generation.empty() && fs::exists(disk_path_, ec) &&
+        !fs::is_empty(disk_path_, ec))
+    {
+        printf("Tile cache %s is not empty and has no GENERATION file, disk cache disabled\n",
+               disk_path_.string().c_str());
+        disk_path_.clear();
+        return;
+    }
+
+    // Charts have changed, tiles on disk are stale
+    printf("Tile cache generation %s -> %s, clearing %s\n",
+           disk_generation.empty() ? "(none)" : disk_generation.c_str(),
+           generation.c_str(), disk_path_.string().c_str());
+    if (fs::exists(disk_path_, ec))
+    {
+        for (const fs::directory_entry &entry : fs::directory_iterator(disk_path_, ec))
+        {
+            fs::remove_all(entry.path(), ec);
+        }
+    }
+    fs::create_directories(disk_path_, ec);
+    std::ofstream handle(gen_path.string().c_str());
+    handle << generation << "\n";
+}
+
+/**
+ * Parse Tile Coordinate From File Name
+ *
+ * \param[in] name Directory or file name ("12", "34.png")
+ * \param[out] value Leading integer
+ * \return False if the name does not start with a number
+ */
+static bool parse_coord(const std::string &name, int &value)
+{
+    char *end = nullptr;
+    long parsed = strtol(name.c_str(), &end, 10);
+    if (end == name.c_str() || (*end != '\0' && *end != '.'))
+    {
+        return false;
+    }
+    value = (int)parsed;
+    return true;
+}
+
+/**
+ * Drop Tiles Over Changed Charts
+ *
+ * Removes the tiles from both tiers, in every style and format, then
+ * records the new generation on disk so the rest stay valid.
+ *
+ * \param[in] ranges Stale tiles
+ * \param[in] generation New chart set generation id
+ * \return Number of tiles dropped (a tile in both tiers counts once)
+ */
+std::size_t tile_cache::invalidate(const std::vector<tile_range> &ranges,
+                                   const std::string &generation)
+{
+    auto stale = [&](const tile_key &key) {
+        for (const tile_range &range : ranges)
+        {
+            if (range.contains(key))
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Memory tier, keys are the tile paths under disk_path_
+    std::unordered_set<std::string> in_memory;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = lru_.begin(); it != lru_.end(); )
+        {
+            if (stale(it->coords))
+            {
+                stats_.bytes -= it->tile->data.size();
+                index_.erase(it->key);
+                in_memory.insert(std::move(it->key));
+                it = lru_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        evict();
+    }
+
+    std::size_t dropped = in_memory.size();
+    if (disk_path_.empty())
+    {
+        return dropped;
+    }
+
+    // Disk tier, only listing the zoom and column directories in range
+    std::error_code ec;
+    for (const fs::directory_entry &style : fs::directory_iterator(disk_path_, ec))
+    {
+        if (!style.is_directory(ec))
+        {
+            continue;
+        }
+        for (const tile_range &range : ranges)
+        {
+            fs::path zoom_dir = style.path() / std::to_string(range.z);
+            for (const fs::directory_entry &column : fs::directory_iterator(zoom_dir, ec))
+            {
+                int x = 0;
+                if (!parse_coord(column.path().filename().string(), x) ||
+                    x < range.x0 || x > range.x1)
+                {
+                    continue;
+                }
+                for (const fs::directory_entry &file : fs::directory_iterator(column.path(), ec))
+                {
+                    int y = 0;
+                    if (parse_coord(file.path().filename().string(), y) &&
+                        y >= range.y0 && y <= range.y1 && fs::remove(file.path(), ec))
+                    {
+                        // Already counted if it was in memory too
+                        std::string key = file.path().lexically_relative(disk_path_).string();
+                        if (in_memory.count(key) == 0)
+                        {
+                            dropped++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Remaining tiles on disk belong to the new generation
+    fs::path gen_path = disk_path_ / "GENERATION";
+    fs::path tmp_path = gen_path.string() + ".tmp";
+    {
+        std::ofstream handle(tmp_path.string().c_str());
+        handle << generation << "\n";
+    }
+    fs::rename(tmp_path, gen_path, ec);
+
+    return dropped;
+}
+
+/**
+ * Look Up Tile
+ *
+ * \param[in] key Tile key
+ * \param[in] as_file Disk hits may be returned as an open file (fd) rather
+ *                    than read in, for sendfile; they skip the memory tier
+ * \return Cached tile, or null if not cached
+ */
+tile_ptr tile_cache::get(const tile_key &key, bool as_file)
+{
+    std::string mkey = key_string(key);
+
+    // Memory first
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(mkey);
+        if (it != index_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            stats_.memory_hits++;
+            return it->second->tile;
+        }
+    }
+
+    // Then disk
+    int fd = -1;
+    if (!disk_path_.empty())
+    {
+        fd = open(disk_path(key).string().c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    struct stat info;
+    if (fd >= 0 && fstat(fd, &info) == 0)
+    {
+        auto blob = std::make_shared<tile_blob>();
+        blob->size = info.st_size;
+        blob->modified = info.st_mtime;
+
+        // Tag saved with the tile, so it can be sent without reading it
+        char etag[64];
+        ssize_t len = as_file ? fgetxattr(fd, ETAG_XATTR, etag, sizeof(etag)) : -1;
+        if (len > 0)
+        {
+            blob->etag.assign(etag, len);
+            blob->fd = fd;
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.disk_hits++;
+            return blob;
+        }
+
+        // Otherwise read it in and keep it in memory
+        blob->data.resize(blob->size);
+        std::size_t done = 0;
+        while (done < blob->size)
+        {
+            ssize_t got = read(fd, blob->data.data() + done, blob->size - done);
+            if (got <= 0)
+            {
+                break;
+            }
+            done += got;
+        }
+        close(fd);
+        fd = -1;
+        if (done == blob->size)
+        {
+            blob->etag = make_etag(blob->data);
+            insert_memory(key, blob);
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.disk_hits++;
+            return blob;
+        }
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.misses++;
+    return nullptr;
+}
+
+/**
+ * Store Tile
+ *
+ * \param[in] key Tile key
+ * \param[in] data Encoded image bytes
+ * \return Stored tile
+ */
+tile_ptr tile_cache::put(const tile_key &key, std::vector<uint8_t> data)
+{
+    tile_ptr blob = make_tile(std::move(data));
+    insert_memory(key, blob);
+
+    if (!disk_path_.empty())
+    {
+        // Write to a temp file and rename, so readers never see partial tiles
+        fs::path path = disk_path(key);
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        std::ostringstream tmp_name;
+        tmp_name << path.string() << ".tmp" << std::this_thread::get_id();
+        fs::path tmp_path = tmp_name.str();
+        {
+            std::ofstream handle(tmp_path.string().c_str(), std::ios::binary);
+            handle.write((const char*)blob->data.data(), blob->data.size());
+        }
+
+        // Not every filesystem takes user attributes, those tiles are read in
+        setxattr(tmp_path.string().c_str(), ETAG_XATTR, blob->etag.data(), blob->etag.size(), 0);
+        fs::rename(tmp_path, path, ec);
+        if (ec)
+        {
+            printf("Cannot write tile cache %s: %s\n",
+                   path.string().c_str(), ec.message().c_str());
+            fs::remove(tmp_path, ec);
+        }
+    }
+
+    return blob;
+}
+
+/**
+ * Get Usage Counters
+ *
+ * \return Snapshot of cache counters
+ */
+tile_cache::stats tile_cache::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+/**
+ * Wrap Tile Without Storing
+ *
+ * \param[in] data Encoded image bytes
+ * \return Tile
+ */
+tile_ptr tile_cache::make_tile(std::vector<uint8_t> data)
+{
+    auto blob = std::make_shared<tile_blob>();
+    blob->data = std::move(data);
+    blob->size = blob->data.size();
+    blob->etag = make_etag(blob->data);
+    blob->modified = time(nullptr);
+    return blob;
+}
+
+/**
+ * Memory Cache Key
+ *
+ * \param[in] key Tile key
+ * \return Key string "style/z/x/y.ext"
+ */
+std::string tile_cache::key_string(const tile_key &key)
+{
+    return key.style + "/" + std::to_string(key.z) + "/" +
+        std::to_string(key.x) + "/" + std::to_string(key.y) + "." +
+        tile_format_extension(key.format);
+}
+
+/**
+ * Disk Cache Path
+ *
+ * \param[in] key Tile key
+ * \return Path to tile on disk
+ */
+fs::path tile_cache::disk_path(const tile_key &key) const
+{
+    return disk_path_ / key.style / std::to_string(key.z) /
+        std::to_string(key.x) / (std::to_string(key.y) + "." + tile_format_extension(key.format));
+}
+
+/**
+ * Insert Into Memory Tier
+ *
+ * \param[in] key Tile key
+ * \param[in] tile Tile data
+ */
+void tile_cache::insert_memory(const tile_key &key, const tile_ptr &tile)
+{
+    std::string mkey = key_string(key);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (max_bytes_ == 0)
+        {
+            return;
+        }
+
+        // Replace any existing copy
+        auto it = index_.find(mkey);
+        if (it != index_.end())
+        {
+            stats_.bytes -= it->second->tile->data.size();
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+
+        lru_.push_front({mkey, key, tile});
+        index_[mkey] = lru_.begin();
+        stats_.bytes += tile->data.size();
+        evict();
+    }
+
+    budget_.enforce();
+}
+
+/**
+ * Evict Tiles Until Under Size Limit
+ *
+ * \note Caller must hold mutex_
+ */
+void tile_cache::evict()
+{
+    while (!lru_.empty() && (stats_.bytes > max_bytes_ || budget_.over()))
+    {
+        // Least recently used is at the back
+        entry &e = lru_.back();
+        stats_.bytes -= e.tile->data.size();
+        stats_.evictions++;
+        index_.erase(e.key);
+        lru_.pop_back();
+        budget_.report(stats_.bytes);
+    }
+    stats_.entries = lru_.size();
+    budget_.report(stats_.bytes);
+}
+
+/**
+ * Evict Tiles for Memory Budget
+ */
+void tile_cache::trim()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict();
+}
+
+/**
+ * Compute Entity Tag
+ *
+ * \param[in] data Encoded image bytes
+ * \return Quoted 64 bit FNV-1a hash of the data
+ */
+std::string make_etag(const std::vector<uint8_t> &data)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint8_t byte : data)
+    {
+        hash ^= byte;
+        hash *= 0x100000001b3ULL;
+    }
+    char text[24];
+    snprintf(text, sizeof(text), "\"%016lx\"", (unsigned long)hash);
+    return text;
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,75 @@
+/**
+ * \file
+ * \brief Tile Data
+ *
+ * Features selected for a single tile, handed from the chart dataset to the
+ * renderer without going through an intermediate GDAL dataset.
+ */
+
+#include <encviz/tile_data.h>
+
+namespace encviz
+{
+
+/**
+ * Constructor
+ */
+tile_data::tile_data()
+    : arena_(64 * 1024)
+{
+}
+
+/**
+ * Add Layer
+ *
+ * \param[in] name S57 layer name
+ * \return Layer (existing one if already added)
+ */
+tile_data::layer &tile_data::add_layer(const std::string &name)
+{
+    auto it = layers_.find(name);
+    if (it == layers_.end())
+    {
+        it = layers_.emplace(name, layer(&arena_)).first;
+    }
+    return it->second;
+}
+
+/**
+ * Get Layer
+ *
+ * \param[in] name S57 layer name
+ * \return Layer, or null if not exported
+ */
+const tile_data::layer *tile_data::get_layer(const std::string &name) const
+{
+    auto it = layers_.find(name);
+    return (it == layers_.end()) ? nullptr : &it->second;
+}
+
+/**
+ * Keep Chart Alive
+ *
+ * Features borrow geometry and attributes from their chart store, which
+ * must outlive this tile even if dropped from the chart cache.
+ *
+ * \param[in] store Compiled chart
+ */
+void tile_data::hold(std::shared_ptr<const chart_store> store)
+{
+    charts_.push_back(std::move(store));
+}
+
+/**
+ * Take Ownership of Derived Geometry
+ *
+ * \param[in] geo Geometry created for this tile (clip, union, ...)
+ * \return Same geometry, valid for the life of this tile
+ */
+const OGRGeometry *tile_data::keep(OGRGeometry *geo)
+{
+    owned_.emplace_back(geo);
+    return geo;
+}
+
+}; // ~namespace encviz
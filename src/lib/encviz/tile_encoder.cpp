@@ -0,0 +1,446 @@
+/**
+ * \file
+ * \brief Tile Encoder
+ *
+ * Encodes rendered (cairo ARGB32) tiles to PNG or WebP, replacing cairo's
+ * fixed-setting PNG writer with a tunable one. Vector tiles (MVT) share the
+ * tile format plumbing, but are built by mvt_encoder instead.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+#include <png.h>
+#ifdef ENCVIZ_HAVE_WEBP
+#include <webp/encode.h>
+#endif
+#include <encviz/tile_encoder.h>
+
+namespace encviz
+{
+
+/// Most colors in a palette image
+static const std::size_t MAX_PALETTE = 256;
+
+/**
+ * Parse Tile Format
+ *
+ * \param[in] ext File extension (without dot, ie - "png")
+ * \param[out] fmt Tile format
+ * \return False if extension is not a known tile format
+ */
+bool parse_tile_format(std::string_view ext, tile_format &fmt)
+{
+    if (ext == "png")
+    {
+        fmt = tile_format::PNG;
+        return true;
+    }
+    if (ext == "webp")
+    {
+        fmt = tile_format::WEBP;
+        return true;
+    }
+    if (ext == "mvt" || ext == "pbf")
+    {
+        fmt = tile_format::MVT;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Tile Format File Extension
+ *
+ * \param[in] fmt Tile format
+ * \return Extension without dot (ie - "png")
+ */
+const char *tile_format_extension(tile_format fmt)
+{
+    switch (fmt)
+    {
+        case tile_format::WEBP:
+            return "webp";
+        case tile_format::MVT:
+            return "mvt";
+        default:
+            return "png";
+    }
+}
+
+/**
+ * Tile Format MIME Type
+ *
+ * \param[in] fmt Tile format
+ * \return MIME type (ie - "image/png")
+ */
+const char *tile_format_mime(tile_format fmt)
+{
+    switch (fmt)
+    {
+        case tile_format::WEBP:
+            return "image/webp";
+        case tile_format::MVT:
+            return "application/vnd.mapbox-vector-tile";
+        default:
+            return "image/png";
+    }
+}
+
+/**
+ * libpng Write Callback
+ *
+ * \param[in] png PNG context (io pointer is a std::vector<uint8_t>)
+ * \param[in] buf Data buffer
+ * \param[in] len Length of data buffer
+ */
+static void png_write_vector(png_structp png, png_bytep buf, png_size_t len)
+{
+    std::vector<uint8_t> *output = (std::vector<uint8_t>*)png_get_io_ptr(png);
+    output->insert(output->end(), buf, buf + len);
+}
+
+/**
+ * Packed RGBA Color
+ *
+ * \param[in] px Straight alpha RGBA pixel
+ * \return Color, with all fully transparent pixels folded together
+ */
+static uint32_t pack_rgba(const uint8_t *px)
+{
+    if (px[3] == 0)
+    {
+        return 0;
+    }
+    return uint32_t(px[0]) | (uint32_t(px[1]) << 8) |
+        (uint32_t(px[2]) << 16) | (uint32_t(px[3]) << 24);
+}
+
+/**
+ * Squared Distance Between Packed Colors
+ *
+ * Alpha is weighted up, a wrong edge color is less visible than a hole.
+ */
+static uint32_t color_distance(uint32_t a, uint32_t b)
+{
+    uint32_t dist = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        int d = int((a >> shift) & 0xff) - int((b >> shift) & 0xff);
+        dist += (shift == 24) ? 4 * d * d : d * d;
+    }
+    return dist;
+}
+
+/**
+ * Reduce Image to a Palette
+ *
+ * Images with few colors are kept exact, otherwise the most used colors
+ * become the palette and the rest map to their nearest entry.
+ *
+ * \param[in] rgba Straight alpha RGBA pixels
+ * \param[in] npixels Number of pixels
+ * \param[out] palette Packed colors, translucent ones first
+ * \param[out] indices Palette index per pixel
+ * \return Number of translucent palette entries
+ */
+static std::size_t quantize(const uint8_t *rgba, std::size_t npixels,
+                            std::vector<uint32_t> &palette,
+                            std::vector<uint8_t> &indices)
+{
+    // Histogram
+    std::unordered_map<uint32_t, uint32_t> counts;
+    for (std::size_t i = 0; i < npixels; i++)
+    {
+        counts[pack_rgba(rgba + 4 * i)]++;
+    }
+
+    // Most used colors
+    std::vector<std::pair<uint32_t, uint32_t>> by_count(counts.begin(), counts.end());
+    if (by_count.size() > MAX_PALETTE)
+    {
+        std::partial_sort(by_count.begin(), by_count.begin() + MAX_PALETTE, by_count.end(),
+                          [](const auto &a, const auto &b) { return a.second > b.second; });
+        by_count.resize(MAX_PALETTE);
+    }
+
+    // Translucent entries first, so the tRNS chunk can stop early
+    palette.clear();
+    for (const auto &it : by_count)
+    {
+        palette.push_back(it.first);
+    }
+    auto opaque = std::stable_partition(palette.begin(), palette.end(),
+                                        [](uint32_t c) { return (c >> 24) != 0xff; });
+
+    // Map every color in the image (reusing the histogram)
+    for (std::size_t i = 0; i < palette.size(); i++)
+    {
+        counts[palette[i]] = i;
+    }
+    for (auto &it : counts)
+    {
+        auto pos = std::find(palette.begin(), palette.end(), it.first);
+        if (pos != palette.end())
+        {
+            continue;
+        }
+
+        uint32_t best = 0;
+        uint32_t best_dist = UINT32_MAX;
+        for (std::size_t i = 0; i < palette.size(); i++)
+        {
+            uint32_t dist = color_distance(it.first, palette[i]);
+            if (dist < best_dist)
+            {
+                best = i;
+                best_dist = dist;
+            }
+        }
+        it.second = best;
+    }
+
+    indices.resize(npixels);
+    uint32_t last_color = pack_rgba(rgba);
+    uint8_t last_index = counts[last_color];
+    for (std::size_t i = 0; i < npixels; i++)
+    {
+        // Runs of one color are the common case
+        uint32_t color = pack_rgba(rgba + 4 * i);
+        if (color != last_color)
+        {
+            last_color = color;
+            last_index = counts[color];
+        }
+        indices[i] = last_index;
+    }
+
+    return opaque - palette.begin();
+}
+
+/**
+ * Set Encoder Settings
+ *
+ * \param[in] opts Encoder settings
+ */
+void tile_encoder::set_options(const options &opts)
+{
+    opts_ = opts;
+    opts_.png_level = std::clamp(opts_.png_level, 0, 9);
+    opts_.webp_quality = std::clamp(opts_.webp_quality, 0, 100);
+}
+
+/**
+ * Check Format Support
+ *
+ * \param[in] fmt Tile format
+ * \return False if this build can't encode the format
+ */
+bool tile_encoder::supports(tile_format fmt)
+{
+#ifdef ENCVIZ_HAVE_WEBP
+    (void)fmt;
+    return true;
+#else
+    return fmt != tile_format::WEBP;
+#endif
+}
+
+/**
+ * Encode Tile Image
+ *
+ * \param[out] data Encoded image bytes
+ * \param[in] surface Rendered ARGB32 image surface
+ * \param[in] fmt Output format
+ * \return False on encode error
+ */
+bool tile_encoder::encode(std::vector<uint8_t> &data, cairo_surface_t *surface,
+                          tile_format fmt) const
+{
+    if (cairo_image_surface_get_format(surface) != CAIRO_FORMAT_ARGB32)
+    {
+        printf("Tile encode error: not an ARGB32 surface\n");
+        return false;
+    }
+
+    cairo_surface_flush(surface);
+    return encode(data, cairo_image_surface_get_data(surface),
+                  cairo_image_surface_get_width(surface),
+                  cairo_image_surface_get_height(surface),
+                  cairo_image_surface_get_stride(surface), fmt);
+}
+
+/**
+ * Encode Raw Image
+ *
+ * \param[out] data Encoded image bytes
+ * \param[in] pixels Native endian, premultiplied ARGB32 pixels
+ * \param[in] width Image width (pixels)
+ * \param[in] height Image height (pixels)
+ * \param[in] stride Bytes per row
+ * \param[in] fmt Output format
+ * \return False on encode error
+ */
+bool tile_encoder::encode(std::vector<uint8_t> &data, const uint8_t *pixels,
+                          int width, int height, int stride, tile_format fmt) const
+{
+    if (fmt == tile_format::MVT)
+    {
+        printf("Tile encode error: vector tiles are not encoded from images\n");
+        return false;
+    }
+
+    // Both encoders take straight alpha RGBA, convert into a per-thread buffer
+    thread_local std::vector<uint8_t> rgba;
+    rgba.resize(std::size_t(width) * height * 4);
+    for (int row = 0; row < height; row++)
+    {
+        const uint32_t *src = (const uint32_t*)(pixels + std::size_t(row) * stride);
+        uint8_t *dst = rgba.data() + std::size_t(row) * width * 4;
+        for (int col = 0; col < width; col++, dst += 4)
+        {
+            uint32_t argb = src[col];
+            uint32_t a = argb >> 24;
+            if (a == 0)
+            {
+                dst[0] = dst[1] = dst[2] = dst[3] = 0;
+                continue;
+            }
+            dst[0] = (((argb >> 16) & 0xff) * 255 + a / 2) / a;
+            dst[1] = (((argb >> 8) & 0xff) * 255 + a / 2) / a;
+            dst[2] = ((argb & 0xff) * 255 + a / 2) / a;
+            dst[3] = a;
+        }
+    }
+
+    // Typical tiles compress well under one byte per pixel
+    data.clear();
+    data.reserve(std::size_t(width) * height);
+
+    if (fmt == tile_format::WEBP)
+    {
+        return encode_webp(data, rgba.data(), width, height);
+    }
+    return encode_png(data, rgba.data(), width, height);
+}
+
+/**
+ * Encode RGBA Image as PNG
+ *
+ * \param[out] data Encoded image bytes
+ * \param[in] rgba Straight alpha RGBA pixels (width * 4 bytes per row)
+ * \param[in] width Image width (pixels)
+ * \param[in] height Image height (pixels)
+ * \return False on encode error
+ */
+bool tile_encoder::encode_png(std::vector<uint8_t> &data, const uint8_t *rgba,
+                              int width, int height) const
+{
+    // Everything with a destructor lives outside the setjmp() scope
+    std::vector<uint32_t> palette;
+    std::vector<uint8_t> indices;
+    std::vector<png_color> plte;
+    std::vector<png_byte> trns;
+    std::vector<png_bytep> rows(height);
+
+    std::size_t ntrans = 0;
+    if (opts_.png_palette)
+    {
+        ntrans = quantize(rgba, std::size_t(width) * height, palette, indices);
+        for (uint32_t c : palette)
+        {
+            plte.push_back(png_color{png_byte(c), png_byte(c >> 8), png_byte(c >> 16)});
+            trns.push_back(png_byte(c >> 24));
+        }
+        for (int row = 0; row < height; row++)
+        {
+            rows[row] = indices.data() + std::size_t(row) * width;
+        }
+    }
+    else
+    {
+        for (int row = 0; row < height; row++)
+        {
+            rows[row] = (png_bytep)rgba + std::size_t(row) * width * 4;
+        }
+    }
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (png == nullptr)
+    {
+        return false;
+    }
+    png_infop info = png_create_info_struct(png);
+    if (info == nullptr || setjmp(png_jmpbuf(png)))
+    {
+        printf("PNG encode error\n");
+        png_destroy_write_struct(&png, &info);
+        return false;
+    }
+
+    png_set_write_fn(png, &data, png_write_vector, nullptr);
+    png_set_compression_level(png, opts_.png_level);
+    if (opts_.png_palette)
+    {
+        png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_PALETTE,
+                     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+                     PNG_FILTER_TYPE_DEFAULT);
+        png_set_PLTE(png, info, plte.data(), plte.size());
+        if (ntrans > 0)
+        {
+            png_set_tRNS(png, info, trns.data(), ntrans, nullptr);
+        }
+
+        // Indexed rows don't benefit from prediction filters
+        png_set_filter(png, 0, PNG_FILTER_NONE);
+    }
+    else
+    {
+        png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+                     PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT,
+                     PNG_FILTER_TYPE_DEFAULT);
+
+        // Adaptive filtering costs more than it saves at low levels
+        png_set_filter(png, 0, (opts_.png_level <= 3) ? PNG_FILTER_SUB : PNG_ALL_FILTERS);
+    }
+
+    png_write_info(png, info);
+    png_write_image(png, rows.data());
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return true;
+}
+
+/**
+ * Encode RGBA Image as WebP
+ *
+ * \param[out] data Encoded image bytes
+ * \param[in] rgba Straight alpha RGBA pixels (width * 4 bytes per row)
+ * \param[in] width Image width (pixels)
+ * \param[in] height Image height (pixels)
+ * \return False on encode error
+ */
+bool tile_encoder::encode_webp(std::vector<uint8_t> &data, const uint8_t *rgba,
+                               int width, int height) const
+{
+#ifdef ENCVIZ_HAVE_WEBP
+    uint8_t *output = nullptr;
+    std::size_t size = (opts_.webp_quality >= 100) ?
+        WebPEncodeLosslessRGBA(rgba, width, height, width * 4, &output) :
+        WebPEncodeRGBA(rgba, width, height, width * 4, opts_.webp_quality, &output);
+    if (size == 0)
+    {
+        printf("WebP encode error\n");
+        WebPFree(output);
+        return false;
+    }
+    data.assign(output, output + size);
+    WebPFree(output);
+    return true;
+#else
+    printf("WebP encode error: built without libwebp\n");
+    return false;
+#endif
+}
+
+}; // ~namespace encviz
@@ -0,0 +1,201 @@
+/**
+ * \file
+ * \brief Tile Prefetcher
+ *
+ * Renders the neighbors and children of requested tiles into the tile
+ * cache as background work, rate limited per client.
+ */
+
+#include <algorithm>
+#include <encviz/log.h>
+#include <encviz/tile_prefetcher.h>
+
+/// Busy clients are forgotten 1 in this many at a time
+#define PRUNE_FRACTION 8
+
+namespace encviz
+{
+
+/**
+ * Constructor
+ *
+ * \param[in] pool Workers, prefetches use their background queue
+ * \param[in] fetch Tile render routine
+ * \param[in] opts Prefetch limits
+ */
+tile_prefetcher::tile_prefetcher(worker_pool &pool, fetch_fn fetch, const options &opts)
+    : pool_(pool), fetch_(std::move(fetch)), opts_(opts)
+{
+}
+
+/**
+ * Note Requested Tile
+ *
+ * \param[in] client Client identity (ie - address)
+ * \param[in] key Requested tile
+ */
+void tile_prefetcher::requested(const std::string &client, const tile_key &key)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::vector<tile_key> next = around(key, opts_.max_zoom);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Refill the client's budget for the time since its last request
+    auto found = buckets_.find(client);
+    if (found == buckets_.end())
+    {
+        if (buckets_.size() >= opts_.max_clients)
+        {
+            prune(now);
+        }
+        found = buckets_.emplace(client, bucket{opts_.burst, now}).first;
+    }
+    bucket &b = found->second;
+    double seconds = std::chrono::duration<double>(now - b.updated).count();
+    b.tokens = std::min(opts_.burst, b.tokens + seconds * opts_.rate);
+    b.updated = now;
+
+    for (const tile_key &tile : next)
+    {
+        std::string name = tile_cache::key_string(tile);
+        if (pending_.count(name) != 0)
+        {
+            // Already on its way
+            continue;
+        }
+        if (b.tokens < 1)
+        {
+            limited_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        bool queued = pool_.try_submit_background([this, tile, name]() {
+            try
+            {
+                fetch_(tile);
+            }
+            catch (const std::exception &e)
+            {
+                ENCVIZ_LOG(warn, "Prefetch of %s failed: %s\n", name.c_str(), e.what());
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.erase(name);
+        });
+        if (!queued)
+        {
+            // Workers are behind, the rest would be dropped too
+            full_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+        pending_.insert(name);
+        b.tokens -= 1;
+        queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Get Prefetch Counts
+ *
+ * \return Counts since startup
+ */
+tile_prefetcher::stats tile_prefetcher::get_stats() const
+{
+    return {queued_.load(std::memory_order_relaxed),
+            limited_.load(std::memory_order_relaxed),
+            full_.load(std::memory_order_relaxed)};
+}
+
+/**
+ * Tiles Likely Requested Next
+ *
+ * \param[in] key Requested tile
+ * \param[in] max_zoom Deepest zoom of children
+ * \return The 8 neighbors (wrapping east-west), then the 4 children
+ */
+std::vector<tile_key> tile_prefetcher::around(const tile_key &key, int max_zoom)
+{
+    std::vector<tile_key> tiles;
+    int n = 1 << key.z;
+
+    // Panning, the ring around the tile
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            tile_key tile = key;
+            tile.x = (key.x + dx + n) % n;
+            tile.y = key.y + dy;
+            bool same = (tile.x == key.x && tile.y == key.y);
+            bool duplicate = std::any_of(tiles.begin(), tiles.end(), [&](const tile_key &t) {
+                return t.x == tile.x && t.y == tile.y;
+            });
+            if (tile.y >= 0 && tile.y < n && !same && !duplicate)
+            {
+                tiles.push_back(tile);
+            }
+        }
+    }
+
+    // Zooming in, the four children
+    if (key.z < max_zoom)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            tile_key tile = key;
+            tile.z = key.z + 1;
+            tile.x = 2 * key.x + (i & 1);
+            tile.y = 2 * key.y + (i >> 1);
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+/**
+ * Forget Idle Clients
+ *
+ * \param[in] now Current time
+ *
+ * \note Call with mutex_ held.
+ */
+void tile_prefetcher::prune(std::chrono::steady_clock::time_point now)
+{
+    // Clients whose budget has refilled are no different from new ones
+    for (auto it = buckets_.begin(); it != buckets_.end(); )
+    {
+        double seconds = std::chrono::duration<double>(now - it->second.updated).count();
+        if (it->second.tokens + seconds * opts_.rate >= opts_.burst)
+        {
+            it = buckets_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // All busy, forget the longest idle, a few at a time so a flood of new
+    // clients doesn't rescan the table on every request
+    if (buckets_.size() >= opts_.max_clients)
+    {
+        std::vector<std::unordered_map<std::string, bucket>::iterator> idle;
+        idle.reserve(buckets_.size());
+        for (auto it = buckets_.begin(); it != buckets_.end(); ++it)
+        {
+            idle.push_back(it);
+        }
+
+        std::size_t count = std::max<std::size_t>(1, idle.size() / PRUNE_FRACTION);
+        std::nth_element(idle.begin(), idle.begin() + (count - 1), idle.end(),
+                         [](const auto &a, const auto &b) {
+                             return a->second.updated < b->second.updated;
+                         });
+        for (std::size_t i = 0; i < count; i++)
+        {
+            buckets_.erase(idle[i]);
+        }
+    }
+}
+
+}; // ~namespace encviz
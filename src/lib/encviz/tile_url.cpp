@@ -0,0 +1,117 @@
+/**
+ * \file
+ * \brief Tile URL Parser
+ *
+ * Parses tile request paths (/<STYLE>/{z}/{y}/{x}[.ext]) in place.
+ */
+
+#include <charconv>
+#include <encviz/tile_url.h>
+
+namespace encviz
+{
+
+/**
+ * Take Next Path Segment
+ *
+ * \param[in,out] path Remaining path, advanced past the segment and its '/'
+ * \param[out] seg Segment
+ * \return False if no segment is left
+ */
+static bool next_segment(std::string_view &path, std::string_view &seg)
+{
+    if (path.empty())
+    {
+        return false;
+    }
+    std::size_t slash = path.find('/');
+    seg = path.substr(0, slash);
+    path = (slash == std::string_view::npos) ? std::string_view() : path.substr(slash + 1);
+    return true;
+}
+
+/**
+ * Parse Tile Coordinate
+ *
+ * \param[in] seg Decimal digits only
+ * \param[out] value Parsed value
+ * \return False if not a number
+ */
+static bool parse_coord(std::string_view seg, int &value)
+{
+    if (seg.empty() || seg[0] < '0' || seg[0] > '9')
+    {
+        return false;
+    }
+    auto result = std::from_chars(seg.data(), seg.data() + seg.size(), value);
+    return result.ec == std::errc() && result.ptr == seg.data() + seg.size();
+}
+
+/**
+ * Parse Tile URL
+ *
+ * \param[in] path Request path (without query string)
+ * \param[out] url Parsed tile, valid while path is
+ * \return Parse result, url is only set on OK
+ */
+tile_url_status parse_tile_url(std::string_view path, tile_url &url)
+{
+    if (path.size() < 2 || path.front() != '/' || path.back() == '/')
+    {
+        return tile_url_status::INVALID;
+    }
+    path.remove_prefix(1);
+
+    std::string_view style, z, y, x;
+    if (!next_segment(path, style) || !next_segment(path, z) ||
+        !next_segment(path, y) || !next_segment(path, x) || !path.empty())
+    {
+        return tile_url_status::INVALID;
+    }
+
+    // Style name ends up in cache paths
+    if (style.empty() || style.size() > tile_url::MAX_STYLE)
+    {
+        return tile_url_status::INVALID;
+    }
+    for (char ch : style)
+    {
+        bool ok = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+            (ch >= '0' && ch <= '9') || ch == '_' || ch == '-';
+        if (!ok)
+        {
+            return tile_url_status::INVALID;
+        }
+    }
+
+    // Image format from extension
+    tile_format format = tile_format::PNG;
+    std::size_t dot = x.find('.');
+    if (dot != std::string_view::npos)
+    {
+        if (!parse_tile_format(x.substr(dot + 1), format))
+        {
+            return tile_url_status::UNKNOWN_FORMAT;
+        }
+        x = x.substr(0, dot);
+    }
+
+    int tz, ty, tx;
+    if (!parse_coord(z, tz) || !parse_coord(y, ty) || !parse_coord(x, tx))
+    {
+        return tile_url_status::INVALID;
+    }
+    if (tz > tile_url::MAX_ZOOM || ty >= (1 << tz) || tx >= (1 << tz))
+    {
+        return tile_url_status::OUT_OF_RANGE;
+    }
+
+    url.style = style;
+    url.z = tz;
+    url.y = ty;
+    url.x = tx;
+    url.format = format;
+    return tile_url_status::OK;
+}
+
+}; // ~namespace encviz
@@ -6,12 +6,55 @@
  * Mercator (EPSG:3857), and WMS tiles.
  */
 
+#include <algorithm>
 #include <cmath>
+#include <utility>
+#include <vector>
 #include <encviz/web_mercator.h>
 
 namespace encviz
 {
 
+/// Nominal planet radius (m)
+static const double EARTH_RADIUS = 6378137;
+
+/// Latitude limit of the square Web Mercator map (deg)
+static const double MAX_LATITUDE = 85.05112877980659;
+
+/// Intervals in the Mercator latitude table
+static const int LAT_TABLE_SIZE = 4096;
+
+/// Mercator latitude table entry
+struct lat_entry
+{
+    /// ln(tan(pi/4 + lat/2))
+    double y;
+
+    /// Slope (sec(lat)), premultiplied by the table step (rad)
+    double slope;
+};
+
+/**
+ * Get Mercator Latitude Table
+ *
+ * \return Table of LAT_TABLE_SIZE + 1 entries from -MAX_LATITUDE to MAX_LATITUDE
+ */
+static const lat_entry *lat_table()
+{
+    static const std::vector<lat_entry> table = []() {
+        std::vector<lat_entry> t(LAT_TABLE_SIZE + 1);
+        double step = 2 * MAX_LATITUDE / LAT_TABLE_SIZE * M_PI / 180;
+        for (int i = 0; i <= LAT_TABLE_SIZE; i++)
+        {
+            double lat = (-MAX_LATITUDE + i * 2 * MAX_LATITUDE / LAT_TABLE_SIZE) * M_PI / 180;
+            t[i].y = std::log(std::tan(M_PI / 4 + lat / 2));
+            t[i].slope = step / std::cos(lat);
+        }
+        return t;
+    }();
+    return table.data();
+}
+
 /**
  * Constructor
  *
@@ -20,13 +63,14 @@ namespace encviz
  * \param[in] y Tile z coordinate (TMS)
  * \param[in] tc Tile coordinate system (WTMS or XYZ)
  * \param[in] tile_size Tile side length in pixels
- * \param[in] tile_size Tile size in pixels
+ * \param[in] span Tiles per side, mapping a (span x span) block of tiles
+ *                 with x,y at its bottom left (XYZ) / top left (WTMS)
  */
 web_mercator::web_mercator(std::size_t x, std::size_t y, std::size_t z,
-                           tile_coords tc, int tile_size)
+                           tile_coords tc, int tile_size, std::size_t span)
 {
     // Nominal planet radius
-    double radius = 6378137;
+    double radius = EARTH_RADIUS;
 
     // Nominal dimentions in meters of Web Mercator map at zoom level 0
     double tile_side = 2 * M_PI * radius;
@@ -38,10 +82,10 @@ web_mercator::web_mercator(std::size_t x, std::size_t y, std::size_t z,
     std::size_t ntiles = (std::size_t)pow(2, z);
 
     // All our math expects XYZ tile coordinates,
-    // will need to flip Y axis if using WTMS
+    // will need to flip Y axis if using WTMS (block grows down from the top)
     if (tc == tile_coords::WTMS)
     {
-        y = ntiles - y - 1;
+        y = ntiles - y - span;
     }
 
     // Update side length, resolution
@@ -50,8 +94,8 @@ web_mercator::web_mercator(std::size_t x, std::size_t y, std::size_t z,
     // Compute bounding box (meters)
     bbox_m_.MinX = x * tile_side - offset_m_;
     bbox_m_.MinY = y * tile_side - offset_m_;
-    bbox_m_.MaxX = bbox_m_.MinX + tile_side;
-    bbox_m_.MaxY = bbox_m_.MinY + tile_side;
+    bbox_m_.MaxX = bbox_m_.MinX + span * tile_side;
+    bbox_m_.MaxY = bbox_m_.MinY + span * tile_side;
 
     // Compute pixels per meter
     ppm_ = tile_size / tile_side;
@@ -155,6 +199,71 @@ coord web_mercator::pixels_to_meters(const coord &in) const
     return out;
 }
 
+/**
+ * Convert coordinates from degrees to pixels (batch)
+ *
+ * \param[in] in Input coordinates (deg)
+ * \param[out] out Output coordinates (pixels), may be the same as in
+ * \param[in] n Number of coordinates
+ */
+void web_mercator::deg_to_pixels(const coord *in, coord *out, std::size_t n) const
+{
+    // Both axes reduce to a scale and offset of a per-point value
+    const double ax = offset_m_ / 180.0 * ppm_;
+    const double bx = -bbox_m_.MinX * ppm_;
+    const double ay = -EARTH_RADIUS * ppm_;
+    const double by = bbox_m_.MaxY * ppm_;
+    const double lat_scale = LAT_TABLE_SIZE / (2 * MAX_LATITUDE);
+    const lat_entry *table = lat_table();
+
+    // Blocks are finished before they are stored, so out may alias in
+    const std::size_t block = 256;
+    coord tmp[block];
+    for (std::size_t first = 0; first < n; first += block)
+    {
+        std::size_t count = std::min(block, n - first);
+        const coord *src = in + first;
+
+        // Branch free, so the loop vectorizes (clamped index, fixed up below)
+        bool out_of_range = false;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            double lon = src[i].x;
+            double lat = src[i].y;
+            out_of_range |= !(std::fabs(lat) <= MAX_LATITUDE);
+
+            // Cubic Hermite interpolation between table entries
+            double u = (lat + MAX_LATITUDE) * lat_scale;
+            u = std::fmin(std::fmax(u, 0.0), LAT_TABLE_SIZE - 1e-9);
+            int k = int(u);
+            double t = u - k;
+            double t2 = t * t;
+            double t3 = t2 * t;
+            const lat_entry &e0 = table[k];
+            const lat_entry &e1 = table[k + 1];
+            double y = (2 * t3 - 3 * t2 + 1) * e0.y + (t3 - 2 * t2 + t) * e0.slope +
+                (3 * t2 - 2 * t3) * e1.y + (t3 - t2) * e1.slope;
+
+            tmp[i].x = lon * ax + bx;
+            tmp[i].y = y * ay + by;
+        }
+
+        // Rare points beyond the square map take the exact path
+        if (out_of_range)
+        {
+            for (std::size_t i = 0; i < count; i++)
+            {
+                if (!(std::fabs(src[i].y) <= MAX_LATITUDE))
+                {
+                    tmp[i] = meters_to_pixels(deg_to_meters(src[i]));
+                }
+            }
+        }
+
+        std::copy(tmp, tmp + count, out + first);
+    }
+}
+
 /**
  * Convert OGR Point to pixels
  *
@@ -182,4 +291,36 @@ coord web_mercator::point_to_meters(const OGRPoint &point) const
 	return deg_to_meters(c);
 }
 
+/**
+ * Hilbert Curve Distance
+ *
+ * \param[in] order Curve covers (2^order x 2^order) cells
+ * \param[in] x Cell column
+ * \param[in] y Cell row
+ * \return Position of cell along the curve
+ */
+uint64_t hilbert_distance(int order, uint64_t x, uint64_t y)
+{
+    uint64_t d = 0;
+    for (int a = order - 1; a >= 0; a--)
+    {
+        uint64_t s = uint64_t(1) << a;
+        uint64_t rx = (x & s) > 0;
+        uint64_t ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+
+        // Rotate quadrant
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return d;
+}
+
 }; // ~namespace encviz
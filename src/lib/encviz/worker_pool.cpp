@@ -0,0 +1,195 @@
+/**
+ * \file
+ * \brief Worker Pool
+ *
+ * Fixed size pool of worker threads servicing a bounded job queue, plus a
+ * low priority background queue.
+ */
+
+#include <algorithm>
+#include <encviz/worker_pool.h>
+
+namespace encviz
+{
+
+/**
+ * Constructor
+ *
+ * \param[in] nthreads Number of worker threads (0 = one per core)
+ * \param[in] max_queue Maximum number of waiting jobs (0 = four per worker)
+ */
+worker_pool::worker_pool(std::size_t nthreads, std::size_t max_queue)
+{
+    if (nthreads == 0)
+    {
+        nthreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    max_queue_ = (max_queue == 0) ? (4 * nthreads) : max_queue;
+    max_background_ = std::max<std::size_t>(1, nthreads / 2);
+
+    for (std::size_t i = 0; i < nthreads; i++)
+    {
+        workers_.emplace_back(&worker_pool::run, this);
+    }
+}
+
+/**
+ * Destructor
+ *
+ * Finishes any queued jobs before joining workers.
+ */
+worker_pool::~worker_pool()
+{
+    shutdown();
+}
+
+/**
+ * Stop Workers
+ *
+ * Finishes any queued jobs and joins workers, later submits are refused.
+ * Safe to call more than once.
+ */
+void worker_pool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &worker : workers_)
+    {
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+}
+
+/**
+ * Queue Job Without Blocking
+ *
+ * \param[in] j Job to run
+ * \return False if the queue is full
+ */
+bool worker_pool::try_submit(job j)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_ || queue_.size() >= max_queue_)
+        {
+            return false;
+        }
+        queue_.push_back(std::move(j));
+    }
+    wake_.notify_one();
+    return true;
+}
+
+/**
+ * Queue Background Job Without Blocking
+ *
+ * \param[in] j Job to run
+ * \return False if the background queue is full
+ */
+bool worker_pool::try_submit_background(job j)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stop_ || background_.size() >= max_queue_)
+        {
+            return false;
+        }
+        background_.push_back(std::move(j));
+    }
+    wake_.notify_one();
+    return true;
+}
+
+/**
+ * Get Number of Workers
+ *
+ * \return Worker thread count
+ */
+std::size_t worker_pool::size() const
+{
+    return workers_.size();
+}
+
+/**
+ * Get Queue Capacity
+ *
+ * \return Maximum number of waiting jobs
+ */
+std::size_t worker_pool::capacity() const
+{
+    return max_queue_;
+}
+
+/**
+ * Get Number of Waiting Jobs
+ *
+ * \return Jobs queued but not yet started
+ */
+std::size_t worker_pool::queued() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+/**
+ * Worker Thread Main Loop
+ */
+void worker_pool::run()
+{
+    while (true)
+    {
+        job next;
+        bool background = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this]() {
+                return stop_ || !queue_.empty() || background_ready();
+            });
+            if (!queue_.empty())
+            {
+                next = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            else if (stop_)
+            {
+                // Stopping, and nothing left to do (background work dropped)
+                return;
+            }
+            else
+            {
+                next = std::move(background_.front());
+                background_.pop_front();
+                background_running_++;
+                background = true;
+            }
+        }
+        next();
+
+        if (background)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                background_running_--;
+            }
+            // A waiting background job may start now
+            wake_.notify_one();
+        }
+    }
+}
+
+/**
+ * Check Background Job Can Start
+ *
+ * \return True if one is waiting and a background slot is free
+ */
+bool worker_pool::background_ready() const
+{
+    return !background_.empty() && background_running_ < max_background_;
+}
+
+}; // ~namespace encviz
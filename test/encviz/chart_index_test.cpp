@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <vector>
+#include <gtest/gtest.h>
+#include <encviz/chart_index.h>
+using namespace testing;
+using namespace encviz;
+
+static OGREnvelope make_bbox(double min_x, double max_x, double min_y, double max_y)
+{
+    OGREnvelope bbox;
+    bbox.MinX = min_x;
+    bbox.MaxX = max_x;
+    bbox.MinY = min_y;
+    bbox.MaxY = max_y;
+    return bbox;
+}
+
+TEST(chart_index, matches_linear_scan)
+{
+    // Grid of 1 deg charts at a mix of scales, enough for several tree levels
+    std::vector<chart_index::item> items;
+    const int scales[] = { 12000, 40000, 80000, 350000, 1200000 };
+    for (int i = 0; i < 40; i++)
+    {
+        for (int j = 0; j < 40; j++)
+        {
+            items.push_back({make_bbox(i, i + 1, j, j + 1), scales[(i * 7 + j) % 5],
+                             items.size()});
+        }
+    }
+
+    chart_index index;
+    index.build(items);
+    ASSERT_EQ(index.size(), items.size());
+
+    const OGREnvelope queries[] = {
+        make_bbox(10.5, 10.6, 20.5, 20.6),
+        make_bbox(-5, 3.5, -5, 2),
+        make_bbox(0, 40, 0, 40),
+        make_bbox(100, 101, 100, 101)
+    };
+    for (const OGREnvelope &bbox : queries)
+    {
+        for (int scale_min : { 0, 40000, 350000, 5000000 })
+        {
+            // Reference result, as selected before the index existed
+            std::vector<const chart_index::item*> expected;
+            for (const auto &item : items)
+            {
+                if (scale_min <= item.scale && bbox.Intersects(item.bbox))
+                {
+                    expected.push_back(&item);
+                }
+            }
+            std::stable_sort(expected.begin(), expected.end(),
+                             [](const chart_index::item *a, const chart_index::item *b) {
+                                 return a->scale < b->scale; });
+
+            std::vector<std::size_t> found = index.query(bbox, scale_min);
+            ASSERT_EQ(found.size(), expected.size());
+            for (std::size_t i = 0; i < found.size(); i++)
+            {
+                EXPECT_EQ(found[i], expected[i]->id);
+            }
+        }
+    }
+}
+
+TEST(chart_index, empty)
+{
+    chart_index index;
+    EXPECT_TRUE(index.query(make_bbox(0, 1, 0, 1), 0).empty());
+}
@@ -0,0 +1,51 @@
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <encviz/chart_watcher.h>
+using namespace testing;
+using namespace encviz;
+namespace fs = std::filesystem;
+
+TEST(chart_watcher, batches_changes)
+{
+    fs::path root = fs::temp_directory_path() / ("encviz_watch_" + std::to_string(getpid()));
+    fs::remove_all(root);
+    fs::create_directories(root / "US5MA1AA");
+    std::ofstream(root / "US5MA1AA" / "US5MA1AA.000") << "base";
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::vector<fs::path>> batches;
+    {
+        chart_watcher watcher(root, [&](const std::vector<fs::path> &files) {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.push_back(files);
+            changed.notify_all();
+        }, std::chrono::milliseconds(100));
+
+        // Update to an existing cell, and a new cell in a new directory
+        std::ofstream(root / "US5MA1AA" / "US5MA1AA.001") << "update";
+        fs::create_directories(root / "US5MA1AB");
+        std::ofstream(root / "US5MA1AB" / "US5MA1AB.000") << "base";
+
+        std::unique_lock<std::mutex> lock(mutex);
+        ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5), [&]() {
+            return !batches.empty();
+        }));
+    }
+
+    // Everything arrived in one batch, once quiet
+    ASSERT_EQ(1u, batches.size());
+    std::set<fs::path> files(batches[0].begin(), batches[0].end());
+    EXPECT_EQ(1u, files.count(root / "US5MA1AA" / "US5MA1AA.001"));
+    EXPECT_EQ(1u, files.count(root / "US5MA1AB" / "US5MA1AB.000"));
+    EXPECT_EQ(0u, files.count(root / "US5MA1AA" / "US5MA1AA.000"));
+    fs::remove_all(root);
+}
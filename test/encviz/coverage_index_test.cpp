@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <encviz/coverage_index.h>
+using namespace testing;
+using namespace encviz;
+
+TEST(coverage_index, empty)
+{
+    coverage_index coverage;
+    coverage.build();
+    EXPECT_TRUE(coverage.empty());
+    EXPECT_FALSE(coverage.touches({0, 0}));
+}
+
+TEST(coverage_index, touches_bounds)
+{
+    // Two adjacent charts, one with a diagonal edge
+    coverage_index coverage;
+    coverage.add_ring({{0, 0}, {100, 0}, {100, 100}, {0, 100}, {0, 0}});
+    coverage.add_ring({{100, 0}, {300, 0}, {100, 250}, {100, 0}});
+    coverage.build();
+    ASSERT_FALSE(coverage.empty());
+
+    // Vertices and points along edges
+    EXPECT_TRUE(coverage.touches({0, 0}));
+    EXPECT_TRUE(coverage.touches({100, 37.5}));
+    EXPECT_TRUE(coverage.touches({50, 100}));
+    EXPECT_TRUE(coverage.touches({200, 125}));
+    EXPECT_TRUE(coverage.touches({100, 240}));
+
+    // Inside, outside and just off an edge
+    EXPECT_FALSE(coverage.touches({50, 50}));
+    EXPECT_FALSE(coverage.touches({-10, -10}));
+    EXPECT_FALSE(coverage.touches({500, 500}));
+    EXPECT_FALSE(coverage.touches({50, 100.5}));
+    EXPECT_FALSE(coverage.touches({200, 124}));
+}
+
+TEST(coverage_index, matches_brute_force)
+{
+    // Long ring spanning many grid cells
+    std::vector<coord> ring;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> pos(-2000, 6000);
+    for (int i = 0; i < 64; i++)
+    {
+        ring.push_back({pos(rng), pos(rng)});
+    }
+    ring.push_back(ring.front());
+
+    coverage_index coverage;
+    coverage.add_ring(ring);
+    coverage.build();
+
+    // Points on and near each segment
+    std::uniform_real_distribution<double> t(0, 1);
+    std::uniform_real_distribution<double> off(-0.2, 0.2);
+    for (std::size_t i = 1; i < ring.size(); i++)
+    {
+        for (int j = 0; j < 20; j++)
+        {
+            double u = t(rng);
+            coord on = {ring[i-1].x + u * (ring[i].x - ring[i-1].x),
+                        ring[i-1].y + u * (ring[i].y - ring[i-1].y)};
+            EXPECT_TRUE(coverage.touches(on));
+
+            coord near = {on.x + off(rng), on.y + off(rng)};
+            bool expected = false;
+            for (std::size_t k = 1; k < ring.size(); k++)
+            {
+                double dx = ring[k].x - ring[k-1].x;
+                double dy = ring[k].y - ring[k-1].y;
+                double s = ((near.x - ring[k-1].x) * dx + (near.y - ring[k-1].y) * dy)
+                    / (dx * dx + dy * dy);
+                s = std::clamp(s, 0.0, 1.0);
+                double ex = ring[k-1].x + s * dx - near.x;
+                double ey = ring[k-1].y + s * dy - near.y;
+                expected = expected || (ex * ex + ey * ey <=
+                                        coverage_index::TOLERANCE_PX * coverage_index::TOLERANCE_PX);
+            }
+            EXPECT_EQ(expected, coverage.touches(near));
+        }
+    }
+}
+
+TEST(coverage_index, reuse_after_clear)
+{
+    // Index reused for another tile forgets the previous rings
+    coverage_index coverage;
+    coverage.add_ring({{0, 0}, {100, 0}, {100, 100}, {0, 100}, {0, 0}});
+    coverage.build();
+    EXPECT_TRUE(coverage.touches({50, 0}));
+
+    coverage.clear();
+    EXPECT_TRUE(coverage.empty());
+    EXPECT_FALSE(coverage.touches({50, 0}));
+
+    coverage.add_ring({{200, 200}, {300, 200}});
+    coverage.build();
+    EXPECT_FALSE(coverage.touches({50, 0}));
+    EXPECT_TRUE(coverage.touches({250, 200}));
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <encviz/memory_budget.h>
+using namespace testing;
+using namespace encviz;
+
+TEST(memory_budget, no_limit_never_over)
+{
+    memory_budget budget;
+    int id = budget.add("charts", 1, nullptr);
+    budget.update(id, 1 << 30);
+    EXPECT_FALSE(budget.over(id));
+}
+
+TEST(memory_budget, over_means_above_share)
+{
+    memory_budget budget;
+    budget.set_limit(1000);
+    int charts = budget.add("charts", 3, nullptr);
+    int tiles = budget.add("tiles", 1, nullptr);
+
+    // Under the limit, either may borrow the other's share
+    budget.update(charts, 900);
+    EXPECT_FALSE(budget.over(charts));
+
+    // Over it, only the cache beyond its share has to shed
+    budget.update(tiles, 200);
+    EXPECT_TRUE(budget.over(charts));
+    EXPECT_FALSE(budget.over(tiles));
+
+    budget.update(charts, 700);
+    EXPECT_FALSE(budget.over(charts));
+
+    std::vector<memory_budget::usage> usage = budget.get_usage();
+    ASSERT_EQ(2u, usage.size());
+    EXPECT_EQ("charts", usage[0].name);
+    EXPECT_EQ(700u, usage[0].bytes);
+    EXPECT_EQ(750u, usage[0].share);
+    EXPECT_EQ(250u, usage[1].share);
+}
+
+TEST(memory_budget, enforce_trims_caches_over_share)
+{
+    memory_budget budget;
+    budget.set_limit(1000);
+
+    std::size_t chart_bytes = 900;
+    int charts = budget.add("charts", 1, [&]() {
+        // Shed 100 byte entries until back within share
+        while (budget.over(charts))
+        {
+            chart_bytes -= 100;
+            budget.update(charts, chart_bytes);
+        }
+    });
+    bool tiles_trimmed = false;
+    int tiles = budget.add("tiles", 1, [&]() { tiles_trimmed = true; });
+
+    budget.update(charts, chart_bytes);
+    budget.update(tiles, 400);
+    budget.enforce();
+
+    EXPECT_EQ(600u, chart_bytes);
+    EXPECT_FALSE(tiles_trimmed);
+    EXPECT_EQ(1u, budget.get_usage()[0].trims);
+    EXPECT_EQ(0u, budget.get_usage()[1].trims);
+}
+
+TEST(memory_budget, client_reports_and_enforces)
+{
+    // Unattached, nothing to report to
+    memory_budget::client idle;
+    idle.report(1 << 30);
+    EXPECT_FALSE(idle.over());
+    idle.enforce();
+
+    memory_budget budget;
+    budget.set_limit(1000);
+    memory_budget::client charts;
+    std::size_t chart_bytes = 0;
+    charts.attach(budget, "charts", 1, [&]() {
+        chart_bytes = 0;
+        charts.report(chart_bytes);
+    });
+
+    chart_bytes = 1500;
+    charts.report(chart_bytes);
+    EXPECT_TRUE(charts.over());
+    charts.enforce();
+    EXPECT_EQ(0u, chart_bytes);
+    EXPECT_FALSE(charts.over());
+    EXPECT_EQ("charts", budget.get_usage()[0].name);
+}
@@ -0,0 +1,87 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <encviz/metrics.h>
+using namespace testing;
+using namespace encviz;
+
+TEST(metrics, histogram_buckets)
+{
+    histogram hist;
+    hist.observe(0);
+    hist.observe(100);
+    hist.observe(101);
+    hist.observe(20000000);
+
+    histogram::snapshot counts = hist.read();
+    ASSERT_EQ(counts.count, 4u);
+    ASSERT_EQ(counts.sum_us, 20000201);
+    ASSERT_EQ(counts.buckets[0], 2u);
+    ASSERT_EQ(counts.buckets[1], 1u);
+    ASSERT_EQ(counts.buckets[histogram::NBUCKETS], 1u);
+}
+
+TEST(metrics, histogram_threads)
+{
+    histogram hist;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 32; t++)
+    {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10000; i++)
+            {
+                hist.observe(i % 1000);
+            }
+        });
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    histogram::snapshot counts = hist.read();
+    ASSERT_EQ(counts.count, 320000u);
+    uint64_t total = 0;
+    for (uint64_t n : counts.buckets)
+    {
+        total += n;
+    }
+    ASSERT_EQ(total, counts.count);
+}
+
+TEST(metrics, prometheus_text)
+{
+    render_metrics metrics;
+    metrics.add_layers({"DEPARE", "LNDARE", "DEPARE"});
+
+    render_profile profile;
+    profile.select_us = 50;
+    profile.export_us["DEPARE"] = 2000;
+    profile.export_us["LNDARE"] = 1000;
+    profile.draw_us["DEPARE"] = 4000;
+    profile.draw_us["SOUNDG"] = 10;
+    metrics.record(profile, 30000);
+
+    std::string text;
+    metrics.write(text);
+    ASSERT_NE(text.find("# TYPE encviz_stage_seconds histogram\n"), std::string::npos);
+    ASSERT_NE(text.find("encviz_stage_seconds_bucket{stage=\"render\",le=\"0.025\"} 0\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("encviz_stage_seconds_bucket{stage=\"render\",le=\"0.05\"} 1\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("encviz_stage_seconds_bucket{stage=\"clip\",le=\"0.0025\"} 0\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("encviz_stage_seconds_bucket{stage=\"clip\",le=\"0.005\"} 1\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("encviz_stage_seconds_count{stage=\"select\"} 1\n"), std::string::npos);
+    ASSERT_NE(text.find("encviz_layer_draw_seconds_bucket{layer=\"DEPARE\",le=\"+Inf\"} 1\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("encviz_layer_draw_seconds_sum{layer=\"DEPARE\"} 0.004000\n"),
+              std::string::npos);
+    ASSERT_NE(text.find("encviz_layer_draw_seconds_count{layer=\"LNDARE\"} 0\n"),
+              std::string::npos);
+
+    // Only layers of loaded styles
+    ASSERT_EQ(text.find("SOUNDG"), std::string::npos);
+}
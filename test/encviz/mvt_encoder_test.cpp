@@ -0,0 +1,229 @@
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include <encviz/mvt_encoder.h>
+using namespace testing;
+using namespace encviz;
+
+/// Decoded vector tile feature
+struct decoded_feature
+{
+    std::string layer;
+    uint32_t extent{0};
+    uint64_t type{0};
+    std::vector<uint32_t> geometry;
+};
+
+static uint64_t read_varint(const uint8_t *&pos)
+{
+    uint64_t value = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        value |= uint64_t(*pos & 0x7f) << shift;
+        if ((*pos++ & 0x80) == 0)
+        {
+            return value;
+        }
+    }
+}
+
+/// Walk a message, calling fn(field, start, end) for length delimited fields
+/// and fn(field, value) for varints (fixed64 fields are skipped)
+template <typename Bytes, typename Varint>
+static void read_message(const uint8_t *pos, const uint8_t *end, Bytes bytes, Varint varint)
+{
+    while (pos < end)
+    {
+        uint64_t key = read_varint(pos);
+        if ((key & 7) == 2)
+        {
+            uint64_t len = read_varint(pos);
+            bytes(key >> 3, pos, pos + len);
+            pos += len;
+        }
+        else if ((key & 7) == 1)
+        {
+            pos += 8;
+        }
+        else
+        {
+            varint(key >> 3, read_varint(pos));
+        }
+    }
+}
+
+static std::vector<decoded_feature> decode(const std::vector<uint8_t> &data)
+{
+    std::vector<decoded_feature> out;
+    read_message(data.data(), data.data() + data.size(), [&](int field, const uint8_t *lpos, const uint8_t *lend) {
+        ASSERT_EQ(field, 3);
+        std::string name;
+        uint32_t extent = 0;
+        std::size_t first = out.size();
+        read_message(lpos, lend, [&](int lfield, const uint8_t *fpos, const uint8_t *fend) {
+            if (lfield == 1)
+            {
+                name.assign((const char*)fpos, fend - fpos);
+            }
+            else if (lfield == 2)
+            {
+                decoded_feature feat;
+                read_message(fpos, fend, [&](int ffield, const uint8_t *gpos, const uint8_t *gend) {
+                    if (ffield == 4)
+                    {
+                        while (gpos < gend)
+                        {
+                            feat.geometry.push_back(read_varint(gpos));
+                        }
+                    }
+                }, [&](int ffield, uint64_t value) {
+                    if (ffield == 3)
+                    {
+                        feat.type = value;
+                    }
+                });
+                out.push_back(feat);
+            }
+        }, [&](int lfield, uint64_t value) {
+            if (lfield == 5)
+            {
+                extent = value;
+            }
+        });
+        for (std::size_t i = first; i < out.size(); i++)
+        {
+            out[i].layer = name;
+            out[i].extent = extent;
+        }
+    }, [](int, uint64_t) {});
+    return out;
+}
+
+static int64_t unzigzag(uint32_t v)
+{
+    return (v >> 1) ^ -int64_t(v & 1);
+}
+
+/// Ring area (tile units, y down) of a single ring polygon command stream
+static double ring_area(const std::vector<uint32_t> &cmds)
+{
+    std::vector<std::pair<int64_t, int64_t>> pts;
+    int64_t x = 0, y = 0;
+    for (std::size_t i = 0; i < cmds.size(); )
+    {
+        uint32_t count = cmds[i] >> 3;
+        uint32_t id = cmds[i++] & 7;
+        if (id == 7)
+        {
+            continue;
+        }
+        for (uint32_t j = 0; j < count; j++)
+        {
+            x += unzigzag(cmds[i++]);
+            y += unzigzag(cmds[i++]);
+            pts.push_back({x, y});
+        }
+    }
+    double area = 0;
+    for (std::size_t i = 0; i < pts.size(); i++)
+    {
+        const auto &a = pts[i];
+        const auto &b = pts[(i + 1) % pts.size()];
+        area += double(a.first) * b.second - double(b.first) * a.second;
+    }
+    return area / 2;
+}
+
+TEST(mvt_encoder, empty)
+{
+    mvt_encoder mvt(0, 0, 0, tile_coords::XYZ, mvt_encoder::options());
+    std::vector<uint8_t> data;
+    EXPECT_FALSE(mvt.finish(data));
+    EXPECT_TRUE(data.empty());
+}
+
+TEST(mvt_encoder, point)
+{
+    mvt_encoder mvt(0, 0, 0, tile_coords::XYZ, mvt_encoder::options());
+    OGRPoint pt(0, 0);
+    mvt.add_feature("LIGHTS", &pt, nullptr);
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(mvt.finish(data));
+    std::vector<decoded_feature> feats = decode(data);
+    ASSERT_EQ(feats.size(), 1u);
+    EXPECT_EQ(feats[0].layer, "LIGHTS");
+    EXPECT_EQ(feats[0].extent, 4096u);
+    EXPECT_EQ(feats[0].type, 1u);
+
+    // MoveTo(1) to the middle of the world tile
+    std::vector<uint32_t> expected = {9, 4096, 4096};
+    EXPECT_EQ(feats[0].geometry, expected);
+}
+
+TEST(mvt_encoder, simplify_line)
+{
+    // Straight line with redundant points, on the equator
+    mvt_encoder mvt(0, 0, 0, tile_coords::XYZ, mvt_encoder::options());
+    OGRLineString line;
+    for (int lon = -90; lon <= 90; lon += 10)
+    {
+        line.addPoint(lon, 0);
+    }
+    mvt.add_feature("DEPCNT", &line, nullptr);
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(mvt.finish(data));
+    std::vector<decoded_feature> feats = decode(data);
+    ASSERT_EQ(feats.size(), 1u);
+    EXPECT_EQ(feats[0].type, 2u);
+
+    // MoveTo(1) 1024,2048 then LineTo(1) +2048,0
+    std::vector<uint32_t> expected = {9, 2048, 4096, 10, 4096, 0};
+    EXPECT_EQ(feats[0].geometry, expected);
+}
+
+TEST(mvt_encoder, polygon_winding)
+{
+    // Exterior rings come out with positive area whichever way they went in
+    for (bool reverse : {false, true})
+    {
+        mvt_encoder mvt(0, 0, 0, tile_coords::XYZ, mvt_encoder::options());
+        OGRLinearRing ring;
+        double lons[] = {-10, 10, 10, -10, -10};
+        double lats[] = {-10, -10, 10, 10, -10};
+        for (int i = 0; i < 5; i++)
+        {
+            int j = reverse ? 4 - i : i;
+            ring.addPoint(lons[j], lats[j]);
+        }
+        OGRPolygon poly;
+        poly.addRing(&ring);
+        mvt.add_feature("DEPARE", &poly, nullptr);
+
+        std::vector<uint8_t> data;
+        ASSERT_TRUE(mvt.finish(data));
+        std::vector<decoded_feature> feats = decode(data);
+        ASSERT_EQ(feats.size(), 1u);
+        EXPECT_EQ(feats[0].type, 3u);
+        EXPECT_EQ(feats[0].geometry.back(), 15u); // ClosePath(1)
+        EXPECT_GT(ring_area(feats[0].geometry), 0);
+    }
+}
+
+TEST(mvt_encoder, collapsed)
+{
+    // A polygon much smaller than one tile unit disappears
+    mvt_encoder mvt(0, 0, 0, tile_coords::XYZ, mvt_encoder::options());
+    OGRLinearRing ring;
+    ring.addPoint(0, 0);
+    ring.addPoint(0.001, 0);
+    ring.addPoint(0.001, 0.001);
+    ring.addPoint(0, 0);
+    OGRPolygon poly;
+    poly.addRing(&ring);
+    mvt.add_feature("DEPARE", &poly, nullptr);
+
+    std::vector<uint8_t> data;
+    EXPECT_FALSE(mvt.finish(data));
+}
@@ -0,0 +1,94 @@
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <gtest/gtest.h>
+#include <encviz/scale_plan.h>
+using namespace testing;
+using namespace encviz;
+
+static OGREnvelope make_bbox(double min_x, double max_x, double min_y, double max_y)
+{
+    OGREnvelope bbox;
+    bbox.MinX = min_x;
+    bbox.MaxX = max_x;
+    bbox.MinY = min_y;
+    bbox.MaxY = max_y;
+    return bbox;
+}
+
+static std::shared_ptr<const OGRGeometry> make_square(const OGREnvelope &bbox)
+{
+    OGRLinearRing ring;
+    ring.addPoint(bbox.MinX, bbox.MinY);
+    ring.addPoint(bbox.MaxX, bbox.MinY);
+    ring.addPoint(bbox.MaxX, bbox.MaxY);
+    ring.addPoint(bbox.MinX, bbox.MaxY);
+    ring.addPoint(bbox.MinX, bbox.MinY);
+    auto poly = std::make_shared<OGRPolygon>();
+    poly->addRing(&ring);
+    return poly;
+}
+
+/// Detailed chart (id 0) over the corner of a coarse one (id 1)
+static std::unique_ptr<scale_plan> make_plan(std::atomic<int> &exact_reads)
+{
+    OGREnvelope detailed = make_bbox(0, 1, 0, 1);
+    OGREnvelope coarse = make_bbox(0, 2, 0, 2);
+    std::vector<scale_plan::chart> charts = {
+        {detailed, make_square(detailed), 0},
+        {coarse, make_square(coarse), 1},
+    };
+    auto exact = [charts, &exact_reads](std::size_t id) {
+        exact_reads++;
+        return charts[id].coverage;
+    };
+    return std::make_unique<scale_plan>(charts, exact);
+}
+
+TEST(scale_plan, inside_detailed_chart)
+{
+    std::atomic<int> exact_reads{0};
+    std::unique_ptr<scale_plan> plan = make_plan(exact_reads);
+
+    // Detailed chart alone covers the region, drawn everywhere in it
+    const scale_plan::region &region = plan->find(make_bbox(0.1, 0.2, 0.1, 0.2));
+    EXPECT_TRUE(region.bbox.Contains(make_bbox(0.1, 0.2, 0.1, 0.2)));
+    ASSERT_EQ(1u, region.steps.size());
+    EXPECT_EQ(0u, region.steps[0].source->id);
+    EXPECT_EQ(nullptr, region.steps[0].mask);
+    EXPECT_TRUE(region.complete);
+    EXPECT_EQ(0, exact_reads);
+
+    // Resolved once
+    EXPECT_EQ(&region, &plan->find(make_bbox(0.1, 0.2, 0.1, 0.2)));
+}
+
+TEST(scale_plan, across_chart_edge)
+{
+    std::atomic<int> exact_reads{0};
+    std::unique_ptr<scale_plan> plan = make_plan(exact_reads);
+
+    // Coarse chart fills in beyond the detailed one
+    const scale_plan::region &region = plan->find(make_bbox(0.9, 1.1, 0.9, 1.1));
+    ASSERT_EQ(2u, region.steps.size());
+    EXPECT_EQ(0u, region.steps[0].source->id);
+    EXPECT_EQ(nullptr, region.steps[0].mask);
+    EXPECT_EQ(1u, region.steps[1].source->id);
+    ASSERT_NE(nullptr, region.steps[1].mask);
+    EXPECT_TRUE(region.complete);
+    EXPECT_EQ(1, exact_reads);
+
+    // Coarse chart is drawn where the detailed one isn't
+    EXPECT_FALSE(region.steps[1].mask->Intersects(make_square(make_bbox(0.9, 0.95, 0.9, 0.95)).get()));
+    EXPECT_TRUE(region.steps[1].mask->Intersects(make_square(make_bbox(1.05, 1.1, 1.05, 1.1)).get()));
+}
+
+TEST(scale_plan, outside_charts)
+{
+    std::atomic<int> exact_reads{0};
+    std::unique_ptr<scale_plan> plan = make_plan(exact_reads);
+
+    const scale_plan::region &region = plan->find(make_bbox(10, 11, 10, 11));
+    EXPECT_TRUE(region.steps.empty());
+    EXPECT_FALSE(region.complete);
+}
@@ -0,0 +1,45 @@
+#include <vector>
+#include <gtest/gtest.h>
+#include <encviz/simplify.h>
+using namespace testing;
+using namespace encviz;
+
+TEST(simplify, douglas_peucker)
+{
+    // Spike survives, points on the straight parts go
+    std::vector<coord> pts = {{0, 0}, {1, 0.1}, {2, 0}, {3, 5}, {4, 0}, {5, -0.1}, {6, 0}};
+    std::vector<std::size_t> index = {0, 1, 2, 3, 4, 5, 6};
+    simplify_line(pts, 0.5, &index);
+
+    std::vector<std::size_t> expected = {0, 2, 3, 4, 6};
+    EXPECT_EQ(index, expected);
+    ASSERT_EQ(pts.size(), expected.size());
+    EXPECT_EQ(pts[2].x, 3);
+    EXPECT_EQ(pts[2].y, 5);
+}
+
+TEST(simplify, disabled)
+{
+    std::vector<coord> pts = {{0, 0}, {1, 0}, {2, 0}};
+    simplify_line(pts, 0);
+    EXPECT_EQ(pts.size(), 3u);
+}
+
+TEST(simplify, dense_line)
+{
+    // A thousand points inside one pixel of a world tile collapse to the ends
+    web_mercator wm(0, 0, 0);
+    OGRLineString line;
+    for (int i = 0; i <= 1000; i++)
+    {
+        line.addPoint(i * 1e-4, 0);
+    }
+
+    std::vector<coord> pts;
+    std::vector<std::size_t> index;
+    project_line(&line, wm, 0.5, pts, &index);
+    std::vector<std::size_t> expected = {0, 1000};
+    EXPECT_EQ(index, expected);
+    EXPECT_NEAR(pts[0].x, 128, 1e-6);
+    EXPECT_NEAR(pts[0].y, 128, 1e-6);
+}
@@ -0,0 +1,59 @@
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include <encviz/single_flight.h>
+using namespace testing;
+using namespace encviz;
+
+TEST(single_flight, duplicates_share_one_call)
+{
+    single_flight<int> flight;
+    std::atomic<int> calls{0};
+    std::atomic<bool> release{false};
+
+    // First caller holds the key until every other caller has joined
+    std::vector<std::thread> threads;
+    std::vector<int> results(8, 0);
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        threads.emplace_back([&, i]() {
+            results[i] = flight.run("style/1/2/3", [&]() {
+                calls++;
+                while (!release)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return 42;
+            });
+        });
+    }
+    while (flight.joined() < results.size() - 1)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    release = true;
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    ASSERT_EQ(calls, 1);
+    for (int r : results)
+    {
+        ASSERT_EQ(r, 42);
+    }
+
+    // Key is free again afterwards
+    ASSERT_EQ(flight.run("style/1/2/3", []() { return 7; }), 7);
+}
+
+TEST(single_flight, errors_reach_caller)
+{
+    single_flight<int> flight;
+    ASSERT_THROW(flight.run("bad", []() -> int { throw std::runtime_error("render"); }),
+                 std::runtime_error);
+    ASSERT_EQ(flight.run("bad", []() { return 1; }), 1);
+}
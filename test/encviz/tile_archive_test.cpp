@@ -0,0 +1,192 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <sqlite3.h>
+#include <encviz/mbtiles.h>
+#include <encviz/pmtiles.h>
+using namespace testing;
+using namespace encviz;
+namespace fs = std::filesystem;
+
+static fs::path temp_path(const std::string &name)
+{
+    return fs::temp_directory_path() / ("encviz_" + std::to_string(getpid()) + "_" + name);
+}
+
+static archive_info make_info(tile_format format, int max_zoom)
+{
+    archive_info info;
+    info.name = "default";
+    info.format = format;
+    info.min_zoom = 0;
+    info.max_zoom = max_zoom;
+    info.bounds.MinX = -180;
+    info.bounds.MinY = -85;
+    info.bounds.MaxX = 180;
+    info.bounds.MaxY = 85;
+    return info;
+}
+
+static std::vector<uint8_t> tile_bytes(int z, int x, int y)
+{
+    std::string text = std::to_string(z) + "/" + std::to_string(x) + "/" + std::to_string(y);
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+static std::vector<uint8_t> read_tile(const tile_archive_reader &reader, int z, int x, int y)
+{
+    archive_tile tile;
+    if (!reader.get(z, x, y, tile))
+    {
+        return {};
+    }
+    return std::vector<uint8_t>(tile.data, tile.data + tile.size);
+}
+
+static uint64_t header_field(const std::vector<char> &file, std::size_t offset)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= uint64_t(uint8_t(file[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+TEST(tile_archive, pmtiles_tile_ids)
+{
+    // Zoom by zoom, Hilbert order from the north west (XYZ rows count from the south)
+    EXPECT_EQ(0u, pmtiles_tile_id(0, 0, 0));
+    EXPECT_EQ(1u, pmtiles_tile_id(1, 0, 1));
+    EXPECT_EQ(2u, pmtiles_tile_id(1, 0, 0));
+    EXPECT_EQ(3u, pmtiles_tile_id(1, 1, 0));
+    EXPECT_EQ(4u, pmtiles_tile_id(1, 1, 1));
+    EXPECT_EQ(5u, pmtiles_tile_id(2, 0, 3));
+}
+
+TEST(tile_archive, pmtiles_round_trip_runs)
+{
+    fs::path path = temp_path("runs.pmtiles");
+    {
+        pmtiles_writer writer(path, make_info(tile_format::PNG, 2));
+        writer.put(0, 0, 0, tile_bytes(0, 0, 0));
+
+        // All of zoom 1 is the same tile, one run
+        for (int i = 0; i < 4; i++)
+        {
+            writer.put(1, i / 2, i % 2, {'s', 'e', 'a'});
+        }
+
+        // Same length, different bytes, must not be shared
+        writer.put(2, 0, 0, {'a', 'b', 'c'});
+        writer.put(2, 3, 3, {'a', 'b', 'd'});
+        writer.finish();
+    }
+
+    pmtiles_reader reader(path);
+    EXPECT_EQ(tile_format::PNG, reader.get_format());
+    EXPECT_EQ(tile_bytes(0, 0, 0), read_tile(reader, 0, 0, 0));
+
+    archive_tile first, last;
+    ASSERT_TRUE(reader.get(1, 0, 0, first));
+    ASSERT_TRUE(reader.get(1, 1, 1, last));
+    EXPECT_EQ(first.data, last.data);
+    EXPECT_EQ(std::vector<uint8_t>({'s', 'e', 'a'}), read_tile(reader, 1, 1, 0));
+
+    EXPECT_EQ(std::vector<uint8_t>({'a', 'b', 'c'}), read_tile(reader, 2, 0, 0));
+    EXPECT_EQ(std::vector<uint8_t>({'a', 'b', 'd'}), read_tile(reader, 2, 3, 3));
+    EXPECT_TRUE(read_tile(reader, 2, 1, 1).empty());
+
+    // Root, zoom 0, one run for zoom 1, two zoom 2 tiles
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(7u, header_field(file, 72));  // addressed tiles
+    EXPECT_EQ(4u, header_field(file, 80));  // entries
+    EXPECT_EQ(4u, header_field(file, 88));  // distinct contents
+    fs::remove(path);
+}
+
+TEST(tile_archive, pmtiles_round_trip_leaves)
+{
+    // Enough distinct tiles that the root directory spills into leaves
+    fs::path path = temp_path("leaves.pmtiles");
+    int z = 7;
+    {
+        pmtiles_writer writer(path, make_info(tile_format::MVT, z));
+        for (int x = 0; x < (1 << z); x++)
+        {
+            for (int y = 0; y < 64; y++)
+            {
+                writer.put(z, x, y, tile_bytes(z, x, y));
+            }
+        }
+        writer.finish();
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_GT(header_field(file, 48), 0u);  // leaf directories length
+
+    // Vector metadata named the same as in MBTiles
+    std::string metadata(file.data() + header_field(file, 24), header_field(file, 32));
+    EXPECT_NE(std::string::npos, metadata.find("\"format\":\"pbf\""));
+    EXPECT_NE(std::string::npos, metadata.find("\"type\":\"overlay\""));
+
+    pmtiles_reader reader(path);
+    EXPECT_EQ(tile_format::MVT, reader.get_format());
+    for (int x = 0; x < (1 << z); x += 7)
+    {
+        for (int y = 0; y < 64; y += 5)
+        {
+            EXPECT_EQ(tile_bytes(z, x, y), read_tile(reader, z, x, y));
+        }
+    }
+    EXPECT_TRUE(read_tile(reader, z, 0, 64).empty());
+    fs::remove(path);
+}
+
+TEST(tile_archive, mbtiles_round_trip_resume)
+{
+    fs::path path = temp_path("resume.mbtiles");
+    {
+        mbtiles_writer writer(path, make_info(tile_format::MVT, 1), false);
+        writer.put(0, 0, 0, tile_bytes(0, 0, 0));
+        writer.put(1, 0, 1, tile_bytes(1, 0, 1));
+        writer.flush();
+
+        // Flushed tiles are already visible to other connections
+        sqlite3 *db = nullptr;
+        ASSERT_EQ(SQLITE_OK, sqlite3_open_v2(path.string().c_str(), &db,
+                                             SQLITE_OPEN_READONLY, nullptr));
+        sqlite3_stmt *stmt = nullptr;
+        sqlite3_prepare_v2(db, "SELECT count(*) FROM tiles", -1, &stmt, nullptr);
+        ASSERT_EQ(SQLITE_ROW, sqlite3_step(stmt));
+        EXPECT_EQ(2, sqlite3_column_int(stmt, 0));
+        sqlite3_finalize(stmt);
+
+        sqlite3_prepare_v2(db, "SELECT value FROM metadata WHERE name = 'format'", -1, &stmt, nullptr);
+        ASSERT_EQ(SQLITE_ROW, sqlite3_step(stmt));
+        EXPECT_STREQ("pbf", (const char*)sqlite3_column_text(stmt, 0));
+        sqlite3_finalize(stmt);
+        sqlite3_close(db);
+    }
+    {
+        // Resume adds to the existing tiles
+        mbtiles_writer writer(path, make_info(tile_format::MVT, 1), true);
+        writer.put(1, 1, 0, tile_bytes(1, 1, 0));
+        writer.finish();
+    }
+
+    mbtiles_reader reader(path);
+    EXPECT_EQ(tile_format::MVT, reader.get_format());
+    EXPECT_EQ(tile_bytes(0, 0, 0), read_tile(reader, 0, 0, 0));
+    EXPECT_EQ(tile_bytes(1, 0, 1), read_tile(reader, 1, 0, 1));
+    EXPECT_EQ(tile_bytes(1, 1, 0), read_tile(reader, 1, 1, 0));
+    EXPECT_TRUE(read_tile(reader, 1, 1, 1).empty());
+    fs::remove(path);
+}
@@ -0,0 +1,196 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/xattr.h>
+#include <gtest/gtest.h>
+#include <encviz/tile_cache.h>
+using namespace testing;
+using namespace encviz;
+namespace fs = std::filesystem;
+
+static fs::path temp_dir(const std::string &name)
+{
+    fs::path dir = fs::temp_directory_path() /
+        ("encviz_tile_cache_" + name + "_" + std::to_string(getpid()));
+    fs::remove_all(dir);
+    return dir;
+}
+
+static void open_cache(tile_cache &cache, const fs::path &dir, const std::string &generation,
+                       std::size_t memory = 1 << 20)
+{
+    cache.set_memory_limit(memory);
+    cache.set_disk_path(dir);
+    cache.set_generation(generation);
+}
+
+static tile_key make_key(int z, int x, int y, const std::string &style = "default",
+                         tile_format format = tile_format::PNG)
+{
+    tile_key key;
+    key.style = style;
+    key.z = z;
+    key.x = x;
+    key.y = y;
+    key.format = format;
+    return key;
+}
+
+static std::vector<uint8_t> tile_bytes(const tile_key &key)
+{
+    std::string text = tile_cache::key_string(key);
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+TEST(tile_cache, invalidate_counts_each_tile_once)
+{
+    fs::path dir = temp_dir("invalidate");
+    tile_cache cache;
+    open_cache(cache, dir, "1");
+
+    // In both tiers
+    tile_key both = make_key(5, 3, 4);
+    tile_key vector = make_key(5, 4, 4, "other", tile_format::MVT);
+    tile_key outside = make_key(5, 9, 4);
+    for (const tile_key &key : {both, vector, outside})
+    {
+        cache.put(key, tile_bytes(key));
+    }
+
+    // Only on disk, written by a cache without a memory tier
+    tile_key disk_only = make_key(5, 3, 5);
+    {
+        tile_cache writer;
+        open_cache(writer, dir, "1", 0);
+        writer.put(disk_only, tile_bytes(disk_only));
+    }
+
+    // Only in memory, its file went away
+    tile_key memory_only = make_key(5, 4, 5);
+    cache.put(memory_only, tile_bytes(memory_only));
+    fs::remove(dir / tile_cache::key_string(memory_only));
+
+    std::vector<tile_range> ranges = {{5, 3, 4, 4, 5}};
+    EXPECT_EQ(4u, cache.invalidate(ranges, "2"));
+    EXPECT_EQ(1u, cache.get_stats().entries);
+
+    for (const tile_key &key : {both, vector, disk_only, memory_only})
+    {
+        EXPECT_EQ(nullptr, cache.get(key)) << tile_cache::key_string(key);
+    }
+    tile_ptr kept = cache.get(outside);
+    ASSERT_NE(nullptr, kept);
+    EXPECT_EQ(tile_bytes(outside), kept->data);
+
+    // Nothing left to drop
+    EXPECT_EQ(0u, cache.invalidate(ranges, "3"));
+    fs::remove_all(dir);
+}
+
+TEST(tile_cache, generation_keeps_or_clears_disk)
+{
+    fs::path dir = temp_dir("generation");
+    tile_key key = make_key(3, 1, 2);
+    {
+        tile_cache cache;
+        open_cache(cache, dir, "1");
+        cache.put(key, tile_bytes(key));
+    }
+
+    // Same charts, tile still on disk
+    {
+        tile_cache cache;
+        open_cache(cache, dir, "1");
+        ASSERT_NE(nullptr, cache.get(key));
+        EXPECT_EQ(1u, cache.get_stats().disk_hits);
+    }
+
+    // Invalidation records the generation the rest of the tiles belong to
+    {
+        tile_cache cache;
+        open_cache(cache, dir, "1");
+        cache.invalidate({{3, 0, 0, 0, 0}}, "2");
+    }
+    {
+        tile_cache cache;
+        open_cache(cache, dir, "2");
+        EXPECT_NE(nullptr, cache.get(key));
+    }
+
+    // Changed charts, everything stale
+    {
+        tile_cache cache;
+        open_cache(cache, dir, "3");
+        EXPECT_EQ(nullptr, cache.get(key));
+        EXPECT_TRUE(cache.has_disk());
+    }
+    std::string generation;
+    std::ifstream(dir / "GENERATION") >> generation;
+    EXPECT_EQ("3", generation);
+    fs::remove_all(dir);
+}
+
+TEST(tile_cache, generation_refuses_foreign_directory)
+{
+    fs::path dir = temp_dir("foreign");
+    fs::create_directories(dir);
+    std::ofstream(dir / "notes.txt") << "not a tile cache\n";
+
+    tile_cache cache;
+    open_cache(cache, dir, "1");
+    EXPECT_FALSE(cache.has_disk());
+    EXPECT_TRUE(fs::exists(dir / "notes.txt"));
+    fs::remove_all(dir);
+}
+
+TEST(tile_cache, disk_hit_as_file)
+{
+    fs::path dir = temp_dir("as_file");
+    tile_key key = make_key(4, 2, 3);
+    tile_ptr stored;
+    {
+        tile_cache cache;
+        open_cache(cache, dir, "1");
+        stored = cache.put(key, tile_bytes(key));
+    }
+
+    // Not every filesystem takes user attributes, then tiles are read in
+    fs::path path = dir / tile_cache::key_string(key);
+    bool has_xattr = getxattr(path.c_str(), "user.encviz.etag", nullptr, 0) > 0;
+
+    tile_cache cache;
+    open_cache(cache, dir, "1");
+    tile_ptr tile = cache.get(key, true);
+    ASSERT_NE(nullptr, tile);
+    EXPECT_EQ(stored->etag, tile->etag);
+    EXPECT_EQ(stored->size, tile->size);
+    if (has_xattr)
+    {
+        // Sent from the file, not read or kept in memory
+        ASSERT_GE(tile->fd, 0);
+        EXPECT_TRUE(tile->data.empty());
+        EXPECT_EQ(0u, cache.get_stats().entries);
+
+        std::vector<uint8_t> data(tile->size);
+        EXPECT_EQ(ssize_t(data.size()), pread(tile->fd, data.data(), data.size(), 0));
+        EXPECT_EQ(stored->data, data);
+    }
+    else
+    {
+        EXPECT_EQ(-1, tile->fd);
+        EXPECT_EQ(stored->data, tile->data);
+    }
+
+    // Read in when a file isn't wanted, and kept in memory from then on
+    tile_cache reader;
+    open_cache(reader, dir, "1");
+    tile = reader.get(key);
+    ASSERT_NE(nullptr, tile);
+    EXPECT_EQ(-1, tile->fd);
+    EXPECT_EQ(stored->data, tile->data);
+    EXPECT_EQ(stored->etag, tile->etag);
+    EXPECT_EQ(1u, reader.get_stats().entries);
+    fs::remove_all(dir);
+}
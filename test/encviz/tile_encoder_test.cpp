@@ -0,0 +1,256 @@
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <vector>
+#include <png.h>
+#include <gtest/gtest.h>
+#include <encviz/tile_encoder.h>
+using namespace testing;
+using namespace encviz;
+
+/// Decoded PNG, without any libpng transforms
+struct decoded_png
+{
+    int width{0}, height{0}, color_type{0};
+    std::vector<png_color> palette;
+    std::vector<uint8_t> trns;
+    std::vector<uint8_t> pixels;  // indices or RGBA
+};
+
+/// Encoded bytes being read back
+struct png_source
+{
+    const std::vector<uint8_t> *data;
+    std::size_t offset;
+};
+
+static void png_read_vector(png_structp png, png_bytep buf, png_size_t len)
+{
+    png_source *src = (png_source*)png_get_io_ptr(png);
+    if (src->offset + len > src->data->size())
+    {
+        png_error(png, "read past end");
+    }
+    memcpy(buf, src->data->data() + src->offset, len);
+    src->offset += len;
+}
+
+static bool decode_png(const std::vector<uint8_t> &data, decoded_png &out)
+{
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png_create_info_struct(png);
+    std::vector<png_bytep> rows;
+    if (setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_read_struct(&png, &info, nullptr);
+        return false;
+    }
+
+    png_source src{&data, 0};
+    png_set_read_fn(png, &src, png_read_vector);
+    png_read_info(png, info);
+    out.width = png_get_image_width(png, info);
+    out.height = png_get_image_height(png, info);
+    out.color_type = png_get_color_type(png, info);
+
+    png_colorp plte = nullptr;
+    int nplte = 0;
+    if (png_get_PLTE(png, info, &plte, &nplte))
+    {
+        out.palette.assign(plte, plte + nplte);
+    }
+    png_bytep trns = nullptr;
+    int ntrns = 0;
+    if (png_get_tRNS(png, info, &trns, &ntrns, nullptr) && trns != nullptr)
+    {
+        out.trns.assign(trns, trns + ntrns);
+    }
+
+    std::size_t row_bytes = png_get_rowbytes(png, info);
+    out.pixels.resize(row_bytes * out.height);
+    for (int row = 0; row < out.height; row++)
+    {
+        rows.push_back(out.pixels.data() + row * row_bytes);
+    }
+    png_read_image(png, rows.data());
+    png_read_end(png, nullptr);
+    png_destroy_read_struct(&png, &info, nullptr);
+    return true;
+}
+
+/// Straight alpha color to native endian premultiplied ARGB32
+static uint32_t premultiply(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+{
+    auto mul = [a](uint32_t c) { return (c * a + 127) / 255; };
+    return (uint32_t(a) << 24) | (mul(r) << 16) | (mul(g) << 8) | mul(b);
+}
+
+/// Palette color of a decoded pixel, alpha from tRNS
+static std::vector<int> palette_rgba(const decoded_png &png, int x, int y)
+{
+    uint8_t index = png.pixels[std::size_t(y) * png.width + x];
+    const png_color &c = png.palette.at(index);
+    int alpha = (index < png.trns.size()) ? png.trns[index] : 255;
+    return {c.red, c.green, c.blue, alpha};
+}
+
+static tile_encoder palette_encoder()
+{
+    tile_encoder encoder;
+    tile_encoder::options opts;
+    opts.png_palette = true;
+    encoder.set_options(opts);
+    return encoder;
+}
+
+TEST(tile_encoder, palette_exact_under_256_colors)
+{
+    // 200 opaque colors plus transparency, all kept as is
+    int width = 16, height = 16;
+    std::vector<uint32_t> pixels(width * height);
+    for (int i = 0; i < width * height; i++)
+    {
+        pixels[i] = (i < 200) ? premultiply(i, 255 - i, i / 2, 255) : 0;
+    }
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(palette_encoder().encode(data, (const uint8_t*)pixels.data(),
+                                         width, height, width * 4, tile_format::PNG));
+    decoded_png png;
+    ASSERT_TRUE(decode_png(data, png));
+    EXPECT_EQ(PNG_COLOR_TYPE_PALETTE, png.color_type);
+    EXPECT_EQ(201u, png.palette.size());
+
+    for (int i = 0; i < width * height; i++)
+    {
+        std::vector<int> expect = {0, 0, 0, 0};
+        if (i < 200)
+        {
+            expect = {i, 255 - i, i / 2, 255};
+        }
+        EXPECT_EQ(expect, palette_rgba(png, i % width, i / width)) << "pixel " << i;
+    }
+}
+
+TEST(tile_encoder, palette_nearest_color_over_256)
+{
+    // 256 common reds fill the palette, rare colors one step off map to them
+    int width = 256, height = 3;
+    std::vector<uint32_t> pixels(width * height);
+    for (int x = 0; x < width; x++)
+    {
+        pixels[x] = pixels[width + x] = premultiply(x, 0, 0, 255);
+        pixels[2 * width + x] = premultiply(x, (x < 64) ? 1 : 0, 0, 255);
+    }
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(palette_encoder().encode(data, (const uint8_t*)pixels.data(),
+                                         width, height, width * 4, tile_format::PNG));
+    decoded_png png;
+    ASSERT_TRUE(decode_png(data, png));
+    EXPECT_EQ(PNG_COLOR_TYPE_PALETTE, png.color_type);
+    EXPECT_EQ(256u, png.palette.size());
+
+    for (int x = 0; x < width; x++)
+    {
+        std::vector<int> expect = {x, 0, 0, 255};
+        EXPECT_EQ(expect, palette_rgba(png, x, 0));
+        EXPECT_EQ(expect, palette_rgba(png, x, 2)) << "column " << x;
+    }
+}
+
+TEST(tile_encoder, palette_translucent_first)
+{
+    // Opaque and translucent colors interleaved
+    int width = 8, height = 2;
+    std::vector<uint32_t> pixels(width * height);
+    std::set<uint8_t> translucent;
+    auto alpha_of = [](int i) { return (i == 5) ? 0 : (i % 3 == 0) ? 255 : 60 + 10 * i; };
+    for (int i = 0; i < width * height; i++)
+    {
+        uint8_t alpha = alpha_of(i);
+        pixels[i] = premultiply(255, 255, 255, alpha);
+        if (alpha != 255)
+        {
+            translucent.insert(alpha);
+        }
+    }
+
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(palette_encoder().encode(data, (const uint8_t*)pixels.data(),
+                                         width, height, width * 4, tile_format::PNG));
+    decoded_png png;
+    ASSERT_TRUE(decode_png(data, png));
+    ASSERT_EQ(translucent.size(), png.trns.size());
+    EXPECT_EQ(translucent.size() + 1, png.palette.size());
+
+    // tRNS covers exactly the translucent entries, the opaque one follows
+    std::set<uint8_t> trns(png.trns.begin(), png.trns.end());
+    EXPECT_EQ(translucent, trns);
+    for (int i = 0; i < width * height; i++)
+    {
+        EXPECT_EQ(alpha_of(i), palette_rgba(png, i % width, i / width)[3]) << "pixel " << i;
+    }
+}
+
+TEST(tile_encoder, rgba_unpremultiplies_alpha)
+{
+    // Padded rows, as cairo may hand over
+    int width = 6, height = 3, stride = 8 * 4;
+    std::vector<uint32_t> pixels(stride / 4 * height, 0xdeadbeef);
+    const uint8_t alphas[] = {255, 200, 128, 64, 1, 0};
+    for (int row = 0; row < height; row++)
+    {
+        for (int col = 0; col < width; col++)
+        {
+            uint8_t a = alphas[col];
+            uint32_t px = 0;
+            if (row == 0)
+            {
+                px = premultiply(255, 255, 255, a);
+            }
+            else if (a != 0)
+            {
+                px = premultiply(200, 100, 30, a);
+            }
+            pixels[row * stride / 4 + col] = px;
+        }
+    }
+
+    tile_encoder encoder;
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(encoder.encode(data, (const uint8_t*)pixels.data(),
+                               width, height, stride, tile_format::PNG));
+    decoded_png png;
+    ASSERT_TRUE(decode_png(data, png));
+    EXPECT_EQ(PNG_COLOR_TYPE_RGB_ALPHA, png.color_type);
+    ASSERT_EQ(width, png.width);
+
+    for (int row = 0; row < height; row++)
+    {
+        for (int col = 0; col < width; col++)
+        {
+            const uint8_t *px = png.pixels.data() + (row * width + col) * 4;
+            uint8_t a = alphas[col];
+            EXPECT_EQ(a, px[3]);
+            if (a == 0)
+            {
+                // Fully transparent pixels carry no color
+                EXPECT_EQ(0, px[0] | px[1] | px[2]);
+            }
+            else if (row == 0)
+            {
+                // White survives any alpha
+                EXPECT_EQ(255, px[0]);
+                EXPECT_EQ(255, px[1]);
+                EXPECT_EQ(255, px[2]);
+            }
+            else if (a >= 128)
+            {
+                EXPECT_NEAR(200, px[0], 1);
+                EXPECT_NEAR(100, px[1], 1);
+                EXPECT_NEAR(30, px[2], 1);
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <gtest/gtest.h>
+#include <encviz/tile_prefetcher.h>
+using namespace testing;
+using namespace encviz;
+
+static tile_key make_key(int z, int x, int y)
+{
+    tile_key key;
+    key.style = "default";
+    key.z = z;
+    key.x = x;
+    key.y = y;
+    return key;
+}
+
+static bool has_tile(const std::vector<tile_key> &tiles, int z, int x, int y)
+{
+    return std::any_of(tiles.begin(), tiles.end(), [&](const tile_key &t) {
+        return t.z == z && t.x == x && t.y == y;
+    });
+}
+
+TEST(tile_prefetcher, around_neighbors_then_children)
+{
+    std::vector<tile_key> tiles = tile_prefetcher::around(make_key(4, 5, 6), 30);
+    ASSERT_EQ(12u, tiles.size());
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            EXPECT_EQ(dx != 0 || dy != 0, has_tile(tiles, 4, 5 + dx, 6 + dy));
+        }
+    }
+    EXPECT_TRUE(has_tile(tiles, 5, 10, 12));
+    EXPECT_TRUE(has_tile(tiles, 5, 11, 12));
+    EXPECT_TRUE(has_tile(tiles, 5, 10, 13));
+    EXPECT_TRUE(has_tile(tiles, 5, 11, 13));
+    for (std::size_t i = 0; i < 8; i++)
+    {
+        EXPECT_EQ(4, tiles[i].z);
+    }
+}
+
+TEST(tile_prefetcher, around_edges)
+{
+    // Wraps east-west, stops at the poles
+    std::vector<tile_key> tiles = tile_prefetcher::around(make_key(2, 0, 0), 30);
+    EXPECT_TRUE(has_tile(tiles, 2, 3, 0));
+    EXPECT_TRUE(has_tile(tiles, 2, 3, 1));
+    EXPECT_FALSE(std::any_of(tiles.begin(), tiles.end(), [](const tile_key &t) {
+        return t.y < 0;
+    }));
+    EXPECT_EQ(5u + 4u, tiles.size());
+
+    // Whole world tile has no neighbors, deepest zoom no children
+    EXPECT_EQ(4u, tile_prefetcher::around(make_key(0, 0, 0), 30).size());
+    EXPECT_EQ(8u, tile_prefetcher::around(make_key(30, 5, 5), 30).size());
+}
+
+TEST(tile_prefetcher, rate_limited_per_client)
+{
+    std::atomic<int> fetched{0};
+    worker_pool pool(2, 64);
+    tile_prefetcher::options opts;
+    opts.rate = 0.001;
+    opts.burst = 5;
+    tile_prefetcher prefetch(pool, [&](const tile_key &) { fetched++; }, opts);
+
+    // Budget caps the first client, a second has its own
+    prefetch.requested("a", make_key(10, 100, 100));
+    prefetch.requested("a", make_key(10, 200, 200));
+    prefetch.requested("b", make_key(10, 300, 300));
+
+    for (int i = 0; i < 200 && fetched < 10; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(10, fetched);
+
+    tile_prefetcher::stats stats = prefetch.get_stats();
+    EXPECT_EQ(10u, stats.queued);
+    EXPECT_EQ(3u * 12u - 10u, stats.limited);
+    pool.shutdown();
+}
+
+TEST(tile_prefetcher, full_table_forgets_longest_idle)
+{
+    worker_pool pool(2, 64);
+    tile_prefetcher::options opts;
+    opts.rate = 0.001;
+    opts.burst = 5;
+    opts.max_clients = 2;
+    tile_prefetcher prefetch(pool, [](const tile_key &) {}, opts);
+
+    // A third client pushes out the first, not every spent budget
+    prefetch.requested("a", make_key(10, 100, 100));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    prefetch.requested("b", make_key(10, 200, 200));
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    prefetch.requested("c", make_key(10, 300, 300));
+    EXPECT_EQ(3u * 7u, prefetch.get_stats().limited);
+
+    prefetch.requested("b", make_key(10, 400, 400));
+    EXPECT_EQ(3u * 7u + 12u, prefetch.get_stats().limited);
+
+    prefetch.requested("a", make_key(10, 500, 500));
+    EXPECT_EQ(3u * 7u + 12u + 7u, prefetch.get_stats().limited);
+    pool.shutdown();
+}
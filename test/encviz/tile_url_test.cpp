@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <encviz/tile_url.h>
+using namespace testing;
+using namespace encviz;
+
+TEST(tile_url, parses_tile)
+{
+    tile_url url;
+    ASSERT_EQ(tile_url_status::OK, parse_tile_url("/default/12/1530/1240.png", url));
+    EXPECT_EQ("default", url.style);
+    EXPECT_EQ(12, url.z);
+    EXPECT_EQ(1530, url.y);
+    EXPECT_EQ(1240, url.x);
+    EXPECT_EQ(tile_format::PNG, url.format);
+
+    ASSERT_EQ(tile_url_status::OK, parse_tile_url("/night_1/0/0/0.pbf", url));
+    EXPECT_EQ("night_1", url.style);
+    EXPECT_EQ(tile_format::MVT, url.format);
+
+    // No extension is PNG
+    ASSERT_EQ(tile_url_status::OK, parse_tile_url("/default/3/7/5", url));
+    EXPECT_EQ(5, url.x);
+    EXPECT_EQ(tile_format::PNG, url.format);
+}
+
+TEST(tile_url, rejects_invalid)
+{
+    const char *paths[] = {
+        "", "/", "default/1/0/0.png", "/default/1/0", "/default/1/0/0/0.png",
+        "/default/1/0/0.png/", "//1/0/0.png", "/../1/0/0.png", "/a.b/1/0/0.png",
+        "/default/x/0/0.png", "/default/1/-1/0.png", "/default/1/0/+0.png",
+        "/default/1/0/0x.png", "/default/1/0/.png", "/default/1//0.png",
+        "/default/1/0/99999999999999999999.png",
+    };
+    for (const char *path : paths)
+    {
+        tile_url url;
+        EXPECT_EQ(tile_url_status::INVALID, parse_tile_url(path, url)) << path;
+    }
+}
+
+TEST(tile_url, rejects_out_of_range)
+{
+    tile_url url;
+    EXPECT_EQ(tile_url_status::OK, parse_tile_url("/default/2/3/3.png", url));
+    EXPECT_EQ(tile_url_status::OUT_OF_RANGE, parse_tile_url("/default/2/4/3.png", url));
+    EXPECT_EQ(tile_url_status::OUT_OF_RANGE, parse_tile_url("/default/2/3/4.png", url));
+    EXPECT_EQ(tile_url_status::OUT_OF_RANGE, parse_tile_url("/default/0/1/0.png", url));
+    EXPECT_EQ(tile_url_status::OUT_OF_RANGE, parse_tile_url("/default/31/0/0.png", url));
+    EXPECT_EQ(tile_url_status::OK, parse_tile_url("/default/30/1073741823/0.png", url));
+}
+
+TEST(tile_url, rejects_unknown_format)
+{
+    tile_url url;
+    EXPECT_EQ(tile_url_status::UNKNOWN_FORMAT, parse_tile_url("/default/1/0/0.jpg", url));
+    EXPECT_EQ(tile_url_status::UNKNOWN_FORMAT, parse_tile_url("/default/1/0/0.", url));
+}
@@ -1,4 +1,5 @@
 #include <array>
+#include <cmath>
 #include <vector>
 #include <gtest/gtest.h>
 #include <encviz/web_mercator.h>
@@ -88,3 +89,69 @@ TEST(web_mercator, testcases)
 	}
     }
 }
+
+TEST(web_mercator, metatile)
+{
+    // 4x4 block from the Florida tile, in both tile coordinate systems
+    web_mercator meta(8, 16, 5, tile_coords::XYZ, 256, 4);
+    web_mercator meta_wtms(8, 15 - 4 + 1, 5, tile_coords::WTMS, 256, 4);
+    web_mercator first(8, 16, 5);
+    web_mercator last(11, 19, 5);
+
+    OGREnvelope bb = meta.get_bbox_meters();
+    OGREnvelope bb_wtms = meta_wtms.get_bbox_meters();
+    ASSERT_NEAR(bb.MinX, first.get_bbox_meters().MinX, 1e-6);
+    ASSERT_NEAR(bb.MinY, first.get_bbox_meters().MinY, 1e-6);
+    ASSERT_NEAR(bb.MaxX, last.get_bbox_meters().MaxX, 1e-6);
+    ASSERT_NEAR(bb.MaxY, last.get_bbox_meters().MaxY, 1e-6);
+    ASSERT_NEAR(bb.MinY, bb_wtms.MinY, 1e-6);
+    ASSERT_NEAR(bb.MaxY, bb_wtms.MaxY, 1e-6);
+
+    // Same resolution as single tiles, one tile per 256 pixels
+    coord c = meta.meters_to_pixels({last.get_bbox_meters().MinX,
+                                     last.get_bbox_meters().MaxY});
+    ASSERT_NEAR(c.x, 3 * 256, 1e-3);
+    ASSERT_NEAR(c.y, 0, 1e-3);
+}
+
+TEST(web_mercator, batch)
+{
+    // Dense lines at both ends of the map, where Mercator is steepest
+    for (int z : {0, 8, 20})
+    {
+        int n = 1 << z;
+        web_mercator wm(n / 3, n / 2, z);
+        std::vector<coord> in;
+        for (int i = 0; i <= 100000; i++)
+        {
+            in.push_back({-180 + 360.0 * i / 100000, -85.0511 + 2 * 85.0511 * i / 100000});
+        }
+
+        // Poles and beyond take the exact path
+        in.push_back({10, 89});
+        in.push_back({-10, -90});
+        in.push_back({0, 85.06});
+
+        std::vector<coord> out(in.size());
+        wm.deg_to_pixels(in.data(), out.data(), in.size());
+        for (std::size_t i = 0; i < in.size(); i++)
+        {
+            coord c = wm.meters_to_pixels(wm.deg_to_meters(in[i]));
+            if (i > 100000)
+            {
+                ASSERT_EQ(out[i].x, c.x);
+                ASSERT_EQ(out[i].y, c.y);
+            }
+            else
+            {
+                ASSERT_NEAR(out[i].x, c.x, 1e-6 * std::fabs(c.x) + 1e-6);
+                ASSERT_NEAR(out[i].y, c.y, 1e-2);
+            }
+        }
+
+        // In place
+        wm.deg_to_pixels(in.data(), in.data(), in.size());
+        ASSERT_EQ(in[500].x, out[500].x);
+        ASSERT_EQ(in[500].y, out[500].y);
+    }
+}